@@ -0,0 +1,558 @@
+/*--------------------------------------------------------------------*/
+/* treeCore.h                                                         */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+/*
+  The traversal, lookup, prefix-chain insertion and serialization
+  logic that every tree in this assignment needs, written once as a
+  template. A tree implementation defines the macros below and then
+  includes this file, which defines static functions specialized to
+  its node type, named by TREECORE_FN. Because it is a template it
+  has no include guard, and must be included at most once per file.
+
+  Required macros:
+    TREECORE_NODE               the node type (a pointer type)
+    TREECORE_FN(name)           the name to give the function "name",
+                                e.g. DT_core##name
+    TREECORE_GET_PATH(n)        node n's absolute Path_T; or, for
+                                nodes that keep only their last
+                                component, all three of:
+      TREECORE_NAME(n)          the characters of n's last component
+      TREECORE_NAME_LENGTH(n)   how many characters that is
+      TREECORE_DEPTH(n)         n's depth, 1 for the root
+    TREECORE_FIND_CHILD(n, oPPath, poNChild)
+                                TRUE if n has a child with path
+                                oPPath, which is stored in *poNChild;
+                                FALSE otherwise (not needed if
+                                TREECORE_FIND_CHILD_PREFIX is defined)
+    TREECORE_NUM_CHILDREN(n)    how many children n has
+    TREECORE_GET_CHILD(n, i)    child i of n, in the order that
+                                toString lists them
+    TREECORE_NEW_NODE(oPPath, oNParent, bIsLast, pvExtra, poNResult)
+                                creates the node with path oPPath
+                                under oNParent (NULL for the root),
+                                stores it in *poNResult and returns
+                                SUCCESS, or returns an error status;
+                                bIsLast is TRUE for the last node of
+                                an insertion, and pvExtra is what the
+                                caller passed to insert
+    TREECORE_FREE(n)            frees the subtree rooted at n and
+                                returns the number of nodes freed
+
+  Optional macros:
+    TREECORE_IS_LEAF(n)         TRUE if n may never have children
+                                (an FT file); FALSE if undefined
+    TREECORE_FANOUT             the most children a node may have;
+                                unlimited if undefined
+    TREECORE_LABEL(n)           a string that toString puts before
+                                n's path; "" if undefined
+    TREECORE_VISIT(n)           a statement run with the node at which
+                                each successful traversal ends
+    TREECORE_RESUME(oPPath, poNCurr)
+                                a statement run before each traversal
+                                towards oPPath goes down from the root
+                                *poNCurr; it may replace *poNCurr with
+                                a deeper node, not a leaf, whose path
+                                is a prefix of oPPath, to go on from
+                                there instead; needs TREECORE_GET_PATH
+    TREECORE_FIND_CHILD_PREFIX(n, pcPath, ulLength, poNChild)
+                                as TREECORE_FIND_CHILD, but for the
+                                path made of the first ulLength
+                                characters of pcPath; if defined,
+                                traversals use it instead, and need
+                                not build a Path_T for every level
+    TREECORE_PREFETCH(n)        a statement run with each node that a
+                                traversal reaches, before it is used,
+                                which may start loading what looking
+                                up n's children will read
+    TREECORE_BATCH              if defined, findBatch is generated too
+    TREECORE_GROUP              how many lookups findBatch interleaves;
+                                8 if undefined
+
+  The including file must already include a4def.h and path.h.
+*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef TREECORE_IS_LEAF
+#define TREECORE_IS_LEAF(n) FALSE
+#endif
+#ifndef TREECORE_LABEL
+#define TREECORE_LABEL(n) ""
+#endif
+#ifndef TREECORE_VISIT
+#define TREECORE_VISIT(n)
+#endif
+#ifndef TREECORE_PREFETCH
+#define TREECORE_PREFETCH(n)
+#endif
+#ifndef TREECORE_GROUP
+#define TREECORE_GROUP 8
+#endif
+
+/* TREECORE_HEADS(n, oPPath) is TRUE if root n's path is the first
+   component of oPPath */
+#ifdef TREECORE_GET_PATH
+#define TREECORE_DEPTH(n) Path_getDepth(TREECORE_GET_PATH(n))
+#define TREECORE_HEADS(n, oPPath) \
+   (Path_getSharedPrefixDepth(TREECORE_GET_PATH(n), (oPPath)) >= 1)
+#else
+#define TREECORE_HEADS(n, oPPath) \
+   (TREECORE_NAME_LENGTH(n) == strcspn(Path_getPathname(oPPath), "/") && \
+    memcmp(TREECORE_NAME(n), Path_getPathname(oPPath), \
+           TREECORE_NAME_LENGTH(n)) == 0)
+#endif
+
+/*
+  Advances a traversal towards absolute path oPPath by one level: from
+  *poNCurr, at depth ulLevel - 1, to its child with oPPath's prefix of
+  depth ulLevel, if there is one. *pulPrefixLength is the length of
+  oPPath's prefix of depth ulLevel - 1, and is advanced to that of the
+  prefix of depth ulLevel. Returns SUCCESS and sets *pbMoved to
+  whether *poNCurr moved down, or returns:
+  * NOT_A_DIRECTORY if *poNCurr is a leaf
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+static int TREECORE_FN(step)(Path_T oPPath, size_t ulLevel,
+                             size_t *pulPrefixLength,
+                             TREECORE_NODE *poNCurr, boolean *pbMoved) {
+   TREECORE_NODE oNChild = NULL;
+   boolean bFound;
+#ifdef TREECORE_FIND_CHILD_PREFIX
+   const char *pcPath = Path_getPathname(oPPath);
+   size_t ulLength = *pulPrefixLength + 1;
+#else
+   int iStatus;
+   Path_T oPPrefix = NULL;
+#endif
+
+   *pbMoved = FALSE;
+   if(TREECORE_IS_LEAF(*poNCurr))
+      return NOT_A_DIRECTORY;
+
+#ifdef TREECORE_FIND_CHILD_PREFIX
+   (void) ulLevel;
+   /* the prefix one level deeper ends at the next '/' or the end */
+   while(pcPath[ulLength] != '/' && pcPath[ulLength] != '\0')
+      ulLength++;
+   *pulPrefixLength = ulLength;
+   bFound = TREECORE_FIND_CHILD_PREFIX(*poNCurr, pcPath, ulLength,
+                                       &oNChild);
+#else
+   (void) pulPrefixLength;
+   iStatus = Path_prefix(oPPath, ulLevel, &oPPrefix);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   bFound = TREECORE_FIND_CHILD(*poNCurr, oPPrefix, &oNChild);
+   Path_free(oPPrefix);
+#endif
+
+   if(bFound) {
+      /* start loading the next level while this one is finished and
+         the next prefix is found */
+      TREECORE_PREFETCH(oNChild);
+      *poNCurr = oNChild;
+      *pbMoved = TRUE;
+   }
+   return SUCCESS;
+}
+
+/*
+  Traverses the tree rooted at oNRoot as far as possible towards
+  absolute path oPPath. If able to traverse, returns an int SUCCESS
+  status and sets *poNFurthest to the furthest node reached (which may
+  be only a prefix of oPPath, or even NULL if oNRoot is NULL).
+  Otherwise, sets *poNFurthest to NULL and returns with status:
+  * CONFLICTING_PATH if the root's path is not a prefix of oPPath
+  * NOT_A_DIRECTORY if a proper prefix of oPPath is a leaf
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+static int TREECORE_FN(traverse)(TREECORE_NODE oNRoot, Path_T oPPath,
+                                 TREECORE_NODE *poNFurthest) {
+   int iStatus;
+   TREECORE_NODE oNCurr;
+   boolean bMoved;
+   size_t ulDepth;
+   size_t ulLevel;
+   size_t ulPrefixLength;
+
+   assert(oPPath != NULL);
+   assert(poNFurthest != NULL);
+
+   *poNFurthest = NULL;
+
+   /* root is NULL -> won't find anything */
+   if(oNRoot == NULL)
+      return SUCCESS;
+
+   if(!TREECORE_HEADS(oNRoot, oPPath))
+      return CONFLICTING_PATH;
+
+   oNCurr = oNRoot;
+   ulDepth = Path_getDepth(oPPath);
+   ulLevel = 2;
+   ulPrefixLength = strcspn(Path_getPathname(oPPath), "/");
+#ifdef TREECORE_RESUME
+   TREECORE_RESUME(oPPath, &oNCurr);
+   if(oNCurr != oNRoot) {
+      assert(!TREECORE_IS_LEAF(oNCurr));
+      ulLevel = Path_getDepth(TREECORE_GET_PATH(oNCurr)) + 1;
+      ulPrefixLength = Path_getStrLength(TREECORE_GET_PATH(oNCurr));
+   }
+#endif
+   for(; ulLevel <= ulDepth; ulLevel++) {
+      iStatus = TREECORE_FN(step)(oPPath, ulLevel, &ulPrefixLength,
+                                  &oNCurr, &bMoved);
+      if(iStatus != SUCCESS)
+         return iStatus;
+      /* oNCurr doesn't have the next prefix as a child:
+         this is as far as we can go */
+      if(!bMoved)
+         break;
+   }
+
+   TREECORE_VISIT(oNCurr);
+   *poNFurthest = oNCurr;
+   return SUCCESS;
+}
+
+/*
+  Finds the node with absolute path pcPath in the tree rooted at
+  oNRoot. Returns an int SUCCESS status and sets *poNResult to be the
+  node, if found. Otherwise, sets *poNResult to NULL and returns with
+  status:
+  * BAD_PATH if pcPath does not represent a well-formatted path
+  * CONFLICTING_PATH if the root's path is not a prefix of pcPath
+  * NOT_A_DIRECTORY if a proper prefix of pcPath is a leaf
+  * NO_SUCH_PATH if no node with pcPath exists in the hierarchy
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+static int TREECORE_FN(find)(TREECORE_NODE oNRoot, const char *pcPath,
+                             TREECORE_NODE *poNResult) {
+   Path_T oPPath = NULL;
+   TREECORE_NODE oNFound = NULL;
+   int iStatus;
+
+   assert(pcPath != NULL);
+   assert(poNResult != NULL);
+
+   *poNResult = NULL;
+
+   iStatus = Path_new(pcPath, &oPPath);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   iStatus = TREECORE_FN(traverse)(oNRoot, oPPath, &oNFound);
+   if(iStatus == SUCCESS &&
+      (oNFound == NULL ||
+       TREECORE_DEPTH(oNFound) != Path_getDepth(oPPath)))
+      iStatus = NO_SUCH_PATH;
+
+   Path_free(oPPath);
+   if(iStatus == SUCCESS)
+      *poNResult = oNFound;
+   return iStatus;
+}
+
+/*
+  Finds the nodes with the ulCount absolute paths in ppcPaths in the
+  tree rooted at oNRoot, as find would, storing the node for
+  ppcPaths[i] (or NULL) in poNResults[i] and find's status in
+  piStatus[i].
+
+  The lookups are run TREECORE_GROUP at a time, taking each lookup in
+  a group one level down before taking any of them a second level
+  down. TREECORE_PREFETCH's loads for one lookup are then under way
+  while the others in its group do their own work, instead of each
+  level of one lookup waiting for the memory the previous level
+  asked for.
+*/
+#ifdef TREECORE_BATCH
+static void TREECORE_FN(findBatch)(TREECORE_NODE oNRoot,
+                                   const char *const *ppcPaths,
+                                   size_t ulCount,
+                                   TREECORE_NODE *poNResults,
+                                   int *piStatus) {
+   Path_T aoPPaths[TREECORE_GROUP];
+   TREECORE_NODE aoNCurr[TREECORE_GROUP];
+   size_t aulPrefixLengths[TREECORE_GROUP];
+   boolean abActive[TREECORE_GROUP];
+   size_t ulFirst, ulInGroup, ulIndex, ulLevel, ulActive;
+   boolean bMoved;
+   int iStatus;
+
+   assert(ppcPaths != NULL || ulCount == 0);
+   assert(poNResults != NULL || ulCount == 0);
+   assert(piStatus != NULL || ulCount == 0);
+
+   for(ulFirst = 0; ulFirst < ulCount; ulFirst += ulInGroup) {
+      ulInGroup = ulCount - ulFirst < TREECORE_GROUP ? ulCount - ulFirst
+                                                     : TREECORE_GROUP;
+
+      /* start every lookup in the group at the root */
+      ulActive = 0;
+      for(ulIndex = 0; ulIndex < ulInGroup; ulIndex++) {
+         assert(ppcPaths[ulFirst + ulIndex] != NULL);
+         poNResults[ulFirst + ulIndex] = NULL;
+         aoPPaths[ulIndex] = NULL;
+         abActive[ulIndex] = FALSE;
+         iStatus = Path_new(ppcPaths[ulFirst + ulIndex], &aoPPaths[ulIndex]);
+         if(iStatus == SUCCESS && oNRoot == NULL)
+            iStatus = NO_SUCH_PATH;
+         else if(iStatus == SUCCESS &&
+                 !TREECORE_HEADS(oNRoot, aoPPaths[ulIndex]))
+            iStatus = CONFLICTING_PATH;
+         piStatus[ulFirst + ulIndex] = iStatus;
+         if(iStatus == SUCCESS) {
+            aoNCurr[ulIndex] = oNRoot;
+            aulPrefixLengths[ulIndex] =
+               strcspn(Path_getPathname(aoPPaths[ulIndex]), "/");
+            abActive[ulIndex] = TRUE;
+            ulActive++;
+         }
+      }
+
+      /* take each unfinished lookup one level further per round */
+      for(ulLevel = 2; ulActive > 0; ulLevel++)
+         for(ulIndex = 0; ulIndex < ulInGroup; ulIndex++) {
+            if(!abActive[ulIndex])
+               continue;
+            bMoved = FALSE;
+            iStatus = SUCCESS;
+            if(ulLevel <= Path_getDepth(aoPPaths[ulIndex]))
+               iStatus = TREECORE_FN(step)(aoPPaths[ulIndex], ulLevel,
+                                           &aulPrefixLengths[ulIndex],
+                                           &aoNCurr[ulIndex], &bMoved);
+            if(bMoved)
+               continue;
+
+            /* this lookup has gone as far as it can */
+            abActive[ulIndex] = FALSE;
+            ulActive--;
+            if(iStatus == SUCCESS) {
+               TREECORE_VISIT(aoNCurr[ulIndex]);
+               if(TREECORE_DEPTH(aoNCurr[ulIndex]) !=
+                  Path_getDepth(aoPPaths[ulIndex]))
+                  iStatus = NO_SUCH_PATH;
+               else
+                  poNResults[ulFirst + ulIndex] = aoNCurr[ulIndex];
+            }
+            piStatus[ulFirst + ulIndex] = iStatus;
+         }
+
+      for(ulIndex = 0; ulIndex < ulInGroup; ulIndex++)
+         if(aoPPaths[ulIndex] != NULL)
+            Path_free(aoPPaths[ulIndex]);
+   }
+}
+#endif
+
+/*
+  Inserts absolute path oPPath, and any of its prefixes that are
+  missing, into the tree rooted at *poNRoot, which holds *pulCount
+  nodes; creates each new node with TREECORE_NEW_NODE, passing it
+  pvExtra. On success updates *poNRoot and *pulCount and returns
+  SUCCESS. Otherwise leaves the tree as it was and returns:
+  * CONFLICTING_PATH if the root exists but is not a prefix of oPPath,
+                     or if a node would get more than TREECORE_FANOUT
+                     children
+  * NOT_A_DIRECTORY if a proper prefix of oPPath is a leaf
+  * ALREADY_IN_TREE if oPPath is already in the tree
+  * MEMORY_ERROR if memory could not be allocated to complete request
+  * any other status TREECORE_NEW_NODE returns
+*/
+static int TREECORE_FN(insert)(TREECORE_NODE *poNRoot, size_t *pulCount,
+                               Path_T oPPath, void *pvExtra) {
+   int iStatus;
+   TREECORE_NODE oNCurr = NULL;
+   TREECORE_NODE oNFirstNew = NULL;
+   size_t ulDepth, ulLevel;
+   size_t ulNewNodes = 0;
+
+   assert(poNRoot != NULL);
+   assert(pulCount != NULL);
+   assert(oPPath != NULL);
+   /* for trees whose TREECORE_NEW_NODE has no use for it */
+   (void) pvExtra;
+
+   /* find the closest ancestor of oPPath already in the tree */
+   iStatus = TREECORE_FN(traverse)(*poNRoot, oPPath, &oNCurr);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   /* the traversal follows oPPath's own prefixes, so reaching its
+      depth means reaching oPPath itself */
+   ulDepth = Path_getDepth(oPPath);
+   ulLevel = oNCurr == NULL ? 1 : TREECORE_DEPTH(oNCurr) + 1;
+   if(ulLevel > ulDepth)
+      return ALREADY_IN_TREE;
+   if(oNCurr != NULL && TREECORE_IS_LEAF(oNCurr))
+      return NOT_A_DIRECTORY;
+
+#ifdef TREECORE_FANOUT
+   /* new nodes below oNCurr each get only one child */
+   if(oNCurr != NULL && TREECORE_NUM_CHILDREN(oNCurr) >= TREECORE_FANOUT)
+      return CONFLICTING_PATH;
+#endif
+
+   /* starting at oNCurr, build rest of the path one level at a time */
+   for(; ulLevel <= ulDepth; ulLevel++) {
+      Path_T oPPrefix = NULL;
+      TREECORE_NODE oNNewNode = NULL;
+
+      iStatus = Path_prefix(oPPath, ulLevel, &oPPrefix);
+      if(iStatus == SUCCESS) {
+         iStatus = TREECORE_NEW_NODE(oPPrefix, oNCurr,
+                                     (boolean) (ulLevel == ulDepth),
+                                     pvExtra, &oNNewNode);
+         Path_free(oPPrefix);
+      }
+      if(iStatus != SUCCESS) {
+         /* freeing the first new node frees the ones below it */
+         if(oNFirstNew != NULL)
+            (void) TREECORE_FREE(oNFirstNew);
+         return iStatus;
+      }
+
+      oNCurr = oNNewNode;
+      ulNewNodes++;
+      if(oNFirstNew == NULL)
+         oNFirstNew = oNCurr;
+   }
+
+   if(*poNRoot == NULL)
+      *poNRoot = oNFirstNew;
+   *pulCount += ulNewNodes;
+   return SUCCESS;
+}
+
+/*
+  Returns the length of node oNNode's path, given that of its
+  parent's, ulParentLength, which is 0 for the root.
+*/
+static size_t TREECORE_FN(pathLength)(TREECORE_NODE oNNode,
+                                      size_t ulParentLength) {
+#ifdef TREECORE_GET_PATH
+   (void) ulParentLength;
+   return Path_getStrLength(TREECORE_GET_PATH(oNNode));
+#else
+   if(ulParentLength == 0)
+      return TREECORE_NAME_LENGTH(oNNode);
+   return ulParentLength + 1 + TREECORE_NAME_LENGTH(oNNode);
+#endif
+}
+
+/*
+  Writes node oNNode's path at pcAt, given its parent's path, the
+  ulParentLength characters at pcParent (none for the root). Returns
+  the byte after the path.
+*/
+static char *TREECORE_FN(writePath)(TREECORE_NODE oNNode,
+                                    const char *pcParent,
+                                    size_t ulParentLength, char *pcAt) {
+#ifdef TREECORE_GET_PATH
+   Path_T oPPath = TREECORE_GET_PATH(oNNode);
+
+   (void) pcParent;
+   (void) ulParentLength;
+   memcpy(pcAt, Path_getPathname(oPPath), Path_getStrLength(oPPath));
+   return pcAt + Path_getStrLength(oPPath);
+#else
+   if(ulParentLength > 0) {
+      memcpy(pcAt, pcParent, ulParentLength);
+      pcAt += ulParentLength;
+      *pcAt++ = '/';
+   }
+   memcpy(pcAt, TREECORE_NAME(oNNode), TREECORE_NAME_LENGTH(oNNode));
+   return pcAt + TREECORE_NAME_LENGTH(oNNode);
+#endif
+}
+
+/*
+  Returns the number of bytes toString needs for the subtree rooted
+  at oNNode, whose path is ulPathLength characters long, not counting
+  the final '\0'.
+*/
+static size_t TREECORE_FN(stringLength)(TREECORE_NODE oNNode,
+                                        size_t ulPathLength) {
+   size_t ulLength, ulChild, ulChildren;
+   TREECORE_NODE oNChild;
+
+   ulLength = strlen(TREECORE_LABEL(oNNode)) + ulPathLength + 1;
+   if(TREECORE_IS_LEAF(oNNode))
+      return ulLength;
+   ulChildren = TREECORE_NUM_CHILDREN(oNNode);
+   for(ulChild = 0; ulChild < ulChildren; ulChild++) {
+      oNChild = TREECORE_GET_CHILD(oNNode, ulChild);
+      ulLength += TREECORE_FN(stringLength)(
+                     oNChild, TREECORE_FN(pathLength)(oNChild,
+                                                      ulPathLength));
+   }
+   return ulLength;
+}
+
+/*
+  Writes one line per node of the subtree rooted at oNNode, in
+  pre-order, starting at pcAt; the ulParentLength characters at
+  pcParent are the path of oNNode's parent (none for the root).
+  Returns the byte after the last line.
+*/
+static char *TREECORE_FN(writeLines)(TREECORE_NODE oNNode,
+                                     const char *pcParent,
+                                     size_t ulParentLength, char *pcAt) {
+   const char *pcLabel = TREECORE_LABEL(oNNode);
+   size_t ulLength, ulChild, ulChildren;
+   const char *pcPath;
+
+   ulLength = strlen(pcLabel);
+   memcpy(pcAt, pcLabel, ulLength);
+   pcAt += ulLength;
+   /* the path just written is where the children find their
+      parent's */
+   pcPath = pcAt;
+   pcAt = TREECORE_FN(writePath)(oNNode, pcParent, ulParentLength, pcAt);
+   ulLength = (size_t) (pcAt - pcPath);
+   *pcAt++ = '\n';
+
+   if(TREECORE_IS_LEAF(oNNode))
+      return pcAt;
+   ulChildren = TREECORE_NUM_CHILDREN(oNNode);
+   for(ulChild = 0; ulChild < ulChildren; ulChild++)
+      pcAt = TREECORE_FN(writeLines)(TREECORE_GET_CHILD(oNNode, ulChild),
+                                     pcPath, ulLength, pcAt);
+   return pcAt;
+}
+
+/*
+  Returns a string with one line per node of the tree rooted at
+  oNRoot (which may be NULL), in pre-order, each line being the
+  node's TREECORE_LABEL followed by its path. Returns NULL if memory
+  could not be allocated. The caller owns the string.
+
+  The length is computed exactly first, so that every line is copied
+  once into its place rather than appended with strcat, which would
+  rescan the string so far for every node.
+*/
+static char *TREECORE_FN(toString)(TREECORE_NODE oNRoot) {
+   size_t ulLength = 0;
+   char *pcResult;
+   char *pcEnd;
+
+   if(oNRoot != NULL)
+      ulLength = TREECORE_FN(stringLength)(
+                    oNRoot, TREECORE_FN(pathLength)(oNRoot, 0));
+
+   pcResult = malloc(ulLength + 1);
+   if(pcResult == NULL)
+      return NULL;
+
+   pcEnd = pcResult;
+   if(oNRoot != NULL)
+      pcEnd = TREECORE_FN(writeLines)(oNRoot, NULL, 0, pcResult);
+   assert((size_t) (pcEnd - pcResult) == ulLength);
+   *pcEnd = '\0';
+   return pcResult;
+}
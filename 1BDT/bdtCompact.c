@@ -0,0 +1,396 @@
+/*--------------------------------------------------------------------*/
+/* bdtCompact.c                                                       */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+#include <stddef.h>
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "a4def.h"
+#include "path.h"
+#include "bdt.h"
+
+/*
+  A BDT implementation built for the fixed fanout of two. Every node
+  is one 32-byte record in a pool (a single growable array), holding
+  the pool indices of its parent and its at most two children and
+  its own path component, not its whole path; components of up to
+  INLINE_NAME - 1 characters are stored in the record itself. Freed
+  records go on a free list for reuse.
+
+  The traversal, insertion and toString logic is treeCore.h's, as
+  in the DT and FT, instantiated with a fanout of two and with nodes
+  that keep only their last component. Lookups match each component
+  of the path in place, without a Path_T per level.
+*/
+
+/* Pool index of a node; NONE means no node */
+typedef unsigned int NodeID;
+enum { NONE = 0 };
+
+/* A node as treeCore.h sees it: its pool index cast to a pointer,
+   which stays valid when the pool moves. Nothing looks behind one,
+   and NONE becomes NULL. */
+typedef struct nodeRef *NodeRef;
+#define NODE_ID(oNNode) ((NodeID) (size_t) (oNNode))
+#define NODE_REF(uNode) ((NodeRef) (size_t) (uNode))
+
+/* Components shorter than this are stored inside the node */
+enum { INLINE_NAME = 16 };
+
+/* Size of the pool when it is first allocated */
+enum { INITIAL_POOL = 64 };
+
+/* One directory. auChild[1] is only used if auChild[0] is. */
+struct node {
+   NodeID auChild[2];
+   /* parent, or the next free node while on the free list */
+   NodeID uParent;
+   /* length of the component */
+   unsigned int uNameLength;
+   union {
+      char acInline[INLINE_NAME];
+      char *pcHeap;
+   } uName;
+};
+
+/*
+  A Binary Directory Tree is a representation of a hierarchy of
+  directories, represented as an AO with 3 state variables:
+*/
+
+/* 1. a flag for being in an initialized state (TRUE) or not (FALSE) */
+static boolean bIsInitialized;
+/* 2. the root node in the hierarchy, or NULL */
+static NodeRef oNRoot;
+/* 3. a counter of the number of nodes in the hierarchy */
+static size_t ulCount;
+
+/* The pool; entry 0 is never used, so that NONE can mean no node */
+static struct node *psPool;
+/* Entries allocated in psPool, and entries used so far */
+static size_t ulPoolSize;
+static size_t ulPoolUsed;
+/* Head of the free list of recycled entries */
+static NodeID uFree;
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the characters of node uNode's component. */
+static const char *BDT_name(NodeID uNode) {
+   struct node *psNode = &psPool[uNode];
+
+   if(psNode->uNameLength < INLINE_NAME)
+      return psNode->uName.acInline;
+   return psNode->uName.pcHeap;
+}
+
+/*
+  Returns TRUE if node uNode's component is the ulLength characters
+  at pcName, FALSE otherwise.
+*/
+static boolean BDT_nameIs(NodeID uNode, const char *pcName,
+                          size_t ulLength) {
+   return (boolean) (psPool[uNode].uNameLength == ulLength &&
+                     memcmp(BDT_name(uNode), pcName, ulLength) == 0);
+}
+
+/*
+  Makes sure the pool has room for ulNeeded more nodes, on the free
+  list or at its end. Returns SUCCESS or MEMORY_ERROR; the pool is
+  unchanged on failure.
+*/
+static int BDT_reserve(size_t ulNeeded) {
+   size_t ulFree = 0, ulNewSize;
+   NodeID uNode;
+   struct node *psNew;
+
+   for(uNode = uFree; uNode != NONE && ulFree < ulNeeded;
+       uNode = psPool[uNode].uParent)
+      ulFree++;
+   if(ulPoolUsed + (ulNeeded - ulFree) <= ulPoolSize)
+      return SUCCESS;
+
+   ulNewSize = ulPoolSize ? ulPoolSize : INITIAL_POOL;
+   while(ulNewSize < ulPoolUsed + ulNeeded - ulFree)
+      ulNewSize *= 2;
+   if(ulNewSize - 1 > (NodeID) -1)
+      return MEMORY_ERROR;
+
+   psNew = realloc(psPool, ulNewSize * sizeof(struct node));
+   if(psNew == NULL)
+      return MEMORY_ERROR;
+   psPool = psNew;
+   ulPoolSize = ulNewSize;
+   return SUCCESS;
+}
+
+/*
+  Takes a node from the pool, which must have room (see BDT_reserve),
+  and gives it the ulLength-character component at pcName and parent
+  uParent. Returns the node, or NONE if a long component could not
+  be copied.
+*/
+static NodeID BDT_newNode(const char *pcName, size_t ulLength,
+                          NodeID uParent) {
+   NodeID uNode;
+   struct node *psNode;
+   char *pcCopy;
+
+   if(ulLength < INLINE_NAME)
+      pcCopy = NULL;
+   else if((pcCopy = malloc(ulLength + 1)) == NULL)
+      return NONE;
+
+   if(uFree != NONE) {
+      uNode = uFree;
+      uFree = psPool[uNode].uParent;
+   }
+   else {
+      if(ulPoolUsed == 0)
+         ulPoolUsed = 1;
+      uNode = (NodeID) ulPoolUsed++;
+   }
+   assert(uNode < ulPoolSize);
+
+   psNode = &psPool[uNode];
+   psNode->auChild[0] = NONE;
+   psNode->auChild[1] = NONE;
+   psNode->uParent = uParent;
+   psNode->uNameLength = (unsigned int) ulLength;
+   if(pcCopy == NULL)
+      pcCopy = psNode->uName.acInline;
+   else
+      psNode->uName.pcHeap = pcCopy;
+   memcpy(pcCopy, pcName, ulLength);
+   pcCopy[ulLength] = '\0';
+   return uNode;
+}
+
+/* Returns node uNode to the free list. */
+static void BDT_releaseNode(NodeID uNode) {
+   struct node *psNode = &psPool[uNode];
+
+   if(psNode->uNameLength >= INLINE_NAME)
+      free(psNode->uName.pcHeap);
+   psNode->uParent = uFree;
+   uFree = uNode;
+}
+
+/*
+  Frees the subtree rooted at uTop, which must already be detached
+  from its parent, without recursion. Returns the number of nodes
+  freed.
+*/
+static size_t BDT_freeSubtree(NodeID uTop) {
+   NodeID uNode = uTop, uParent;
+   size_t ulFreed = 0;
+
+   for(;;) {
+      struct node *psNode = &psPool[uNode];
+
+      /* descend to a leaf, detaching each child on the way down */
+      if(psNode->auChild[0] != NONE) {
+         NodeID uChild = psNode->auChild[0];
+         psNode->auChild[0] = psNode->auChild[1];
+         psNode->auChild[1] = NONE;
+         uNode = uChild;
+         continue;
+      }
+      uParent = psNode->uParent;
+      BDT_releaseNode(uNode);
+      ulFreed++;
+      if(uNode == uTop)
+         return ulFreed;
+      uNode = uParent;
+   }
+}
+
+/*
+  Detaches node uNode from its parent, moving a second child up to
+  be the first if uNode was the first.
+*/
+static void BDT_detach(NodeID uNode) {
+   struct node *psParent;
+
+   if(psPool[uNode].uParent == NONE)
+      return;
+   psParent = &psPool[psPool[uNode].uParent];
+   if(psParent->auChild[0] == uNode)
+      psParent->auChild[0] = psParent->auChild[1];
+   else
+      assert(psParent->auChild[1] == uNode);
+   psParent->auChild[1] = NONE;
+}
+
+/* Returns the depth of node uNode, 1 for the root. */
+static size_t BDT_depth(NodeID uNode) {
+   size_t ulDepth = 0;
+
+   for(; uNode != NONE; uNode = psPool[uNode].uParent)
+      ulDepth++;
+   return ulDepth;
+}
+
+/* Returns how many children node uNode has. */
+static size_t BDT_numChildren(NodeID uNode) {
+   if(psPool[uNode].auChild[0] == NONE)
+      return 0;
+   return psPool[uNode].auChild[1] == NONE ? 1 : 2;
+}
+
+/*
+  Looks among node uNode's children for the one whose path is the
+  first ulLength characters of pcPath, comparing only its last
+  component. Returns TRUE and stores it in *poNChild if found, FALSE
+  otherwise.
+*/
+static boolean BDT_findChild(NodeID uNode, const char *pcPath,
+                             size_t ulLength, NodeRef *poNChild) {
+   size_t ulStart = ulLength;
+   int iChild;
+
+   while(ulStart > 0 && pcPath[ulStart - 1] != '/')
+      ulStart--;
+   for(iChild = 0; iChild < 2; iChild++) {
+      NodeID uChild = psPool[uNode].auChild[iChild];
+      if(uChild != NONE &&
+         BDT_nameIs(uChild, pcPath + ulStart, ulLength - ulStart)) {
+         *poNChild = NODE_REF(uChild);
+         return TRUE;
+      }
+   }
+   return FALSE;
+}
+
+/*
+  Makes the node with path oPPath as the last child of oNParent, or
+  as a lone root if oNParent is NULL, and stores it in *poNResult.
+  Returns SUCCESS or MEMORY_ERROR.
+*/
+static int BDT_newChild(Path_T oPPath, NodeRef oNParent,
+                        NodeRef *poNResult) {
+   const char *pcName;
+   NodeID uNew, uParent = NODE_ID(oNParent);
+
+   pcName = Path_getComponent(oPPath, Path_getDepth(oPPath) - 1);
+   if(BDT_reserve(1) != SUCCESS)
+      return MEMORY_ERROR;
+   uNew = BDT_newNode(pcName, strlen(pcName), uParent);
+   if(uNew == NONE)
+      return MEMORY_ERROR;
+   if(uParent != NONE) {
+      struct node *psParent = &psPool[uParent];
+      psParent->auChild[psParent->auChild[0] == NONE ? 0 : 1] = uNew;
+   }
+   *poNResult = NODE_REF(uNew);
+   return SUCCESS;
+}
+
+/* Detaches node uNode from its parent and frees its subtree. Returns
+   the number of nodes freed. */
+static size_t BDT_freeNode(NodeID uNode) {
+   BDT_detach(uNode);
+   return BDT_freeSubtree(uNode);
+}
+
+#define TREECORE_NODE NodeRef
+#define TREECORE_FN(name) BDT_core##name
+#define TREECORE_NAME(n) BDT_name(NODE_ID(n))
+#define TREECORE_NAME_LENGTH(n) ((size_t) psPool[NODE_ID(n)].uNameLength)
+#define TREECORE_DEPTH(n) BDT_depth(NODE_ID(n))
+#define TREECORE_FIND_CHILD_PREFIX(n, pcPath, ulLength, poNChild) \
+   BDT_findChild(NODE_ID(n), (pcPath), (ulLength), (poNChild))
+#define TREECORE_NUM_CHILDREN(n) BDT_numChildren(NODE_ID(n))
+#define TREECORE_GET_CHILD(n, i) NODE_REF(psPool[NODE_ID(n)].auChild[i])
+#define TREECORE_NEW_NODE(oPPath, oNParent, bIsLast, pvExtra, poNResult) \
+   BDT_newChild((oPPath), (oNParent), (poNResult))
+#define TREECORE_FREE(n) BDT_freeNode(NODE_ID(n))
+#define TREECORE_FANOUT 2
+#include "treeCore.h"
+
+/*--------------------------------------------------------------------*/
+
+int BDT_insert(const char *pcPath) {
+   Path_T oPPath = NULL;
+   int iStatus;
+
+   assert(pcPath != NULL);
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   iStatus = Path_new(pcPath, &oPPath);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   iStatus = BDT_coreinsert(&oNRoot, &ulCount, oPPath, NULL);
+   Path_free(oPPath);
+   return iStatus;
+}
+
+boolean BDT_contains(const char *pcPath) {
+   NodeRef oNFound = NULL;
+
+   assert(pcPath != NULL);
+
+   if(!bIsInitialized)
+      return FALSE;
+   return (boolean) (BDT_corefind(oNRoot, pcPath, &oNFound) == SUCCESS);
+}
+
+int BDT_rm(const char *pcPath) {
+   NodeRef oNFound = NULL;
+   int iStatus;
+
+   assert(pcPath != NULL);
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   iStatus = BDT_corefind(oNRoot, pcPath, &oNFound);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   ulCount -= BDT_freeNode(NODE_ID(oNFound));
+   if(oNFound == oNRoot)
+      oNRoot = NULL;
+   return SUCCESS;
+}
+
+int BDT_init(void) {
+   if(bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   bIsInitialized = TRUE;
+   oNRoot = NULL;
+   ulCount = 0;
+   return SUCCESS;
+}
+
+int BDT_destroy(void) {
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   if(oNRoot != NULL)
+      ulCount -= BDT_freeNode(NODE_ID(oNRoot));
+   assert(ulCount == 0);
+   oNRoot = NULL;
+
+   free(psPool);
+   psPool = NULL;
+   ulPoolSize = 0;
+   ulPoolUsed = 0;
+   uFree = NONE;
+
+   bIsInitialized = FALSE;
+   return SUCCESS;
+}
+
+char *BDT_toString(void) {
+   if(!bIsInitialized)
+      return NULL;
+
+   return BDT_coretoString(oNRoot);
+}
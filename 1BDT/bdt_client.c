@@ -8,12 +8,147 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
+#include <malloc.h>
 #include "bdt.h"
 
+/* Number of nodes in the benchmark tree when -b is not given one: a
+   complete tree of 16 levels, so that a store that doubles its
+   capacity is not measured just past a doubling */
+enum { BENCH_NODES = (1 << 16) - 1 };
+
+/* Longest path in the benchmark tree, including its '\0' */
+enum { BENCH_PATH = 256 };
+
+/* Writes into pcPath the path of node ulNode of a complete binary
+   tree numbered in heap order from 1, whose components are "c" and
+   the number of the node they name. */
+static void benchPath(size_t ulNode, char *pcPath) {
+  char acComponent[32];
+  size_t ulLength;
+
+  if(ulNode == 1) {
+    strcpy(pcPath, "c1");
+    return;
+  }
+  benchPath(ulNode / 2, pcPath);
+  ulLength = strlen(pcPath);
+  sprintf(acComponent, "/c%lu", (unsigned long) ulNode);
+  assert(ulLength + strlen(acComponent) < BENCH_PATH);
+  strcpy(pcPath + ulLength, acComponent);
+}
+
+/* Returns the seconds of processor time since clock() read cStart. */
+static double benchSeconds(clock_t cStart) {
+  return (double) (clock() - cStart) / CLOCKS_PER_SEC;
+}
+
+/* Prints one line of the benchmark's results to stdout. */
+static void benchReport(const char *pcWhat, size_t ulOps,
+                        double dSeconds) {
+  printf("%-14s %9lu ops %9.3f s %12.0f ops/s\n", pcWhat,
+         (unsigned long) ulOps, dSeconds,
+         dSeconds > 0 ? ulOps / dSeconds : 0.0);
+}
+
+/* Reports to stderr that ulWrong of the operations timed as pcWhat
+   gave the wrong result. Returns 1. */
+static int benchFailed(const char *pcWhat, size_t ulWrong) {
+  fprintf(stderr, "benchmark: %lu %s operations gave the wrong result\n",
+          (unsigned long) ulWrong, pcWhat);
+  return 1;
+}
+
+/* Times insert, contains and rm on a complete binary tree of
+   ulNodes nodes, and measures the heap bytes it holds. The BDT
+   calls are made outside assert, so that the timings mean the same
+   with -DNDEBUG, and are checked after each timed loop. Prints the
+   results to stdout. Returns 0, or 1 if memory ran out or an
+   operation gave the wrong result. */
+static int benchmark(size_t ulNodes) {
+  char (*pacPaths)[BENCH_PATH];
+  char (*pacMissing)[BENCH_PATH + 2];
+  struct mallinfo2 sBefore, sAfter;
+  clock_t cStart;
+  size_t ulNode, ulWrong;
+  double dBytes;
+
+  /* build the paths first so that only the BDT is timed; each miss
+     goes all the way down before failing */
+  pacPaths = malloc(ulNodes * sizeof(*pacPaths));
+  pacMissing = malloc(ulNodes * sizeof(*pacMissing));
+  if(pacPaths == NULL || pacMissing == NULL) {
+    fprintf(stderr, "benchmark: out of memory\n");
+    free(pacPaths);
+    free(pacMissing);
+    return 1;
+  }
+  for(ulNode = 1; ulNode <= ulNodes; ulNode++) {
+    benchPath(ulNode, pacPaths[ulNode - 1]);
+    sprintf(pacMissing[ulNode - 1], "%s/x", pacPaths[ulNode - 1]);
+  }
+
+  if(BDT_init() != SUCCESS)
+    return benchFailed("init", 1);
+  sBefore = mallinfo2();
+
+  /* inserting in heap order adds one new node each time */
+  ulWrong = 0;
+  cStart = clock();
+  for(ulNode = 0; ulNode < ulNodes; ulNode++)
+    if(BDT_insert(pacPaths[ulNode]) != SUCCESS)
+      ulWrong++;
+  benchReport("insert", ulNodes, benchSeconds(cStart));
+  if(ulWrong > 0)
+    return benchFailed("insert", ulWrong);
+
+  sAfter = mallinfo2();
+  /* large blocks come from mmap, which uordblks does not count */
+  dBytes = ((double) (sAfter.uordblks + sAfter.hblkhd) -
+            (double) (sBefore.uordblks + sBefore.hblkhd));
+  printf("%-14s %9lu nodes %11.0f bytes %9.1f bytes/node\n", "memory",
+         (unsigned long) ulNodes, dBytes, dBytes / ulNodes);
+
+  ulWrong = 0;
+  cStart = clock();
+  for(ulNode = 0; ulNode < ulNodes; ulNode++)
+    if(!BDT_contains(pacPaths[ulNode]))
+      ulWrong++;
+  benchReport("contains hit", ulNodes, benchSeconds(cStart));
+  if(ulWrong > 0)
+    return benchFailed("contains hit", ulWrong);
+
+  ulWrong = 0;
+  cStart = clock();
+  for(ulNode = 0; ulNode < ulNodes; ulNode++)
+    if(BDT_contains(pacMissing[ulNode]))
+      ulWrong++;
+  benchReport("contains miss", ulNodes, benchSeconds(cStart));
+  if(ulWrong > 0)
+    return benchFailed("contains miss", ulWrong);
+
+  /* removing in reverse heap order only ever removes leaves */
+  ulWrong = 0;
+  cStart = clock();
+  for(ulNode = ulNodes; ulNode > 0; ulNode--)
+    if(BDT_rm(pacPaths[ulNode - 1]) != SUCCESS)
+      ulWrong++;
+  benchReport("rm", ulNodes, benchSeconds(cStart));
+  if(ulWrong > 0)
+    return benchFailed("rm", ulWrong);
+
+  if(BDT_destroy() != SUCCESS)
+    return benchFailed("destroy", 1);
+  free(pacPaths);
+  free(pacMissing);
+  return 0;
+}
+
 /* Tests the BDT implementation with an assortment of checks.
    Prints the status of the data structure along the way to stderr.
    Returns 0. */
-int main(void) {
+static int test(void) {
+
   char* temp;
 
   /* Before the data structure is initialized:
@@ -166,3 +301,20 @@ int main(void) {
 
   return 0;
 }
+
+/* With no arguments, tests the BDT implementation. With -b, and
+   optionally a number of nodes, benchmarks it instead.
+   Returns 0, or 1 if the arguments are bad or the benchmark
+   fails. */
+int main(int argc, char *argv[]) {
+  long lNodes = BENCH_NODES;
+
+  if(argc == 1)
+    return test();
+  if(strcmp(argv[1], "-b") != 0 || argc > 3 ||
+     (argc == 3 && (lNodes = atol(argv[2])) <= 0)) {
+    fprintf(stderr, "usage: %s [-b [nodes]]\n", argv[0]);
+    return 1;
+  }
+  return benchmark((size_t) lNodes);
+}
@@ -13,6 +13,18 @@
 /* forward declarations, using node oNNode; returns: boolean for tree check*/
 static boolean CheckerDT_treeCheck(Node_T oNNode);
 
+/*
+ * how often CheckerDT_isValidRegion falls back to a full check; can be
+ * overridden at build time with -DCHECKERDT_FULL_INTERVAL=n.
+ */
+#ifndef CHECKERDT_FULL_INTERVAL
+#define CHECKERDT_FULL_INTERVAL 256
+#endif
+
+/* number of calls to CheckerDT_isValidRegion so far, from any
+   thread, so only updated atomically */
+static size_t ulRegionChecks = 0;
+
 /*
  * we use this static variable to keep track of the actual node count
  * during traversal. it helps us ensure that the reported node count
@@ -47,77 +59,35 @@ static boolean CheckerDT_validateChildParentReference(Node_T oParentNode, Node_T
 }
 
 /*
- * the function CheckerDT_checkForDuplicateChildren checks for duplicate child nodes by
- * comparing the current child with all previously processed child nodes under the same parent.
- * this ensures that there aren't two nodes with the same name under the same parent node.
+ * the function CheckerDT_checkAdjacentChildren checks that a child node sorts strictly
+ * after the sibling just before it. strict order between every adjacent pair means the
+ * children are sorted and, since duplicates would sort next to each other, unique too.
+ * so one pass over the children proves both, instead of comparing each child with every
+ * earlier sibling.
  *
  * parameters:
- *   - oParentNode: the parent node containing the child nodes.
+ *   - oPrevChildNode: the child node at index currentIndex - 1.
  *   - oChildNode: the child node being checked.
  *   - currentIndex: the index of the current child within the parent's list.
  *
  * returns:
- *   - TRUE if there are no duplicates found, or FALSE if a duplicate is detected.
+ *   - TRUE if oChildNode sorts strictly after oPrevChildNode, or FALSE otherwise.
  */
-static boolean CheckerDT_checkForDuplicateChildren(Node_T oParentNode, Node_T oChildNode, size_t currentIndex) {
-    size_t compareIdx;
-    Node_T oComparisonNode = NULL;
-    int status;
-
-    for (compareIdx = 0; compareIdx < currentIndex; compareIdx++) {
-        status = Node_getChild(oParentNode, compareIdx, &oComparisonNode);
-        if (status != SUCCESS) {
-            fprintf(stderr, "validation error: failed to retrieve comparison child node at index %lu.\n"
-                            "Node_getChild returned status: %d.\n",
-                    (unsigned long)compareIdx, status);
-            return FALSE;
-        }
+static boolean CheckerDT_checkAdjacentChildren(Node_T oPrevChildNode, Node_T oChildNode, size_t currentIndex) {
+    int comparison = Node_compare(oPrevChildNode, oChildNode);
 
-        if (Node_compare(oChildNode, oComparisonNode) == 0) {
-            fprintf(stderr, "validation error: duplicate child nodes found at indices %lu and %lu.\n"
-                            "each child must be unique under the same parent.\n",
-                    (unsigned long)currentIndex, (unsigned long)compareIdx);
-            return FALSE;
-        }
+    if (comparison == 0) {
+        fprintf(stderr, "validation error: duplicate child nodes found at indices %lu and %lu.\n"
+                        "each child must be unique under the same parent.\n",
+                (unsigned long)(currentIndex - 1), (unsigned long)currentIndex);
+        return FALSE;
     }
 
-    return TRUE;
-}
-
-/*
- * the function CheckerDT_verifyLexicographicalOrder ensures that child nodes are stored
- * in lexicographical order within their parent's list. it checks if each child node is
- * in the correct position relative to its neighboring nodes.
- *
- * parameters:
- *   - oParentNode: the parent node containing the child nodes.
- *   - oChildNode: the child node being checked.
- *   - currentIndex: the index of the current child within the parent's list.
- *
- * returns:
- *   - TRUE if the child nodes are in the correct lexicographical order,
- *     or FALSE if an ordering violation is detected.
- */
-static boolean CheckerDT_verifyLexicographicalOrder(Node_T oParentNode, Node_T oChildNode, size_t currentIndex) {
-    if (currentIndex > 0) {
-        Node_T oPrevChildNode = NULL;
-        int status;
-
-        status = Node_getChild(oParentNode, currentIndex - 1, &oPrevChildNode);
-        if (status != SUCCESS) {
-            fprintf(stderr, "validation error: unable to retrieve previous child node at index %lu.\n"
-                            "Node_getChild returned status: %d.\n",
-                    (unsigned long)(currentIndex - 1), status);
-            return FALSE;
-        }
-
-        if (strcmp(Path_getPathname(Node_getPath(oPrevChildNode)),
-                   Path_getPathname(Node_getPath(oChildNode))) > 0) {
-            fprintf(stderr, "validation error: children are not in lexicographic order between indices %lu and %lu.\n"
-                            "make sure child nodes are sorted lexicographically.\n",
-                    (unsigned long)(currentIndex - 1), (unsigned long)currentIndex);
-            return FALSE;
-        }
+    if (comparison > 0) {
+        fprintf(stderr, "validation error: children are not in lexicographic order between indices %lu and %lu.\n"
+                        "make sure child nodes are sorted lexicographically.\n",
+                (unsigned long)(currentIndex - 1), (unsigned long)currentIndex);
+        return FALSE;
     }
 
     return TRUE;
@@ -125,17 +95,19 @@ static boolean CheckerDT_verifyLexicographicalOrder(Node_T oParentNode, Node_T o
 
 /*
  * the function CheckerDT_validateChildNode checks a single child node to ensure it
- * meets all the required rules. it performs parent reference validation, duplicate detection,
- * and lexicographical order verification.
+ * meets all the required rules. it performs parent reference validation and checks
+ * the child against its previous sibling for order and uniqueness.
  *
  * parameters:
  *   - oParentNode: the parent node of the child.
  *   - childIndex: the index of the child node within the parent's list.
+ *   - poPrevChildNode: the previous sibling, or NULL for the first child;
+ *     updated to this child on success.
  *
  * returns:
  *   - TRUE if the child node passes all checks, or FALSE if any validation fails.
  */
-static boolean CheckerDT_validateChildNode(Node_T oParentNode, size_t childIndex) {
+static boolean CheckerDT_validateChildNode(Node_T oParentNode, size_t childIndex, Node_T *poPrevChildNode) {
     Node_T oChildNode = NULL;
     int status;
 
@@ -151,13 +123,11 @@ static boolean CheckerDT_validateChildNode(Node_T oParentNode, size_t childIndex
         return FALSE;
     }
 
-    if (!CheckerDT_checkForDuplicateChildren(oParentNode, oChildNode, childIndex)) {
-        return FALSE;
-    }
-
-    if (!CheckerDT_verifyLexicographicalOrder(oParentNode, oChildNode, childIndex)) {
+    if (*poPrevChildNode != NULL &&
+        !CheckerDT_checkAdjacentChildren(*poPrevChildNode, oChildNode, childIndex)) {
         return FALSE;
     }
+    *poPrevChildNode = oChildNode;
 
     if (!CheckerDT_treeCheck(oChildNode)) {
         return FALSE;
@@ -217,6 +187,7 @@ boolean CheckerDT_Node_isValid(Node_T oNNode) {
  */
 static boolean CheckerDT_treeCheck(Node_T oNNode) {
     size_t childIndex;
+    Node_T oPrevChildNode = NULL;
 
     if (oNNode != NULL) {
         if (!CheckerDT_Node_isValid(oNNode)) {
@@ -226,7 +197,7 @@ static boolean CheckerDT_treeCheck(Node_T oNNode) {
         ulVerifiedNodeCount++;
 
         for (childIndex = 0; childIndex < Node_getNumChildren(oNNode); childIndex++) {
-            if (!CheckerDT_validateChildNode(oNNode, childIndex)) {
+            if (!CheckerDT_validateChildNode(oNNode, childIndex, &oPrevChildNode)) {
                 return FALSE;
             }
         }
@@ -272,4 +243,156 @@ boolean CheckerDT_isValid(boolean bIsInitialized, Node_T oNRoot, size_t ulCount)
     }
 
     return TRUE;
-}
\ No newline at end of file
+}
+
+/*
+ * the function CheckerDT_checkTopLevel checks the invariants that tie the state
+ * variables together without looking inside the tree: an uninitialized tree has no
+ * nodes, and the root is missing exactly when the count is zero.
+ *
+ * parameters:
+ *   - bIsInitialized: boolean indicating if the tree is initialized.
+ *   - oNRoot: the root node of the tree.
+ *   - ulCount: the reported node count.
+ *
+ * returns:
+ *   - TRUE if the invariants hold, or FALSE otherwise.
+ */
+static boolean CheckerDT_checkTopLevel(boolean bIsInitialized, Node_T oNRoot, size_t ulCount) {
+    if (!bIsInitialized && ulCount != 0) {
+        fprintf(stderr, "validation error: tree is not initialized, but node count is %lu."
+                        " expected node count to be zero when uninitialized.\n", (unsigned long)ulCount);
+        return FALSE;
+    }
+
+    if ((oNRoot == NULL) != (ulCount == 0)) {
+        fprintf(stderr, "validation error: root is %s but node count is %lu.\n",
+                oNRoot == NULL ? "null" : "present", (unsigned long)ulCount);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/*
+ * the function CheckerDT_checkSiblingRange checks the children of oParentNode around
+ * index childIndex: the child there (if any) and its neighbours on either side must be
+ * valid nodes pointing back to oParentNode, and must be in strict order. this covers
+ * the siblings a mutation at that index could have disturbed.
+ *
+ * parameters:
+ *   - oParentNode: the parent node whose children are checked.
+ *   - childIndex: the index at which a child was found, or would be inserted.
+ *
+ * returns:
+ *   - TRUE if the checked range is valid, or FALSE otherwise.
+ */
+static boolean CheckerDT_checkSiblingRange(Node_T oParentNode, size_t childIndex) {
+    size_t numChildren = Node_getNumChildren(oParentNode);
+    size_t firstIndex = childIndex > 0 ? childIndex - 1 : 0;
+    size_t endIndex = childIndex + 2 < numChildren ? childIndex + 2 : numChildren;
+    size_t index;
+    Node_T oPrevChildNode = NULL;
+    Node_T oChildNode = NULL;
+    int status;
+
+    for (index = firstIndex; index < endIndex; index++) {
+        status = Node_getChild(oParentNode, index, &oChildNode);
+        if (status != SUCCESS) {
+            fprintf(stderr, "validation error: Node_getChild failed at child index %lu.\n"
+                            "Node_getChild returned status: %d.\n",
+                    (unsigned long)index, status);
+            return FALSE;
+        }
+
+        if (!CheckerDT_Node_isValid(oChildNode) ||
+            !CheckerDT_validateChildParentReference(oParentNode, oChildNode, index)) {
+            return FALSE;
+        }
+
+        if (oPrevChildNode != NULL &&
+            !CheckerDT_checkAdjacentChildren(oPrevChildNode, oChildNode, index)) {
+            return FALSE;
+        }
+        oPrevChildNode = oChildNode;
+    }
+
+    return TRUE;
+}
+
+/*
+ * the function CheckerDT_isValidRegion checks only the part of the tree that a mutation
+ * at pcPath could have changed: it walks from the root towards pcPath, checking each
+ * node on the way and the siblings around it, and stops at the deepest existing node.
+ * the cost is proportional to the depth of pcPath rather than the size of the tree.
+ * every CHECKERDT_FULL_INTERVAL-th call does a full check instead.
+ *
+ * parameters:
+ *   - bIsInitialized: boolean indicating if the tree is initialized.
+ *   - oNRoot: the root node of the tree.
+ *   - ulCount: the reported node count.
+ *   - pcPath: the path that was mutated, or NULL.
+ *
+ * returns:
+ *   - TRUE if the checked region passes all checks, or FALSE if any validation fails.
+ */
+boolean CheckerDT_isValidRegion(boolean bIsInitialized, Node_T oNRoot, size_t ulCount,
+                                const char *pcPath) {
+    Path_T oPPath = NULL;
+    Path_T oPPrefix = NULL;
+    Node_T oNCurr = oNRoot;
+    Node_T oNChild = NULL;
+    size_t level, childIndex;
+    boolean bValid = TRUE;
+
+    if (__atomic_add_fetch(&ulRegionChecks, 1, __ATOMIC_RELAXED) %
+        CHECKERDT_FULL_INTERVAL == 0) {
+        return CheckerDT_isValid(bIsInitialized, oNRoot, ulCount);
+    }
+
+    if (!CheckerDT_checkTopLevel(bIsInitialized, oNRoot, ulCount)) {
+        return FALSE;
+    }
+
+    if (oNRoot == NULL || pcPath == NULL) {
+        return TRUE;
+    }
+
+    if (!CheckerDT_Node_isValid(oNRoot)) {
+        return FALSE;
+    }
+
+    /* a path the tree could not hold leaves nothing else to check */
+    if (Path_new(pcPath, &oPPath) != SUCCESS) {
+        return TRUE;
+    }
+    if (Path_getSharedPrefixDepth(oPPath, Node_getPath(oNRoot)) < 1) {
+        Path_free(oPPath);
+        return TRUE;
+    }
+
+    for (level = 2; bValid && level <= Path_getDepth(oPPath); level++) {
+        if (Path_prefix(oPPath, level, &oPPrefix) != SUCCESS) {
+            break;
+        }
+
+        if (Node_hasChild(oNCurr, oPPrefix, &childIndex)) {
+            bValid = CheckerDT_checkSiblingRange(oNCurr, childIndex) &&
+                     Node_getChild(oNCurr, childIndex, &oNChild) == SUCCESS;
+            oNCurr = oNChild;
+        }
+        else {
+            /* the deepest existing node: check where the child would go */
+            bValid = CheckerDT_checkSiblingRange(oNCurr, childIndex);
+            oNCurr = NULL;
+        }
+
+        Path_free(oPPrefix);
+        if (oNCurr == NULL) {
+            break;
+        }
+    }
+
+    Path_free(oPPath);
+    return bValid;
+}
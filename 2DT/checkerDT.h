@@ -29,4 +29,19 @@ boolean CheckerDT_isValid(boolean bIsInitialized,
                           Node_T oNRoot,
                           size_t ulCount);
 
+/*
+   Like CheckerDT_isValid, but for use after a mutation of the
+   hierarchy at absolute path pcPath: checks the top-level
+   invariants, every node on the way from the root towards pcPath,
+   and each such node's immediate siblings, rather than the whole
+   hierarchy. pcPath may be NULL to check only the top-level
+   invariants. Every CHECKERDT_FULL_INTERVAL-th call runs the full
+   CheckerDT_isValid instead, to catch anything the region checks
+   cannot see (such as a wrong ulCount).
+*/
+boolean CheckerDT_isValidRegion(boolean bIsInitialized,
+                                Node_T oNRoot,
+                                size_t ulCount,
+                                const char *pcPath);
+
 #endif
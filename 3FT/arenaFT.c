@@ -0,0 +1,165 @@
+/*--------------------------------------------------------------------*/
+/* arenaFT.c                                                          */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+/* mmap's MAP_ANONYMOUS and madvise's MADV_HUGEPAGE are not C99 */
+#define _DEFAULT_SOURCE
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arenaFT.h"
+
+#ifdef FT_HUGEPAGES
+
+#include <stdint.h>
+#include <sys/mman.h>
+
+/* Bytes in blocks mapped on their own, updated atomically because
+   per-thread trees allocate concurrently */
+static size_t ulMappedBytes;
+
+/* Returns ulBytes rounded up to a whole number of huge pages. */
+static size_t ArenaFT_roundUp(size_t ulBytes) {
+   return (ulBytes + ARENAFT_HUGE_MIN - 1) / ARENAFT_HUGE_MIN *
+          ARENAFT_HUGE_MIN;
+}
+
+/* Returns TRUE if a block of ulBytes bytes is mapped on its own. */
+static int ArenaFT_isMapped(size_t ulBytes) {
+   return ulBytes >= ARENAFT_HUGE_MIN;
+}
+
+/*
+  Maps ulBytes (a multiple of ARENAFT_HUGE_MIN) bytes aligned to a
+  huge page, so that every 2 MB of the block can be one huge page,
+  and asks for huge pages. Returns the block or NULL.
+*/
+static void *ArenaFT_map(size_t ulBytes) {
+   char *pcMap, *pcBlock;
+   size_t ulHead;
+
+   /* map one huge page extra, then trim to an aligned block */
+   pcMap = mmap(NULL, ulBytes + ARENAFT_HUGE_MIN, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   if(pcMap == MAP_FAILED)
+      return NULL;
+   ulHead = (ARENAFT_HUGE_MIN - (uintptr_t) pcMap % ARENAFT_HUGE_MIN) %
+            ARENAFT_HUGE_MIN;
+   pcBlock = pcMap + ulHead;
+   if(ulHead > 0)
+      (void) munmap(pcMap, ulHead);
+   (void) munmap(pcBlock + ulBytes, ARENAFT_HUGE_MIN - ulHead);
+
+   /* only advice: the block works without huge pages too */
+   (void) madvise(pcBlock, ulBytes, MADV_HUGEPAGE);
+   (void) __atomic_fetch_add(&ulMappedBytes, ulBytes, __ATOMIC_RELAXED);
+   return pcBlock;
+}
+
+/* Unmaps the block pv, of ulBytes bytes before rounding. */
+static void ArenaFT_unmap(void *pv, size_t ulBytes) {
+   ulBytes = ArenaFT_roundUp(ulBytes);
+   (void) munmap(pv, ulBytes);
+   (void) __atomic_fetch_sub(&ulMappedBytes, ulBytes, __ATOMIC_RELAXED);
+}
+
+void *ArenaFT_resize(void *pvOld, size_t ulOldBytes, size_t ulNewBytes) {
+   void *pvNew;
+
+   assert(ulNewBytes > 0);
+   assert(pvOld != NULL || ulOldBytes == 0);
+
+   if(!ArenaFT_isMapped(ulOldBytes) && !ArenaFT_isMapped(ulNewBytes))
+      return realloc(pvOld, ulNewBytes);
+   /* a mapped block already has room up to its rounded size */
+   if(ArenaFT_isMapped(ulOldBytes) && ArenaFT_isMapped(ulNewBytes) &&
+      ArenaFT_roundUp(ulOldBytes) == ArenaFT_roundUp(ulNewBytes))
+      return pvOld;
+
+   if(ArenaFT_isMapped(ulNewBytes))
+      pvNew = ArenaFT_map(ArenaFT_roundUp(ulNewBytes));
+   else
+      pvNew = malloc(ulNewBytes);
+   if(pvNew == NULL)
+      return NULL;
+
+   if(pvOld != NULL)
+      memcpy(pvNew, pvOld, ulOldBytes < ulNewBytes ? ulOldBytes
+                                                   : ulNewBytes);
+   ArenaFT_free(pvOld, ulOldBytes);
+   return pvNew;
+}
+
+void ArenaFT_free(void *pv, size_t ulBytes) {
+   if(pv == NULL)
+      return;
+   if(ArenaFT_isMapped(ulBytes))
+      ArenaFT_unmap(pv, ulBytes);
+   else
+      free(pv);
+}
+
+/*
+  Returns the number of bytes of huge pages backing the mappings that
+  were marked with MADV_HUGEPAGE ("hg" in their VmFlags), which in
+  this program are the arena's blocks, according to /proc/self/smaps;
+  0 if it cannot be read.
+*/
+static size_t ArenaFT_smapsHuge(void) {
+   FILE *psSmaps;
+   char acLine[256];
+   unsigned long ulKB, ulHugeKB = 0, ulTotalKB = 0;
+
+   psSmaps = fopen("/proc/self/smaps", "r");
+   if(psSmaps == NULL)
+      return 0;
+
+   /* AnonHugePages comes before VmFlags in each mapping's entry */
+   while(fgets(acLine, (int) sizeof(acLine), psSmaps) != NULL) {
+      if(sscanf(acLine, "AnonHugePages: %lu kB", &ulKB) == 1)
+         ulHugeKB = ulKB;
+      else if(strncmp(acLine, "VmFlags:", 8) == 0) {
+         if(strstr(acLine, " hg") != NULL)
+            ulTotalKB += ulHugeKB;
+         ulHugeKB = 0;
+      }
+   }
+   (void) fclose(psSmaps);
+   return (size_t) ulTotalKB * 1024;
+}
+
+void ArenaFT_getStats(size_t *pulMapped, size_t *pulHuge) {
+   assert(pulMapped != NULL);
+   assert(pulHuge != NULL);
+
+   *pulMapped = __atomic_load_n(&ulMappedBytes, __ATOMIC_RELAXED);
+   *pulHuge = *pulMapped > 0 ? ArenaFT_smapsHuge() : 0;
+}
+
+#else /* FT_HUGEPAGES */
+
+void *ArenaFT_resize(void *pvOld, size_t ulOldBytes, size_t ulNewBytes) {
+   assert(ulNewBytes > 0);
+   assert(pvOld != NULL || ulOldBytes == 0);
+   (void) ulOldBytes;
+
+   return realloc(pvOld, ulNewBytes);
+}
+
+void ArenaFT_free(void *pv, size_t ulBytes) {
+   (void) ulBytes;
+   free(pv);
+}
+
+void ArenaFT_getStats(size_t *pulMapped, size_t *pulHuge) {
+   assert(pulMapped != NULL);
+   assert(pulHuge != NULL);
+
+   *pulMapped = 0;
+   *pulHuge = 0;
+}
+
+#endif /* FT_HUGEPAGES */
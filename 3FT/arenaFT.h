@@ -0,0 +1,46 @@
+/*--------------------------------------------------------------------*/
+/* arenaFT.h                                                          */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+#ifndef ARENAFT_INCLUDED
+#define ARENAFT_INCLUDED
+
+#include <stddef.h>
+
+/*
+  Allocation for the node store's arrays (see nodeFTSoA.c), which in
+  a tree of tens of millions of nodes are each hundreds of MB, so
+  that a walk down the tree misses the TLB at almost every level.
+  Without -DFT_HUGEPAGES these functions are just realloc and free.
+  With it, an array of at least ARENAFT_HUGE_MIN bytes gets a mapping
+  of its own, aligned to a huge page and marked with
+  madvise(MADV_HUGEPAGE), so that the kernel can back it with 2 MB
+  transparent huge pages; smaller arrays still come from malloc.
+*/
+
+/* Size of a huge page, and of the smallest array mapped on its own */
+enum { ARENAFT_HUGE_MIN = 2 * 1024 * 1024 };
+
+/*
+  Resizes the ulOldBytes-byte block pvOld (NULL if ulOldBytes is 0)
+  to ulNewBytes bytes, which must be positive, keeping its contents
+  up to the smaller size. Returns the block, which may have moved,
+  or NULL if memory could not be allocated, leaving pvOld as it was.
+*/
+void *ArenaFT_resize(void *pvOld, size_t ulOldBytes, size_t ulNewBytes);
+
+/* Frees the ulBytes-byte block pv, which may be NULL. */
+void ArenaFT_free(void *pv, size_t ulBytes);
+
+/*
+  Stores in *pulMapped the number of bytes in arrays mapped on their
+  own for huge pages, and in *pulHuge how many of those the kernel
+  currently backs with huge pages, which it reports in
+  /proc/self/smaps. Both are 0 without -DFT_HUGEPAGES; *pulHuge is
+  also 0 where transparent huge pages are disabled or smaps cannot be
+  read.
+*/
+void ArenaFT_getStats(size_t *pulMapped, size_t *pulHuge);
+
+#endif
@@ -0,0 +1,602 @@
+/*--------------------------------------------------------------------*/
+/* asyncFT.c                                                          */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "ft.h"
+#include "asyncFT.h"
+
+/* Most operations a worker reorders as one run, which bounds the
+   cost of checking each new operation against the run */
+enum { MAX_RUN = 64 };
+
+/* An operation queued for a worker, with its place in submission
+   order */
+struct op {
+   struct AsyncFT_Sqe sSqe;
+   size_t ulSeq;
+};
+
+/* A worker and the operations queued for it */
+struct worker {
+   pthread_t sThread;
+   struct AsyncFT *psRing;
+   /* signalled when operations are queued */
+   pthread_cond_t sWork;
+   /* the operations queued, under the ring's lock, and the batch the
+      worker took last and its results, private to the worker */
+   struct op *psQueue;
+   size_t ulQueued;
+   struct op *psBatch;
+   struct AsyncFT_Cqe *psResults;
+   /* TRUE while running a batch */
+   boolean bBusy;
+};
+
+struct AsyncFT {
+   /* number of entries in each ring, less 1 */
+   size_t ulMask;
+
+   /* the submission ring: entries in [ulSqHead, ulSqTail) are
+      published and not yet dispatched; the caller fills up to
+      ulSqNext before publishing */
+   struct AsyncFT_Sqe *psSq;
+   size_t ulSqHead;
+   size_t ulSqTail;
+   size_t ulSqNext;
+
+   /* the completion ring: entries in [ulCqHead, ulCqTail) are ready
+      to be reaped */
+   struct AsyncFT_Cqe *psCq;
+   size_t ulCqHead;
+   size_t ulCqTail;
+
+   /* operations handed out by AsyncFT_getSqe and not yet reaped;
+      used by the caller only */
+   size_t ulInFlight;
+
+   /* protects everything but the caller-only fields and the
+      workers' private batches */
+   pthread_mutex_t sLock;
+   /* signalled when entries are published, when completions are
+      posted, and when the last worker goes idle */
+   pthread_cond_t sSubmitted;
+   pthread_cond_t sCompleted;
+   pthread_cond_t sIdle;
+
+   /* the thread that moves published entries to the workers */
+   pthread_t sDispatcher;
+   /* the workers, and how many have work queued or running */
+   struct worker *psWorkers;
+   size_t ulWorkers;
+   size_t ulActive;
+   /* next sequence number to give a queued operation */
+   size_t ulSeq;
+   /* the name of the FT's root directory, if the dispatcher knows
+      it exists, or NULL; used by the dispatcher only */
+   char *pcRoot;
+
+   /* set when the ring is being freed, and once the dispatcher has
+      dispatched everything and exited */
+   boolean bStopping;
+   boolean bDrained;
+};
+
+/*---------------------------------------------------------------*/
+
+/*
+  Returns TRUE if operation eOp only reads the tree.
+*/
+static boolean AsyncFT_isRead(enum OpFT eOp) {
+   return (boolean) (eOp == OPFT_CONTAINS_DIR ||
+                     eOp == OPFT_CONTAINS_FILE || eOp == OPFT_STAT ||
+                     eOp == OPFT_GET_CONTENTS);
+}
+
+/*
+  Returns TRUE if psSqe must run as a barrier in psRing: an operation
+  without a path, on a path with no directory under the root, or
+  under a root other than the directory psRing knows is the FT's
+  root. Until the root exists, any insertion may create it, which
+  would change the result of operations under every other top-level
+  directory.
+*/
+static boolean AsyncFT_isBarrier(const struct AsyncFT *psRing,
+                                 const struct AsyncFT_Sqe *psSqe) {
+   size_t ulRoot;
+
+   if(psSqe->pcPath == NULL || psRing->pcRoot == NULL)
+      return TRUE;
+   ulRoot = strcspn(psSqe->pcPath, "/");
+   return (boolean) (psSqe->pcPath[ulRoot] == '\0' ||
+                     strncmp(psSqe->pcPath, psRing->pcRoot, ulRoot) != 0 ||
+                     psRing->pcRoot[ulRoot] != '\0');
+}
+
+/*
+  Updates which root directory psRing knows the FT has after the
+  barrier psSqe has run. Only a barrier can remove the root, so once
+  known it stays so until the next barrier.
+*/
+static void AsyncFT_learnRoot(struct AsyncFT *psRing,
+                              const struct AsyncFT_Sqe *psSqe) {
+   size_t ulRoot;
+
+   if(psSqe->eOp == OPFT_TO_STRING)
+      return;
+   free(psRing->pcRoot);
+   psRing->pcRoot = NULL;
+   if(psSqe->pcPath == NULL)
+      return;
+
+   ulRoot = strcspn(psSqe->pcPath, "/");
+   psRing->pcRoot = malloc(ulRoot + 1);
+   if(psRing->pcRoot == NULL)
+      return;
+   memcpy(psRing->pcRoot, psSqe->pcPath, ulRoot);
+   psRing->pcRoot[ulRoot] = '\0';
+   if(FT_containsDir(psRing->pcRoot) != TRUE) {
+      free(psRing->pcRoot);
+      psRing->pcRoot = NULL;
+   }
+}
+
+/*
+  Returns the worker of ulWorkers that runs operations on pcPath,
+  which has a '/', chosen by the component after the root.
+*/
+static size_t AsyncFT_workerOf(const char *pcPath, size_t ulWorkers) {
+   uint32_t uiHash = 2166136261u;
+   const char *pc;
+
+   for(pc = strchr(pcPath, '/') + 1; *pc != '\0' && *pc != '/'; pc++)
+      uiHash = (uiHash ^ (unsigned char) *pc) * 16777619u;
+   return uiHash % ulWorkers;
+}
+
+/*
+  Returns TRUE if pcPrefix is pcPath or one of its ancestors.
+*/
+static boolean AsyncFT_isPrefix(const char *pcPrefix, const char *pcPath) {
+   size_t ulLength = strlen(pcPrefix);
+
+   return (boolean) (strncmp(pcPrefix, pcPath, ulLength) == 0 &&
+                     (pcPath[ulLength] == '\0' ||
+                      pcPath[ulLength] == '/'));
+}
+
+/*
+  Returns TRUE if operations psA and psB might not commute: at least
+  one writes, and one's path is the other's or under it.
+*/
+static boolean AsyncFT_conflict(const struct AsyncFT_Sqe *psA,
+                                const struct AsyncFT_Sqe *psB) {
+   if(AsyncFT_isRead(psA->eOp) && AsyncFT_isRead(psB->eOp))
+      return FALSE;
+   return (boolean) (AsyncFT_isPrefix(psA->pcPath, psB->pcPath) ||
+                     AsyncFT_isPrefix(psB->pcPath, psA->pcPath));
+}
+
+/*
+  Orders queued operations by path, and then by submission order.
+*/
+static int AsyncFT_compare(const void *pvA, const void *pvB) {
+   const struct op *psA = pvA, *psB = pvB;
+   int iCmp = strcmp(psA->sSqe.pcPath, psB->sSqe.pcPath);
+
+   if(iCmp != 0)
+      return iCmp;
+   return psA->ulSeq < psB->ulSeq ? -1 : psA->ulSeq > psB->ulSeq;
+}
+
+/*
+  Runs the operation of psSqe and stores its result in *psCqe.
+*/
+static void AsyncFT_run(const struct AsyncFT_Sqe *psSqe,
+                        struct AsyncFT_Cqe *psCqe) {
+   const char *pcPath = psSqe->pcPath;
+   size_t ulOldSize = 0;
+   void *pvContents;
+
+   psCqe->pvUser = psSqe->pvUser;
+   psCqe->eOp = psSqe->eOp;
+   psCqe->iStatus = SUCCESS;
+   psCqe->bIsFile = FALSE;
+   psCqe->ulSize = 0;
+   psCqe->pvData = NULL;
+
+   if(pcPath == NULL && psSqe->eOp != OPFT_INIT &&
+      psSqe->eOp != OPFT_DESTROY && psSqe->eOp != OPFT_TO_STRING) {
+      psCqe->iStatus = BAD_PATH;
+      return;
+   }
+
+   switch(psSqe->eOp) {
+   case OPFT_INIT:
+      psCqe->iStatus = FT_init();
+      break;
+   case OPFT_DESTROY:
+      psCqe->iStatus = FT_destroy();
+      break;
+   case OPFT_INSERT_DIR:
+      psCqe->iStatus = FT_insertDir(pcPath);
+      break;
+   case OPFT_INSERT_FILE:
+      psCqe->iStatus = FT_insertFile(pcPath, psSqe->pvContents,
+                                     psSqe->ulLength);
+      break;
+   case OPFT_RM_DIR:
+      psCqe->iStatus = FT_rmDir(pcPath);
+      break;
+   case OPFT_RM_FILE:
+      psCqe->iStatus = FT_rmFile(pcPath);
+      break;
+   case OPFT_CONTAINS_DIR:
+      psCqe->iStatus = FT_containsDir(pcPath);
+      break;
+   case OPFT_CONTAINS_FILE:
+      psCqe->iStatus = FT_containsFile(pcPath);
+      break;
+   case OPFT_STAT:
+      psCqe->iStatus = FT_stat(pcPath, &psCqe->bIsFile, &psCqe->ulSize);
+      break;
+   case OPFT_GET_CONTENTS:
+      /* no other operation on this path runs meanwhile, so the stat,
+         the read and the copy agree; the FT's own buffer could be
+         freed by a later operation before the caller reaps this one */
+      psCqe->iStatus = FT_stat(pcPath, &psCqe->bIsFile, &psCqe->ulSize);
+      if(psCqe->iStatus == SUCCESS && !psCqe->bIsFile)
+         psCqe->iStatus = NOT_A_FILE;
+      if(psCqe->iStatus != SUCCESS)
+         break;
+      pvContents = FT_getFileContents(pcPath);
+      if(pvContents == NULL || psCqe->ulSize == 0)
+         break;
+      psCqe->pvData = malloc(psCqe->ulSize);
+      if(psCqe->pvData == NULL)
+         psCqe->iStatus = MEMORY_ERROR;
+      else
+         memcpy(psCqe->pvData, pvContents, psCqe->ulSize);
+      break;
+   case OPFT_REPLACE_CONTENTS:
+      psCqe->iStatus = FT_stat(pcPath, &psCqe->bIsFile, &ulOldSize);
+      if(psCqe->iStatus == SUCCESS && !psCqe->bIsFile)
+         psCqe->iStatus = NOT_A_FILE;
+      if(psCqe->iStatus != SUCCESS)
+         break;
+      psCqe->pvData = FT_replaceFileContents(pcPath, psSqe->pvContents,
+                                             psSqe->ulLength);
+      /* the FT returns a copy of nonempty old contents */
+      if(psCqe->pvData == NULL && ulOldSize > 0)
+         psCqe->iStatus = MEMORY_ERROR;
+      psCqe->ulSize = ulOldSize;
+      break;
+   case OPFT_TO_STRING:
+      psCqe->pvData = FT_toString();
+      if(psCqe->pvData == NULL)
+         psCqe->iStatus = MEMORY_ERROR;
+      break;
+   default:
+      psCqe->iStatus = BAD_PATH;
+      break;
+   }
+}
+
+/*
+  Posts the ulCount completions of psCqes to the completion ring and
+  wakes the caller. Called with the ring's lock held.
+*/
+static void AsyncFT_post(struct AsyncFT *psRing,
+                         const struct AsyncFT_Cqe *psCqes,
+                         size_t ulCount) {
+   size_t ulIndex;
+
+   /* at most ulMask + 1 operations are in flight, so there is room */
+   for(ulIndex = 0; ulIndex < ulCount; ulIndex++)
+      psRing->psCq[psRing->ulCqTail++ & psRing->ulMask] = psCqes[ulIndex];
+   pthread_cond_broadcast(&psRing->sCompleted);
+}
+
+/*
+  Runs the ulCount operations of psOps, which commute with one
+  another, sorted by path, storing their results in psResults.
+*/
+static void AsyncFT_runSorted(struct op *psOps, size_t ulCount,
+                              struct AsyncFT_Cqe *psResults) {
+   size_t ulIndex;
+
+   qsort(psOps, ulCount, sizeof(*psOps), AsyncFT_compare);
+   for(ulIndex = 0; ulIndex < ulCount; ulIndex++)
+      AsyncFT_run(&psOps[ulIndex].sSqe, &psResults[ulIndex]);
+}
+
+/*
+  Runs the ulCount operations of psOps as if in their order, cutting
+  them into runs in which no operation conflicts with an earlier one
+  and sorting each run by path. Stores their results in psResults.
+*/
+static void AsyncFT_runBatch(struct op *psOps, size_t ulCount,
+                             struct AsyncFT_Cqe *psResults) {
+   size_t ulStart = 0, ulIndex, ulEarlier;
+
+   for(ulIndex = 1; ulIndex < ulCount; ulIndex++) {
+      for(ulEarlier = ulStart; ulEarlier < ulIndex; ulEarlier++)
+         if(AsyncFT_conflict(&psOps[ulEarlier].sSqe, &psOps[ulIndex].sSqe))
+            break;
+      if(ulEarlier < ulIndex || ulIndex - ulStart == MAX_RUN) {
+         AsyncFT_runSorted(psOps + ulStart, ulIndex - ulStart,
+                           psResults + ulStart);
+         ulStart = ulIndex;
+      }
+   }
+   if(ulStart < ulCount)
+      AsyncFT_runSorted(psOps + ulStart, ulCount - ulStart,
+                        psResults + ulStart);
+}
+
+/*
+  The body of each worker thread: takes every operation queued for it
+  at once and runs them, until the dispatcher has finished and
+  nothing is left.
+*/
+static void *AsyncFT_work(void *pvWorker) {
+   struct worker *psWorker = pvWorker;
+   struct AsyncFT *psRing = psWorker->psRing;
+   struct op *psTaken;
+   size_t ulCount;
+
+   pthread_mutex_lock(&psRing->sLock);
+   for(;;) {
+      while(psWorker->ulQueued == 0 && !psRing->bDrained)
+         pthread_cond_wait(&psWorker->sWork, &psRing->sLock);
+      if(psWorker->ulQueued == 0)
+         break;
+
+      /* swap the queue for the spare array, so that the dispatcher
+         can queue more while this batch runs */
+      psTaken = psWorker->psQueue;
+      psWorker->psQueue = psWorker->psBatch;
+      psWorker->psBatch = psTaken;
+      ulCount = psWorker->ulQueued;
+      psWorker->ulQueued = 0;
+      psWorker->bBusy = TRUE;
+      pthread_mutex_unlock(&psRing->sLock);
+
+      AsyncFT_runBatch(psTaken, ulCount, psWorker->psResults);
+
+      pthread_mutex_lock(&psRing->sLock);
+      AsyncFT_post(psRing, psWorker->psResults, ulCount);
+      psWorker->bBusy = FALSE;
+      if(psWorker->ulQueued == 0 && --psRing->ulActive == 0)
+         pthread_cond_broadcast(&psRing->sIdle);
+   }
+   pthread_mutex_unlock(&psRing->sLock);
+   return NULL;
+}
+
+/*
+  The body of the dispatcher thread: moves each published entry, in
+  order, to the queue of its worker, or, if it is a barrier, runs it
+  itself once every worker is idle, until the ring is being freed
+  and every entry has been dispatched.
+*/
+static void *AsyncFT_dispatch(void *pvRing) {
+   struct AsyncFT *psRing = pvRing;
+   struct AsyncFT_Sqe sSqe;
+   struct AsyncFT_Cqe sCqe;
+   struct worker *psWorker;
+   size_t ulIndex;
+
+   pthread_mutex_lock(&psRing->sLock);
+   for(;;) {
+      while(psRing->ulSqHead == psRing->ulSqTail && !psRing->bStopping)
+         pthread_cond_wait(&psRing->sSubmitted, &psRing->sLock);
+      if(psRing->ulSqHead == psRing->ulSqTail)
+         break;
+
+      sSqe = psRing->psSq[psRing->ulSqHead++ & psRing->ulMask];
+      if(AsyncFT_isBarrier(psRing, &sSqe)) {
+         while(psRing->ulActive > 0)
+            pthread_cond_wait(&psRing->sIdle, &psRing->sLock);
+         pthread_mutex_unlock(&psRing->sLock);
+         AsyncFT_run(&sSqe, &sCqe);
+         AsyncFT_learnRoot(psRing, &sSqe);
+         pthread_mutex_lock(&psRing->sLock);
+         AsyncFT_post(psRing, &sCqe, 1);
+         continue;
+      }
+
+      psWorker = &psRing->psWorkers[AsyncFT_workerOf(sSqe.pcPath,
+                                                     psRing->ulWorkers)];
+      if(psWorker->ulQueued == 0) {
+         if(!psWorker->bBusy)
+            psRing->ulActive++;
+         pthread_cond_signal(&psWorker->sWork);
+      }
+      psWorker->psQueue[psWorker->ulQueued].sSqe = sSqe;
+      psWorker->psQueue[psWorker->ulQueued].ulSeq = psRing->ulSeq++;
+      psWorker->ulQueued++;
+   }
+
+   psRing->bDrained = TRUE;
+   for(ulIndex = 0; ulIndex < psRing->ulWorkers; ulIndex++)
+      pthread_cond_signal(&psRing->psWorkers[ulIndex].sWork);
+   pthread_mutex_unlock(&psRing->sLock);
+   return NULL;
+}
+
+/*---------------------------------------------------------------*/
+
+/*
+  Frees psRing's memory and synchronization objects; its threads must
+  have finished or never started.
+*/
+static void AsyncFT_release(struct AsyncFT *psRing) {
+   size_t ulIndex;
+
+   for(ulIndex = 0; ulIndex < psRing->ulWorkers; ulIndex++) {
+      pthread_cond_destroy(&psRing->psWorkers[ulIndex].sWork);
+      free(psRing->psWorkers[ulIndex].psQueue);
+      free(psRing->psWorkers[ulIndex].psBatch);
+      free(psRing->psWorkers[ulIndex].psResults);
+   }
+   free(psRing->psWorkers);
+   free(psRing->pcRoot);
+   free(psRing->psSq);
+   free(psRing->psCq);
+   pthread_cond_destroy(&psRing->sIdle);
+   pthread_cond_destroy(&psRing->sCompleted);
+   pthread_cond_destroy(&psRing->sSubmitted);
+   pthread_mutex_destroy(&psRing->sLock);
+   free(psRing);
+}
+
+/*
+  Stops psRing's dispatcher and the ulStarted workers it has started,
+  after everything published has run.
+*/
+static void AsyncFT_stop(struct AsyncFT *psRing, size_t ulStarted) {
+   size_t ulIndex;
+
+   pthread_mutex_lock(&psRing->sLock);
+   psRing->bStopping = TRUE;
+   pthread_cond_signal(&psRing->sSubmitted);
+   pthread_mutex_unlock(&psRing->sLock);
+   pthread_join(psRing->sDispatcher, NULL);
+   for(ulIndex = 0; ulIndex < ulStarted; ulIndex++)
+      pthread_join(psRing->psWorkers[ulIndex].sThread, NULL);
+}
+
+AsyncFT_T AsyncFT_new(size_t ulEntries, size_t ulWorkers) {
+   struct AsyncFT *psRing;
+   struct worker *psWorker;
+   size_t ulSize = 1, ulIndex;
+   boolean bOk = TRUE;
+
+   assert(ulEntries > 0);
+   assert(ulWorkers > 0);
+
+   while(ulSize < ulEntries)
+      ulSize *= 2;
+
+   psRing = calloc(1, sizeof(*psRing));
+   if(psRing == NULL)
+      return NULL;
+   psRing->ulMask = ulSize - 1;
+   psRing->ulWorkers = ulWorkers;
+   pthread_mutex_init(&psRing->sLock, NULL);
+   pthread_cond_init(&psRing->sSubmitted, NULL);
+   pthread_cond_init(&psRing->sCompleted, NULL);
+   pthread_cond_init(&psRing->sIdle, NULL);
+
+   psRing->psSq = malloc(ulSize * sizeof(*psRing->psSq));
+   psRing->psCq = malloc(ulSize * sizeof(*psRing->psCq));
+   psRing->psWorkers = calloc(ulWorkers, sizeof(*psRing->psWorkers));
+   if(psRing->psSq == NULL || psRing->psCq == NULL ||
+      psRing->psWorkers == NULL) {
+      /* release only destroys the workers that exist */
+      psRing->ulWorkers = psRing->psWorkers == NULL ? 0 : ulWorkers;
+      AsyncFT_release(psRing);
+      return NULL;
+   }
+
+   /* every worker may have every operation in flight queued */
+   for(ulIndex = 0; ulIndex < ulWorkers; ulIndex++) {
+      psWorker = &psRing->psWorkers[ulIndex];
+      psWorker->psRing = psRing;
+      pthread_cond_init(&psWorker->sWork, NULL);
+      psWorker->psQueue = malloc(ulSize * sizeof(struct op));
+      psWorker->psBatch = malloc(ulSize * sizeof(struct op));
+      psWorker->psResults = malloc(ulSize * sizeof(struct AsyncFT_Cqe));
+      if(psWorker->psQueue == NULL || psWorker->psBatch == NULL ||
+         psWorker->psResults == NULL)
+         bOk = FALSE;
+   }
+   if(!bOk || pthread_create(&psRing->sDispatcher, NULL, AsyncFT_dispatch,
+                             psRing) != 0) {
+      AsyncFT_release(psRing);
+      return NULL;
+   }
+
+   for(ulIndex = 0; ulIndex < ulWorkers; ulIndex++)
+      if(pthread_create(&psRing->psWorkers[ulIndex].sThread, NULL,
+                        AsyncFT_work, &psRing->psWorkers[ulIndex]) != 0) {
+         AsyncFT_stop(psRing, ulIndex);
+         AsyncFT_release(psRing);
+         return NULL;
+      }
+   return psRing;
+}
+
+void AsyncFT_free(AsyncFT_T oARing) {
+   struct AsyncFT_Cqe *psCqe;
+
+   if(oARing == NULL)
+      return;
+
+   AsyncFT_stop(oARing, oARing->ulWorkers);
+   for(; oARing->ulCqHead != oARing->ulCqTail; oARing->ulCqHead++) {
+      psCqe = &oARing->psCq[oARing->ulCqHead & oARing->ulMask];
+      /* the caller would have owned these */
+      if(psCqe->eOp == OPFT_GET_CONTENTS ||
+         psCqe->eOp == OPFT_REPLACE_CONTENTS ||
+         psCqe->eOp == OPFT_TO_STRING)
+         free(psCqe->pvData);
+   }
+   AsyncFT_release(oARing);
+}
+
+struct AsyncFT_Sqe *AsyncFT_getSqe(AsyncFT_T oARing) {
+   assert(oARing != NULL);
+
+   if(oARing->ulInFlight > oARing->ulMask)
+      return NULL;
+   oARing->ulInFlight++;
+   return &oARing->psSq[oARing->ulSqNext++ & oARing->ulMask];
+}
+
+size_t AsyncFT_submit(AsyncFT_T oARing) {
+   size_t ulCount;
+
+   assert(oARing != NULL);
+
+   pthread_mutex_lock(&oARing->sLock);
+   ulCount = oARing->ulSqNext - oARing->ulSqTail;
+   oARing->ulSqTail = oARing->ulSqNext;
+   if(ulCount > 0)
+      pthread_cond_signal(&oARing->sSubmitted);
+   pthread_mutex_unlock(&oARing->sLock);
+   return ulCount;
+}
+
+size_t AsyncFT_reap(AsyncFT_T oARing, struct AsyncFT_Cqe *psCqes,
+                    size_t ulMax, size_t ulWait) {
+   size_t ulPublished, ulCount, ulIndex;
+
+   assert(oARing != NULL);
+   assert(psCqes != NULL || ulMax == 0);
+   assert(ulWait <= ulMax);
+
+   pthread_mutex_lock(&oARing->sLock);
+   /* never wait for more than could ever complete */
+   ulPublished = oARing->ulInFlight - (oARing->ulSqNext - oARing->ulSqTail);
+   if(ulWait > ulPublished)
+      ulWait = ulPublished;
+   while(oARing->ulCqTail - oARing->ulCqHead < ulWait)
+      pthread_cond_wait(&oARing->sCompleted, &oARing->sLock);
+
+   ulCount = oARing->ulCqTail - oARing->ulCqHead;
+   if(ulCount > ulMax)
+      ulCount = ulMax;
+   for(ulIndex = 0; ulIndex < ulCount; ulIndex++)
+      psCqes[ulIndex] = oARing->psCq[oARing->ulCqHead++ & oARing->ulMask];
+   pthread_mutex_unlock(&oARing->sLock);
+
+   oARing->ulInFlight -= ulCount;
+   return ulCount;
+}
@@ -0,0 +1,110 @@
+/*--------------------------------------------------------------------*/
+/* asyncFT.h                                                          */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+#ifndef ASYNCFT_INCLUDED
+#define ASYNCFT_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+#include "opFT.h"
+
+/*
+  Asynchronous FT operations through a pair of rings, in the manner
+  of io_uring. The caller fills submission entries, publishes them
+  with AsyncFT_submit and goes on with other work; worker threads run
+  the operations, and their results appear on the completion ring,
+  to be collected with AsyncFT_reap, not necessarily in the order
+  they were submitted.
+
+  Operations run against the process's one FT, which must be
+  compiled with -DFT_THREADSAFE. The rings are spread over the
+  workers by the top-level directory each path is under: operations
+  under different top-level directories cannot affect one another,
+  so they run in parallel. Each worker takes all the operations
+  queued for it at once and runs them in an order that leaves every
+  result as if they had run in submission order. Operations on
+  unrelated paths commute, so within each run of such operations it
+  sorts them by path, and those under one directory then reuse each
+  other's traversal (the FT resumes from where the last one
+  stopped). Operations on the root itself, FT_init, FT_destroy and
+  FT_toString are barriers: they start once everything submitted
+  before them is done, and everything submitted after waits for them.
+  So is every operation while the FT has no root directory, since any
+  insertion might create it.
+
+  A ring must only be used by one thread at a time.
+*/
+
+/* A pair of rings and the workers that serve them */
+typedef struct AsyncFT *AsyncFT_T;
+
+/* A submission: an operation and its arguments */
+struct AsyncFT_Sqe {
+   enum OpFT eOp;
+   /* must stay valid until the operation's completion is reaped;
+      NULL for FT_init, FT_destroy and FT_toString */
+   const char *pcPath;
+   /* for FT_insertFile and FT_replaceFileContents, with the FT's
+      usual ownership */
+   void *pvContents;
+   size_t ulLength;
+   /* returned as is in the completion */
+   void *pvUser;
+};
+
+/* A completion: the result of one submission */
+struct AsyncFT_Cqe {
+   void *pvUser;
+   enum OpFT eOp;
+   /* the status returned, or the boolean result of FT_containsDir
+      and FT_containsFile */
+   int iStatus;
+   /* for FT_stat */
+   boolean bIsFile;
+   size_t ulSize;
+   /* for FT_getFileContents, a copy of the contents, or NULL for an
+      empty file; for FT_replaceFileContents and FT_toString, what
+      they returned. The caller owns and frees each of these. */
+   void *pvData;
+};
+
+/*
+  Returns a new pair of rings with room for ulEntries operations in
+  flight (submitted or waiting to be reaped), rounded up to a power
+  of two, served by ulWorkers worker threads. Returns NULL if memory
+  or the threads could not be allocated.
+*/
+AsyncFT_T AsyncFT_new(size_t ulEntries, size_t ulWorkers);
+
+/*
+  Waits for every submitted operation to finish, then stops the
+  workers and frees oARing. Completions that were not reaped are
+  discarded, and the data they carry that the caller would own is
+  freed.
+*/
+void AsyncFT_free(AsyncFT_T oARing);
+
+/*
+  Returns the next free submission entry for the caller to fill, or
+  NULL if the ring has as many operations in flight as it can hold.
+  The entry is not seen by the workers until AsyncFT_submit.
+*/
+struct AsyncFT_Sqe *AsyncFT_getSqe(AsyncFT_T oARing);
+
+/*
+  Publishes every entry filled since the last call to the workers.
+  Returns how many were published.
+*/
+size_t AsyncFT_submit(AsyncFT_T oARing);
+
+/*
+  Moves up to ulMax completions into psCqes, first waiting until at
+  least ulWait (at most ulMax) are available. Returns how many were
+  moved.
+*/
+size_t AsyncFT_reap(AsyncFT_T oARing, struct AsyncFT_Cqe *psCqes,
+                    size_t ulMax, size_t ulWait);
+
+#endif
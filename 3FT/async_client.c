@@ -0,0 +1,225 @@
+/*--------------------------------------------------------------------*/
+/* async_client.c                                                     */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "asyncFT.h"
+#include "ft.h"
+
+/*
+  Tests asyncFT.c against the thread-safe FT: checks the rings'
+  capacity, that results are as if operations ran in submission
+  order, for operations on one path and across top-level directories
+  served by different workers, that barriers see everything before
+  them, that contents come back as copies the caller owns, and that
+  AsyncFT_free frees completions never reaped. Prints the tree along
+  the way to stderr.
+*/
+
+/* Entries asked for; the ring rounds them up to RING_ENTRIES */
+enum { ASKED_ENTRIES = 50, RING_ENTRIES = 64 };
+
+/* Workers serving the ring */
+enum { WORKERS = 4 };
+
+/* Top-level directories the ordering check spreads its work over,
+   and operations it runs on each */
+enum { TOP_DIRS = 5, DIR_OPS = 11 };
+
+/*
+  Submits the ulCount operations of psOps, reaps their completions
+  and stores each in psCqes at its operation's index.
+*/
+static void runAll(AsyncFT_T oARing, const struct AsyncFT_Sqe *psOps,
+                   struct AsyncFT_Cqe *psCqes, size_t ulCount) {
+   struct AsyncFT_Cqe asReaped[RING_ENTRIES];
+   struct AsyncFT_Sqe *psSqe;
+   size_t ulIndex, ulDone, ulReaped;
+
+   for(ulIndex = 0; ulIndex < ulCount; ulIndex++) {
+      psSqe = AsyncFT_getSqe(oARing);
+      assert(psSqe != NULL);
+      *psSqe = psOps[ulIndex];
+      psSqe->pvUser = psCqes + ulIndex;
+   }
+   assert(AsyncFT_submit(oARing) == ulCount);
+
+   for(ulDone = 0; ulDone < ulCount; ulDone += ulReaped) {
+      ulReaped = AsyncFT_reap(oARing, asReaped, RING_ENTRIES, 1);
+      assert(ulReaped > 0);
+      for(ulIndex = 0; ulIndex < ulReaped; ulIndex++)
+         *(struct AsyncFT_Cqe *) asReaped[ulIndex].pvUser =
+            asReaped[ulIndex];
+   }
+}
+
+/* Sets *psSqe to the operation eOp on pcPath, with no contents */
+static void setOp(struct AsyncFT_Sqe *psSqe, enum OpFT eOp,
+                  const char *pcPath) {
+   memset(psSqe, 0, sizeof(*psSqe));
+   psSqe->eOp = eOp;
+   psSqe->pcPath = pcPath;
+}
+
+/* Checks that the ring holds exactly RING_ENTRIES operations */
+static void testCapacity(AsyncFT_T oARing) {
+   struct AsyncFT_Cqe asCqes[RING_ENTRIES];
+   struct AsyncFT_Sqe *psSqe;
+   size_t ulIndex;
+
+   for(ulIndex = 0; ulIndex < RING_ENTRIES; ulIndex++) {
+      psSqe = AsyncFT_getSqe(oARing);
+      assert(psSqe != NULL);
+      setOp(psSqe, OPFT_CONTAINS_DIR, "1root/x");
+   }
+   assert(AsyncFT_getSqe(oARing) == NULL);
+   assert(AsyncFT_submit(oARing) == RING_ENTRIES);
+   assert(AsyncFT_reap(oARing, asCqes, RING_ENTRIES, RING_ENTRIES) ==
+          RING_ENTRIES);
+   for(ulIndex = 0; ulIndex < RING_ENTRIES; ulIndex++)
+      assert(asCqes[ulIndex].iStatus == FALSE);
+}
+
+/*
+  Runs DIR_OPS operations on each of TOP_DIRS directories under
+  1root, interleaved across the directories, and checks that each
+  gave the result it would have in submission order.
+*/
+static void testOrder(AsyncFT_T oARing) {
+   char aacDir[TOP_DIRS][16], aacFile[TOP_DIRS][16], aacSub[TOP_DIRS][16];
+   struct AsyncFT_Sqe asOps[TOP_DIRS * DIR_OPS], *psOp;
+   struct AsyncFT_Cqe asCqes[TOP_DIRS * DIR_OPS], *psCqe;
+   size_t ulDir, ulStep;
+
+   for(ulDir = 0; ulDir < TOP_DIRS; ulDir++) {
+      sprintf(aacDir[ulDir], "1root/d%lu", (unsigned long) ulDir);
+      sprintf(aacFile[ulDir], "%s/f", aacDir[ulDir]);
+      sprintf(aacSub[ulDir], "%s/a", aacDir[ulDir]);
+   }
+
+   /* step-major, so that each directory's operations are spread over
+      the whole submission */
+   for(ulStep = 0; ulStep < DIR_OPS; ulStep++)
+      for(ulDir = 0; ulDir < TOP_DIRS; ulDir++) {
+         psOp = &asOps[ulStep * TOP_DIRS + ulDir];
+         switch(ulStep) {
+         case 0: setOp(psOp, OPFT_INSERT_DIR, aacDir[ulDir]); break;
+         case 1:
+            setOp(psOp, OPFT_INSERT_FILE, aacFile[ulDir]);
+            psOp->pvContents = "Ritchie";
+            psOp->ulLength = strlen("Ritchie") + 1;
+            break;
+         case 2: setOp(psOp, OPFT_INSERT_DIR, aacSub[ulDir]); break;
+         case 3: setOp(psOp, OPFT_CONTAINS_FILE, aacFile[ulDir]); break;
+         case 4:
+            setOp(psOp, OPFT_REPLACE_CONTENTS, aacFile[ulDir]);
+            psOp->pvContents = "Thompson";
+            psOp->ulLength = strlen("Thompson") + 1;
+            break;
+         case 5: setOp(psOp, OPFT_CONTAINS_DIR, aacSub[ulDir]); break;
+         case 6: setOp(psOp, OPFT_STAT, aacFile[ulDir]); break;
+         case 7: setOp(psOp, OPFT_RM_FILE, aacFile[ulDir]); break;
+         case 8: setOp(psOp, OPFT_CONTAINS_FILE, aacFile[ulDir]); break;
+         case 9: setOp(psOp, OPFT_INSERT_DIR, aacFile[ulDir]); break;
+         default: setOp(psOp, OPFT_RM_DIR, aacSub[ulDir]); break;
+         }
+      }
+   runAll(oARing, asOps, asCqes, TOP_DIRS * DIR_OPS);
+
+   for(ulStep = 0; ulStep < DIR_OPS; ulStep++)
+      for(ulDir = 0; ulDir < TOP_DIRS; ulDir++) {
+         psCqe = &asCqes[ulStep * TOP_DIRS + ulDir];
+         assert(psCqe->eOp == asOps[ulStep * TOP_DIRS + ulDir].eOp);
+         switch(ulStep) {
+         case 3: case 5: assert(psCqe->iStatus == TRUE); break;
+         case 8: assert(psCqe->iStatus == FALSE); break;
+         case 4:
+            assert(psCqe->iStatus == SUCCESS);
+            assert(psCqe->pvData != NULL &&
+                   !strcmp(psCqe->pvData, "Ritchie"));
+            free(psCqe->pvData);
+            break;
+         case 6:
+            assert(psCqe->iStatus == SUCCESS && psCqe->bIsFile == TRUE);
+            assert(psCqe->ulSize == strlen("Thompson") + 1);
+            break;
+         default: assert(psCqe->iStatus == SUCCESS); break;
+         }
+      }
+}
+
+/* Runs the checks with one ring. Returns 0. */
+int main(void) {
+   struct AsyncFT_Sqe asOps[2];
+   struct AsyncFT_Cqe asCqes[2];
+   AsyncFT_T oARing;
+   char acExpected[256];
+   size_t ulDir;
+
+   oARing = AsyncFT_new(ASKED_ENTRIES, WORKERS);
+   assert(oARing != NULL);
+   testCapacity(oARing);
+
+   /* barriers: the root is only made once the FT is initialized */
+   setOp(&asOps[0], OPFT_INIT, NULL);
+   setOp(&asOps[1], OPFT_INSERT_DIR, "1root");
+   runAll(oARing, asOps, asCqes, 2);
+   assert(asCqes[0].iStatus == SUCCESS && asCqes[1].iStatus == SUCCESS);
+
+   testOrder(oARing);
+
+   /* FT_toString is a barrier, so it sees everything before it */
+   setOp(&asOps[0], OPFT_TO_STRING, NULL);
+   runAll(oARing, asOps, asCqes, 1);
+   assert(asCqes[0].iStatus == SUCCESS && asCqes[0].pvData != NULL);
+   fprintf(stderr, "Checkpoint 1:\n%s\n", (char *) asCqes[0].pvData);
+   strcpy(acExpected, "Dir:  1root\n");
+   for(ulDir = 0; ulDir < TOP_DIRS; ulDir++)
+      sprintf(acExpected + strlen(acExpected),
+              "Dir:  1root/d%lu\nDir:  1root/d%lu/f\n",
+              (unsigned long) ulDir, (unsigned long) ulDir);
+   assert(!strcmp(asCqes[0].pvData, acExpected));
+   free(asCqes[0].pvData);
+
+   /* contents come back as a copy, which outlives the file */
+   setOp(&asOps[0], OPFT_INSERT_FILE, "1root/g");
+   asOps[0].pvContents = "Ritchie";
+   asOps[0].ulLength = strlen("Ritchie") + 1;
+   runAll(oARing, asOps, asCqes, 1);
+   assert(asCqes[0].iStatus == SUCCESS);
+   setOp(&asOps[0], OPFT_GET_CONTENTS, "1root/g");
+   setOp(&asOps[1], OPFT_RM_FILE, "1root/g");
+   runAll(oARing, asOps, asCqes, 2);
+   assert(asCqes[0].iStatus == SUCCESS && asCqes[1].iStatus == SUCCESS);
+   assert(asCqes[0].ulSize == strlen("Ritchie") + 1);
+   assert(asCqes[0].pvData != NULL && !strcmp(asCqes[0].pvData, "Ritchie"));
+   free(asCqes[0].pvData);
+
+   /* so is FT_destroy, and nothing after it finds the old tree */
+   setOp(&asOps[0], OPFT_DESTROY, NULL);
+   setOp(&asOps[1], OPFT_CONTAINS_DIR, "1root/d0");
+   runAll(oARing, asOps, asCqes, 2);
+   assert(asCqes[0].iStatus == SUCCESS && asCqes[1].iStatus == FALSE);
+
+   /* a completion never reaped is freed with the ring */
+   setOp(&asOps[0], OPFT_INIT, NULL);
+   setOp(&asOps[1], OPFT_INSERT_DIR, "1root");
+   runAll(oARing, asOps, asCqes, 2);
+   setOp(&asOps[0], OPFT_INSERT_FILE, "1root/g");
+   asOps[0].pvContents = "Ritchie";
+   asOps[0].ulLength = strlen("Ritchie") + 1;
+   runAll(oARing, asOps, asCqes, 1);
+   setOp(AsyncFT_getSqe(oARing), OPFT_GET_CONTENTS, "1root/g");
+   setOp(AsyncFT_getSqe(oARing), OPFT_TO_STRING, NULL);
+   assert(AsyncFT_submit(oARing) == 2);
+   AsyncFT_free(oARing);
+
+   assert(FT_containsDir("1root") == TRUE);
+   assert(FT_destroy() == SUCCESS);
+   return 0;
+}
@@ -0,0 +1,139 @@
+/*--------------------------------------------------------------------*/
+/* batch_client.c                                                     */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "ft.h"
+
+/*
+  Tests FT_statBatch and FT_insertBatch: checks the status, and for
+  FT_statBatch the type and size, stored for every entry of batches
+  that mix what succeeds with misses, bad paths, paths through a file
+  and paths outside the root, in batches longer than the number of
+  lookups FT_statBatch walks together, and checks that each agrees
+  with the single-path call. Prints the tree along the way to stderr.
+*/
+
+/* Entries in each batch checked, more than FT_statBatch walks at once */
+enum { ENTRIES = 20 };
+
+/* The expected result of one entry of a batch */
+struct entry {
+   const char *pcPath;
+   int iStatus;
+   boolean bIsFile;
+   size_t ulSize;
+};
+
+/* Runs the checks. Returns 0. */
+int main(void) {
+   /* the tree built by the insertion batch below */
+   static const struct entry asStats[ENTRIES] = {
+      {"1root", SUCCESS, FALSE, 0},
+      {"1root/a/C", SUCCESS, TRUE, 8},
+      {"1root/none", NO_SUCH_PATH, FALSE, 0},
+      {"1root/a", SUCCESS, FALSE, 0},
+      {"1root//a", BAD_PATH, FALSE, 0},
+      {"1root/a/C/below", NOT_A_DIRECTORY, FALSE, 0},
+      {"1root/a/b/c/d", SUCCESS, FALSE, 0},
+      {"2root/a", CONFLICTING_PATH, FALSE, 0},
+      {"1root/a/empty", SUCCESS, TRUE, 0},
+      {"1root/a/b/c/d/e", NO_SUCH_PATH, FALSE, 0},
+      {"", BAD_PATH, FALSE, 0},
+      {"1root/a/b", SUCCESS, FALSE, 0},
+      {"1root/a/C/below/deeper", NOT_A_DIRECTORY, FALSE, 0},
+      {"1root/a/b/c", SUCCESS, FALSE, 0},
+      {"1root/x/y", NO_SUCH_PATH, FALSE, 0},
+      {"1root/a/b/c/d/K", SUCCESS, TRUE, 10},
+      {"1root/", BAD_PATH, FALSE, 0},
+      {"1root/a/C", SUCCESS, TRUE, 8},
+      {"1root/a/b/none", NO_SUCH_PATH, FALSE, 0},
+      {"1root/a/b/c/d/K", SUCCESS, TRUE, 10}
+   };
+   /* what each insertion returns, in order: later entries depend on
+      earlier ones of the same batch */
+   static const struct entry asInserts[] = {
+      {"1root/a", SUCCESS, FALSE, 0},
+      {"1root/a/C", SUCCESS, TRUE, 8},
+      {"1root/a/C", ALREADY_IN_TREE, TRUE, 8},
+      {"1root/a/C/below", NOT_A_DIRECTORY, FALSE, 0},
+      {"1root/a/b/c/d", SUCCESS, FALSE, 0},
+      {"1root//b", BAD_PATH, FALSE, 0},
+      {"1root/a/empty", SUCCESS, TRUE, 0},
+      {"2root", CONFLICTING_PATH, FALSE, 0},
+      {"1root/a/b/c/d/K", SUCCESS, TRUE, 10},
+      {"1root/a/b", ALREADY_IN_TREE, FALSE, 0},
+      {"1root/a/C/x/y", NOT_A_DIRECTORY, TRUE, 3}
+   };
+   enum { INSERTS = sizeof(asInserts) / sizeof(asInserts[0]) };
+   const char *apcPaths[ENTRIES];
+   void *apvContents[ENTRIES];
+   size_t aulSizes[ENTRIES];
+   boolean abIsFile[ENTRIES];
+   int aiStatus[ENTRIES];
+   size_t ulIndex, ulSize;
+   boolean bIsFile;
+   char *pcText;
+
+   for(ulIndex = 0; ulIndex < ENTRIES; ulIndex++)
+      apcPaths[ulIndex] = asStats[ulIndex].pcPath;
+   assert(FT_statBatch(apcPaths, ENTRIES, aiStatus, abIsFile, aulSizes) ==
+          INITIALIZATION_ERROR);
+
+   assert(FT_init() == SUCCESS);
+   assert(FT_insertDir("1root") == SUCCESS);
+
+   /* insertions, with files and directories mixed */
+   for(ulIndex = 0; ulIndex < INSERTS; ulIndex++) {
+      apcPaths[ulIndex] = asInserts[ulIndex].pcPath;
+      abIsFile[ulIndex] = asInserts[ulIndex].bIsFile;
+      apvContents[ulIndex] = asInserts[ulIndex].ulSize == 10 ? "Kernighan"
+                                                             : "Ritchie";
+      aulSizes[ulIndex] = asInserts[ulIndex].ulSize;
+      aiStatus[ulIndex] = -1;
+   }
+   assert(FT_insertBatch(apcPaths, INSERTS, abIsFile, apvContents,
+                         aulSizes, aiStatus) == SUCCESS);
+   for(ulIndex = 0; ulIndex < INSERTS; ulIndex++)
+      assert(aiStatus[ulIndex] == asInserts[ulIndex].iStatus);
+   assert(!strcmp(FT_getFileContents("1root/a/C"), "Ritchie"));
+   assert(!strcmp(FT_getFileContents("1root/a/b/c/d/K"), "Kernighan"));
+   assert((pcText = FT_toString()) != NULL);
+   fprintf(stderr, "Checkpoint 1:\n%s\n", pcText);
+   free(pcText);
+
+   /* lookups, each checked against the batch and against FT_stat */
+   for(ulIndex = 0; ulIndex < ENTRIES; ulIndex++) {
+      apcPaths[ulIndex] = asStats[ulIndex].pcPath;
+      aiStatus[ulIndex] = -1;
+   }
+   assert(FT_statBatch(apcPaths, ENTRIES, aiStatus, abIsFile, aulSizes) ==
+          SUCCESS);
+   for(ulIndex = 0; ulIndex < ENTRIES; ulIndex++) {
+      assert(aiStatus[ulIndex] == asStats[ulIndex].iStatus);
+      assert(FT_stat(apcPaths[ulIndex], &bIsFile, &ulSize) ==
+             aiStatus[ulIndex]);
+      if(aiStatus[ulIndex] != SUCCESS)
+         continue;
+      assert(abIsFile[ulIndex] == asStats[ulIndex].bIsFile &&
+             abIsFile[ulIndex] == bIsFile);
+      if(bIsFile)
+         assert(aulSizes[ulIndex] == asStats[ulIndex].ulSize &&
+                aulSizes[ulIndex] == ulSize);
+   }
+
+   /* an empty batch, and a batch after the tree is destroyed */
+   assert(FT_statBatch(apcPaths, 0, aiStatus, abIsFile, aulSizes) ==
+          SUCCESS);
+   assert(FT_insertBatch(apcPaths, 0, abIsFile, apvContents, aulSizes,
+                         aiStatus) == SUCCESS);
+   assert(FT_destroy() == SUCCESS);
+   assert(FT_insertBatch(apcPaths, 1, abIsFile, apvContents, aulSizes,
+                         aiStatus) == INITIALIZATION_ERROR);
+   return 0;
+}
@@ -0,0 +1,392 @@
+/*--------------------------------------------------------------------*/
+/* bench.c                                                            */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+/* getrusage is POSIX, not C99, and syscall is neither */
+#define _POSIX_C_SOURCE 200112L
+#define _DEFAULT_SOURCE
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+#include "bench.h"
+
+/* A Zipf sampler is the cumulative distribution over its ranks */
+struct zipf {
+   /* number of ranks */
+   size_t ulN;
+   /* adCdf[r] is the probability of drawing a rank <= r */
+   double *adCdf;
+};
+
+/* File descriptors of the open hardware counters, -1 if not open.
+   The first one open leads the group the others join, so all are
+   scheduled together and read at once through the leader. */
+static int aiCounterFds[BENCH_NUM_COUNTERS] = { -1, -1, -1, -1, -1, -1 };
+
+/* What each counter reads across an empty bracket: the cost of
+   Bench_perfRead itself, subtracted by Bench_perfAdd */
+static unsigned long aulBaseline[BENCH_NUM_COUNTERS];
+
+/* Number of malloc-family calls made by the whole program */
+static unsigned long ulAllocs;
+
+/* The real allocator, reached through the linker's --wrap option */
+void *__real_malloc(size_t ulSize);
+void *__real_calloc(size_t ulCount, size_t ulSize);
+void *__real_realloc(void *pvOld, size_t ulSize);
+
+/* Counting replacements, installed by the linker's --wrap option */
+void *__wrap_malloc(size_t ulSize);
+void *__wrap_calloc(size_t ulCount, size_t ulSize);
+void *__wrap_realloc(void *pvOld, size_t ulSize);
+
+void *__wrap_malloc(size_t ulSize) {
+   (void) __atomic_fetch_add(&ulAllocs, 1, __ATOMIC_RELAXED);
+   return __real_malloc(ulSize);
+}
+
+void *__wrap_calloc(size_t ulCount, size_t ulSize) {
+   (void) __atomic_fetch_add(&ulAllocs, 1, __ATOMIC_RELAXED);
+   return __real_calloc(ulCount, ulSize);
+}
+
+void *__wrap_realloc(void *pvOld, size_t ulSize) {
+   (void) __atomic_fetch_add(&ulAllocs, 1, __ATOMIC_RELAXED);
+   return __real_realloc(pvOld, ulSize);
+}
+
+unsigned long Bench_rand(unsigned long *pulState) {
+   unsigned long ulX;
+
+   assert(pulState != NULL);
+   assert(*pulState != 0);
+
+   ulX = *pulState;
+   ulX ^= ulX >> 12;
+   ulX ^= ulX << 25;
+   ulX ^= ulX >> 27;
+   *pulState = ulX;
+   return ulX * 2685821657736338717UL;
+}
+
+unsigned long Bench_seed(unsigned long ulSeed) {
+   /* one splitmix64 step, so that nearby seeds diverge at once */
+   ulSeed += 0x9e3779b97f4a7c15UL;
+   ulSeed = (ulSeed ^ (ulSeed >> 30)) * 0xbf58476d1ce4e5b9UL;
+   ulSeed = (ulSeed ^ (ulSeed >> 27)) * 0x94d049bb133111ebUL;
+   ulSeed ^= ulSeed >> 31;
+   return ulSeed != 0 ? ulSeed : 1;
+}
+
+double Bench_uniform(unsigned long *pulState) {
+   return (double) (Bench_rand(pulState) >> 11) / 9007199254740992.0;
+}
+
+Zipf_T Bench_zipfNew(size_t ulN, double dS) {
+   Zipf_T oZipf;
+   double dSum = 0.0;
+   size_t ulRank;
+
+   assert(ulN > 0);
+
+   oZipf = malloc(sizeof(struct zipf));
+   if(oZipf == NULL)
+      return NULL;
+   oZipf->adCdf = malloc(ulN * sizeof(double));
+   if(oZipf->adCdf == NULL) {
+      free(oZipf);
+      return NULL;
+   }
+   oZipf->ulN = ulN;
+
+   for(ulRank = 0; ulRank < ulN; ulRank++) {
+      dSum += 1.0 / pow((double) (ulRank + 1), dS);
+      oZipf->adCdf[ulRank] = dSum;
+   }
+   for(ulRank = 0; ulRank < ulN; ulRank++)
+      oZipf->adCdf[ulRank] /= dSum;
+
+   return oZipf;
+}
+
+size_t Bench_zipfNext(Zipf_T oZipf, unsigned long *pulState) {
+   double dU;
+   size_t ulLo = 0, ulHi;
+
+   assert(oZipf != NULL);
+
+   /* find the first rank whose cumulative probability exceeds dU */
+   dU = Bench_uniform(pulState);
+   ulHi = oZipf->ulN - 1;
+   while(ulLo < ulHi) {
+      size_t ulMid = ulLo + (ulHi - ulLo) / 2;
+      if(oZipf->adCdf[ulMid] > dU)
+         ulHi = ulMid;
+      else
+         ulLo = ulMid + 1;
+   }
+   return ulLo;
+}
+
+void Bench_zipfFree(Zipf_T oZipf) {
+   if(oZipf != NULL)
+      free(oZipf->adCdf);
+   free(oZipf);
+}
+
+/*
+  Compares the unsigned longs that pv1 and pv2 point to, for qsort.
+*/
+static int Bench_compareULong(const void *pv1, const void *pv2) {
+   unsigned long ul1 = *(const unsigned long *) pv1;
+   unsigned long ul2 = *(const unsigned long *) pv2;
+
+   return (ul1 > ul2) - (ul1 < ul2);
+}
+
+void Bench_sort(unsigned long *aulValues, size_t ulN) {
+   assert(aulValues != NULL || ulN == 0);
+
+   if(ulN > 1)
+      qsort(aulValues, ulN, sizeof(unsigned long), Bench_compareULong);
+}
+
+unsigned long Bench_percentile(const unsigned long *aulSorted,
+                               size_t ulN, double dPercentile) {
+   size_t ulIndex;
+
+   assert(aulSorted != NULL || ulN == 0);
+
+   if(ulN == 0)
+      return 0;
+
+   ulIndex = (size_t) (dPercentile / 100.0 * (double) (ulN - 1) + 0.5);
+   if(ulIndex >= ulN)
+      ulIndex = ulN - 1;
+   return aulSorted[ulIndex];
+}
+
+unsigned long Bench_mad(const unsigned long *aulSorted, size_t ulN,
+                        unsigned long ulMedian) {
+   unsigned long *aulDev;
+   unsigned long ulMad;
+   size_t ulIndex;
+
+   assert(aulSorted != NULL || ulN == 0);
+
+   if(ulN == 0)
+      return 0;
+
+   aulDev = malloc(ulN * sizeof(unsigned long));
+   if(aulDev == NULL)
+      return 0;
+   for(ulIndex = 0; ulIndex < ulN; ulIndex++)
+      aulDev[ulIndex] = aulSorted[ulIndex] > ulMedian ?
+                        aulSorted[ulIndex] - ulMedian :
+                        ulMedian - aulSorted[ulIndex];
+   Bench_sort(aulDev, ulN);
+   ulMad = Bench_percentile(aulDev, ulN, 50.0);
+   free(aulDev);
+   return ulMad;
+}
+
+unsigned long Bench_allocCount(void) {
+   return __atomic_load_n(&ulAllocs, __ATOMIC_RELAXED);
+}
+
+long Bench_peakRssKB(void) {
+   struct rusage sUsage;
+
+   if(getrusage(RUSAGE_SELF, &sUsage) != 0)
+      return -1;
+   return sUsage.ru_maxrss;
+}
+
+const char *Bench_perfName(enum BenchCounter eCounter) {
+   static const char *const apcNames[BENCH_NUM_COUNTERS] = {
+      "cycles", "instrs", "L1D miss", "LLC miss", "br miss", "dTLB miss"
+   };
+
+   assert((int) eCounter >= 0 && eCounter < BENCH_NUM_COUNTERS);
+   return apcNames[eCounter];
+}
+
+#ifdef __linux__
+/* Number of empty brackets whose median is the baseline */
+enum { BASELINE_BRACKETS = 101 };
+
+/* Returns the file descriptor of the group leader, or -1 if no
+   counter is open */
+static int leaderFd(void) {
+   int iCounter;
+
+   for(iCounter = 0; iCounter < BENCH_NUM_COUNTERS; iCounter++)
+      if(aiCounterFds[iCounter] >= 0)
+         return aiCounterFds[iCounter];
+   return -1;
+}
+
+/* Sets aulBaseline to the median of what each counter reads across
+   BASELINE_BRACKETS empty brackets */
+static void measureBaseline(void) {
+   unsigned long aulBefore[BENCH_NUM_COUNTERS];
+   unsigned long aulAfter[BENCH_NUM_COUNTERS];
+   unsigned long aaulDeltas[BENCH_NUM_COUNTERS][BASELINE_BRACKETS];
+   int iCounter, iBracket;
+
+   for(iBracket = 0; iBracket < BASELINE_BRACKETS; iBracket++) {
+      Bench_perfRead(aulBefore);
+      Bench_perfRead(aulAfter);
+      for(iCounter = 0; iCounter < BENCH_NUM_COUNTERS; iCounter++)
+         aaulDeltas[iCounter][iBracket] =
+            aulAfter[iCounter] > aulBefore[iCounter]
+               ? aulAfter[iCounter] - aulBefore[iCounter] : 0;
+   }
+   for(iCounter = 0; iCounter < BENCH_NUM_COUNTERS; iCounter++) {
+      Bench_sort(aaulDeltas[iCounter], BASELINE_BRACKETS);
+      aulBaseline[iCounter] = Bench_percentile(aaulDeltas[iCounter],
+                                               BASELINE_BRACKETS, 50.0);
+   }
+}
+
+int Bench_perfOpen(void) {
+   /* perf_event_attr type and config for each enum BenchCounter */
+   static const struct { unsigned int uiType; unsigned long ulConfig; }
+   asEvents[BENCH_NUM_COUNTERS] = {
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+      { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                            (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                            (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+      { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB |
+                            (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                            (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) }
+   };
+   struct perf_event_attr sAttr;
+   int iCounter, iOpened = 0;
+
+   if(leaderFd() >= 0) {
+      for(iCounter = 0; iCounter < BENCH_NUM_COUNTERS; iCounter++)
+         if(aiCounterFds[iCounter] >= 0)
+            iOpened++;
+      return iOpened;
+   }
+
+   for(iCounter = 0; iCounter < BENCH_NUM_COUNTERS; iCounter++) {
+      memset(&sAttr, 0, sizeof(sAttr));
+      sAttr.size = sizeof(sAttr);
+      sAttr.type = asEvents[iCounter].uiType;
+      sAttr.config = asEvents[iCounter].ulConfig;
+      sAttr.exclude_kernel = 1;
+      sAttr.exclude_hv = 1;
+      sAttr.read_format = PERF_FORMAT_GROUP |
+                          PERF_FORMAT_TOTAL_TIME_ENABLED |
+                          PERF_FORMAT_TOTAL_TIME_RUNNING;
+      /* a counter the group can never fit with the others fails to
+         open here, and is left out */
+      aiCounterFds[iCounter] = (int) syscall(SYS_perf_event_open, &sAttr,
+                                             0, -1, leaderFd(), 0UL);
+      if(aiCounterFds[iCounter] >= 0)
+         iOpened++;
+      else
+         aiCounterFds[iCounter] = -1;
+   }
+   if(iOpened > 0)
+      measureBaseline();
+   return iOpened;
+}
+
+void Bench_perfRead(unsigned long aulValues[]) {
+   /* number of counters, time enabled, time running, then a value
+      for each open counter in enum BenchCounter order */
+   unsigned long aulRead[3 + BENCH_NUM_COUNTERS];
+   ssize_t lBytes;
+   size_t ulValue = 0;
+   int iCounter, iLeader;
+   double dScale = 1.0;
+
+   assert(aulValues != NULL);
+
+   for(iCounter = 0; iCounter < BENCH_NUM_COUNTERS; iCounter++)
+      aulValues[iCounter] = 0;
+   iLeader = leaderFd();
+   if(iLeader < 0)
+      return;
+   lBytes = read(iLeader, aulRead, sizeof(aulRead));
+   if(lBytes < (ssize_t) (3 * sizeof(unsigned long)) ||
+      (size_t) lBytes < (3 + aulRead[0]) * sizeof(unsigned long))
+      return;
+   if(aulRead[2] != 0 && aulRead[2] < aulRead[1])
+      dScale = (double) aulRead[1] / (double) aulRead[2];
+
+   for(iCounter = 0; iCounter < BENCH_NUM_COUNTERS &&
+                     ulValue < aulRead[0]; iCounter++) {
+      if(aiCounterFds[iCounter] < 0)
+         continue;
+      aulValues[iCounter] = (unsigned long) ((double) aulRead[3 + ulValue]
+                                             * dScale);
+      ulValue++;
+   }
+}
+
+void Bench_perfClose(void) {
+   int iCounter;
+
+   /* siblings first, then the leader */
+   for(iCounter = BENCH_NUM_COUNTERS - 1; iCounter >= 0; iCounter--)
+      if(aiCounterFds[iCounter] >= 0) {
+         (void) close(aiCounterFds[iCounter]);
+         aiCounterFds[iCounter] = -1;
+      }
+   memset(aulBaseline, 0, sizeof(aulBaseline));
+}
+#else
+int Bench_perfOpen(void) {
+   return 0;
+}
+
+void Bench_perfRead(unsigned long aulValues[]) {
+   int iCounter;
+
+   assert(aulValues != NULL);
+
+   for(iCounter = 0; iCounter < BENCH_NUM_COUNTERS; iCounter++)
+      aulValues[iCounter] = 0;
+}
+
+void Bench_perfClose(void) {
+}
+#endif
+
+int Bench_perfIsOpen(enum BenchCounter eCounter) {
+   assert((int) eCounter >= 0 && eCounter < BENCH_NUM_COUNTERS);
+   return aiCounterFds[eCounter] >= 0;
+}
+
+void Bench_perfAdd(unsigned long aulTotals[], const unsigned long aulBefore[],
+                   const unsigned long aulAfter[]) {
+   unsigned long ulDelta;
+   int iCounter;
+
+   assert(aulTotals != NULL);
+   assert(aulBefore != NULL);
+   assert(aulAfter != NULL);
+
+   for(iCounter = 0; iCounter < BENCH_NUM_COUNTERS; iCounter++) {
+      ulDelta = aulAfter[iCounter] > aulBefore[iCounter]
+                   ? aulAfter[iCounter] - aulBefore[iCounter] : 0;
+      if(ulDelta > aulBaseline[iCounter])
+         aulTotals[iCounter] += ulDelta - aulBaseline[iCounter];
+   }
+}
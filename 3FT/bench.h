@@ -0,0 +1,117 @@
+/*--------------------------------------------------------------------*/
+/* bench.h                                                            */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+#ifndef BENCH_INCLUDED
+#define BENCH_INCLUDED
+
+#include <stddef.h>
+
+/*
+  Helpers shared by the benchmark programs: a fast random number
+  generator, a Zipfian sampler, order statistics, and process-level
+  resource accounting. Programs using this module must be linked with
+  -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc so that allocations
+  can be counted (see the Makefile's BENCH_LDFLAGS).
+*/
+
+/*
+  Returns the next pseudo-random 64-bit value from the xorshift64*
+  generator whose state is *pulState, and advances the state.
+  *pulState must not be 0; see Bench_seed.
+*/
+unsigned long Bench_rand(unsigned long *pulState);
+
+/* Returns a generator state derived from ulSeed (which may be 0). */
+unsigned long Bench_seed(unsigned long ulSeed);
+
+/* Returns a pseudo-random value uniformly distributed in [0, 1). */
+double Bench_uniform(unsigned long *pulState);
+
+/* A sampler of ranks 0..n-1 following a Zipf distribution */
+typedef struct zipf *Zipf_T;
+
+/*
+  Returns a sampler that draws rank r in [0, ulN) with probability
+  proportional to 1/(r+1)^dS, or NULL if memory could not be
+  allocated. dS = 0 gives the uniform distribution.
+*/
+Zipf_T Bench_zipfNew(size_t ulN, double dS);
+
+/* Draws one rank from oZipf using the generator state *pulState. */
+size_t Bench_zipfNext(Zipf_T oZipf, unsigned long *pulState);
+
+/* Frees oZipf. */
+void Bench_zipfFree(Zipf_T oZipf);
+
+/* Sorts the ulN values of aulValues into ascending order. */
+void Bench_sort(unsigned long *aulValues, size_t ulN);
+
+/*
+  Returns the value at percentile dPercentile (0.0 to 100.0) of the
+  ulN ascending values in aulSorted, or 0 if ulN is 0.
+*/
+unsigned long Bench_percentile(const unsigned long *aulSorted,
+                               size_t ulN, double dPercentile);
+
+/*
+  Returns the median absolute deviation of the ulN ascending values in
+  aulSorted, whose median is ulMedian. Reorders nothing.
+*/
+unsigned long Bench_mad(const unsigned long *aulSorted, size_t ulN,
+                        unsigned long ulMedian);
+
+/* Returns the number of malloc, calloc and realloc calls so far. */
+unsigned long Bench_allocCount(void);
+
+/* Returns the peak resident set size of this process in kilobytes. */
+long Bench_peakRssKB(void);
+
+/*
+  Hardware event counters, read through Linux perf_event_open. They
+  count user-mode events of the calling thread only, as one group, so
+  they are scheduled together and one read takes all of them. Where a
+  counter cannot be opened (other systems, perf_event_paranoid,
+  virtual machines without a PMU, more events than the PMU can count
+  at once), it is left out and reads as 0.
+*/
+enum BenchCounter { BENCH_CYCLES, BENCH_INSTRUCTIONS, BENCH_L1D_MISSES,
+                    BENCH_LLC_MISSES, BENCH_BRANCH_MISSES,
+                    BENCH_DTLB_MISSES, BENCH_NUM_COUNTERS };
+
+/*
+  Opens and starts every counter for the calling thread, then
+  measures what each reads across an empty bracket of two
+  Bench_perfRead calls, for Bench_perfAdd to subtract. Returns the
+  number of counters that could be opened.
+*/
+int Bench_perfOpen(void);
+
+/* Returns TRUE if counter eCounter was opened, FALSE otherwise. */
+int Bench_perfIsOpen(enum BenchCounter eCounter);
+
+/* Returns a short name for eCounter, for report headings. */
+const char *Bench_perfName(enum BenchCounter eCounter);
+
+/*
+  Stores the current value of every counter in aulValues, which has
+  BENCH_NUM_COUNTERS elements. Values are scaled up when the kernel
+  had to multiplex the counters. Only differences between two reads
+  are meaningful.
+*/
+void Bench_perfRead(unsigned long aulValues[]);
+
+/*
+  Adds to each of the BENCH_NUM_COUNTERS elements of aulTotals what
+  its counter counted between the reads aulBefore and aulAfter, less
+  the empty-bracket baseline measured by Bench_perfOpen, and never
+  less than 0.
+*/
+void Bench_perfAdd(unsigned long aulTotals[], const unsigned long aulBefore[],
+                   const unsigned long aulAfter[]);
+
+/* Closes every counter opened by Bench_perfOpen. */
+void Bench_perfClose(void);
+
+#endif
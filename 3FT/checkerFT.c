@@ -0,0 +1,428 @@
+/*--------------------------------------------------------------------*/
+/* checkerFT.c                                                        */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+#include <stdarg.h>
+#include <stdio.h>
+#include "path.h"
+#include "checkerFT.h"
+
+/* How often CheckerFT_isValidRegion falls back to a full check; can
+   be overridden with -DCHECKERFT_FULL_INTERVAL=n */
+#ifndef CHECKERFT_FULL_INTERVAL
+#define CHECKERFT_FULL_INTERVAL 256
+#endif
+
+/* Longest problem description passed to a report function */
+enum { MAX_MESSAGE = 512 };
+
+/* Where one check sends its findings, and how far it may go */
+struct walk {
+   /* called once per problem found */
+   CheckerFT_Report pfReport;
+   void *pvArg;
+   /* nodes the check may still visit */
+   size_t ulBudget;
+   /* nodes it has visited */
+   size_t ulVisited;
+   /* whether it ran out of budget before finishing */
+   boolean bTruncated;
+};
+
+/* Number of calls to CheckerFT_isValidRegion so far, from every
+   thread under -DFT_PERTHREAD, so only updated atomically */
+static size_t ulRegionChecks;
+
+/* Names of the two kinds of children, for messages */
+static const char *CheckerFT_kind(boolean bIsFile) {
+   return bIsFile ? "file" : "directory";
+}
+
+/* The pathname of node oNNode, for messages */
+static const char *CheckerFT_name(Node_T oNNode) {
+   return Path_getPathname(NodeFT_getPath(oNNode));
+}
+
+/*
+  The report function of the unsampled checks: prints pcProblem to
+  stderr.
+*/
+static void CheckerFT_printReport(const char *pcProblem, void *pvArg) {
+   (void) pvArg;
+   fprintf(stderr, "checkerFT: %s\n", pcProblem);
+}
+
+/*
+  Formats a problem description from pcFormat and the arguments that
+  follow, as printf does, and passes it to psWalk's report function.
+  Always returns FALSE, so that callers can return its result.
+*/
+static boolean CheckerFT_fail(struct walk *psWalk, const char *pcFormat,
+                              ...) {
+   char acMessage[MAX_MESSAGE];
+   va_list ap;
+
+   va_start(ap, pcFormat);
+   (void) vsnprintf(acMessage, sizeof(acMessage), pcFormat, ap);
+   va_end(ap);
+   psWalk->pfReport(acMessage, psWalk->pvArg);
+   return FALSE;
+}
+
+/*
+  Checks oNNode on its own, as CheckerFT_Node_isValid describes,
+  reporting to psWalk.
+*/
+static boolean CheckerFT_checkNode(struct walk *psWalk, Node_T oNNode) {
+   Node_T oNParent;
+   Path_T oPPath, oPParentPath;
+
+   if(oNNode == NULL)
+      return CheckerFT_fail(psWalk, "node is NULL");
+
+   oPPath = NodeFT_getPath(oNNode);
+   oNParent = NodeFT_getParent(oNNode);
+   if(oNParent != NULL) {
+      oPParentPath = NodeFT_getPath(oNParent);
+      if(NodeFT_isFile(oNParent))
+         return CheckerFT_fail(psWalk, "%s has a file (%s) as its parent",
+                               Path_getPathname(oPPath),
+                               Path_getPathname(oPParentPath));
+      if(Path_getDepth(oPPath) != Path_getDepth(oPParentPath) + 1 ||
+         Path_getSharedPrefixDepth(oPPath, oPParentPath) !=
+         Path_getDepth(oPParentPath))
+         return CheckerFT_fail(psWalk, "parent path %s is not node path "
+                               "%s minus its last component",
+                               Path_getPathname(oPParentPath),
+                               Path_getPathname(oPPath));
+   }
+   return TRUE;
+}
+
+boolean CheckerFT_Node_isValid(Node_T oNNode) {
+   struct walk sWalk = { CheckerFT_printReport, NULL, 0, 0, FALSE };
+
+   return CheckerFT_checkNode(&sWalk, oNNode);
+}
+
+/*
+  Checks the state variables on their own: an uninitialized FT has
+  no nodes, the root is missing exactly when the count is 0, and the
+  root is a directory with no parent.
+*/
+static boolean CheckerFT_checkTopLevel(struct walk *psWalk,
+                                       boolean bIsInitialized,
+                                       Node_T oNRoot, size_t ulCount) {
+   if(!bIsInitialized && ulCount != 0)
+      return CheckerFT_fail(psWalk, "FT is not initialized but has %lu "
+                            "nodes", (unsigned long) ulCount);
+   if((oNRoot == NULL) != (ulCount == 0))
+      return CheckerFT_fail(psWalk, "root is %s but the count is %lu",
+                            oNRoot == NULL ? "NULL" : "present",
+                            (unsigned long) ulCount);
+   if(oNRoot != NULL &&
+      (NodeFT_getParent(oNRoot) != NULL || NodeFT_isFile(oNRoot)))
+      return CheckerFT_fail(psWalk, "root %s is a file or has a parent",
+                            CheckerFT_name(oNRoot));
+   return TRUE;
+}
+
+/*
+  Checks child ulIndex of kind bIsFile of directory oNParent on its
+  own and against oNPrev, the child before it (NULL for the first):
+  it must be valid, of the right kind, point back to oNParent, and
+  sort strictly after oNPrev. Strict order between every adjacent
+  pair proves both order and uniqueness in one pass. Stores the
+  child in *poNChild.
+*/
+static boolean CheckerFT_checkChild(struct walk *psWalk, Node_T oNParent,
+                                    size_t ulIndex, boolean bIsFile,
+                                    Node_T oNPrev, Node_T *poNChild) {
+   Node_T oNChild = NULL;
+   int iComparison;
+
+   if(NodeFT_getChild(oNParent, ulIndex, &oNChild, bIsFile) != SUCCESS)
+      return CheckerFT_fail(psWalk, "cannot get %s child %lu of %s",
+                            CheckerFT_kind(bIsFile),
+                            (unsigned long) ulIndex,
+                            CheckerFT_name(oNParent));
+   if(!CheckerFT_checkNode(psWalk, oNChild))
+      return FALSE;
+   if(NodeFT_getParent(oNChild) != oNParent)
+      return CheckerFT_fail(psWalk, "%s does not point back to parent %s",
+                            CheckerFT_name(oNChild),
+                            CheckerFT_name(oNParent));
+   if(NodeFT_isFile(oNChild) != bIsFile)
+      return CheckerFT_fail(psWalk, "%s is stored as a %s child but is "
+                            "not a %s", CheckerFT_name(oNChild),
+                            CheckerFT_kind(bIsFile),
+                            CheckerFT_kind(bIsFile));
+   if(oNPrev != NULL) {
+      iComparison = Path_comparePath(NodeFT_getPath(oNPrev),
+                                     NodeFT_getPath(oNChild));
+      if(iComparison >= 0)
+         return CheckerFT_fail(psWalk, "%s children %s and %s are %s",
+                               CheckerFT_kind(bIsFile),
+                               CheckerFT_name(oNPrev),
+                               CheckerFT_name(oNChild),
+                               iComparison == 0 ? "duplicates"
+                                                : "out of order");
+   }
+   *poNChild = oNChild;
+   return TRUE;
+}
+
+/*
+  Checks that no name is used by both a file child and a directory
+  child of oNDir, by merging the two sorted child arrays.
+*/
+static boolean CheckerFT_checkKindsDisjoint(struct walk *psWalk,
+                                            Node_T oNDir) {
+   size_t ulFiles = NodeFT_getNumChildren(oNDir, TRUE);
+   size_t ulDirs = NodeFT_getNumChildren(oNDir, FALSE);
+   size_t ulFile = 0, ulSubdir = 0;
+   Node_T oNFile = NULL, oNSubdir = NULL;
+   int iComparison;
+
+   while(ulFile < ulFiles && ulSubdir < ulDirs) {
+      (void) NodeFT_getChild(oNDir, ulFile, &oNFile, TRUE);
+      (void) NodeFT_getChild(oNDir, ulSubdir, &oNSubdir, FALSE);
+      iComparison = Path_comparePath(NodeFT_getPath(oNFile),
+                                     NodeFT_getPath(oNSubdir));
+      if(iComparison == 0)
+         return CheckerFT_fail(psWalk, "%s is both a file and a "
+                               "directory", CheckerFT_name(oNFile));
+      if(iComparison < 0)
+         ulFile++;
+      else
+         ulSubdir++;
+   }
+   return TRUE;
+}
+
+/*
+  Checks the subtree rooted at directory oNDir, which has already
+  been checked on its own, counting the nodes below it in psWalk.
+  Stops early, setting psWalk->bTruncated, once the budget is spent.
+*/
+static boolean CheckerFT_treeCheck(struct walk *psWalk, Node_T oNDir) {
+   Node_T oNPrev, oNChild = NULL;
+   size_t ulIndex;
+   int iKind;
+
+   for(iKind = 0; iKind < 2; iKind++) {
+      boolean bIsFile = (boolean) (iKind == 0);
+      size_t ulChildren = NodeFT_getNumChildren(oNDir, bIsFile);
+
+      oNPrev = NULL;
+      for(ulIndex = 0; ulIndex < ulChildren; ulIndex++) {
+         if(psWalk->ulBudget == 0) {
+            psWalk->bTruncated = TRUE;
+            return TRUE;
+         }
+         if(!CheckerFT_checkChild(psWalk, oNDir, ulIndex, bIsFile, oNPrev,
+                                  &oNChild))
+            return FALSE;
+         psWalk->ulBudget--;
+         psWalk->ulVisited++;
+         if(!bIsFile && !CheckerFT_treeCheck(psWalk, oNChild))
+            return FALSE;
+         if(psWalk->bTruncated)
+            return TRUE;
+         oNPrev = oNChild;
+      }
+   }
+   return CheckerFT_checkKindsDisjoint(psWalk, oNDir);
+}
+
+boolean CheckerFT_isValid(boolean bIsInitialized, Node_T oNRoot,
+                          size_t ulCount) {
+   struct walk sWalk = { CheckerFT_printReport, NULL, (size_t) -1, 0,
+                         FALSE };
+
+   if(!CheckerFT_checkTopLevel(&sWalk, bIsInitialized, oNRoot, ulCount))
+      return FALSE;
+   if(oNRoot == NULL)
+      return TRUE;
+   if(!CheckerFT_checkNode(&sWalk, oNRoot))
+      return FALSE;
+
+   sWalk.ulVisited = 1;
+   if(!CheckerFT_treeCheck(&sWalk, oNRoot))
+      return FALSE;
+   if(sWalk.ulVisited != ulCount)
+      return CheckerFT_fail(&sWalk, "the tree has %lu nodes but the "
+                            "count is %lu", (unsigned long) sWalk.ulVisited,
+                            (unsigned long) ulCount);
+   return TRUE;
+}
+
+/*
+  Checks the children of kind bIsFile of directory oNDir around index
+  ulIndex, where a child was found or would be inserted: the child
+  there and its neighbours on either side, which are all a mutation
+  at that index could have disturbed.
+*/
+static boolean CheckerFT_checkSiblingRange(struct walk *psWalk,
+                                           Node_T oNDir, size_t ulIndex,
+                                           boolean bIsFile) {
+   size_t ulChildren = NodeFT_getNumChildren(oNDir, bIsFile);
+   size_t ulFirst = ulIndex > 0 ? ulIndex - 1 : 0;
+   size_t ulEnd = ulIndex + 2 < ulChildren ? ulIndex + 2 : ulChildren;
+   Node_T oNPrev = NULL, oNChild = NULL;
+
+   for(; ulFirst < ulEnd; ulFirst++) {
+      if(!CheckerFT_checkChild(psWalk, oNDir, ulFirst, bIsFile, oNPrev,
+                               &oNChild))
+         return FALSE;
+      oNPrev = oNChild;
+   }
+   return TRUE;
+}
+
+boolean CheckerFT_isValidRegion(boolean bIsInitialized, Node_T oNRoot,
+                                size_t ulCount, const char *pcPath) {
+   struct walk sWalk = { CheckerFT_printReport, NULL, 0, 0, FALSE };
+   Path_T oPPath = NULL, oPPrefix = NULL;
+   Node_T oNCurr = oNRoot, oNChild = NULL;
+   size_t ulLevel, ulDirIndex, ulFileIndex;
+   boolean bIsDir, bIsFile, bValid = TRUE;
+
+   if(__atomic_add_fetch(&ulRegionChecks, 1, __ATOMIC_RELAXED) %
+      CHECKERFT_FULL_INTERVAL == 0)
+      return CheckerFT_isValid(bIsInitialized, oNRoot, ulCount);
+
+   if(!CheckerFT_checkTopLevel(&sWalk, bIsInitialized, oNRoot, ulCount))
+      return FALSE;
+   if(oNRoot == NULL || pcPath == NULL)
+      return TRUE;
+   if(!CheckerFT_checkNode(&sWalk, oNRoot))
+      return FALSE;
+
+   /* a path the tree could not hold leaves nothing else to check */
+   if(Path_new(pcPath, &oPPath) != SUCCESS)
+      return TRUE;
+   if(Path_getSharedPrefixDepth(oPPath, NodeFT_getPath(oNRoot)) < 1) {
+      Path_free(oPPath);
+      return TRUE;
+   }
+
+   for(ulLevel = 2; ulLevel <= Path_getDepth(oPPath); ulLevel++) {
+      if(Path_prefix(oPPath, ulLevel, &oPPrefix) != SUCCESS)
+         break;
+      bIsDir = NodeFT_hasChild(oNCurr, oPPrefix, &ulDirIndex, FALSE);
+      bIsFile = NodeFT_hasChild(oNCurr, oPPrefix, &ulFileIndex, TRUE);
+      Path_free(oPPrefix);
+
+      if(bIsDir && bIsFile) {
+         bValid = CheckerFT_fail(&sWalk, "%s has a file and a directory "
+                                 "with the same name",
+                                 CheckerFT_name(oNCurr));
+         break;
+      }
+      if(!CheckerFT_checkSiblingRange(&sWalk, oNCurr, ulDirIndex, FALSE) ||
+         !CheckerFT_checkSiblingRange(&sWalk, oNCurr, ulFileIndex, TRUE)) {
+         bValid = FALSE;
+         break;
+      }
+
+      /* stop at the deepest existing directory */
+      if(!bIsDir ||
+         NodeFT_getChild(oNCurr, ulDirIndex, &oNChild, FALSE) != SUCCESS)
+         break;
+      oNCurr = oNChild;
+   }
+
+   Path_free(oPPath);
+   return bValid;
+}
+
+/*
+  Advances the xorshift generator state *pulSeed and returns a
+  pseudo-random number below ulBound, which must be positive.
+*/
+static size_t CheckerFT_random(unsigned long *pulSeed, size_t ulBound) {
+   unsigned long ulX = *pulSeed ? *pulSeed : 0x9e3779b97f4a7c15UL;
+
+   ulX ^= ulX << 13;
+   ulX ^= ulX >> 7;
+   ulX ^= ulX << 17;
+   *pulSeed = ulX;
+   return (size_t) (ulX % ulBound);
+}
+
+/*
+  Does the work of CheckerFT_isValidSample on the non-empty tree
+  rooted at oNRoot, with the budget and report function in psWalk.
+*/
+static boolean CheckerFT_sample(struct walk *psWalk, Node_T oNRoot,
+                                size_t ulCount, unsigned long *pulSeed) {
+   Node_T oNCurr = oNRoot, oNChild = NULL;
+   size_t ulDirs, ulPick, ulBelow;
+
+   if(!CheckerFT_checkNode(psWalk, oNRoot))
+      return FALSE;
+   psWalk->ulBudget--;
+   psWalk->ulVisited++;
+
+   /* walk down at random, stopping at each directory with probability
+      1 / (subdirectories + 1), and check each step's neighbourhood */
+   for(;;) {
+      ulDirs = NodeFT_getNumChildren(oNCurr, FALSE);
+      ulPick = CheckerFT_random(pulSeed, ulDirs + 1);
+      if(ulPick == ulDirs || psWalk->ulBudget == 0)
+         break;
+      if(!CheckerFT_checkSiblingRange(psWalk, oNCurr, ulPick, FALSE))
+         return FALSE;
+      (void) NodeFT_getChild(oNCurr, ulPick, &oNChild, FALSE);
+      psWalk->ulBudget--;
+      psWalk->ulVisited++;
+      oNCurr = oNChild;
+   }
+
+   /* then check the subtree there as far as the budget goes */
+   ulBelow = psWalk->ulVisited;
+   if(!CheckerFT_treeCheck(psWalk, oNCurr))
+      return FALSE;
+   if(psWalk->bTruncated)
+      return TRUE;
+   ulBelow = psWalk->ulVisited - ulBelow + 1;
+
+   /* the count can only be checked against the whole tree, but no
+      proper subtree can hold as many nodes as the whole */
+   if(oNCurr == oNRoot && ulBelow != ulCount)
+      return CheckerFT_fail(psWalk, "the tree has %lu nodes but the "
+                            "count is %lu", (unsigned long) ulBelow,
+                            (unsigned long) ulCount);
+   if(oNCurr != oNRoot && ulBelow >= ulCount)
+      return CheckerFT_fail(psWalk, "subtree %s has %lu nodes but the "
+                            "whole tree only %lu", CheckerFT_name(oNCurr),
+                            (unsigned long) ulBelow,
+                            (unsigned long) ulCount);
+   return TRUE;
+}
+
+boolean CheckerFT_isValidSample(boolean bIsInitialized, Node_T oNRoot,
+                                size_t ulCount, size_t ulBudget,
+                                unsigned long *pulSeed,
+                                CheckerFT_Report pfReport, void *pvArg,
+                                size_t *pulVisited) {
+   struct walk sWalk;
+   boolean bValid = TRUE;
+
+   sWalk.pfReport = pfReport != NULL ? pfReport : CheckerFT_printReport;
+   sWalk.pvArg = pvArg;
+   sWalk.ulBudget = ulBudget;
+   sWalk.ulVisited = 0;
+   sWalk.bTruncated = FALSE;
+
+   if(!CheckerFT_checkTopLevel(&sWalk, bIsInitialized, oNRoot, ulCount))
+      bValid = FALSE;
+   else if(oNRoot != NULL && ulBudget > 0)
+      bValid = CheckerFT_sample(&sWalk, oNRoot, ulCount, pulSeed);
+
+   if(pulVisited != NULL)
+      *pulVisited = sWalk.ulVisited;
+   return bValid;
+}
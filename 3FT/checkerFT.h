@@ -0,0 +1,81 @@
+/*--------------------------------------------------------------------*/
+/* checkerFT.h                                                        */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+#ifndef CHECKERFT_INCLUDED
+#define CHECKERFT_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+#include "nodeFT.h"
+
+/*
+  Invariant checks for the FT, the counterpart of 2DT's checkerDT.
+  ft.c runs them after every operation that changes the tree when
+  compiled with -DFT_CHECK (full checks) or -DFT_CHECK_INCREMENTAL
+  (region checks with a periodic full check), and samplerFT runs
+  sampled checks from a background thread.
+*/
+
+/*
+  A function to which a check reports each problem it finds, as a
+  one-line description pcProblem, together with the pvArg the check
+  was given.
+*/
+typedef void (*CheckerFT_Report)(const char *pcProblem, void *pvArg);
+
+/*
+  Returns TRUE if oNNode is a node in a valid state on its own: it
+  exists and its parent (if any) is a directory whose path is
+  oNNode's path minus the last component. Otherwise prints an
+  explanation to stderr and returns FALSE.
+*/
+boolean CheckerFT_Node_isValid(Node_T oNNode);
+
+/*
+  Returns TRUE if the hierarchy described by bIsInitialized, the root
+  oNRoot and the node count ulCount is in a valid state: every node
+  is valid and points back to its parent, each directory's file and
+  directory children are in strictly increasing order with no name
+  used by both a file and a directory, the root is a directory, and
+  there are exactly ulCount nodes. Otherwise prints an explanation
+  to stderr and returns FALSE. Takes time linear in the size of the
+  hierarchy.
+*/
+boolean CheckerFT_isValid(boolean bIsInitialized, Node_T oNRoot,
+                          size_t ulCount);
+
+/*
+  Like CheckerFT_isValid, but for use after a mutation at absolute
+  path pcPath: checks the state variables, every node on the way
+  from the root towards pcPath, and each such node's immediate
+  siblings of both kinds. pcPath may be NULL to check only the state
+  variables. Takes time proportional to the depth of pcPath, except
+  that every CHECKERFT_FULL_INTERVAL-th call runs the full
+  CheckerFT_isValid instead, to catch what region checks cannot see
+  (such as a wrong ulCount).
+*/
+boolean CheckerFT_isValidRegion(boolean bIsInitialized, Node_T oNRoot,
+                                size_t ulCount, const char *pcPath);
+
+/*
+  Checks a randomly chosen part of the hierarchy described by
+  bIsInitialized, oNRoot and ulCount while visiting at most ulBudget
+  nodes: walks down from the root to a random directory, checking
+  each directory passed through and its neighbours, then checks the
+  subtree there as CheckerFT_isValid would until the budget runs out.
+  ulCount can only be verified when the chosen subtree is the whole
+  tree and fits in the budget. *pulSeed is the state of the random
+  generator and is advanced. Reports each problem through pfReport
+  (with pvArg), or to stderr if pfReport is NULL, and returns FALSE
+  if there were any, TRUE otherwise. Stores the number of nodes
+  visited in *pulVisited if pulVisited is not NULL.
+*/
+boolean CheckerFT_isValidSample(boolean bIsInitialized, Node_T oNRoot,
+                                size_t ulCount, size_t ulBudget,
+                                unsigned long *pulSeed,
+                                CheckerFT_Report pfReport, void *pvArg,
+                                size_t *pulVisited);
+
+#endif
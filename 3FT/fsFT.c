@@ -0,0 +1,750 @@
+/*--------------------------------------------------------------------*/
+/* fsFT.c                                                             */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+/* getdents64 is Linux's, and openat and fstatat are POSIX.1-2008 */
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "ft.h"
+#include "fsFT.h"
+
+/* Entries a worker gathers before handing them over at once */
+enum { BATCH_SIZE = 256 };
+
+/* Batches that may wait to be inserted, per worker, before the
+   workers wait in turn; this bounds the memory the contents take */
+enum { QUEUED_PER_WORKER = 4 };
+
+/* Bytes of directory entries read by each getdents64 */
+enum { DIRENT_BUFFER = 1 << 15 };
+
+/* A directory waiting to be read, by its path relative to the
+   import's root ("" for the root itself) */
+struct task {
+   struct task *psNext;
+   char acPath[];
+};
+
+/* Entries read by a worker, waiting to be inserted; each path and
+   contents is owned by the batch */
+struct batch {
+   struct batch *psNext;
+   size_t ulCount;
+   char *apcPaths[BATCH_SIZE];
+   boolean abIsFile[BATCH_SIZE];
+   void *apvContents[BATCH_SIZE];
+   size_t aulLengths[BATCH_SIZE];
+   int aiStatus[BATCH_SIZE];
+};
+
+/* A node to export, by its path relative to the export's root ("" for
+   the root itself) and its depth below the root */
+struct item {
+   char *pcRel;
+   size_t ulDepth;
+   boolean bIsFile;
+   const void *pvContents;
+   size_t ulLength;
+};
+
+/* An export under way */
+struct export {
+   const char *pcFsRoot;
+   size_t ulThreads;
+   /* the length of the tree path being exported */
+   size_t ulRootLength;
+   /* the nodes to export, parents before their children */
+   struct item *psItems;
+   size_t ulItems;
+   size_t ulCapacity;
+   /* the items of the phase under way, and the next one to take */
+   const size_t *pulJobs;
+   size_t ulJobs;
+   size_t ulNext;
+   /* the first problem met, after which the threads stop */
+   int iStatus;
+};
+
+/* An import under way */
+struct import {
+   const char *pcFsRoot;
+   const char *pcTreeRoot;
+   boolean bContents;
+   /* guards everything below; sWork wakes the workers, sReady the
+      calling thread, and sRoom the workers waiting to queue a batch */
+   pthread_mutex_t sLock;
+   pthread_cond_t sWork;
+   pthread_cond_t sReady;
+   pthread_cond_t sRoom;
+   /* directories to read, and how many are queued or being read */
+   struct task *psTasks;
+   size_t ulBusy;
+   /* batches to insert, oldest first */
+   struct batch *psFirst;
+   struct batch *psLast;
+   size_t ulQueued;
+   size_t ulMaxQueued;
+   /* the first problem met, after which the workers stop reading */
+   int iStatus;
+};
+
+/*---------------------------------------------------------------*/
+
+/*
+  Returns a new string joining the non-empty ones of pcA, pcB and pcC
+  with '/', or NULL if memory could not be allocated.
+*/
+static char *FsFT_join(const char *pcA, const char *pcB, const char *pcC) {
+   const char *apcParts[3];
+   size_t ulLength = 0, ulPart;
+   char *pcJoined;
+
+   apcParts[0] = pcA;
+   apcParts[1] = pcB;
+   apcParts[2] = pcC;
+   for(ulPart = 0; ulPart < 3; ulPart++)
+      ulLength += strlen(apcParts[ulPart]) + 1;
+   pcJoined = malloc(ulLength);
+   if(pcJoined == NULL)
+      return NULL;
+
+   pcJoined[0] = '\0';
+   for(ulPart = 0; ulPart < 3; ulPart++) {
+      if(apcParts[ulPart][0] == '\0')
+         continue;
+      if(pcJoined[0] != '\0')
+         strcat(pcJoined, "/");
+      strcat(pcJoined, apcParts[ulPart]);
+   }
+   return pcJoined;
+}
+
+/*
+  Records iStatus as psImport's outcome if it is the first problem,
+  and wakes every thread so that they wind down.
+*/
+static void FsFT_fail(struct import *psImport, int iStatus) {
+   pthread_mutex_lock(&psImport->sLock);
+   if(psImport->iStatus == SUCCESS)
+      __atomic_store_n(&psImport->iStatus, iStatus, __ATOMIC_RELAXED);
+   pthread_cond_broadcast(&psImport->sWork);
+   pthread_cond_broadcast(&psImport->sRoom);
+   pthread_cond_signal(&psImport->sReady);
+   pthread_mutex_unlock(&psImport->sLock);
+}
+
+/*
+  Queues the directory pcRel (relative to the import's root) to be
+  read. Returns SUCCESS or MEMORY_ERROR.
+*/
+static int FsFT_pushTask(struct import *psImport, const char *pcRel) {
+   struct task *psTask = malloc(sizeof(*psTask) + strlen(pcRel) + 1);
+
+   if(psTask == NULL)
+      return MEMORY_ERROR;
+   strcpy(psTask->acPath, pcRel);
+
+   pthread_mutex_lock(&psImport->sLock);
+   psTask->psNext = psImport->psTasks;
+   psImport->psTasks = psTask;
+   psImport->ulBusy++;
+   pthread_cond_signal(&psImport->sWork);
+   pthread_mutex_unlock(&psImport->sLock);
+   return SUCCESS;
+}
+
+/* Frees psBatch and the paths and contents it holds. */
+static void FsFT_freeBatch(struct batch *psBatch) {
+   size_t ulIndex;
+
+   for(ulIndex = 0; ulIndex < psBatch->ulCount; ulIndex++) {
+      free(psBatch->apcPaths[ulIndex]);
+      free(psBatch->apvContents[ulIndex]);
+   }
+   free(psBatch);
+}
+
+/*
+  Hands psBatch to the calling thread, first waiting while too many
+  are queued.
+*/
+static void FsFT_sendBatch(struct import *psImport, struct batch *psBatch) {
+   pthread_mutex_lock(&psImport->sLock);
+   while(psImport->ulQueued >= psImport->ulMaxQueued &&
+         psImport->iStatus == SUCCESS)
+      pthread_cond_wait(&psImport->sRoom, &psImport->sLock);
+   psBatch->psNext = NULL;
+   if(psImport->psLast == NULL)
+      psImport->psFirst = psBatch;
+   else
+      psImport->psLast->psNext = psBatch;
+   psImport->psLast = psBatch;
+   psImport->ulQueued++;
+   pthread_cond_signal(&psImport->sReady);
+   pthread_mutex_unlock(&psImport->sLock);
+}
+
+/*
+  Adds the entry pcName of directory pcRel to *ppsBatch, starting a
+  batch if it is NULL and sending it once full: a file holding the
+  ulLength bytes at pvContents, which the batch takes, if bIsFile,
+  and a directory otherwise. Returns SUCCESS or MEMORY_ERROR.
+*/
+static int FsFT_add(struct import *psImport, struct batch **ppsBatch,
+                    const char *pcRel, const char *pcName,
+                    boolean bIsFile, void *pvContents, size_t ulLength) {
+   struct batch *psBatch = *ppsBatch;
+   char *pcPath;
+
+   pcPath = FsFT_join(psImport->pcTreeRoot, pcRel, pcName);
+   if(psBatch == NULL)
+      psBatch = malloc(sizeof(*psBatch));
+   if(pcPath == NULL || psBatch == NULL) {
+      free(pcPath);
+      free(pvContents);
+      if(*ppsBatch == NULL)
+         free(psBatch);
+      return MEMORY_ERROR;
+   }
+   if(*ppsBatch == NULL) {
+      psBatch->ulCount = 0;
+      *ppsBatch = psBatch;
+   }
+
+   psBatch->apcPaths[psBatch->ulCount] = pcPath;
+   psBatch->abIsFile[psBatch->ulCount] = bIsFile;
+   psBatch->apvContents[psBatch->ulCount] = pvContents;
+   psBatch->aulLengths[psBatch->ulCount] = ulLength;
+   if(++psBatch->ulCount == BATCH_SIZE) {
+      FsFT_sendBatch(psImport, psBatch);
+      *ppsBatch = NULL;
+   }
+   return SUCCESS;
+}
+
+/*
+  Reads the regular file pcName in the directory open as iDirFd into
+  a new buffer, storing it in *ppvContents (NULL if empty) and its
+  length in *pulLength. Returns SUCCESS, NO_SUCH_PATH or
+  MEMORY_ERROR.
+*/
+static int FsFT_readFile(int iDirFd, const char *pcName,
+                         void **ppvContents, size_t *pulLength) {
+   struct stat sStat;
+   size_t ulRead = 0;
+   ssize_t lRead;
+   char *pcContents;
+   int iFd;
+
+   *ppvContents = NULL;
+   *pulLength = 0;
+   iFd = openat(iDirFd, pcName, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+   if(iFd < 0)
+      return NO_SUCH_PATH;
+   if(fstat(iFd, &sStat) < 0) {
+      (void) close(iFd);
+      return NO_SUCH_PATH;
+   }
+   if(sStat.st_size == 0) {
+      (void) close(iFd);
+      return SUCCESS;
+   }
+   pcContents = malloc((size_t) sStat.st_size);
+   if(pcContents == NULL) {
+      (void) close(iFd);
+      return MEMORY_ERROR;
+   }
+
+   /* the file may shrink while it is read; what is there is kept */
+   while(ulRead < (size_t) sStat.st_size) {
+      lRead = read(iFd, pcContents + ulRead, (size_t) sStat.st_size - ulRead);
+      if(lRead < 0 && errno == EINTR)
+         continue;
+      if(lRead < 0) {
+         free(pcContents);
+         (void) close(iFd);
+         return NO_SUCH_PATH;
+      }
+      if(lRead == 0)
+         break;
+      ulRead += (size_t) lRead;
+   }
+   (void) close(iFd);
+
+   if(ulRead == 0)
+      free(pcContents);
+   else {
+      *ppvContents = pcContents;
+      *pulLength = ulRead;
+   }
+   return SUCCESS;
+}
+
+/*
+  Reads the directory pcRel (relative to the import's root), queuing
+  its subdirectories to be read and sending its entries to be
+  inserted. Returns SUCCESS, NO_SUCH_PATH or MEMORY_ERROR.
+*/
+static int FsFT_readDir(struct import *psImport, const char *pcRel) {
+   long alEntries[DIRENT_BUFFER / sizeof(long)];
+   struct batch *psBatch = NULL;
+   struct dirent64 *psEntry;
+   struct stat sStat;
+   unsigned char ucType;
+   ssize_t lRead;
+   size_t ulAt;
+   char *pcPath;
+   void *pvContents;
+   size_t ulLength;
+   int iFd, iStatus = SUCCESS;
+
+   pcPath = FsFT_join(psImport->pcFsRoot, pcRel, "");
+   if(pcPath == NULL)
+      return MEMORY_ERROR;
+   iFd = openat(AT_FDCWD, pcPath, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+   free(pcPath);
+   if(iFd < 0)
+      return NO_SUCH_PATH;
+
+   while(iStatus == SUCCESS) {
+      lRead = getdents64(iFd, alEntries, sizeof(alEntries));
+      if(lRead < 0 && errno == EINTR)
+         continue;
+      if(lRead <= 0) {
+         if(lRead < 0)
+            iStatus = NO_SUCH_PATH;
+         break;
+      }
+
+      for(ulAt = 0; iStatus == SUCCESS && ulAt < (size_t) lRead;
+          ulAt += psEntry->d_reclen) {
+         psEntry = (struct dirent64 *) ((char *) alEntries + ulAt);
+         if(strcmp(psEntry->d_name, ".") == 0 ||
+            strcmp(psEntry->d_name, "..") == 0)
+            continue;
+
+         /* not every filesystem reports the type */
+         ucType = psEntry->d_type;
+         if(ucType == DT_UNKNOWN) {
+            if(fstatat(iFd, psEntry->d_name, &sStat,
+                       AT_SYMLINK_NOFOLLOW) < 0)
+               iStatus = NO_SUCH_PATH;
+            else if(S_ISDIR(sStat.st_mode))
+               ucType = DT_DIR;
+            else if(S_ISREG(sStat.st_mode))
+               ucType = DT_REG;
+         }
+
+         if(iStatus == SUCCESS && ucType == DT_DIR) {
+            pcPath = FsFT_join(pcRel, psEntry->d_name, "");
+            iStatus = pcPath == NULL ? MEMORY_ERROR
+                      : FsFT_pushTask(psImport, pcPath);
+            free(pcPath);
+            if(iStatus == SUCCESS)
+               iStatus = FsFT_add(psImport, &psBatch, pcRel,
+                                  psEntry->d_name, FALSE, NULL, 0);
+         }
+         else if(iStatus == SUCCESS && ucType == DT_REG) {
+            pvContents = NULL;
+            ulLength = 0;
+            if(psImport->bContents)
+               iStatus = FsFT_readFile(iFd, psEntry->d_name, &pvContents,
+                                       &ulLength);
+            if(iStatus == SUCCESS)
+               iStatus = FsFT_add(psImport, &psBatch, pcRel,
+                                  psEntry->d_name, TRUE, pvContents,
+                                  ulLength);
+         }
+      }
+
+      /* another worker has failed: this one's result is moot */
+      if(__atomic_load_n(&psImport->iStatus, __ATOMIC_RELAXED) != SUCCESS)
+         break;
+   }
+   (void) close(iFd);
+
+   if(psBatch != NULL)
+      FsFT_sendBatch(psImport, psBatch);
+   return iStatus;
+}
+
+/* Reads queued directories until there are none left to read. */
+static void *FsFT_work(void *pvImport) {
+   struct import *psImport = pvImport;
+   struct task *psTask;
+   int iStatus;
+
+   for(;;) {
+      pthread_mutex_lock(&psImport->sLock);
+      while(psImport->psTasks == NULL && psImport->ulBusy > 0)
+         pthread_cond_wait(&psImport->sWork, &psImport->sLock);
+      psTask = psImport->psTasks;
+      if(psTask == NULL) {
+         pthread_mutex_unlock(&psImport->sLock);
+         return NULL;
+      }
+      psImport->psTasks = psTask->psNext;
+      pthread_mutex_unlock(&psImport->sLock);
+
+      /* after a failure the queue is only drained */
+      if(__atomic_load_n(&psImport->iStatus, __ATOMIC_RELAXED) == SUCCESS) {
+         iStatus = FsFT_readDir(psImport, psTask->acPath);
+         if(iStatus != SUCCESS)
+            FsFT_fail(psImport, iStatus);
+      }
+      free(psTask);
+
+      pthread_mutex_lock(&psImport->sLock);
+      if(--psImport->ulBusy == 0) {
+         pthread_cond_broadcast(&psImport->sWork);
+         pthread_cond_signal(&psImport->sReady);
+      }
+      pthread_mutex_unlock(&psImport->sLock);
+   }
+}
+
+/*
+  Inserts psBatch into the FT. Returns SUCCESS, or the first status
+  that is neither SUCCESS nor, for a directory, ALREADY_IN_TREE (a
+  directory may have been made already on the way to a file below it).
+*/
+static int FsFT_insert(struct batch *psBatch) {
+   size_t ulIndex;
+   int iStatus;
+
+   iStatus = FT_insertBatch((const char *const *) psBatch->apcPaths,
+                            psBatch->ulCount, psBatch->abIsFile,
+                            psBatch->apvContents, psBatch->aulLengths,
+                            psBatch->aiStatus);
+   for(ulIndex = 0; iStatus == SUCCESS && ulIndex < psBatch->ulCount;
+       ulIndex++)
+      if(psBatch->aiStatus[ulIndex] != SUCCESS &&
+         (psBatch->abIsFile[ulIndex] ||
+          psBatch->aiStatus[ulIndex] != ALREADY_IN_TREE))
+         iStatus = psBatch->aiStatus[ulIndex];
+   return iStatus;
+}
+
+int FsFT_importDir(const char *pcFsPath, const char *pcTreePath,
+                   size_t ulThreads, boolean bContents) {
+   struct import sImport;
+   struct batch *psBatch;
+   pthread_t *psThreads;
+   size_t ulStarted = 0, ulIndex;
+   int iFd, iStatus;
+
+   assert(pcFsPath != NULL);
+   assert(pcTreePath != NULL);
+
+   if(ulThreads == 0)
+      ulThreads = 1;
+
+   iFd = openat(AT_FDCWD, pcFsPath, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+   if(iFd < 0)
+      return NO_SUCH_PATH;
+   (void) close(iFd);
+
+   iStatus = FT_insertDir(pcTreePath);
+   if(iStatus == ALREADY_IN_TREE)
+      iStatus = FT_containsDir(pcTreePath) ? SUCCESS : NOT_A_DIRECTORY;
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   psThreads = malloc(ulThreads * sizeof(*psThreads));
+   if(psThreads == NULL)
+      return MEMORY_ERROR;
+
+   sImport.pcFsRoot = pcFsPath;
+   sImport.pcTreeRoot = pcTreePath;
+   sImport.bContents = bContents;
+   pthread_mutex_init(&sImport.sLock, NULL);
+   pthread_cond_init(&sImport.sWork, NULL);
+   pthread_cond_init(&sImport.sReady, NULL);
+   pthread_cond_init(&sImport.sRoom, NULL);
+   sImport.psTasks = NULL;
+   sImport.ulBusy = 0;
+   sImport.psFirst = NULL;
+   sImport.psLast = NULL;
+   sImport.ulQueued = 0;
+   sImport.ulMaxQueued = ulThreads * QUEUED_PER_WORKER;
+   sImport.iStatus = FsFT_pushTask(&sImport, "");
+
+   if(sImport.iStatus == SUCCESS)
+      for(ulStarted = 0; ulStarted < ulThreads; ulStarted++)
+         if(pthread_create(&psThreads[ulStarted], NULL, FsFT_work,
+                           &sImport) != 0)
+            break;
+   if(sImport.iStatus == SUCCESS && ulStarted == 0) {
+      free(sImport.psTasks);
+      sImport.iStatus = MEMORY_ERROR;
+   }
+
+   /* insert batches as they come, until the workers have finished */
+   pthread_mutex_lock(&sImport.sLock);
+   for(;;) {
+      while(sImport.psFirst == NULL && sImport.ulBusy > 0 && ulStarted > 0)
+         pthread_cond_wait(&sImport.sReady, &sImport.sLock);
+      psBatch = sImport.psFirst;
+      if(psBatch == NULL)
+         break;
+      sImport.psFirst = psBatch->psNext;
+      if(sImport.psFirst == NULL)
+         sImport.psLast = NULL;
+      sImport.ulQueued--;
+      pthread_cond_signal(&sImport.sRoom);
+      pthread_mutex_unlock(&sImport.sLock);
+
+      if(__atomic_load_n(&sImport.iStatus, __ATOMIC_RELAXED) == SUCCESS) {
+         iStatus = FsFT_insert(psBatch);
+         if(iStatus != SUCCESS)
+            FsFT_fail(&sImport, iStatus);
+      }
+      FsFT_freeBatch(psBatch);
+      pthread_mutex_lock(&sImport.sLock);
+   }
+   pthread_mutex_unlock(&sImport.sLock);
+
+   for(ulIndex = 0; ulIndex < ulStarted; ulIndex++)
+      pthread_join(psThreads[ulIndex], NULL);
+   free(psThreads);
+   pthread_cond_destroy(&sImport.sRoom);
+   pthread_cond_destroy(&sImport.sReady);
+   pthread_cond_destroy(&sImport.sWork);
+   pthread_mutex_destroy(&sImport.sLock);
+   return sImport.iStatus;
+}
+
+/*---------------------------------------------------------------*/
+
+/*
+  Returns TRUE if the relative path pcRel has a "." or ".." part, which
+  the FT allows as a name but which would name something else, or
+  something outside the export, on disk.
+*/
+static boolean FsFT_hasDotPart(const char *pcRel) {
+   size_t ulPart;
+
+   while(*pcRel != '\0') {
+      ulPart = strcspn(pcRel, "/");
+      if((ulPart == 1 && pcRel[0] == '.') ||
+         (ulPart == 2 && pcRel[0] == '.' && pcRel[1] == '.'))
+         return TRUE;
+      pcRel += ulPart;
+      if(*pcRel == '/')
+         pcRel++;
+   }
+   return FALSE;
+}
+
+/*
+  Adds the node pcPath, as FT_walk passes it, to the export pvExport.
+  Returns SUCCESS, BAD_PATH if its path below the export's root has a
+  "." or ".." part, or MEMORY_ERROR.
+*/
+static int FsFT_collect(const char *pcPath, boolean bIsFile,
+                        const void *pvContents, size_t ulLength,
+                        void *pvExport) {
+   struct export *psExport = pvExport;
+   struct item *psItem, *psGrown;
+   const char *pcRel = pcPath + psExport->ulRootLength;
+   size_t ulCapacity;
+
+   if(*pcRel == '/')
+      pcRel++;
+   if(FsFT_hasDotPart(pcRel))
+      return BAD_PATH;
+
+   if(psExport->ulItems == psExport->ulCapacity) {
+      ulCapacity = psExport->ulCapacity == 0 ? 64 : 2 * psExport->ulCapacity;
+      psGrown = realloc(psExport->psItems, ulCapacity * sizeof(*psGrown));
+      if(psGrown == NULL)
+         return MEMORY_ERROR;
+      psExport->psItems = psGrown;
+      psExport->ulCapacity = ulCapacity;
+   }
+
+   psItem = &psExport->psItems[psExport->ulItems];
+   psItem->pcRel = malloc(strlen(pcRel) + 1);
+   if(psItem->pcRel == NULL)
+      return MEMORY_ERROR;
+   strcpy(psItem->pcRel, pcRel);
+   psItem->ulDepth = 0;
+   if(*pcRel != '\0')
+      for(psItem->ulDepth = 1; *pcRel != '\0'; pcRel++)
+         if(*pcRel == '/')
+            psItem->ulDepth++;
+   psItem->bIsFile = bIsFile;
+   psItem->pvContents = pvContents;
+   psItem->ulLength = ulLength;
+   psExport->ulItems++;
+   return SUCCESS;
+}
+
+/*
+  Makes the directory, or writes the file, for item ulItem of
+  psExport. Returns SUCCESS, NO_SUCH_PATH or MEMORY_ERROR.
+*/
+static int FsFT_exportItem(struct export *psExport, size_t ulItem) {
+   const struct item *psItem = &psExport->psItems[ulItem];
+   const char *pcAt = psItem->pvContents;
+   size_t ulLeft = psItem->ulLength;
+   ssize_t lWritten;
+   char *pcPath;
+   int iFd, iStatus = SUCCESS;
+
+   pcPath = FsFT_join(psExport->pcFsRoot, psItem->pcRel, "");
+   if(pcPath == NULL)
+      return MEMORY_ERROR;
+
+   if(!psItem->bIsFile) {
+      if(mkdir(pcPath, 0755) < 0 && errno != EEXIST)
+         iStatus = NO_SUCH_PATH;
+      free(pcPath);
+      return iStatus;
+   }
+
+   iFd = open(pcPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+   free(pcPath);
+   if(iFd < 0)
+      return NO_SUCH_PATH;
+   while(ulLeft > 0) {
+      lWritten = write(iFd, pcAt, ulLeft);
+      if(lWritten < 0 && errno == EINTR)
+         continue;
+      if(lWritten <= 0) {
+         iStatus = NO_SUCH_PATH;
+         break;
+      }
+      pcAt += lWritten;
+      ulLeft -= (size_t) lWritten;
+   }
+   if(close(iFd) < 0)
+      iStatus = NO_SUCH_PATH;
+   return iStatus;
+}
+
+/* Exports the items of the phase under way until none are left. */
+static void *FsFT_exportWork(void *pvExport) {
+   struct export *psExport = pvExport;
+   size_t ulJob;
+   int iStatus, iExpected;
+
+   while(__atomic_load_n(&psExport->iStatus, __ATOMIC_RELAXED) == SUCCESS) {
+      ulJob = __atomic_fetch_add(&psExport->ulNext, 1, __ATOMIC_RELAXED);
+      if(ulJob >= psExport->ulJobs)
+         break;
+      iStatus = FsFT_exportItem(psExport, psExport->pulJobs[ulJob]);
+      if(iStatus != SUCCESS) {
+         iExpected = SUCCESS;
+         (void) __atomic_compare_exchange_n(&psExport->iStatus, &iExpected,
+                                            iStatus, FALSE, __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED);
+      }
+   }
+   return NULL;
+}
+
+/*
+  Exports the ulJobs items listed in pulJobs on up to psExport's
+  number of threads, the calling thread among them, returning once
+  all are done. Returns SUCCESS or the first problem met.
+*/
+static int FsFT_runPhase(struct export *psExport, const size_t *pulJobs,
+                         size_t ulJobs) {
+   pthread_t *psThreads;
+   size_t ulStarted = 0, ulWanted, ulIndex;
+
+   psExport->pulJobs = pulJobs;
+   psExport->ulJobs = ulJobs;
+   psExport->ulNext = 0;
+
+   /* threads that cannot be had only make the phase slower */
+   ulWanted = psExport->ulThreads < ulJobs ? psExport->ulThreads : ulJobs;
+   psThreads = ulWanted > 1 ? malloc((ulWanted - 1) * sizeof(*psThreads))
+                            : NULL;
+   if(psThreads != NULL)
+      for(ulStarted = 0; ulStarted + 1 < ulWanted; ulStarted++)
+         if(pthread_create(&psThreads[ulStarted], NULL, FsFT_exportWork,
+                           psExport) != 0)
+            break;
+   (void) FsFT_exportWork(psExport);
+   for(ulIndex = 0; ulIndex < ulStarted; ulIndex++)
+      pthread_join(psThreads[ulIndex], NULL);
+   free(psThreads);
+   return psExport->iStatus;
+}
+
+int FsFT_exportDir(const char *pcTreePath, const char *pcFsPath,
+                   size_t ulThreads) {
+   struct export sExport;
+   size_t *pulOrder = NULL, *pulStart = NULL;
+   size_t ulIndex, ulDepth, ulMaxDepth = 0, ulFiles = 0, ulDirs;
+   int iStatus;
+
+   assert(pcTreePath != NULL);
+   assert(pcFsPath != NULL);
+
+   sExport.pcFsRoot = pcFsPath;
+   sExport.ulThreads = ulThreads == 0 ? 1 : ulThreads;
+   sExport.ulRootLength = strlen(pcTreePath);
+   sExport.psItems = NULL;
+   sExport.ulItems = 0;
+   sExport.ulCapacity = 0;
+   sExport.iStatus = SUCCESS;
+
+   iStatus = FT_walk(pcTreePath, FsFT_collect, &sExport);
+
+   /* order the directories by depth, then the files, counting sort */
+   if(iStatus == SUCCESS) {
+      for(ulIndex = 0; ulIndex < sExport.ulItems; ulIndex++)
+         if(sExport.psItems[ulIndex].ulDepth > ulMaxDepth)
+            ulMaxDepth = sExport.psItems[ulIndex].ulDepth;
+      pulOrder = malloc(sExport.ulItems * sizeof(*pulOrder));
+      pulStart = calloc(ulMaxDepth + 2, sizeof(*pulStart));
+      if(pulOrder == NULL || pulStart == NULL)
+         iStatus = MEMORY_ERROR;
+   }
+   if(iStatus == SUCCESS) {
+      for(ulIndex = 0; ulIndex < sExport.ulItems; ulIndex++)
+         if(sExport.psItems[ulIndex].bIsFile)
+            ulFiles++;
+         else
+            pulStart[sExport.psItems[ulIndex].ulDepth + 1]++;
+      for(ulDepth = 1; ulDepth <= ulMaxDepth + 1; ulDepth++)
+         pulStart[ulDepth] += pulStart[ulDepth - 1];
+      ulDirs = sExport.ulItems - ulFiles;
+      for(ulIndex = 0; ulIndex < sExport.ulItems; ulIndex++)
+         if(sExport.psItems[ulIndex].bIsFile)
+            pulOrder[ulDirs++] = ulIndex;
+         else
+            pulOrder[pulStart[sExport.psItems[ulIndex].ulDepth]++] = ulIndex;
+
+      /* pulStart[d] now ends depth d; each level needs the last */
+      for(ulDepth = 0; iStatus == SUCCESS && ulDepth <= ulMaxDepth; ulDepth++)
+         iStatus = FsFT_runPhase(&sExport,
+                                 pulOrder + (ulDepth == 0 ? 0
+                                             : pulStart[ulDepth - 1]),
+                                 pulStart[ulDepth] -
+                                    (ulDepth == 0 ? 0 : pulStart[ulDepth - 1]));
+      if(iStatus == SUCCESS)
+         iStatus = FsFT_runPhase(&sExport, pulOrder + sExport.ulItems - ulFiles,
+                                 ulFiles);
+   }
+
+   for(ulIndex = 0; ulIndex < sExport.ulItems; ulIndex++)
+      free(sExport.psItems[ulIndex].pcRel);
+   free(sExport.psItems);
+   free(pulOrder);
+   free(pulStart);
+   return iStatus;
+}
@@ -0,0 +1,59 @@
+/*--------------------------------------------------------------------*/
+/* fsFT.h                                                             */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+#ifndef FSFT_INCLUDED
+#define FSFT_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/*
+  Moving trees between the FT and the real filesystem with a pool of
+  threads. The FT itself is only ever called from the calling thread,
+  so this works with any build of ft.c; the workers do the system
+  calls.
+*/
+
+/*
+  Copies the real directory pcFsPath, and everything below it, into
+  the FT as the directory pcTreePath (which may already exist), with
+  ulThreads threads (at least one) walking the disk. Each thread
+  takes a directory at a time, so the work is split by subtree; it
+  reads the entries with getdents64, opening everything relative to
+  the directory with openat, and passes them to the calling thread in
+  batches, which it inserts with FT_insertBatch. Files hold their
+  contents if bContents, and are empty otherwise. Symbolic links and
+  special files are skipped. Returns SUCCESS, or stops at the first
+  problem, keeping what was inserted before it, and returns:
+  * NO_SUCH_PATH if pcFsPath or something below it could not be read
+  * MEMORY_ERROR if memory or the threads could not be allocated
+  * the first status other than SUCCESS (or ALREADY_IN_TREE, for a
+    directory) that an insertion returned, or that FT_insertDir
+    returned for pcTreePath (NOT_A_DIRECTORY if it is a file)
+*/
+int FsFT_importDir(const char *pcFsPath, const char *pcTreePath,
+                   size_t ulThreads, boolean bContents);
+
+/*
+  Writes the FT's node pcTreePath, and everything below it, to the
+  real filesystem as pcFsPath, with ulThreads threads (at least one).
+  Directories are made a level at a time, the directories of each
+  level in parallel; then the files are written in parallel, each
+  with as few large writes as the system allows, straight from where
+  the FT keeps its contents. So the subtree must not change until this
+  returns. Existing directories are reused and existing files
+  replaced. Returns SUCCESS, or stops at the first problem and
+  returns:
+  * NO_SUCH_PATH if pcTreePath is not in the FT, or something could
+    not be created or written on disk
+  * BAD_PATH if a node below pcTreePath is named "." or "..", which
+    would land elsewhere on disk; nothing is written then
+  * MEMORY_ERROR if memory could not be allocated
+  * the other reasons FT_walk gives for failing to walk pcTreePath
+*/
+int FsFT_exportDir(const char *pcTreePath, const char *pcFsPath,
+                   size_t ulThreads);
+
+#endif
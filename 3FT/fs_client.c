@@ -0,0 +1,242 @@
+/*--------------------------------------------------------------------*/
+/* fs_client.c                                                        */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+/* mkdtemp, symlink and nftw */
+#define _XOPEN_SOURCE 700
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "fsFT.h"
+#include "ft.h"
+
+/*
+  Tests fsFT.c: builds a small directory tree on disk under a fresh
+  temporary directory, imports it into the FT with several threads,
+  with and without contents, and checks what arrived and what the
+  import refuses; then exports it back to disk, imports the copy and
+  checks that it matches, and that nodes named "." or ".." are never
+  written. Prints the tree along the way to stderr,
+  and removes the temporary directory at the end.
+*/
+
+/* Threads each import or export runs with */
+enum { THREADS = 4 };
+
+/* Directories at each level of the tree built on disk, and levels */
+enum { FANOUT = 3, DEPTH = 3 };
+
+/* Writes ulLength bytes of pcContents to the new file pcPath */
+static void writeFile(const char *pcPath, const char *pcContents,
+                      size_t ulLength) {
+   int iFd;
+
+   iFd = open(pcPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+   assert(iFd >= 0);
+   assert(write(iFd, pcContents, ulLength) == (ssize_t) ulLength);
+   assert(close(iFd) == 0);
+}
+
+/*
+  Builds below the existing directory pcDir, ulDepth levels deep,
+  FANOUT directories per level, each holding a file "f" whose
+  contents are its own path relative to pcBase, and an empty file
+  "e". Returns how many files it made.
+*/
+static size_t buildTree(const char *pcBase, const char *pcDir,
+                        size_t ulDepth) {
+   char acPath[256], acFile[300];
+   size_t ulIndex, ulFiles = 0;
+
+   for(ulIndex = 0; ulIndex < FANOUT; ulIndex++) {
+      sprintf(acPath, "%s/d%lu", pcDir, (unsigned long) ulIndex);
+      assert(mkdir(acPath, 0755) == 0);
+      sprintf(acFile, "%s/f", acPath);
+      writeFile(acFile, acFile + strlen(pcBase) + 1,
+                strlen(acFile) - strlen(pcBase) - 1);
+      sprintf(acFile, "%s/e", acPath);
+      writeFile(acFile, "", 0);
+      ulFiles += 2;
+      if(ulDepth > 1)
+         ulFiles += buildTree(pcBase, acPath, ulDepth - 1);
+   }
+   return ulFiles;
+}
+
+/*
+  Checks that the FT has below pcTreeDir, ulDepth levels deep, what
+  buildTree made below the matching directory on disk, with the
+  contents if bContents and empty files otherwise. pcRel is the path
+  relative to the directory imported. Returns how many files it
+  found.
+*/
+static size_t checkTree(const char *pcTreeDir, const char *pcRel,
+                        size_t ulDepth, boolean bContents) {
+   char acTree[256], acRel[256], acFile[300];
+   size_t ulIndex, ulFiles = 0, ulSize;
+   boolean bIsFile;
+   char *pcContents;
+
+   for(ulIndex = 0; ulIndex < FANOUT; ulIndex++) {
+      sprintf(acTree, "%s/d%lu", pcTreeDir, (unsigned long) ulIndex);
+      sprintf(acRel, "%s%sd%lu", pcRel, *pcRel == '\0' ? "" : "/",
+              (unsigned long) ulIndex);
+      assert(FT_containsDir(acTree) == TRUE);
+
+      sprintf(acFile, "%s/f", acTree);
+      assert(FT_stat(acFile, &bIsFile, &ulSize) == SUCCESS && bIsFile);
+      pcContents = FT_getFileContents(acFile);
+      if(bContents) {
+         assert(ulSize == strlen(acRel) + 2);
+         assert(pcContents != NULL &&
+                !strncmp(pcContents, acRel, strlen(acRel)) &&
+                !strncmp(pcContents + strlen(acRel), "/f", 2));
+      }
+      else
+         assert(ulSize == 0 && pcContents == NULL);
+      sprintf(acFile, "%s/e", acTree);
+      assert(FT_stat(acFile, &bIsFile, &ulSize) == SUCCESS && bIsFile);
+      assert(ulSize == 0);
+      ulFiles += 2;
+
+      if(ulDepth > 1)
+         ulFiles += checkTree(acTree, acRel, ulDepth - 1, bContents);
+   }
+   return ulFiles;
+}
+
+/* Checks that the file pcPath on disk holds exactly pcContents */
+static void checkFile(const char *pcPath, const char *pcContents) {
+   char acBuffer[256];
+   ssize_t lRead;
+   int iFd;
+
+   iFd = open(pcPath, O_RDONLY);
+   assert(iFd >= 0);
+   lRead = read(iFd, acBuffer, sizeof(acBuffer));
+   assert(close(iFd) == 0);
+   assert(lRead == (ssize_t) strlen(pcContents));
+   assert(!memcmp(acBuffer, pcContents, (size_t) lRead));
+}
+
+/* Counts the node visited by FT_walk in pvArg, an array of the
+   directories and the files seen so far */
+static int countNode(const char *pcPath, boolean bIsFile,
+                     const void *pvContents, size_t ulLength, void *pvArg) {
+   (void) pcPath;
+   (void) pvContents;
+   (void) ulLength;
+   ((size_t *) pvArg)[bIsFile ? 1 : 0]++;
+   return SUCCESS;
+}
+
+/* Removes pcPath, for nftw */
+static int removeEntry(const char *pcPath, const struct stat *psStat,
+                       int iFlag, struct FTW *psFtw) {
+   (void) psStat;
+   (void) iFlag;
+   (void) psFtw;
+   return remove(pcPath);
+}
+
+/* Runs the checks in a fresh temporary directory. Returns 0. */
+int main(void) {
+   char acBase[64], acSrc[96], acPath[128];
+   size_t ulFiles, aulCounts[2];
+   char *pcText;
+
+   strcpy(acBase, "/tmp/fs_client.XXXXXX");
+   assert(mkdtemp(acBase) != NULL);
+   sprintf(acSrc, "%s/src", acBase);
+   assert(mkdir(acSrc, 0755) == 0);
+   ulFiles = buildTree(acSrc, acSrc, DEPTH);
+   /* links are skipped */
+   sprintf(acPath, "%s/link", acSrc);
+   assert(symlink("d0", acPath) == 0);
+
+   assert(FsFT_importDir(acSrc, "1root/in", THREADS, TRUE) ==
+          INITIALIZATION_ERROR);
+   assert(FT_init() == SUCCESS);
+
+   /* with contents, into a directory the import makes */
+   assert(FsFT_importDir(acSrc, "1root/in", THREADS, TRUE) == SUCCESS);
+   assert(checkTree("1root/in", "", DEPTH, TRUE) == ulFiles);
+   assert(FT_containsDir("1root/in/link") == FALSE);
+   assert(FT_containsFile("1root/in/link") == FALSE);
+   aulCounts[0] = aulCounts[1] = 0;
+   assert(FT_walk("1root/in", countNode, aulCounts) == SUCCESS);
+   assert(aulCounts[1] == ulFiles);
+
+   /* without contents, and again over what is already there */
+   assert(FsFT_importDir(acSrc, "1root/bare", 1, FALSE) == SUCCESS);
+   assert(checkTree("1root/bare", "", DEPTH, FALSE) == ulFiles);
+   assert(FsFT_importDir(acSrc, "1root/bare", THREADS, FALSE) ==
+          ALREADY_IN_TREE);
+
+   /* what the import refuses */
+   sprintf(acPath, "%s/none", acBase);
+   assert(FsFT_importDir(acPath, "1root/none", THREADS, TRUE) ==
+          NO_SUCH_PATH);
+   assert(FsFT_importDir(acSrc, "1root/in/d0/f", THREADS, TRUE) ==
+          NOT_A_DIRECTORY);
+   assert(FsFT_importDir(acSrc, "2root", THREADS, TRUE) ==
+          CONFLICTING_PATH);
+
+   /* exported and imported again, the tree comes back the same */
+   sprintf(acPath, "%s/out", acBase);
+   assert(FsFT_exportDir("1root/in", acPath, THREADS) == SUCCESS);
+   sprintf(acPath, "%s/out/d2/d1/f", acBase);
+   checkFile(acPath, "d2/d1/f");
+   sprintf(acPath, "%s/out/d2/d1/e", acBase);
+   checkFile(acPath, "");
+   sprintf(acPath, "%s/out", acBase);
+   assert(FsFT_importDir(acPath, "1root/back", THREADS, TRUE) == SUCCESS);
+   assert(checkTree("1root/back", "", DEPTH, TRUE) == ulFiles);
+
+   /* exporting again reuses the directories and replaces the files */
+   assert((pcText = FT_replaceFileContents("1root/in/d0/f", "new", 3)) !=
+          NULL);
+   free(pcText);
+   assert(FsFT_exportDir("1root/in", acPath, 1) == SUCCESS);
+   sprintf(acPath, "%s/out/d0/f", acBase);
+   checkFile(acPath, "new");
+
+   /* what the export refuses */
+   assert(FsFT_exportDir("1root/none", acPath, THREADS) == NO_SUCH_PATH);
+   sprintf(acPath, "%s/out/d0/f/below", acBase);
+   assert(FsFT_exportDir("1root/in", acPath, THREADS) == NO_SUCH_PATH);
+
+   /* the FT takes "." and ".." as names, but they would land outside
+      the export on disk, so nothing is written */
+   assert(FT_insertFile("1root/dots/../../escaped", "out", 3) == SUCCESS);
+   sprintf(acPath, "%s/deep/a", acBase);
+   assert(FsFT_exportDir("1root/dots", acPath, THREADS) == BAD_PATH);
+   sprintf(acPath, "%s/escaped", acBase);
+   assert(access(acPath, F_OK) != 0);
+   sprintf(acPath, "%s/deep", acBase);
+   assert(access(acPath, F_OK) != 0);
+   assert(FT_rmDir("1root/dots") == SUCCESS);
+   assert(FT_insertFile("1root/dots/./f", "out", 3) == SUCCESS);
+   assert(FsFT_exportDir("1root/dots", acPath, THREADS) == BAD_PATH);
+   assert(FT_rmDir("1root/dots") == SUCCESS);
+
+   assert(FT_rmDir("1root/in/d1") == SUCCESS);
+   assert(FT_rmDir("1root/in/d2") == SUCCESS);
+   assert(FT_rmDir("1root/bare") == SUCCESS);
+   assert(FT_rmDir("1root/back") == SUCCESS);
+   assert((pcText = FT_toString()) != NULL);
+   fprintf(stderr, "Checkpoint 1:\n%s\n", pcText);
+   free(pcText);
+
+   assert(FT_destroy() == SUCCESS);
+   assert(nftw(acBase, removeEntry, 16, FTW_DEPTH | FTW_PHYS) == 0);
+   return 0;
+}
@@ -3,6 +3,9 @@
 /* Author: anish                                                      */
 /*--------------------------------------------------------------------*/
 
+/* fork, waitpid and pthread rwlocks are POSIX, not C99 */
+#define _POSIX_C_SOURCE 200112L
+
 #include "ft.h"  /* Include ft.h first to ensure declarations match definitions */
 
 #include <stddef.h>
@@ -10,46 +13,110 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 
-#include "dynarray.h"
 #include "path.h"
 #include "nodeFT.h"
+#include "opFT.h"
+#include "checkerFT.h"
+#include "arenaFT.h"
+#include "snapFT.h"
+
+#if defined(FT_THREADSAFE) && defined(FT_PERTHREAD)
+#error "FT_THREADSAFE and FT_PERTHREAD are mutually exclusive"
+#endif
+
+#if defined(FT_HIST) || defined(FT_TRACE) || defined(FT_RECORD)
+#define FT_PROBED
+#endif
+#if defined(FT_PROBED) || defined(FT_THREADSAFE)
+#include "timerFT.h"
+#endif
+#ifdef FT_THREADSAFE
+#include <pthread.h>
+#endif
+#ifdef FT_HIST
+#include "histFT.h"
+#endif
+#ifdef FT_TRACE
+#include "traceFT.h"
+#endif
+#ifdef FT_RECORD
+#include "recordFT.h"
+#endif
 
 /*
   The File Tree (FT) maintains a hierarchical structure of directories and files.
-  It uses three static variables to represent its state.
+  It uses three static variables to represent its state. With -DFT_PERTHREAD
+  they are thread-local, so every thread has its own independent File Tree.
 */
+#ifdef FT_PERTHREAD
+#define FT_STATE static __thread
+#else
+#define FT_STATE static
+#endif
 
 /* Flag indicating whether the File Tree has been initialized */
-static boolean bIsInitialized;
+FT_STATE boolean bIsInitialized;
 
 /* Root node of the File Tree */
-static Node_T oNRoot;
+FT_STATE Node_T oNRoot;
 
 /* Total number of nodes in the File Tree */
-static size_t ulCount;
+FT_STATE size_t ulCount;
 
-/*---------------------------------------------------------------*/
-/* Static Helper Function Prototypes                             */
-/*---------------------------------------------------------------*/
+/* Bumped whenever nodes are freed, so that a cursor taken before
+   then is known to be stale */
+FT_STATE unsigned long ulGeneration;
 
 /*
-  Navigates the File Tree starting from the root node towards the specified path `oPPath`.
-  The traversal stops if a file node is encountered, as files cannot have children.
-
-  Parameters:
-    - oPPath: the target `Path_T` object representing the path to traverse to
-    - poNFurthestNode: pointer to where we'll store the deepest `Node_T` reached
-    - pbIsFile: pointer to a boolean that will be set to TRUE if traversal stopped at a file node
-
-  Returns:
-    - SUCCESS if traversal is successful
-    - Appropriate error code otherwise
-
-  On success, sets `*poNFurthestNode` to the deepest node reached and `*pbIsFile` accordingly.
-  On failure, sets `*poNFurthestNode` to NULL.
+  The cursor: the directory the last traversal ended in (or the
+  parent of the file it ended at), and ulGeneration at the time.
+  Successive operations tend to stay in one part of the tree, so the
+  next traversal starts from the cursor, or the nearest ancestor of
+  it on the way to its target, instead of the root. Each thread has
+  its own in a -DFT_THREADSAFE or -DFT_PERTHREAD build.
 */
-static int FT_traversePath(Path_T oPPath, Node_T *poNFurthestNode, boolean *pbIsFile);
+#if defined(FT_THREADSAFE) || defined(FT_PERTHREAD)
+#define FT_CURSOR static __thread
+#else
+#define FT_CURSOR static
+#endif
+FT_CURSOR Node_T oNCursor;
+FT_CURSOR unsigned long ulCursorGeneration;
+
+#ifdef FT_THREADSAFE
+/* With -DFT_THREADSAFE, queries hold this lock shared and everything
+   that modifies the tree holds it exclusively */
+static pthread_rwlock_t sTreeLock = PTHREAD_RWLOCK_INITIALIZER;
+
+/* Lock statistics reported by FT_getLockStats, updated atomically */
+static unsigned long ulLockAcquired;
+static unsigned long ulLockContended;
+static unsigned long ulLockWaitNanos;
+#endif
+
+#ifdef FT_HEAT
+/* Number of lookups recorded by FT_recordHeat; its high bits are the
+   heat epoch, which advances every 2^HEAT_EPOCH_SHIFT lookups */
+static unsigned long ulHeatLookups;
+
+enum { HEAT_EPOCH_SHIFT = 16 };
+#endif
+
+/* The child process writing the snapshot FT_saveAsync last started,
+   or 0 once it has been waited for, and the status of the last
+   snapshot waited for */
+FT_STATE pid_t iSavePid;
+FT_STATE int iSaveStatus = SUCCESS;
+
+/*---------------------------------------------------------------*/
+/* Static Helper Function Prototypes                             */
+/*---------------------------------------------------------------*/
 
 /*
   Traverses the File Tree to find a node with absolute path `pcPath`.
@@ -68,142 +135,328 @@ static int FT_traversePath(Path_T oPPath, Node_T *poNFurthestNode, boolean *pbIs
 static int FT_findNode(const char *pcPath, Node_T *poNResult);
 
 /*
-  Handles errors during insertion operations.
-  Frees allocated resources and returns the provided status code.
+  Creates the node with path `oPPath` under `oNParent` for an
+  insertion: a file holding the contents in `pvExtra` if `bIsLast`
+  and `pvExtra` is not NULL, and a directory otherwise. This is the
+  FT's TREECORE_NEW_NODE.
 
   Parameters:
-    - iStatus: the error code to return
-    - oPPath: the `Path_T` object that was being inserted
-    - oNNewNodes: the newly created nodes that need to be freed
+    - oPPath: the path of the new node
+    - oNParent: its parent, or NULL for the root
+    - bIsLast: whether this is the last node the insertion creates
+    - pvExtra: NULL when inserting a directory, or a pointer to the
+      `struct FT_contents` of the file being inserted
+    - poNResult: where to store the new node
 
   Returns:
-    - The provided error status `iStatus`
+    - SUCCESS, or the error status of NodeFT_new or NodeFT_setContents
 */
-static int FT_handleInsertError(int iStatus, Path_T oPPath, Node_T oNNewNodes);
+static int FT_newNode(Path_T oPPath, Node_T oNParent, boolean bIsLast,
+                      void *pvExtra, Node_T *poNResult);
 
 /*
-  Helper function for pre-order traversal of the File Tree.
-  Inserts each node into `oDNodes` starting at index `ulIndex`.
+  Returns TRUE and stores the child of directory `oNParent` whose path
+  is the first `ulLength` characters of `pcPath` in `*poNChild` if
+  there is one, looking among the file children first; returns FALSE
+  otherwise. This is the FT's TREECORE_FIND_CHILD_PREFIX, which spares
+  a traversal from building a Path_T for each level it goes down.
+*/
+static boolean FT_findChild(Node_T oNParent, const char *pcPath, size_t ulLength,
+                            Node_T *poNChild);
+
+/*
+  Returns the number of children of `oNNode`: files and directories
+  together, or 0 for a file.
+*/
+static size_t FT_numChildren(Node_T oNNode);
+
+/*
+  Makes the directory `oNFurthest` (or the parent of `oNFurthest`, if
+  it is a file) the cursor.
 
   Parameters:
-    - oNNode: the current `Node_T` being traversed
-    - oDNodes: the dynamic array `DynArray_T` to store nodes
-    - ulIndex: the current index in the array
+    - oNFurthest: the deepest node a traversal reached
+*/
+static void FT_remember(Node_T oNFurthest);
+
+/*
+  If the cursor is current, replaces `*poNCurr`, the root, with the
+  deepest of the cursor and its ancestors whose path is a prefix of
+  `oPPath`. This is the FT's TREECORE_RESUME.
+
+  Parameters:
+    - oPPath: the path being traversed towards
+    - poNCurr: where the node to start from is stored
+*/
+static void FT_resume(Path_T oPPath, Node_T *poNCurr);
+
+/*
+  Returns child `ulIndex` of directory `oNNode`, numbering its file
+  children first and its directory children after them, which is
+  the order FT_toString lists them in.
+*/
+static Node_T FT_child(Node_T oNNode, size_t ulIndex);
+
+#ifdef FT_HEAT
+/*
+  Records a lookup that reached `oNFurthest` in the per-directory
+  access counters: it ended at `oNFurthest` (or at its parent, if
+  `oNFurthest` is a file) and passed through every ancestor of that.
+
+  Parameters:
+    - oNFurthest: the deepest node the lookup reached
+*/
+static void FT_recordHeat(Node_T oNFurthest);
+
+/*
+  Offers directory `oNDir` to the bounded min-heap `psHeap` that holds
+  the `ulK` hottest directories seen so far, then does the same for
+  every directory below it.
+
+  Parameters:
+    - oNDir: the root of the subtree to scan
+    - psHeap: min-heap ordered by (ulEnded, ulThrough)
+    - pulHeapSize: the number of entries currently in `psHeap`
+    - ulK: the capacity of `psHeap`
+    - ulEpoch: the current heat epoch
+*/
+static void FT_collectHotspots(Node_T oNDir, struct FT_Hotspot *psHeap,
+                               size_t *pulHeapSize, size_t ulK,
+                               unsigned long ulEpoch);
+#endif
+
+/*
+  Marks the start of a public FT operation for the optional
+  instrumentation compiled in with -DFT_HIST, -DFT_TRACE or
+  -DFT_RECORD.
 
   Returns:
-    - The next available index in `oDNodes` after insertion
+    - An opaque start stamp to pass to FT_probeEnd (0 when no
+      instrumentation is compiled in)
+*/
+static unsigned long FT_probeBegin(void);
+
+/*
+  Marks the end of the public FT operation `eOp` that began at
+  `ulStart` and hands the observation to the enabled instrumentation.
+
+  Parameters:
+    - eOp: the operation that just finished
+    - ulStart: the stamp returned by the matching FT_probeBegin
+    - pcPath: the path the operation was called with, or NULL
+    - ulLength: the content length the operation was called with,
+      or 0 if it takes none
+    - iResult: the status the operation returned; for boolean
+      operations the boolean, and for pointer operations whether
+      the pointer was non-NULL
 */
-static size_t FT_preOrderTraversal(Node_T oNNode, DynArray_T oDNodes, size_t ulIndex);
+static void FT_probeEnd(enum OpFT eOp, unsigned long ulStart,
+                        const char *pcPath, size_t ulLength,
+                        int iResult);
+
+/*
+  Acquires the tree lock, exclusively if `bWrite` is TRUE and shared
+  otherwise, counting the time spent waiting for other threads. Does
+  nothing unless the FT is compiled with -DFT_THREADSAFE.
+
+  Parameters:
+    - bWrite: whether the caller will modify the tree
+*/
+static void FT_lock(boolean bWrite);
+
+/*
+  Releases the tree lock taken by FT_lock. Does nothing unless the
+  FT is compiled with -DFT_THREADSAFE.
+*/
+static void FT_unlock(void);
+
+/*
+  Asserts that the tree is valid after a mutation at `pcPath`. With
+  -DFT_CHECK_INCREMENTAL only the region around `pcPath` is checked
+  (see CheckerFT_isValidRegion); with -DFT_CHECK the whole tree is.
+  Does nothing otherwise. Called with the lock still held.
+
+  Parameters:
+    - pcPath: the path the mutation was called with, or NULL to
+      check only the FT's state variables
+*/
+static void FT_check(const char *pcPath);
 
 /*---------------------------------------------------------------*/
 /* Static Helper Function Definitions                            */
 /*---------------------------------------------------------------*/
 
+/* The contents of a file being inserted, passed to FT_newNode */
+struct FT_contents {
+    void *pvContents;
+    size_t ulLength;
+};
+
 /*
-  Navigates the File Tree starting from the root node towards the specified path `oPPath`.
-  The traversal stops if a file node is encountered, as files cannot have children.
+  Traversal, lookup, insertion and serialization come from the shared
+  tree template in treeCore.h, specialized here to nodeFT's nodes,
+  whose files are leaves listed before their directory siblings.
+*/
+#define TREECORE_NODE Node_T
+#define TREECORE_FN(name) FT_core##name
+#define TREECORE_GET_PATH(n) NodeFT_getPath(n)
+#define TREECORE_FIND_CHILD_PREFIX(n, pcPath, ulLength, poNChild) \
+    FT_findChild((n), (pcPath), (ulLength), (poNChild))
+#define TREECORE_NUM_CHILDREN(n) FT_numChildren(n)
+#define TREECORE_GET_CHILD(n, i) FT_child((n), (i))
+#define TREECORE_NEW_NODE(oPPath, oNParent, bIsLast, pvExtra, poNResult) \
+    FT_newNode((oPPath), (oNParent), (bIsLast), (pvExtra), (poNResult))
+#define TREECORE_FREE(n) NodeFT_free(n)
+#define TREECORE_IS_LEAF(n) NodeFT_isFile(n)
+#define TREECORE_LABEL(n) (NodeFT_isFile(n) ? "File: " : "Dir:  ")
+#define TREECORE_PREFETCH(n) NodeFT_prefetch(n)
+#define TREECORE_BATCH
+#define TREECORE_RESUME(oPPath, poNCurr) FT_resume((oPPath), (poNCurr))
+#ifdef FT_HEAT
+#define TREECORE_VISIT(n) (FT_recordHeat(n), FT_remember(n))
+#else
+#define TREECORE_VISIT(n) FT_remember(n)
+#endif
+#include "treeCore.h"
 
-  Parameters:
-    - oPPath: the target `Path_T` object representing the path to traverse to
-    - poNFurthestNode: pointer to where we'll store the deepest `Node_T` reached
-    - pbIsFile: pointer to a boolean that will be set to TRUE if traversal stopped at a file node
+/*
+  Returns TRUE and stores the child of directory `oNParent` whose path
+  is the first `ulLength` characters of `pcPath` in `*poNChild` if
+  there is one, looking among the file children first; returns FALSE
+  otherwise. This is the FT's TREECORE_FIND_CHILD_PREFIX, which spares
+  a traversal from building a Path_T for each level it goes down.
+*/
+static boolean FT_findChild(Node_T oNParent, const char *pcPath, size_t ulLength,
+                            Node_T *poNChild) {
+    size_t ulChildID = 0;
 
-  Returns:
-    - SUCCESS if traversal is successful
-    - Appropriate error code otherwise
+    if (NodeFT_hasChildPrefix(oNParent, pcPath, ulLength, &ulChildID, TRUE))
+        return (boolean)(NodeFT_getChild(oNParent, ulChildID, poNChild, TRUE) == SUCCESS);
+    if (NodeFT_hasChildPrefix(oNParent, pcPath, ulLength, &ulChildID, FALSE))
+        return (boolean)(NodeFT_getChild(oNParent, ulChildID, poNChild, FALSE) == SUCCESS);
+    return FALSE;
+}
 
-  On success, sets `*poNFurthestNode` to the deepest node reached and `*pbIsFile` accordingly.
-  On failure, sets `*poNFurthestNode` to NULL.
+/*
+  Returns the number of children of `oNNode`: files and directories
+  together, or 0 for a file.
 */
-static int FT_traversePath(Path_T oPPath, Node_T *poNFurthestNode, boolean *pbIsFile) {
-    int iStatus;
-    Path_T oPPrefixPath = NULL;
-    Node_T oNCurrNode = NULL;
+static size_t FT_numChildren(Node_T oNNode) {
+    if (NodeFT_isFile(oNNode))
+        return 0;
+    return NodeFT_getNumChildren(oNNode, TRUE) + NodeFT_getNumChildren(oNNode, FALSE);
+}
+
+/*
+  Returns child `ulIndex` of directory `oNNode`, numbering its file
+  children first and its directory children after them, which is
+  the order FT_toString lists them in.
+*/
+static Node_T FT_child(Node_T oNNode, size_t ulIndex) {
     Node_T oNChild = NULL;
-    size_t ulDepth, ulIndex;
-    size_t ulChildID = 0;
-    boolean bFoundFile = FALSE;
+    size_t ulFiles = NodeFT_getNumChildren(oNNode, TRUE);
+    int iStatus;
 
-    assert(oPPath != NULL);
-    assert(poNFurthestNode != NULL);
-    assert(pbIsFile != NULL);
+    if (ulIndex < ulFiles)
+        iStatus = NodeFT_getChild(oNNode, ulIndex, &oNChild, TRUE);
+    else
+        iStatus = NodeFT_getChild(oNNode, ulIndex - ulFiles, &oNChild, FALSE);
+    assert(iStatus == SUCCESS);
+    (void)iStatus;
+    return oNChild;
+}
 
-    if (oNRoot == NULL) {
-        *poNFurthestNode = NULL;
-        *pbIsFile = FALSE;
-        return SUCCESS;
-    }
+/*
+  Makes the directory `oNFurthest` (or the parent of `oNFurthest`, if
+  it is a file) the cursor.
 
-    /* Get the first component of the path */
-    iStatus = Path_prefix(oPPath, 1, &oPPrefixPath);
-    if (iStatus != SUCCESS) {
-        *poNFurthestNode = NULL;
-        return iStatus;
-    }
+  Parameters:
+    - oNFurthest: the deepest node a traversal reached
+*/
+static void FT_remember(Node_T oNFurthest) {
+    assert(oNFurthest != NULL);
 
-    /* Compare with the root's path */
-    if (Path_comparePath(NodeFT_getPath(oNRoot), oPPrefixPath) != 0) {
-        Path_free(oPPrefixPath);
-        *poNFurthestNode = NULL;
-        return CONFLICTING_PATH;
-    }
-    Path_free(oPPrefixPath);
+    oNCursor = NodeFT_isFile(oNFurthest) ? NodeFT_getParent(oNFurthest) : oNFurthest;
+    ulCursorGeneration = ulGeneration;
+}
+
+/*
+  If the cursor is current, replaces `*poNCurr`, the root, with the
+  deepest of the cursor and its ancestors whose path is a prefix of
+  `oPPath`. This is the FT's TREECORE_RESUME.
 
-    oNCurrNode = oNRoot;
-    ulDepth = Path_getDepth(oPPath);
-    ulIndex = 2;
+  Parameters:
+    - oPPath: the path being traversed towards
+    - poNCurr: where the node to start from is stored
+*/
+static void FT_resume(Path_T oPPath, Node_T *poNCurr) {
+    const char *pcCursor, *pcPath;
+    size_t ulShared, ulIndex;
+    Node_T oNStart;
 
-    /* Loop through each component of the path */
-    while (ulIndex <= ulDepth) {
-        iStatus = Path_prefix(oPPath, ulIndex, &oPPrefixPath);
-        if (iStatus != SUCCESS) {
-            *poNFurthestNode = NULL;
-            return iStatus;
-        }
+    assert(oPPath != NULL);
+    assert(poNCurr != NULL);
+
+    if (oNCursor == NULL || ulCursorGeneration != ulGeneration)
+        return;
+
+    /* find the longest prefix of whole components the two share */
+    pcCursor = Path_getPathname(NodeFT_getPath(oNCursor));
+    pcPath = Path_getPathname(oPPath);
+    for (ulIndex = 0; pcCursor[ulIndex] != '\0' && pcCursor[ulIndex] == pcPath[ulIndex]; ulIndex++)
+        ;
+    ulShared = ulIndex;
+    /* if they part within a component, back up to the '/' before it,
+       which is never where they part ("r/a/c" and "r/ab" share "r") */
+    if ((pcCursor[ulIndex] != '\0' && pcCursor[ulIndex] != '/') ||
+        (pcPath[ulIndex] != '\0' && pcPath[ulIndex] != '/'))
+        while (ulShared > 0 && pcCursor[--ulShared] != '/')
+            ;
+    if (ulShared == 0)
+        return;
+
+    /* climb from the cursor once per component past the shared part */
+    oNStart = oNCursor;
+    for (ulIndex = ulShared; pcCursor[ulIndex] != '\0'; ulIndex++)
+        if (pcCursor[ulIndex] == '/')
+            oNStart = NodeFT_getParent(oNStart);
+    *poNCurr = oNStart;
+}
 
-        if (NodeFT_isFile(oNCurrNode)) {
-            /* Cannot traverse further if current node is a file */
-            *poNFurthestNode = oNCurrNode;
-            *pbIsFile = TRUE;
-            Path_free(oPPrefixPath);
-            return NOT_A_DIRECTORY;
-        }
+/*
+  Creates the node with path `oPPath` under `oNParent` for an
+  insertion: a file holding the contents in `pvExtra` if `bIsLast`
+  and `pvExtra` is not NULL, and a directory otherwise. This is the
+  FT's TREECORE_NEW_NODE.
 
-        /* Check for file child first */
-        if (NodeFT_hasChild(oNCurrNode, oPPrefixPath, &ulChildID, TRUE)) {
-            iStatus = NodeFT_getChild(oNCurrNode, ulChildID, &oNChild, TRUE);
-            if (iStatus != SUCCESS) {
-                Path_free(oPPrefixPath);
-                *poNFurthestNode = NULL;
-                return iStatus;
-            }
-            oNCurrNode = oNChild;
-            bFoundFile = TRUE;
-        }
-        /* Check for directory child */
-        else if (NodeFT_hasChild(oNCurrNode, oPPrefixPath, &ulChildID, FALSE)) {
-            iStatus = NodeFT_getChild(oNCurrNode, ulChildID, &oNChild, FALSE);
-            if (iStatus != SUCCESS) {
-                Path_free(oPPrefixPath);
-                *poNFurthestNode = NULL;
-                return iStatus;
-            }
-            oNCurrNode = oNChild;
-            bFoundFile = FALSE;
-        }
-        else {
-            /* No child found, traversal ends */
-            Path_free(oPPrefixPath);
-            break;
-        }
+  Parameters:
+    - oPPath: the path of the new node
+    - oNParent: its parent, or NULL for the root
+    - bIsLast: whether this is the last node the insertion creates
+    - pvExtra: NULL when inserting a directory, or a pointer to the
+      `struct FT_contents` of the file being inserted
+    - poNResult: where to store the new node
 
-        Path_free(oPPrefixPath);
-        ulIndex++;
-    }
+  Returns:
+    - SUCCESS, or the error status of NodeFT_new or NodeFT_setContents
+*/
+static int FT_newNode(Path_T oPPath, Node_T oNParent, boolean bIsLast,
+                      void *pvExtra, Node_T *poNResult) {
+    struct FT_contents *psContents = pvExtra;
+    boolean bIsFile = (boolean)(bIsLast && psContents != NULL);
+    int iStatus;
 
-    *poNFurthestNode = oNCurrNode;
-    *pbIsFile = bFoundFile;
-    return SUCCESS;
+    iStatus = NodeFT_new(oPPath, oNParent, bIsFile, poNResult);
+    if (iStatus != SUCCESS || !bIsFile)
+        return iStatus;
+
+    iStatus = NodeFT_setContents(*poNResult, psContents->pvContents,
+                                 psContents->ulLength);
+    if (iStatus != SUCCESS) {
+        (void)NodeFT_free(*poNResult);
+        *poNResult = NULL;
+    }
+    return iStatus;
 }
 
 /*
@@ -221,11 +474,6 @@ static int FT_traversePath(Path_T oPPath, Node_T *poNFurthestNode, boolean *pbIs
   On failure, sets `*poNResult` to NULL.
 */
 static int FT_findNode(const char *pcPath, Node_T *poNResult) {
-    int iStatus;
-    Path_T oPPath = NULL;
-    Node_T oNFoundNode = NULL;
-    boolean bIsFile = FALSE;
-
     assert(pcPath != NULL);
     assert(poNResult != NULL);
 
@@ -233,108 +481,242 @@ static int FT_findNode(const char *pcPath, Node_T *poNResult) {
         *poNResult = NULL;
         return INITIALIZATION_ERROR;
     }
+    return FT_corefind(oNRoot, pcPath, poNResult);
+}
 
-    /* Create a Path_T object from the string */
-    iStatus = Path_new(pcPath, &oPPath);
-    if (iStatus != SUCCESS) {
-        *poNResult = NULL;
-        return iStatus;
-    }
+#ifdef FT_HEAT
+/*
+  Records a lookup that reached `oNFurthest` in the per-directory
+  access counters: it ended at `oNFurthest` (or at its parent, if
+  `oNFurthest` is a file) and passed through every ancestor of that.
 
-    /* Traverse the tree to find the node */
-    iStatus = FT_traversePath(oPPath, &oNFoundNode, &bIsFile);
-    if (iStatus != SUCCESS) {
-        Path_free(oPPath);
-        *poNResult = NULL;
-        return iStatus;
+  Parameters:
+    - oNFurthest: the deepest node the lookup reached
+*/
+static void FT_recordHeat(Node_T oNFurthest) {
+    Node_T oNDir;
+    unsigned long ulEpoch;
+
+    assert(oNFurthest != NULL);
+
+    ulEpoch = __atomic_fetch_add(&ulHeatLookups, 1, __ATOMIC_RELAXED)
+              >> HEAT_EPOCH_SHIFT;
+
+    oNDir = NodeFT_isFile(oNFurthest) ? NodeFT_getParent(oNFurthest) : oNFurthest;
+    NodeFT_touch(oNDir, TRUE, ulEpoch);
+    for (oNDir = NodeFT_getParent(oNDir); oNDir != NULL; oNDir = NodeFT_getParent(oNDir))
+        NodeFT_touch(oNDir, FALSE, ulEpoch);
+}
+
+/*
+  Returns TRUE if hotspot `psFirst` is colder than `psSecond`,
+  ordering by lookups ended first and lookups passed through second.
+*/
+static boolean FT_isColder(const struct FT_Hotspot *psFirst,
+                           const struct FT_Hotspot *psSecond) {
+    assert(psFirst != NULL);
+    assert(psSecond != NULL);
+
+    if (psFirst->ulEnded != psSecond->ulEnded)
+        return psFirst->ulEnded < psSecond->ulEnded;
+    return psFirst->ulThrough < psSecond->ulThrough;
+}
+
+/*
+  Restores the min-heap property of `psHeap` (of `ulSize` entries)
+  below index `ulIndex`.
+*/
+static void FT_siftDown(struct FT_Hotspot *psHeap, size_t ulSize, size_t ulIndex) {
+    struct FT_Hotspot sTemp;
+    size_t ulChild;
+
+    assert(psHeap != NULL);
+
+    while ((ulChild = 2 * ulIndex + 1) < ulSize) {
+        if (ulChild + 1 < ulSize && FT_isColder(&psHeap[ulChild + 1], &psHeap[ulChild]))
+            ulChild++;
+        if (!FT_isColder(&psHeap[ulChild], &psHeap[ulIndex]))
+            break;
+        sTemp = psHeap[ulIndex];
+        psHeap[ulIndex] = psHeap[ulChild];
+        psHeap[ulChild] = sTemp;
+        ulIndex = ulChild;
     }
+}
 
-    if (oNFoundNode == NULL) {
-        Path_free(oPPath);
-        *poNResult = NULL;
-        return NO_SUCH_PATH;
+/*
+  Offers directory `oNDir` to the bounded min-heap `psHeap` that holds
+  the `ulK` hottest directories seen so far, then does the same for
+  every directory below it. While collecting, pcPath holds the
+  directory's Node_T rather than a copy of its path.
+
+  Parameters:
+    - oNDir: the root of the subtree to scan
+    - psHeap: min-heap ordered by (ulEnded, ulThrough)
+    - pulHeapSize: the number of entries currently in `psHeap`
+    - ulK: the capacity of `psHeap`
+    - ulEpoch: the current heat epoch
+*/
+static void FT_collectHotspots(Node_T oNDir, struct FT_Hotspot *psHeap,
+                               size_t *pulHeapSize, size_t ulK,
+                               unsigned long ulEpoch) {
+    struct FT_Hotspot sCandidate;
+    Node_T oNChild = NULL;
+    size_t ulChildIndex, ulIndex;
+    int iStatus;
+
+    assert(oNDir != NULL);
+    assert(psHeap != NULL);
+    assert(pulHeapSize != NULL);
+
+    NodeFT_getHeat(oNDir, ulEpoch, &sCandidate.ulEnded, &sCandidate.ulThrough);
+    sCandidate.pcPath = (char *)oNDir;
+
+    if (*pulHeapSize < ulK) {
+        /* heap not full yet: sift the new entry up */
+        ulIndex = (*pulHeapSize)++;
+        psHeap[ulIndex] = sCandidate;
+        while (ulIndex > 0 && FT_isColder(&psHeap[ulIndex], &psHeap[(ulIndex - 1) / 2])) {
+            psHeap[ulIndex] = psHeap[(ulIndex - 1) / 2];
+            psHeap[(ulIndex - 1) / 2] = sCandidate;
+            ulIndex = (ulIndex - 1) / 2;
+        }
+    } else if (FT_isColder(&psHeap[0], &sCandidate)) {
+        /* hotter than the coldest kept entry: replace it */
+        psHeap[0] = sCandidate;
+        FT_siftDown(psHeap, *pulHeapSize, 0);
     }
 
-    /* Ensure the found node's path matches exactly */
-    if (Path_comparePath(NodeFT_getPath(oNFoundNode), oPPath) != 0) {
-        Path_free(oPPath);
-        *poNResult = NULL;
-        return NO_SUCH_PATH;
+    for (ulChildIndex = 0; ulChildIndex < NodeFT_getNumChildren(oNDir, FALSE); ulChildIndex++) {
+        iStatus = NodeFT_getChild(oNDir, ulChildIndex, &oNChild, FALSE);
+        assert(iStatus == SUCCESS);
+        FT_collectHotspots(oNChild, psHeap, pulHeapSize, ulK, ulEpoch);
     }
+}
+#endif /* FT_HEAT */
 
-    Path_free(oPPath);
-    *poNResult = oNFoundNode;
-    return SUCCESS;
+/*
+  Marks the start of a public FT operation for the optional
+  instrumentation compiled in with -DFT_HIST, -DFT_TRACE or
+  -DFT_RECORD.
+
+  Returns:
+    - An opaque start stamp to pass to FT_probeEnd (0 when no
+      instrumentation is compiled in)
+*/
+static unsigned long FT_probeBegin(void) {
+#ifdef FT_PROBED
+    return TimerFT_ticks();
+#else
+    return 0;
+#endif
 }
 
 /*
-  Handles errors during insertion operations.
-  Frees allocated resources and returns the provided status code.
+  Marks the end of the public FT operation `eOp` that began at
+  `ulStart` and hands the observation to the enabled instrumentation.
 
   Parameters:
-    - iStatus: the error code to return
-    - oPPath: the `Path_T` object that was being inserted
-    - oNNewNodes: the newly created nodes that need to be freed
-
-  Returns:
-    - The provided error status `iStatus`
+    - eOp: the operation that just finished
+    - ulStart: the stamp returned by the matching FT_probeBegin
+    - pcPath: the path the operation was called with, or NULL
+    - ulLength: the content length the operation was called with,
+      or 0 if it takes none
+    - iResult: the status the operation returned; for boolean
+      operations the boolean, and for pointer operations whether
+      the pointer was non-NULL
 */
-static int FT_handleInsertError(int iStatus, Path_T oPPath, Node_T oNNewNodes) {
-    /* Free the path and any new nodes created */
-    Path_free(oPPath);
-    if (oNNewNodes != NULL)
-        (void)NodeFT_free(oNNewNodes);
-    return iStatus;
+static void FT_probeEnd(enum OpFT eOp, unsigned long ulStart,
+                        const char *pcPath, size_t ulLength,
+                        int iResult) {
+#ifdef FT_PROBED
+    unsigned long ulEnd = TimerFT_ticks();
+#endif
+
+#ifdef FT_HIST
+    HistFT_record(eOp, TimerFT_ticksToNanos(ulEnd - ulStart));
+#endif
+#ifdef FT_TRACE
+    TraceFT_record(eOp, ulStart, ulEnd, pcPath, iResult);
+#endif
+#ifdef FT_RECORD
+    RecordFT_record(eOp, ulStart, ulEnd, pcPath, ulLength, iResult);
+#endif
+#ifndef FT_PROBED
+    (void)eOp;
+    (void)ulStart;
+#endif
+    (void)pcPath;
+    (void)ulLength;
+    (void)iResult;
 }
 
 /*
-  Helper function for pre-order traversal of the File Tree.
-  Inserts each node into `oDNodes` starting at index `ulIndex`.
+  Acquires the tree lock, exclusively if `bWrite` is TRUE and shared
+  otherwise, counting the time spent waiting for other threads. Does
+  nothing unless the FT is compiled with -DFT_THREADSAFE.
 
   Parameters:
-    - oNNode: the current `Node_T` being traversed
-    - oDNodes: the dynamic array `DynArray_T` to store nodes
-    - ulIndex: the current index in the array
+    - bWrite: whether the caller will modify the tree
+*/
+static void FT_lock(boolean bWrite) {
+#ifdef FT_THREADSAFE
+    unsigned long ulStart;
+    int iBusy;
+
+    /* only time the acquisitions that actually have to wait */
+    iBusy = bWrite ? pthread_rwlock_trywrlock(&sTreeLock)
+                   : pthread_rwlock_tryrdlock(&sTreeLock);
+    if (iBusy != 0) {
+        ulStart = TimerFT_nanos();
+        if (bWrite)
+            pthread_rwlock_wrlock(&sTreeLock);
+        else
+            pthread_rwlock_rdlock(&sTreeLock);
+        __atomic_fetch_add(&ulLockWaitNanos, TimerFT_nanos() - ulStart,
+                           __ATOMIC_RELAXED);
+        __atomic_fetch_add(&ulLockContended, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&ulLockAcquired, 1, __ATOMIC_RELAXED);
+#else
+    (void)bWrite;
+#endif
+}
 
-  Returns:
-    - The next available index in `oDNodes` after insertion
+/*
+  Releases the tree lock taken by FT_lock. Does nothing unless the
+  FT is compiled with -DFT_THREADSAFE.
 */
-static size_t FT_preOrderTraversal(Node_T oNNode, DynArray_T oDNodes, size_t ulIndex) {
-    size_t ulNumFileChildren, ulNumDirChildren;
-    size_t ulChildIndex;
-    Node_T oNChild = NULL;
-    int iStatus;
+static void FT_unlock(void) {
+#ifdef FT_THREADSAFE
+    pthread_rwlock_unlock(&sTreeLock);
+#endif
+}
 
-    assert(oDNodes != NULL);
-
-    if (oNNode != NULL) {
-        /* Add the current node to the array */
-        (void)DynArray_set(oDNodes, ulIndex, oNNode);
-        ulIndex++;
-
-        if (!NodeFT_isFile(oNNode)) {
-            /* Traverse file children first */
-            ulNumFileChildren = NodeFT_getNumChildren(oNNode, TRUE);
-            for (ulChildIndex = 0; ulChildIndex < ulNumFileChildren; ulChildIndex++) {
-                iStatus = NodeFT_getChild(oNNode, ulChildIndex, &oNChild, TRUE);
-                assert(iStatus == SUCCESS);
-                ulIndex = FT_preOrderTraversal(oNChild, oDNodes, ulIndex);
-            }
-
-            /* Then traverse directory children */
-            ulNumDirChildren = NodeFT_getNumChildren(oNNode, FALSE);
-            for (ulChildIndex = 0; ulChildIndex < ulNumDirChildren; ulChildIndex++) {
-                iStatus = NodeFT_getChild(oNNode, ulChildIndex, &oNChild, FALSE);
-                assert(iStatus == SUCCESS);
-                ulIndex = FT_preOrderTraversal(oNChild, oDNodes, ulIndex);
-            }
-        }
-    }
-    return ulIndex;
+/*
+  Asserts that the tree is valid after a mutation at `pcPath`. With
+  -DFT_CHECK_INCREMENTAL only the region around `pcPath` is checked
+  (see CheckerFT_isValidRegion); with -DFT_CHECK the whole tree is.
+  Does nothing otherwise. Called with the lock still held.
+
+  Parameters:
+    - pcPath: the path the mutation was called with, or NULL to
+      check only the FT's state variables
+*/
+static void FT_check(const char *pcPath) {
+#if defined(FT_CHECK_INCREMENTAL)
+    assert(CheckerFT_isValidRegion(bIsInitialized, oNRoot, ulCount,
+                                   pcPath));
+#elif defined(FT_CHECK)
+    (void)pcPath;
+    assert(CheckerFT_isValid(bIsInitialized, oNRoot, ulCount));
+#else
+    (void)pcPath;
+#endif
 }
 
 /*---------------------------------------------------------------*/
-/* Public Interface Functions                                    */
+/* Lifecycle Functions                                           */
 /*---------------------------------------------------------------*/
 
 /*
@@ -343,7 +725,7 @@ static size_t FT_preOrderTraversal(Node_T oNNode, DynArray_T oDNodes, size_t ulI
   Returns INITIALIZATION_ERROR if already initialized,
   and SUCCESS otherwise.
 */
-int FT_init(void) {
+static int FT_doInit(void) {
     if (bIsInitialized)
         return INITIALIZATION_ERROR;
 
@@ -360,7 +742,7 @@ int FT_init(void) {
   Returns INITIALIZATION_ERROR if not already initialized,
   and SUCCESS otherwise.
 */
-int FT_destroy(void) {
+static int FT_doDestroy(void) {
     if (!bIsInitialized)
         return INITIALIZATION_ERROR;
 
@@ -368,6 +750,7 @@ int FT_destroy(void) {
         ulCount -= NodeFT_free(oNRoot);
         oNRoot = NULL;
     }
+    ulGeneration++;
 
     bIsInitialized = FALSE;
 
@@ -389,15 +772,9 @@ int FT_destroy(void) {
   * ALREADY_IN_TREE if pcPath is already in the FT (as dir or file)
   * MEMORY_ERROR if memory could not be allocated to complete request
 */
-int FT_insertDir(const char *pcPath) {
+static int FT_doInsertDir(const char *pcPath) {
     int iStatus;
     Path_T oPPath = NULL;
-    Node_T oNCurrNode = NULL;
-    Node_T oNNewNodes = NULL;
-    size_t ulDepth, ulCurrDepth;
-    size_t ulNewNodesCount = 0;
-    boolean bIsFile = FALSE;
-    size_t ulIndex;
 
     assert(pcPath != NULL);
 
@@ -409,70 +786,10 @@ int FT_insertDir(const char *pcPath) {
     if (iStatus != SUCCESS)
         return iStatus;
 
-    /* Traverse the tree to find how far we can go */
-    iStatus = FT_traversePath(oPPath, &oNCurrNode, &bIsFile);
-    if (iStatus != SUCCESS) {
-        Path_free(oPPath);
-        return iStatus;
-    }
-
-    if (oNCurrNode == NULL && oNRoot != NULL) {
-        /* Path conflicts with existing root */
-        Path_free(oPPath);
-        return CONFLICTING_PATH;
-    }
-
-    if (bIsFile) {
-        /* Can't insert under a file */
-        Path_free(oPPath);
-        return NOT_A_DIRECTORY;
-    }
-
-    ulDepth = Path_getDepth(oPPath);
-    ulCurrDepth = oNCurrNode ? Path_getDepth(NodeFT_getPath(oNCurrNode)) : 0;
-    ulIndex = ulCurrDepth + 1;
-
-    if (ulCurrDepth == ulDepth) {
-        /* The directory already exists */
-        if (Path_comparePath(NodeFT_getPath(oNCurrNode), oPPath) == 0) {
-            Path_free(oPPath);
-            return ALREADY_IN_TREE;
-        }
-    }
-
-    /* Build the path from oNCurrNode towards oPPath */
-    while (ulIndex <= ulDepth) {
-        Path_T oPPrefixPath = NULL;
-        Node_T oNNewNode = NULL;
-
-        /* Get the next prefix */
-        iStatus = Path_prefix(oPPath, ulIndex, &oPPrefixPath);
-        if (iStatus != SUCCESS) {
-            return FT_handleInsertError(iStatus, oPPath, oNNewNodes);
-        }
-
-        /* Create a new directory node */
-        iStatus = NodeFT_new(oPPrefixPath, oNCurrNode, FALSE, &oNNewNode);
-        Path_free(oPPrefixPath);
-        if (iStatus != SUCCESS) {
-            return FT_handleInsertError(iStatus, oPPath, oNNewNodes);
-        }
-
-        if (oNNewNodes == NULL)
-            oNNewNodes = oNNewNode; /* Keep track of the first new node */
-
-        oNCurrNode = oNNewNode;
-        ulNewNodesCount++;
-        ulIndex++;
-    }
-
+    /* Build whatever part of the path is missing, all directories */
+    iStatus = FT_coreinsert(&oNRoot, &ulCount, oPPath, NULL);
     Path_free(oPPath);
-
-    if (oNRoot == NULL)
-        oNRoot = oNNewNodes; /* Set the new root if needed */
-    ulCount += ulNewNodesCount;
-
-    return SUCCESS;
+    return iStatus;
 }
 
 /*
@@ -488,15 +805,10 @@ int FT_insertDir(const char *pcPath) {
   * ALREADY_IN_TREE if pcPath is already in the FT (as dir or file)
   * MEMORY_ERROR if memory could not be allocated to complete request
 */
-int FT_insertFile(const char *pcPath, void *pvContents, size_t ulLength) {
+static int FT_doInsertFile(const char *pcPath, void *pvContents, size_t ulLength) {
     int iStatus;
     Path_T oPPath = NULL;
-    Node_T oNCurrNode = NULL;
-    Node_T oNNewNodes = NULL;
-    size_t ulDepth, ulCurrDepth;
-    size_t ulNewNodesCount = 0;
-    boolean bIsFile = FALSE;
-    size_t ulIndex;
+    struct FT_contents sContents;
 
     assert(pcPath != NULL);
     /* Not asserting pvContents because it can be NULL (empty file) */
@@ -509,85 +821,18 @@ int FT_insertFile(const char *pcPath, void *pvContents, size_t ulLength) {
     if (iStatus != SUCCESS)
         return iStatus;
 
-    if (Path_getDepth(oPPath) == 1) {
-        /* Cannot insert a file at the root */
-        Path_free(oPPath);
-        return CONFLICTING_PATH;
-    }
-
-    /* Traverse the tree to find how far we can go */
-    iStatus = FT_traversePath(oPPath, &oNCurrNode, &bIsFile);
-    if (iStatus != SUCCESS) {
-        Path_free(oPPath);
-        return iStatus;
-    }
-
-    if (oNCurrNode == NULL) {
-        /* Path conflicts with existing root */
+    if (Path_getDepth(oPPath) == 1 || oNRoot == NULL) {
+        /* A file cannot be the root, or go anywhere without one */
         Path_free(oPPath);
         return CONFLICTING_PATH;
     }
 
-    if (bIsFile) {
-        /* Can't insert under a file */
-        Path_free(oPPath);
-        return NOT_A_DIRECTORY;
-    }
-
-    ulDepth = Path_getDepth(oPPath);
-    ulCurrDepth = oNCurrNode ? Path_getDepth(NodeFT_getPath(oNCurrNode)) : 0;
-    ulIndex = ulCurrDepth + 1;
-
-    if (ulCurrDepth == ulDepth) {
-        /* The file already exists */
-        if (Path_comparePath(NodeFT_getPath(oNCurrNode), oPPath) == 0) {
-            Path_free(oPPath);
-            return ALREADY_IN_TREE;
-        }
-    }
-
-    /* Build the path from oNCurrNode towards oPPath */
-    while (ulIndex <= ulDepth) {
-        Path_T oPPrefixPath = NULL;
-        Node_T oNNewNode = NULL;
-        boolean bIsFileNode = (ulIndex == ulDepth) ? TRUE : FALSE;  /* Ensure boolean assignment */
-
-        /* Get the next prefix */
-        iStatus = Path_prefix(oPPath, ulIndex, &oPPrefixPath);
-        if (iStatus != SUCCESS) {
-            return FT_handleInsertError(iStatus, oPPath, oNNewNodes);
-        }
-
-        /* Create a new node (file or directory) */
-        iStatus = NodeFT_new(oPPrefixPath, oNCurrNode, bIsFileNode, &oNNewNode);
-        Path_free(oPPrefixPath);
-        if (iStatus != SUCCESS) {
-            return FT_handleInsertError(iStatus, oPPath, oNNewNodes);
-        }
-
-        if (bIsFileNode) {
-            /* Set the contents of the new file */
-            iStatus = NodeFT_setContents(oNNewNode, pvContents, ulLength);
-            if (iStatus != SUCCESS) {
-                return FT_handleInsertError(iStatus, oPPath, oNNewNodes);
-            }
-        }
-
-        if (oNNewNodes == NULL)
-            oNNewNodes = oNNewNode; /* Keep track of the first new node */
-
-        oNCurrNode = oNNewNode;
-        ulNewNodesCount++;
-        ulIndex++;
-    }
-
+    /* Build the missing directories, then the file at the end */
+    sContents.pvContents = pvContents;
+    sContents.ulLength = ulLength;
+    iStatus = FT_coreinsert(&oNRoot, &ulCount, oPPath, &sContents);
     Path_free(oPPath);
-
-    if (oNRoot == NULL)
-        oNRoot = oNNewNodes; /* Set the new root if needed */
-    ulCount += ulNewNodesCount;
-
-    return SUCCESS;
+    return iStatus;
 }
 
 /*---------------------------------------------------------------*/
@@ -605,7 +850,7 @@ int FT_insertFile(const char *pcPath, void *pvContents, size_t ulLength) {
   * NOT_A_DIRECTORY if pcPath is in the FT as a file not a directory
   * MEMORY_ERROR if memory could not be allocated to complete request
 */
-int FT_rmDir(const char *pcPath) {
+static int FT_doRmDir(const char *pcPath) {
     int iStatus;
     Node_T oNTargetNode = NULL;
 
@@ -623,6 +868,7 @@ int FT_rmDir(const char *pcPath) {
     ulCount -= NodeFT_free(oNTargetNode);
     if (ulCount == 0)
         oNRoot = NULL;
+    ulGeneration++;
 
     return SUCCESS;
 }
@@ -638,7 +884,7 @@ int FT_rmDir(const char *pcPath) {
   * NOT_A_FILE if pcPath is in the FT as a directory not a file
   * MEMORY_ERROR if memory could not be allocated to complete request
 */
-int FT_rmFile(const char *pcPath) {
+static int FT_doRmFile(const char *pcPath) {
     int iStatus;
     Node_T oNTargetNode = NULL;
 
@@ -656,6 +902,7 @@ int FT_rmFile(const char *pcPath) {
     ulCount -= NodeFT_free(oNTargetNode);
     if (ulCount == 0)
         oNRoot = NULL;
+    ulGeneration++;
 
     return SUCCESS;
 }
@@ -668,7 +915,7 @@ int FT_rmFile(const char *pcPath) {
   Returns TRUE if the FT contains a directory with absolute path
   pcPath and FALSE if not or if there is an error while checking.
 */
-boolean FT_containsDir(const char *pcPath) {
+static boolean FT_doContainsDir(const char *pcPath) {
     int iStatus;
     Node_T oNFoundNode = NULL;
 
@@ -687,7 +934,7 @@ boolean FT_containsDir(const char *pcPath) {
   Returns TRUE if the FT contains a file with absolute path
   pcPath and FALSE if not or if there is an error while checking.
 */
-boolean FT_containsFile(const char *pcPath) {
+static boolean FT_doContainsFile(const char *pcPath) {
     int iStatus;
     Node_T oNFoundNode = NULL;
 
@@ -709,7 +956,7 @@ boolean FT_containsFile(const char *pcPath) {
   Note: checking for a non-NULL return is not an appropriate
   contains check, because the contents of a file may be NULL.
 */
-void *FT_getFileContents(const char *pcPath) {
+static void *FT_doGetFileContents(const char *pcPath) {
     int iStatus;
     Node_T oNFoundNode = NULL;
     void *pvContents = NULL;
@@ -738,7 +985,7 @@ void *FT_getFileContents(const char *pcPath) {
   Returns the old contents if successful. (Note: contents may be NULL.)
   Returns NULL if unable to complete the request for any reason.
 */
-void *FT_replaceFileContents(const char *pcPath, void *pvNewContents, size_t ulNewLength) {
+static void *FT_doReplaceFileContents(const char *pcPath, void *pvNewContents, size_t ulNewLength) {
     int iStatus;
     Node_T oNFoundNode = NULL;
     void *pvOldContents = NULL;
@@ -800,7 +1047,7 @@ void *FT_replaceFileContents(const char *pcPath, void *pvNewContents, size_t ulN
 
   When returning another status, *pbIsFile and *pulSize are unchanged.
 */
-int FT_stat(const char *pcPath, boolean *pbIsFile, size_t *pulSize) {
+static int FT_doStat(const char *pcPath, boolean *pbIsFile, size_t *pulSize) {
     int iStatus;
     Node_T oNFoundNode = NULL;
 
@@ -827,6 +1074,82 @@ int FT_stat(const char *pcPath, boolean *pbIsFile, size_t *pulSize) {
     return SUCCESS;
 }
 
+/*
+  Looks up the `ulCount` paths in `ppcPaths` as FT_doStat would,
+  interleaving the lookups (see FT_corefindBatch).
+
+  Parameters:
+    - ppcPaths: the paths to look up
+    - ulCount: how many there are
+    - piStatus: where each path's status is stored
+    - pbIsFile: where each found path's type is stored
+    - pulSize: where each found file's size is stored
+
+  Returns:
+    - SUCCESS, or INITIALIZATION_ERROR if the FT is not initialized
+*/
+static int FT_doStatBatch(const char *const *ppcPaths, size_t ulCount,
+                          int *piStatus, boolean *pbIsFile, size_t *pulSize) {
+    Node_T aoNFound[TREECORE_GROUP];
+    size_t ulFirst, ulInGroup, ulIndex;
+
+    if (!bIsInitialized)
+        return INITIALIZATION_ERROR;
+
+    /* one group at a time, so that the results need no allocation */
+    for (ulFirst = 0; ulFirst < ulCount; ulFirst += ulInGroup) {
+        ulInGroup = ulCount - ulFirst < TREECORE_GROUP ? ulCount - ulFirst
+                                                       : TREECORE_GROUP;
+        FT_corefindBatch(oNRoot, ppcPaths + ulFirst, ulInGroup, aoNFound,
+                         piStatus + ulFirst);
+        for (ulIndex = 0; ulIndex < ulInGroup; ulIndex++) {
+            if (piStatus[ulFirst + ulIndex] != SUCCESS)
+                continue;
+            pbIsFile[ulFirst + ulIndex] = NodeFT_isFile(aoNFound[ulIndex]);
+            if (pbIsFile[ulFirst + ulIndex])
+                (void)NodeFT_getContentLength(aoNFound[ulIndex],
+                                              &pulSize[ulFirst + ulIndex]);
+        }
+    }
+
+    return SUCCESS;
+}
+
+/*
+  Inserts `ulCount` directories and files, in order. See FT_insertBatch
+  in ft.h for the contract.
+
+  Parameters:
+    - ppcPaths: the paths to insert
+    - ulCount: how many there are
+    - pbIsFile: whether each is a file or a directory
+    - ppvContents: each file's contents
+    - pulLengths: each file's content length
+    - piStatus: where each insertion's status is stored
+
+  Returns:
+    - SUCCESS, or INITIALIZATION_ERROR if the FT is not initialized
+*/
+static int FT_doInsertBatch(const char *const *ppcPaths, size_t ulCount,
+                            const boolean *pbIsFile, void *const *ppvContents,
+                            const size_t *pulLengths, int *piStatus) {
+    size_t ulIndex;
+
+    if (!bIsInitialized)
+        return INITIALIZATION_ERROR;
+
+    for (ulIndex = 0; ulIndex < ulCount; ulIndex++) {
+        if (pbIsFile[ulIndex])
+            piStatus[ulIndex] = FT_doInsertFile(ppcPaths[ulIndex], ppvContents[ulIndex],
+                                                pulLengths[ulIndex]);
+        else
+            piStatus[ulIndex] = FT_doInsertDir(ppcPaths[ulIndex]);
+        FT_check(ppcPaths[ulIndex]);
+    }
+
+    return SUCCESS;
+}
+
 /*---------------------------------------------------------------*/
 /* Utility Functions                                             */
 /*---------------------------------------------------------------*/
@@ -843,52 +1166,585 @@ int FT_stat(const char *pcPath, boolean *pbIsFile, size_t *pulSize) {
   Allocates memory for the returned string,
   which is then owned by client!
 */
+static char *FT_doToString(void) {
+    if (!bIsInitialized)
+        return NULL;
+
+    return FT_coretoString(oNRoot);
+}
+
+/*---------------------------------------------------------------*/
+/* Public Interface Functions                                    */
+/*---------------------------------------------------------------*/
+
+/*
+  Each public function below is a thin wrapper around its FT_do*
+  implementation above, so that instrumentation and locking see
+  every call in exactly one place. See ft.h for the contracts.
+*/
+
+int FT_init(void) {
+    int iStatus;
+    unsigned long ulStart = FT_probeBegin();
+
+    FT_lock(TRUE);
+    iStatus = FT_doInit();
+    FT_check(NULL);
+    FT_unlock();
+    FT_probeEnd(OPFT_INIT, ulStart, NULL, 0, iStatus);
+    return iStatus;
+}
+
+int FT_destroy(void) {
+    int iStatus;
+    unsigned long ulStart = FT_probeBegin();
+
+    FT_lock(TRUE);
+    iStatus = FT_doDestroy();
+    FT_check(NULL);
+    FT_unlock();
+    FT_probeEnd(OPFT_DESTROY, ulStart, NULL, 0, iStatus);
+    return iStatus;
+}
+
+int FT_insertDir(const char *pcPath) {
+    int iStatus;
+    unsigned long ulStart = FT_probeBegin();
+
+    FT_lock(TRUE);
+    iStatus = FT_doInsertDir(pcPath);
+    FT_check(pcPath);
+    FT_unlock();
+    FT_probeEnd(OPFT_INSERT_DIR, ulStart, pcPath, 0, iStatus);
+    return iStatus;
+}
+
+int FT_insertFile(const char *pcPath, void *pvContents, size_t ulLength) {
+    int iStatus;
+    unsigned long ulStart = FT_probeBegin();
+
+    FT_lock(TRUE);
+    iStatus = FT_doInsertFile(pcPath, pvContents, ulLength);
+    FT_check(pcPath);
+    FT_unlock();
+    FT_probeEnd(OPFT_INSERT_FILE, ulStart, pcPath, ulLength, iStatus);
+    return iStatus;
+}
+
+int FT_rmDir(const char *pcPath) {
+    int iStatus;
+    unsigned long ulStart = FT_probeBegin();
+
+    FT_lock(TRUE);
+    iStatus = FT_doRmDir(pcPath);
+    FT_check(pcPath);
+    FT_unlock();
+    FT_probeEnd(OPFT_RM_DIR, ulStart, pcPath, 0, iStatus);
+    return iStatus;
+}
+
+int FT_rmFile(const char *pcPath) {
+    int iStatus;
+    unsigned long ulStart = FT_probeBegin();
+
+    FT_lock(TRUE);
+    iStatus = FT_doRmFile(pcPath);
+    FT_check(pcPath);
+    FT_unlock();
+    FT_probeEnd(OPFT_RM_FILE, ulStart, pcPath, 0, iStatus);
+    return iStatus;
+}
+
+boolean FT_containsDir(const char *pcPath) {
+    boolean bResult;
+    unsigned long ulStart = FT_probeBegin();
+
+    FT_lock(FALSE);
+    bResult = FT_doContainsDir(pcPath);
+    FT_unlock();
+    FT_probeEnd(OPFT_CONTAINS_DIR, ulStart, pcPath, 0, (int)bResult);
+    return bResult;
+}
+
+boolean FT_containsFile(const char *pcPath) {
+    boolean bResult;
+    unsigned long ulStart = FT_probeBegin();
+
+    FT_lock(FALSE);
+    bResult = FT_doContainsFile(pcPath);
+    FT_unlock();
+    FT_probeEnd(OPFT_CONTAINS_FILE, ulStart, pcPath, 0, (int)bResult);
+    return bResult;
+}
+
+void *FT_getFileContents(const char *pcPath) {
+    void *pvResult;
+    unsigned long ulStart = FT_probeBegin();
+
+    FT_lock(FALSE);
+    pvResult = FT_doGetFileContents(pcPath);
+    FT_unlock();
+    FT_probeEnd(OPFT_GET_CONTENTS, ulStart, pcPath, 0, pvResult != NULL);
+    return pvResult;
+}
+
+void *FT_replaceFileContents(const char *pcPath, void *pvNewContents, size_t ulNewLength) {
+    void *pvResult;
+    unsigned long ulStart = FT_probeBegin();
+
+    FT_lock(TRUE);
+    pvResult = FT_doReplaceFileContents(pcPath, pvNewContents, ulNewLength);
+    FT_check(pcPath);
+    FT_unlock();
+    FT_probeEnd(OPFT_REPLACE_CONTENTS, ulStart, pcPath, ulNewLength,
+                pvResult != NULL);
+    return pvResult;
+}
+
+int FT_stat(const char *pcPath, boolean *pbIsFile, size_t *pulSize) {
+    int iStatus;
+    unsigned long ulStart = FT_probeBegin();
+
+    FT_lock(FALSE);
+    iStatus = FT_doStat(pcPath, pbIsFile, pulSize);
+    FT_unlock();
+    FT_probeEnd(OPFT_STAT, ulStart, pcPath, 0, iStatus);
+    return iStatus;
+}
+
+int FT_statBatch(const char *const *ppcPaths, size_t ulCount,
+                 int *piStatus, boolean *pbIsFile, size_t *pulSize) {
+    int iStatus;
+
+    assert(ppcPaths != NULL || ulCount == 0);
+    assert(piStatus != NULL || ulCount == 0);
+    assert(pbIsFile != NULL || ulCount == 0);
+    assert(pulSize != NULL || ulCount == 0);
+
+    FT_lock(FALSE);
+    iStatus = FT_doStatBatch(ppcPaths, ulCount, piStatus, pbIsFile, pulSize);
+    FT_unlock();
+    return iStatus;
+}
+
+int FT_insertBatch(const char *const *ppcPaths, size_t ulCount,
+                   const boolean *pbIsFile, void *const *ppvContents,
+                   const size_t *pulLengths, int *piStatus) {
+    int iStatus;
+
+    assert(ppcPaths != NULL || ulCount == 0);
+    assert(pbIsFile != NULL || ulCount == 0);
+    assert(ppvContents != NULL || ulCount == 0);
+    assert(pulLengths != NULL || ulCount == 0);
+    assert(piStatus != NULL || ulCount == 0);
+
+    FT_lock(TRUE);
+    iStatus = FT_doInsertBatch(ppcPaths, ulCount, pbIsFile, ppvContents,
+                               pulLengths, piStatus);
+    FT_unlock();
+    return iStatus;
+}
+
 char *FT_toString(void) {
-    DynArray_T oDNodes;
-    size_t ulTotalStrLen = 1; /* Start with 1 for null terminator */
-    char *pcResultStr = NULL;
+    char *pcResult;
+    unsigned long ulStart = FT_probeBegin();
+
+    FT_lock(FALSE);
+    pcResult = FT_doToString();
+    FT_unlock();
+    FT_probeEnd(OPFT_TO_STRING, ulStart, NULL, 0, pcResult != NULL);
+    return pcResult;
+}
+
+/*---------------------------------------------------------------*/
+/* Extension Functions                                           */
+/*---------------------------------------------------------------*/
+
+/*
+  Finds the (at most) ulK directories at which the most lookups have
+  recently ended, hottest first. See ft.h for the full contract.
+*/
+static int FT_doHotspots(size_t ulK, struct FT_Hotspot *psHotspots, size_t *pulFound) {
+#ifdef FT_HEAT
+    struct FT_Hotspot sTemp;
+    size_t ulHeapSize = 0;
     size_t ulIndex;
+    unsigned long ulEpoch;
+    Node_T oNDir;
+#endif
+
+    assert(psHotspots != NULL || ulK == 0);
+    assert(pulFound != NULL);
 
+    *pulFound = 0;
     if (!bIsInitialized)
-        return NULL;
+        return INITIALIZATION_ERROR;
 
-    oDNodes = DynArray_new(ulCount);
-    if (oDNodes == NULL)
-        return NULL;
+#ifndef FT_HEAT
+    (void)ulK;
+    (void)psHotspots;
+    return SUCCESS;
+#else
+    if (oNRoot == NULL || ulK == 0)
+        return SUCCESS;
+
+    ulEpoch = __atomic_load_n(&ulHeatLookups, __ATOMIC_RELAXED) >> HEAT_EPOCH_SHIFT;
+    FT_collectHotspots(oNRoot, psHotspots, &ulHeapSize, ulK, ulEpoch);
 
-    /* Perform a pre-order traversal to fill the array */
-    (void)FT_preOrderTraversal(oNRoot, oDNodes, 0);
+    /* heapsort in place: repeatedly move the coldest to the back */
+    for (ulIndex = ulHeapSize; ulIndex > 1; ulIndex--) {
+        sTemp = psHotspots[0];
+        psHotspots[0] = psHotspots[ulIndex - 1];
+        psHotspots[ulIndex - 1] = sTemp;
+        FT_siftDown(psHotspots, ulIndex - 1, 0);
+    }
 
-    /* Calculate total string length */
-    for (ulIndex = 0; ulIndex < DynArray_getLength(oDNodes); ulIndex++) {
-        Node_T oNNode = DynArray_get(oDNodes, ulIndex);
-        char *pcNodeStr = NodeFT_toString(oNNode);
-        if (pcNodeStr != NULL) {
-            ulTotalStrLen += strlen(pcNodeStr) + 1; /* +1 for newline */
-            free(pcNodeStr);
+    /* replace the Node_T placeholders with copies of the paths */
+    for (ulIndex = 0; ulIndex < ulHeapSize; ulIndex++) {
+        const char *pcPath;
+
+        oNDir = (Node_T)psHotspots[ulIndex].pcPath;
+        pcPath = Path_getPathname(NodeFT_getPath(oNDir));
+        psHotspots[ulIndex].pcPath = malloc(strlen(pcPath) + 1);
+        if (psHotspots[ulIndex].pcPath == NULL) {
+            while (ulIndex > 0)
+                free(psHotspots[--ulIndex].pcPath);
+            return MEMORY_ERROR;
         }
+        strcpy(psHotspots[ulIndex].pcPath, pcPath);
     }
 
-    /* Allocate memory for the result string */
-    pcResultStr = malloc(ulTotalStrLen);
-    if (pcResultStr == NULL) {
-        DynArray_free(oDNodes);
-        return NULL;
+    *pulFound = ulHeapSize;
+    return SUCCESS;
+#endif
+}
+
+int FT_hotspots(size_t ulK, struct FT_Hotspot *psHotspots, size_t *pulFound) {
+    int iStatus;
+
+    FT_lock(FALSE);
+    iStatus = FT_doHotspots(ulK, psHotspots, pulFound);
+    FT_unlock();
+    return iStatus;
+}
+
+boolean FT_checkSample(size_t ulBudget, unsigned long *pulSeed,
+                       void (*pfReport)(const char *pcProblem, void *pvArg),
+                       void *pvArg, size_t *pulVisited) {
+    boolean bValid;
+
+    assert(pulSeed != NULL);
+    assert(pulVisited != NULL);
+
+    FT_lock(FALSE);
+    bValid = CheckerFT_isValidSample(bIsInitialized, oNRoot, ulCount,
+                                     ulBudget, pulSeed, pfReport, pvArg,
+                                     pulVisited);
+    FT_unlock();
+    return bValid;
+}
+
+void FT_getLockStats(struct FT_LockStats *psStats) {
+    assert(psStats != NULL);
+
+#ifdef FT_THREADSAFE
+    psStats->ulAcquired = __atomic_load_n(&ulLockAcquired, __ATOMIC_RELAXED);
+    psStats->ulContended = __atomic_load_n(&ulLockContended, __ATOMIC_RELAXED);
+    psStats->ulWaitNanos = __atomic_load_n(&ulLockWaitNanos, __ATOMIC_RELAXED);
+#else
+    psStats->ulAcquired = 0;
+    psStats->ulContended = 0;
+    psStats->ulWaitNanos = 0;
+#endif
+}
+
+void FT_resetLockStats(void) {
+#ifdef FT_THREADSAFE
+    __atomic_store_n(&ulLockAcquired, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&ulLockContended, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&ulLockWaitNanos, 0, __ATOMIC_RELAXED);
+#endif
+}
+
+void FT_getArenaStats(struct FT_ArenaStats *psStats) {
+    assert(psStats != NULL);
+
+    ArenaFT_getStats(&psStats->ulMapped, &psStats->ulHuge);
+}
+
+void FT_getHotCacheStats(struct FT_HotCacheStats *psStats) {
+    assert(psStats != NULL);
+
+#ifdef FT_HOTCACHE
+    NodeFT_getHotStats(&psStats->ulHits, &psStats->ulMisses);
+#else
+    psStats->ulHits = 0;
+    psStats->ulMisses = 0;
+#endif
+}
+
+void FT_resetHotCacheStats(void) {
+#ifdef FT_HOTCACHE
+    NodeFT_resetHotStats();
+#endif
+}
+
+/*
+  Appends `oNNode` and everything below it to the snapshot being
+  written by `psWriter`, parents before their children. Only reads
+  the tree, without allocating, so that it is safe in the child of a
+  fork taken while other threads were running.
+
+  Returns:
+    - TRUE, or FALSE if a write failed
+*/
+static boolean FT_saveSubtree(struct SnapFT_Writer *psWriter, Node_T oNNode) {
+    void *pvContents = NULL;
+    size_t ulLength = 0;
+    size_t ulIndex, ulChildren;
+
+    if (NodeFT_isFile(oNNode)) {
+        (void)NodeFT_getContents(oNNode, &pvContents);
+        (void)NodeFT_getContentLength(oNNode, &ulLength);
+        return SnapFT_put(psWriter, TRUE, Path_getPathname(NodeFT_getPath(oNNode)),
+                          pvContents, pvContents == NULL ? 0 : ulLength);
     }
-    *pcResultStr = '\0';
-
-    /* Concatenate node strings */
-    for (ulIndex = 0; ulIndex < DynArray_getLength(oDNodes); ulIndex++) {
-        Node_T oNNode = DynArray_get(oDNodes, ulIndex);
-        char *pcNodeStr = NodeFT_toString(oNNode);
-        if (pcNodeStr != NULL) {
-            strcat(pcResultStr, pcNodeStr);
-            strcat(pcResultStr, "\n");
-            free(pcNodeStr);
-        }
+
+    if (!SnapFT_put(psWriter, FALSE, Path_getPathname(NodeFT_getPath(oNNode)),
+                    NULL, 0))
+        return FALSE;
+    ulChildren = FT_numChildren(oNNode);
+    for (ulIndex = 0; ulIndex < ulChildren; ulIndex++)
+        if (!FT_saveSubtree(psWriter, FT_child(oNNode, ulIndex)))
+            return FALSE;
+    return TRUE;
+}
+
+/*
+  Runs in the child forked by FT_saveAsync: writes the tree, as it
+  was when the child was forked, to `pcTemp`, renames it to `pcFile`
+  and syncs `pcDir`, the directory holding both, so that the rename
+  is on disk too. Exits with status 0 if all of that succeeded and 1
+  otherwise. Only uses calls that are safe in the child of a
+  multithreaded process.
+*/
+static void FT_saveChild(const char *pcTemp, const char *pcFile,
+                         const char *pcDir) {
+    struct SnapFT_Writer sWriter;
+    boolean bOk;
+    int iFd;
+
+    iFd = open(pcTemp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (iFd < 0)
+        _exit(1);
+    SnapFT_begin(&sWriter, iFd);
+    bOk = oNRoot == NULL || FT_saveSubtree(&sWriter, oNRoot);
+    bOk = SnapFT_end(&sWriter) && bOk;
+    /* the rename must not reach the disk before the data */
+    bOk = fsync(iFd) == 0 && bOk;
+    bOk = close(iFd) == 0 && bOk;
+    if (!bOk || rename(pcTemp, pcFile) != 0) {
+        (void)unlink(pcTemp);
+        _exit(1);
+    }
+
+    /* the new directory entry is only durable once its directory is
+       synced; EINVAL means the system cannot sync directories */
+    iFd = open(pcDir, O_RDONLY);
+    if (iFd < 0)
+        _exit(1);
+    bOk = fsync(iFd) == 0 || errno == EINVAL;
+    (void)close(iFd);
+    _exit(bOk ? 0 : 1);
+}
+
+int FT_saveWait(void) {
+    int iExit;
+    pid_t iPid;
+
+    if (iSavePid == 0)
+        return iSaveStatus;
+
+    do
+        iPid = waitpid(iSavePid, &iExit, 0);
+    while (iPid < 0 && errno == EINTR);
+    iSaveStatus = iPid == iSavePid && WIFEXITED(iExit) &&
+                  WEXITSTATUS(iExit) == 0 ? SUCCESS : MEMORY_ERROR;
+    iSavePid = 0;
+    return iSaveStatus;
+}
+
+int FT_saveAsync(const char *pcFile) {
+    char *pcTemp, *pcDir;
+    const char *pcSlash;
+    size_t ulDirLength;
+    pid_t iPid;
+
+    assert(pcFile != NULL);
+
+    /* one snapshot at a time */
+    (void)FT_saveWait();
+
+    /* named before the fork, since the child must not allocate */
+    pcTemp = malloc(strlen(pcFile) + sizeof(".tmp"));
+    pcDir = malloc(strlen(pcFile) + 2);
+    if (pcTemp == NULL || pcDir == NULL) {
+        free(pcTemp);
+        free(pcDir);
+        return MEMORY_ERROR;
+    }
+    strcpy(pcTemp, pcFile);
+    strcat(pcTemp, ".tmp");
+    pcSlash = strrchr(pcFile, '/');
+    if (pcSlash == NULL)
+        strcpy(pcDir, ".");
+    else {
+        /* keep the '/' itself if it is the only one, for "/file" */
+        ulDirLength = pcSlash == pcFile ? 1 : (size_t)(pcSlash - pcFile);
+        memcpy(pcDir, pcFile, ulDirLength);
+        pcDir[ulDirLength] = '\0';
+    }
+
+    /* writers are only held off for the fork itself; after it the
+       child has its own copy-on-write image of the tree */
+    FT_lock(FALSE);
+    if (!bIsInitialized) {
+        FT_unlock();
+        free(pcTemp);
+        free(pcDir);
+        return INITIALIZATION_ERROR;
+    }
+    iPid = fork();
+    if (iPid == 0)
+        FT_saveChild(pcTemp, pcFile, pcDir);
+    FT_unlock();
+    free(pcTemp);
+    free(pcDir);
+
+    if (iPid < 0)
+        return MEMORY_ERROR;
+    iSavePid = iPid;
+    return SUCCESS;
+}
+
+/*
+  Replaces the contents of the initialized FT with the snapshot in
+  `psFile`, whose header has been read. See FT_load in ft.h for the
+  contract.
+*/
+static int FT_doLoad(FILE *psFile) {
+    struct SnapFT_Node sNode;
+    int iRead, iStatus = SUCCESS;
+
+    assert(bIsInitialized);
+
+    if (oNRoot != NULL) {
+        ulCount -= NodeFT_free(oNRoot);
+        oNRoot = NULL;
+    }
+    ulGeneration++;
+
+    sNode.pcBuffer = NULL;
+    sNode.ulBufferSize = 0;
+    while ((iRead = SnapFT_read(psFile, &sNode)) == 1) {
+        if (sNode.bIsFile)
+            iStatus = FT_doInsertFile(sNode.pcPath, (void *)sNode.pvContents,
+                                      sNode.ulLength);
+        else
+            iStatus = FT_doInsertDir(sNode.pcPath);
+        if (iStatus != SUCCESS)
+            break;
+    }
+    free(sNode.pcBuffer);
+
+    /* a tree cannot have produced what the insertions rejected */
+    if ((iStatus != SUCCESS && iStatus != MEMORY_ERROR) ||
+        (iStatus == SUCCESS && iRead < 0))
+        iStatus = BAD_PATH;
+    if (iStatus != SUCCESS && oNRoot != NULL) {
+        /* leave the FT empty rather than half loaded */
+        ulCount -= NodeFT_free(oNRoot);
+        oNRoot = NULL;
+        ulGeneration++;
+    }
+    return iStatus;
+}
+
+int FT_load(const char *pcFile) {
+    FILE *psFile;
+    int iStatus;
+
+    assert(pcFile != NULL);
+
+    psFile = fopen(pcFile, "rb");
+
+    /* the tree is only touched once the file looks like a snapshot */
+    FT_lock(TRUE);
+    if (!bIsInitialized)
+        iStatus = INITIALIZATION_ERROR;
+    else if (psFile == NULL)
+        iStatus = NO_SUCH_PATH;
+    else if (!SnapFT_readHeader(psFile))
+        iStatus = BAD_PATH;
+    else
+        iStatus = FT_doLoad(psFile);
+    FT_check(NULL);
+    FT_unlock();
+    if (psFile != NULL)
+        fclose(psFile);
+    return iStatus;
+}
+
+/*
+  Calls `pfVisit` for `oNNode` and everything below it, parents before
+  their children and files before directories, as FT_walk does.
+
+  Returns:
+    - SUCCESS, or the first other status `pfVisit` returned
+*/
+static int FT_walkSubtree(Node_T oNNode,
+                          int (*pfVisit)(const char *pcPath, boolean bIsFile,
+                                         const void *pvContents,
+                                         size_t ulLength, void *pvArg),
+                          void *pvArg) {
+    void *pvContents = NULL;
+    size_t ulLength = 0;
+    size_t ulIndex, ulChildren;
+    int iStatus;
+
+    if (NodeFT_isFile(oNNode)) {
+        (void)NodeFT_getContents(oNNode, &pvContents);
+        (void)NodeFT_getContentLength(oNNode, &ulLength);
+        return pfVisit(Path_getPathname(NodeFT_getPath(oNNode)), TRUE,
+                       pvContents, pvContents == NULL ? 0 : ulLength, pvArg);
     }
 
-    DynArray_free(oDNodes);
+    iStatus = pfVisit(Path_getPathname(NodeFT_getPath(oNNode)), FALSE, NULL, 0,
+                      pvArg);
+    ulChildren = FT_numChildren(oNNode);
+    for (ulIndex = 0; iStatus == SUCCESS && ulIndex < ulChildren; ulIndex++)
+        iStatus = FT_walkSubtree(FT_child(oNNode, ulIndex), pfVisit, pvArg);
+    return iStatus;
+}
 
-    return pcResultStr;
-}
\ No newline at end of file
+int FT_walk(const char *pcPath,
+            int (*pfVisit)(const char *pcPath, boolean bIsFile,
+                           const void *pvContents, size_t ulLength,
+                           void *pvArg),
+            void *pvArg) {
+    Node_T oNNode = NULL;
+    int iStatus;
+
+    assert(pcPath != NULL);
+    assert(pfVisit != NULL);
+
+    FT_lock(FALSE);
+    if (!bIsInitialized)
+        iStatus = INITIALIZATION_ERROR;
+    else
+        iStatus = FT_findNode(pcPath, &oNNode);
+    if (iStatus == SUCCESS)
+        iStatus = FT_walkSubtree(oNNode, pfVisit, pvArg);
+    FT_unlock();
+    return iStatus;
+}
@@ -148,4 +148,203 @@ int FT_stat(const char *pcPath, boolean *pbIsFile, size_t *pulSize);
 */
 char *FT_toString(void);
 
+/*--------------------------------------------------------------------*/
+/* Extensions beyond the assignment interface                         */
+/*--------------------------------------------------------------------*/
+
+/* One directory reported by FT_hotspots */
+struct FT_Hotspot {
+   /* absolute path of the directory, owned by the caller */
+   char *pcPath;
+   /* decayed number of lookups that ended at this directory
+      (for a file, lookups end at the file's parent directory) */
+   unsigned long ulEnded;
+   /* decayed number of lookups that passed through this directory
+      on their way to a deeper one */
+   unsigned long ulThrough;
+};
+
+/*
+  Finds the (at most) ulK directories at which the most lookups have
+  recently ended, hottest first, and stores them in psHotspots, which
+  must have room for ulK entries. Access counts are only kept when
+  the FT is compiled with -DFT_HEAT, and are halved every 65536
+  lookups so that they follow shifts in the workload.
+  Returns SUCCESS and sets *pulFound to the number of entries stored
+  (always 0 without -DFT_HEAT). The caller must free each pcPath.
+  Otherwise, sets *pulFound to 0 and returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_hotspots(size_t ulK, struct FT_Hotspot *psHotspots,
+                size_t *pulFound);
+
+/*
+  Checks a randomly chosen part of the FT against its invariants
+  while visiting at most ulBudget nodes, holding the tree lock shared
+  (see CheckerFT_isValidSample in checkerFT.h; samplerFT runs this
+  from a background thread). *pulSeed is the state of the random
+  generator and is advanced. Each problem found is passed to pfReport
+  together with pvArg. Returns TRUE if there were none, FALSE
+  otherwise, and stores the number of nodes visited in *pulVisited.
+*/
+boolean FT_checkSample(size_t ulBudget, unsigned long *pulSeed,
+                       void (*pfReport)(const char *pcProblem,
+                                        void *pvArg),
+                       void *pvArg, size_t *pulVisited);
+
+/*
+  Does FT_stat for each of the ulCount paths in ppcPaths, storing the
+  status for ppcPaths[i] in piStatus[i] and setting pbIsFile[i] and
+  pulSize[i] as FT_stat would set *pbIsFile and *pulSize. Several
+  lookups are walked down the tree together, a level of each at a
+  time, so that the cache misses of one can overlap with the work of
+  the others. Returns SUCCESS, or INITIALIZATION_ERROR (storing nothing)
+  if the FT is not in an initialized state.
+*/
+int FT_statBatch(const char *const *ppcPaths, size_t ulCount,
+                 int *piStatus, boolean *pbIsFile, size_t *pulSize);
+
+/*
+  Inserts the ulCount paths in ppcPaths, in order: a file holding a
+  copy of the pulLengths[i] bytes at ppvContents[i] if pbIsFile[i],
+  and a directory otherwise, storing the status FT_insertFile or
+  FT_insertDir would return in piStatus[i]. The tree lock is taken
+  once for the whole batch rather than once per path, and paths that
+  share a directory find it from where the last insertion stopped.
+  Returns SUCCESS, or INITIALIZATION_ERROR (storing nothing) if the
+  FT is not in an initialized state.
+*/
+int FT_insertBatch(const char *const *ppcPaths, size_t ulCount,
+                   const boolean *pbIsFile, void *const *ppvContents,
+                   const size_t *pulLengths, int *piStatus);
+
+/*
+  Threading: by default the FT is a single tree that must only be used
+  from one thread at a time. When compiled with -DFT_THREADSAFE, every
+  function above may be called from any thread at any time: queries
+  share a lock that modifications hold exclusively (the pointer from
+  FT_getFileContents is still only valid until the file is next
+  modified). When compiled with -DFT_PERTHREAD instead, every thread
+  has its own independent tree, which it must FT_init itself.
+*/
+
+/* Counters describing the tree lock, reported by FT_getLockStats */
+struct FT_LockStats {
+   /* number of times the lock was acquired */
+   unsigned long ulAcquired;
+   /* how many of those acquisitions had to wait for another thread */
+   unsigned long ulContended;
+   /* total time spent waiting for the lock, in ns */
+   unsigned long ulWaitNanos;
+};
+
+/*
+  Stores the tree lock's counters since the last FT_resetLockStats
+  (or since the program started) in *psStats. They are all 0 unless
+  the FT is compiled with -DFT_THREADSAFE.
+*/
+void FT_getLockStats(struct FT_LockStats *psStats);
+
+/* Sets the counters reported by FT_getLockStats back to 0. */
+void FT_resetLockStats(void);
+
+/* Memory behind the node store, reported by FT_getArenaStats */
+struct FT_ArenaStats {
+   /* bytes of node arrays mapped on their own for huge pages */
+   size_t ulMapped;
+   /* how many of those bytes the kernel backs with huge pages */
+   size_t ulHuge;
+};
+
+/*
+  Stores in *psStats how much of the node store is set up for, and
+  backed by, transparent huge pages (see arenaFT.h), for every tree
+  in the process. Both counts are 0 unless the FT is compiled with
+  -DFT_SOA -DFT_HUGEPAGES and holds at least a few hundred thousand
+  nodes.
+*/
+void FT_getArenaStats(struct FT_ArenaStats *psStats);
+
+/* Counters of the hot-child caches, reported by FT_getHotCacheStats */
+struct FT_HotCacheStats {
+   /* child lookups answered by their directory's hot-child cache */
+   unsigned long ulHits;
+   /* child lookups that found the child by binary search instead */
+   unsigned long ulMisses;
+};
+
+/*
+  Stores the hot-child cache counters since the last
+  FT_resetHotCacheStats (or since the program started) in *psStats.
+  When compiled with -DFT_HOTCACHE, each directory remembers the few
+  children it most recently gave up, most recent first, and checks
+  them before searching its sorted children, so that the hot entries
+  of a wide directory are found without a search. Every step of a
+  traversal that finds the next node counts as a hit or a miss; the
+  counters are all 0 without -DFT_HOTCACHE.
+*/
+void FT_getHotCacheStats(struct FT_HotCacheStats *psStats);
+
+/* Sets the counters reported by FT_getHotCacheStats back to 0. */
+void FT_resetHotCacheStats(void);
+
+/*
+  Starts writing a snapshot of the FT to the file pcFile in the
+  background and returns without waiting for it, in the manner of
+  Redis's BGSAVE: the process forks, and the child writes the tree as
+  it was at the fork from its copy-on-write image, while this process
+  goes on changing the FT. Writers are only held off while the fork
+  itself runs. The snapshot is written to pcFile with ".tmp" appended
+  and renamed to pcFile once complete, so pcFile only ever holds a
+  complete snapshot; FT_load reads it back. A snapshot still being
+  written is waited for first (see FT_saveWait). Returns SUCCESS once
+  the child is running, or:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * MEMORY_ERROR if the process could not be forked
+*/
+int FT_saveAsync(const char *pcFile);
+
+/*
+  Waits for the snapshot FT_saveAsync last started, if it has not
+  been waited for. Returns SUCCESS if it was written completely and
+  synced to disk, file and directory entry both (or none was ever
+  started), or MEMORY_ERROR if it could not be. The file then holds
+  the previous snapshot, or this one if only syncing its directory
+  failed. FT_saveAsync and FT_saveWait must only be called from one
+  thread at a time.
+*/
+int FT_saveWait(void);
+
+/*
+  Replaces the contents of the FT with the snapshot in the file
+  pcFile. Returns SUCCESS, or leaves the FT unchanged and returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * NO_SUCH_PATH if pcFile could not be opened
+  * BAD_PATH if pcFile does not start with a snapshot's header
+  or, once the old contents have been dropped, leaves the FT empty
+  rather than half loaded and returns:
+  * BAD_PATH if the rest of pcFile is not a complete snapshot
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_load(const char *pcFile);
+
+/*
+  Calls pfVisit(pcPath, bIsFile, pvContents, ulLength, pvArg) for the
+  node with absolute path pcPath and everything below it, parents
+  before their children and, within a directory, files before
+  directories, in the order of FT_toString. For a file, pvContents
+  and ulLength are its contents, which stay valid until the file is
+  next modified, as with FT_getFileContents; for a directory they are
+  NULL and 0. pfVisit runs with the tree lock held shared, so it must
+  not call the FT. Stops at the first status other than SUCCESS that
+  pfVisit returns, and returns it. Otherwise returns SUCCESS, or the
+  reasons FT_stat gives for failing to find pcPath.
+*/
+int FT_walk(const char *pcPath,
+            int (*pfVisit)(const char *pcPath, boolean bIsFile,
+                           const void *pvContents, size_t ulLength,
+                           void *pvArg),
+            void *pvArg);
+
 #endif /* FT_INCLUDED */
\ No newline at end of file
@@ -0,0 +1,788 @@
+/*--------------------------------------------------------------------*/
+/* ft_bench.c                                                         */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+/* getopt is POSIX, not C99 */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "ft.h"
+#include "bench.h"
+#include "timerFT.h"
+
+/*
+  Workload benchmark for the FT interface. Builds a tree of a chosen
+  shape, then runs a weighted random mix of operations against it and
+  reports throughput, latency percentiles, allocations per operation
+  and peak RSS, and with -p hardware counters per operation. Then
+  times FT_stat one path at a time against FT_statBatch on the same
+  paths. Only ft.h functions are called, so the same driver links
+  against ft.c (target ft_bench) or the reference sampleft.o (target
+  ft_bench_sample) for side-by-side comparison; built with
+  -DBENCH_REFERENCE for the latter, it leaves out FT_statBatch, which
+  the reference lacks.
+*/
+
+/* The operations a workload mixes */
+enum benchOp { OP_INSERT, OP_HIT, OP_MISS, OP_STAT, OP_REPLACE,
+               OP_RMDIR, OP_TOSTRING, NUM_OPS };
+
+/* Names used in reports, indexed by enum benchOp */
+static const char *const apcOpNames[NUM_OPS] = {
+   "insertFile", "lookup-hit", "lookup-miss", "stat",
+   "replace", "rmDir", "toString"
+};
+
+/* Names accepted by -m, indexed by enum benchOp */
+static const char *const apcMixKeys[NUM_OPS] = {
+   "insert", "hit", "miss", "stat", "replace", "rmdir", "tostring"
+};
+
+/* The tree shapes that can be built */
+enum shape { SHAPE_CHAIN, SHAPE_WIDE, SHAPE_BALANCED, SHAPE_ZIPF };
+
+/* Names accepted by -s, indexed by enum shape */
+static const char *const apcShapeNames[] = {
+   "chain", "wide", "balanced", "zipf"
+};
+
+/* Everything the command line controls */
+struct config {
+   /* shape of the initial tree */
+   enum shape eShape;
+   /* approximate number of nodes in the initial tree */
+   size_t ulNodes;
+   /* number of operations in the measured phase */
+   size_t ulOps;
+   /* depth of each chain (chain) */
+   size_t ulDepth;
+   /* children per directory (balanced) */
+   size_t ulFanout;
+   /* Zipf exponent for choosing which existing path to access */
+   double dSkew;
+   /* random seed */
+   unsigned long ulSeed;
+   /* size of file contents written by insert and replace */
+   size_t ulContentLen;
+   /* relative weight of each operation in the mix */
+   unsigned aWeights[NUM_OPS];
+   /* whether to read hardware counters around every operation */
+   int bPerf;
+   /* paths per FT_statBatch call when comparing it with FT_stat, or
+      0 to skip the comparison */
+   size_t ulBatch;
+};
+
+/* A growable list of path strings owned by the benchmark */
+struct pathList {
+   /* the paths */
+   char **ppcPaths;
+   /* number of paths stored */
+   size_t ulLength;
+   /* number of paths there is room for */
+   size_t ulCapacity;
+};
+
+/* Directories known to exist, used as parents and for misses */
+static struct pathList sDirs;
+/* Files known to exist, used for hits, stats and replaces */
+static struct pathList sFiles;
+/* Leaf directories created only to be removed by rmDir */
+static struct pathList sScratch;
+
+/* Contents written by insert and replace */
+static char *pcContents;
+
+/*
+  Prints a usage message for program pcProg to stderr and exits.
+*/
+static void usage(const char *pcProg) {
+   fprintf(stderr,
+      "usage: %s [-s chain|wide|balanced|zipf] [-n nodes] [-o ops]\n"
+      "          [-d chaindepth] [-f fanout] [-z skew] [-r seed]\n"
+      "          [-c contentbytes] [-m insert=W,hit=W,miss=W,stat=W,"
+      "replace=W,rmdir=W,tostring=W]\n"
+      "          [-p (hardware counters)] [-b statbatch]\n", pcProg);
+   exit(EXIT_FAILURE);
+}
+
+/*
+  Prints pcWhat to stderr and exits; used when the FT fails in a way
+  that makes the measurement meaningless.
+*/
+static void die(const char *pcWhat) {
+   fprintf(stderr, "ft_bench: %s\n", pcWhat);
+   exit(EXIT_FAILURE);
+}
+
+/*
+  Appends a copy of pcPath to psList.
+*/
+static void pathList_add(struct pathList *psList, const char *pcPath) {
+   char *pcCopy;
+
+   assert(psList != NULL);
+   assert(pcPath != NULL);
+
+   if(psList->ulLength == psList->ulCapacity) {
+      size_t ulNew = psList->ulCapacity ? 2 * psList->ulCapacity : 64;
+      char **ppcNew = realloc(psList->ppcPaths, ulNew * sizeof(char *));
+      if(ppcNew == NULL)
+         die("out of memory");
+      psList->ppcPaths = ppcNew;
+      psList->ulCapacity = ulNew;
+   }
+   pcCopy = malloc(strlen(pcPath) + 1);
+   if(pcCopy == NULL)
+      die("out of memory");
+   strcpy(pcCopy, pcPath);
+   psList->ppcPaths[psList->ulLength++] = pcCopy;
+}
+
+/*
+  Frees every path in psList and the list's storage.
+*/
+static void pathList_free(struct pathList *psList) {
+   size_t ulIndex;
+
+   assert(psList != NULL);
+
+   for(ulIndex = 0; ulIndex < psList->ulLength; ulIndex++)
+      free(psList->ppcPaths[ulIndex]);
+   free(psList->ppcPaths);
+   psList->ppcPaths = NULL;
+   psList->ulLength = psList->ulCapacity = 0;
+}
+
+/*
+  Returns a newly allocated string "pcParent/pcName<ulNum>".
+*/
+static char *joinPath(const char *pcParent, const char *pcName,
+                      unsigned long ulNum) {
+   char *pcResult;
+
+   assert(pcParent != NULL);
+   assert(pcName != NULL);
+
+   pcResult = malloc(strlen(pcParent) + strlen(pcName) + 24);
+   if(pcResult == NULL)
+      die("out of memory");
+   sprintf(pcResult, "%s/%s%lu", pcParent, pcName, ulNum);
+   return pcResult;
+}
+
+/*
+  Inserts directory pcPath and remembers it, failing on any status
+  other than SUCCESS.
+*/
+static void buildDir(const char *pcPath) {
+   if(FT_insertDir(pcPath) != SUCCESS)
+      die("FT_insertDir failed while building the tree");
+   pathList_add(&sDirs, pcPath);
+}
+
+/*
+  Inserts file pcPath and remembers it, failing on any status other
+  than SUCCESS.
+*/
+static void buildFile(const char *pcPath) {
+   if(FT_insertFile(pcPath, pcContents, 0) != SUCCESS)
+      die("FT_insertFile failed while building the tree");
+   pathList_add(&sFiles, pcPath);
+}
+
+/*
+  Builds chains of psConfig->ulDepth directories hanging off the root,
+  with one file in every directory, until about psConfig->ulNodes
+  nodes exist.
+*/
+static void buildChains(const struct config *psConfig) {
+   size_t ulBuilt = 1, ulChain = 0, ulLevel;
+   char *pcDir, *pcNext, *pcFile;
+
+   while(ulBuilt < psConfig->ulNodes) {
+      pcDir = joinPath("r", "c", ulChain++);
+      buildDir(pcDir);
+      ulBuilt++;
+      for(ulLevel = 0; ulLevel < psConfig->ulDepth &&
+                       ulBuilt < psConfig->ulNodes; ulLevel++) {
+         pcFile = joinPath(pcDir, "f", ulLevel);
+         buildFile(pcFile);
+         free(pcFile);
+         pcNext = joinPath(pcDir, "d", ulLevel);
+         buildDir(pcNext);
+         free(pcDir);
+         pcDir = pcNext;
+         ulBuilt += 2;
+      }
+      free(pcDir);
+   }
+}
+
+/*
+  Puts about psConfig->ulNodes children directly under the root, one
+  in four a directory and the rest files.
+*/
+static void buildWide(const struct config *psConfig) {
+   size_t ulChild;
+   char *pcPath;
+
+   for(ulChild = 1; ulChild < psConfig->ulNodes; ulChild++) {
+      if(ulChild % 4 == 0) {
+         pcPath = joinPath("r", "d", ulChild);
+         buildDir(pcPath);
+      }
+      else {
+         pcPath = joinPath("r", "f", ulChild);
+         buildFile(pcPath);
+      }
+      free(pcPath);
+   }
+}
+
+/*
+  Builds a breadth-first tree in which every directory has
+  psConfig->ulFanout subdirectories and psConfig->ulFanout files,
+  until about psConfig->ulNodes nodes exist.
+*/
+static void buildBalanced(const struct config *psConfig) {
+   size_t ulBuilt = 1, ulNextParent = 0, ulChild;
+   char *pcPath;
+
+   while(ulBuilt < psConfig->ulNodes) {
+      /* sDirs doubles as the breadth-first queue */
+      const char *pcParent = sDirs.ppcPaths[ulNextParent++];
+      for(ulChild = 0; ulChild < psConfig->ulFanout &&
+                       ulBuilt < psConfig->ulNodes; ulChild++) {
+         pcPath = joinPath(pcParent, "f", ulChild);
+         buildFile(pcPath);
+         free(pcPath);
+         pcPath = joinPath(pcParent, "d", ulChild);
+         buildDir(pcPath);
+         free(pcPath);
+         ulBuilt += 2;
+      }
+   }
+}
+
+/*
+  Inserts about psConfig->ulNodes files at random depths from 2 to 7,
+  with directory names drawn from a Zipf-distributed vocabulary so
+  that a few names are very common, as in real file systems.
+*/
+static void buildZipf(const struct config *psConfig,
+                      unsigned long *pulRand) {
+   Zipf_T oNames;
+   size_t ulVocabulary, ulFile, ulLevel, ulDepth;
+   char *pcPath, *pcNext;
+   int iStatus;
+
+   ulVocabulary = psConfig->ulNodes / 8 + 16;
+   oNames = Bench_zipfNew(ulVocabulary, 1.0);
+   if(oNames == NULL)
+      die("out of memory");
+
+   for(ulFile = 0; ulFile < psConfig->ulNodes / 2; ulFile++) {
+      ulDepth = 1 + (size_t) (Bench_rand(pulRand) % 6);
+      pcPath = joinPath("r", "w", Bench_zipfNext(oNames, pulRand));
+      for(ulLevel = 1; ulLevel < ulDepth; ulLevel++) {
+         pcNext = joinPath(pcPath, "w", Bench_zipfNext(oNames, pulRand));
+         free(pcPath);
+         pcPath = pcNext;
+      }
+      pathList_add(&sDirs, pcPath);
+      pcNext = joinPath(pcPath, "f", ulFile);
+      iStatus = FT_insertFile(pcNext, pcContents, 0);
+      if(iStatus != SUCCESS)
+         die("FT_insertFile failed while building the tree");
+      pathList_add(&sFiles, pcNext);
+      free(pcNext);
+      free(pcPath);
+   }
+   Bench_zipfFree(oNames);
+}
+
+/*
+  Creates ulCount leaf directories (each holding one file) for rmDir
+  to remove, under randomly chosen existing directories.
+*/
+static void buildScratch(size_t ulCount, unsigned long *pulRand) {
+   size_t ulIndex;
+   char *pcDir, *pcFile;
+
+   for(ulIndex = 0; ulIndex < ulCount; ulIndex++) {
+      const char *pcParent =
+         sDirs.ppcPaths[Bench_rand(pulRand) % sDirs.ulLength];
+      pcDir = joinPath(pcParent, "x", ulIndex);
+      pcFile = joinPath(pcDir, "f", 0);
+      if(FT_insertFile(pcFile, NULL, 0) != SUCCESS)
+         die("FT_insertFile failed while building scratch directories");
+      pathList_add(&sScratch, pcDir);
+      free(pcFile);
+      free(pcDir);
+   }
+}
+
+/*
+  Parses a -m argument such as "hit=50,miss=10" into psConfig's
+  weights; weights that are not mentioned become 0. Returns 0 on
+  success and -1 on a malformed argument.
+*/
+static int parseMix(char *pcArg, struct config *psConfig) {
+   char *pcItem;
+   size_t ulOp;
+
+   for(ulOp = 0; ulOp < NUM_OPS; ulOp++)
+      psConfig->aWeights[ulOp] = 0;
+
+   for(pcItem = strtok(pcArg, ","); pcItem != NULL;
+       pcItem = strtok(NULL, ",")) {
+      char *pcEquals = strchr(pcItem, '=');
+      if(pcEquals == NULL)
+         return -1;
+      *pcEquals = '\0';
+      for(ulOp = 0; ulOp < NUM_OPS; ulOp++)
+         if(strcmp(pcItem, apcMixKeys[ulOp]) == 0)
+            break;
+      if(ulOp == NUM_OPS)
+         return -1;
+      psConfig->aWeights[ulOp] = (unsigned) atoi(pcEquals + 1);
+   }
+   return 0;
+}
+
+/*
+  Parses the command line into psConfig, exiting on bad usage.
+*/
+static void parseArgs(int argc, char *argv[], struct config *psConfig) {
+   static const unsigned aDefaultWeights[NUM_OPS] =
+      { 10, 40, 15, 15, 10, 5, 0 };
+   int iOpt;
+   size_t ulIndex;
+
+   psConfig->eShape = SHAPE_BALANCED;
+   psConfig->ulNodes = 10000;
+   psConfig->ulOps = 100000;
+   psConfig->ulDepth = 256;
+   psConfig->ulFanout = 8;
+   psConfig->dSkew = 0.0;
+   psConfig->ulSeed = 1;
+   psConfig->ulContentLen = 64;
+   memcpy(psConfig->aWeights, aDefaultWeights, sizeof(aDefaultWeights));
+   psConfig->bPerf = FALSE;
+   psConfig->ulBatch = 32;
+
+   while((iOpt = getopt(argc, argv, "s:n:o:d:f:z:r:c:m:pb:h")) != -1) {
+      switch(iOpt) {
+         case 's':
+            for(ulIndex = 0; ulIndex < sizeof(apcShapeNames) /
+                                       sizeof(apcShapeNames[0]); ulIndex++)
+               if(strcmp(optarg, apcShapeNames[ulIndex]) == 0)
+                  break;
+            if(ulIndex == sizeof(apcShapeNames) / sizeof(apcShapeNames[0]))
+               usage(argv[0]);
+            psConfig->eShape = (enum shape) ulIndex;
+            break;
+         case 'n': psConfig->ulNodes = strtoul(optarg, NULL, 10); break;
+         case 'o': psConfig->ulOps = strtoul(optarg, NULL, 10); break;
+         case 'd': psConfig->ulDepth = strtoul(optarg, NULL, 10); break;
+         case 'f': psConfig->ulFanout = strtoul(optarg, NULL, 10); break;
+         case 'z': psConfig->dSkew = strtod(optarg, NULL); break;
+         case 'r': psConfig->ulSeed = strtoul(optarg, NULL, 10); break;
+         case 'c': psConfig->ulContentLen = strtoul(optarg, NULL, 10);
+                   break;
+         case 'm':
+            if(parseMix(optarg, psConfig) != 0)
+               usage(argv[0]);
+            break;
+         case 'p': psConfig->bPerf = TRUE; break;
+         case 'b': psConfig->ulBatch = strtoul(optarg, NULL, 10); break;
+         default:
+            usage(argv[0]);
+      }
+   }
+   if(psConfig->ulNodes < 2 || psConfig->ulDepth == 0 ||
+      psConfig->ulFanout == 0)
+      usage(argv[0]);
+}
+
+/*
+  Picks an operation according to the weights in psConfig, whose sum
+  is uTotal.
+*/
+static enum benchOp pickOp(const struct config *psConfig,
+                           unsigned uTotal, unsigned long *pulRand) {
+   unsigned uRoll = (unsigned) (Bench_rand(pulRand) % uTotal);
+   size_t ulOp;
+
+   for(ulOp = 0; ulOp < NUM_OPS - 1; ulOp++) {
+      if(uRoll < psConfig->aWeights[ulOp])
+         break;
+      uRoll -= psConfig->aWeights[ulOp];
+   }
+   return (enum benchOp) ulOp;
+}
+
+/*
+  Chooses the path that operation eOp of the workload will use and
+  stores it in *ppcPath: a new path for insertFile and lookup-miss, a
+  scratch directory for rmDir, which the caller then owns, an existing
+  file for the others, or NULL for toString. Paths are formatted here
+  so that the timed region holds only the FT call. Returns the
+  operation to perform, which is OP_HIT when an rmDir finds no scratch
+  directory left to remove.
+*/
+static enum benchOp prepareOp(enum benchOp eOp, Zipf_T oPick,
+                              unsigned long *pulRand,
+                              unsigned long *pulNext, char **ppcPath) {
+   if(eOp == OP_RMDIR && sScratch.ulLength == 0)
+      eOp = OP_HIT;
+
+   switch(eOp) {
+      case OP_INSERT:
+         *ppcPath = joinPath(sDirs.ppcPaths[Bench_rand(pulRand) %
+                                            sDirs.ulLength],
+                             "n", (*pulNext)++);
+         break;
+      case OP_MISS:
+         *ppcPath = joinPath(sDirs.ppcPaths[Bench_rand(pulRand) %
+                                            sDirs.ulLength],
+                             "missing", Bench_rand(pulRand) % 1000);
+         break;
+      case OP_RMDIR:
+         *ppcPath = sScratch.ppcPaths[--sScratch.ulLength];
+         break;
+      case OP_TOSTRING:
+         *ppcPath = NULL;
+         break;
+      default:
+         *ppcPath = sFiles.ppcPaths[Bench_zipfNext(oPick, pulRand)];
+         break;
+   }
+   return eOp;
+}
+
+/*
+  Performs operation eOp of the workload on pcPath, as chosen by
+  prepareOp. Only calls the FT, so that it can be timed alone.
+*/
+static void runOp(enum benchOp eOp, const struct config *psConfig,
+                  const char *pcPath) {
+   void *pvOld;
+   boolean bIsFile;
+   size_t ulSize;
+
+   switch(eOp) {
+      case OP_INSERT:
+         if(FT_insertFile(pcPath, pcContents, psConfig->ulContentLen)
+            != SUCCESS)
+            die("FT_insertFile failed");
+         break;
+      case OP_HIT:
+         if(!FT_containsFile(pcPath))
+            die("FT_containsFile missed an existing file");
+         break;
+      case OP_MISS:
+         if(FT_containsFile(pcPath))
+            die("FT_containsFile found a missing file");
+         break;
+      case OP_STAT:
+         if(FT_stat(pcPath, &bIsFile, &ulSize) != SUCCESS)
+            die("FT_stat failed on an existing file");
+         break;
+      case OP_REPLACE:
+         pvOld = FT_replaceFileContents(pcPath, pcContents,
+                                        psConfig->ulContentLen);
+         /* an FT that copies contents hands back a copy to free; one
+            that keeps pointers (sampleft.o) hands back pcContents */
+         if(pvOld != (void *) pcContents)
+            free(pvOld);
+         break;
+      case OP_RMDIR:
+         if(FT_rmDir(pcPath) != SUCCESS)
+            die("FT_rmDir failed on a scratch directory");
+         break;
+      case OP_TOSTRING:
+         free(FT_toString());
+         break;
+      default:
+         assert(0);
+   }
+}
+
+/*
+  Records the result of operation eOp on pcPath, after the timed
+  region: a new file joins the files later operations pick from, and
+  the paths prepareOp handed over are freed.
+*/
+static void finishOp(enum benchOp eOp, char *pcPath) {
+   if(eOp == OP_INSERT)
+      pathList_add(&sFiles, pcPath);
+   if(eOp == OP_INSERT || eOp == OP_MISS || eOp == OP_RMDIR)
+      free(pcPath);
+}
+
+#ifndef BENCH_REFERENCE
+/*
+  Times FT_stat on psConfig->ulOps existing files picked by oPick, one
+  at a time, then FT_statBatch on the same files in batches of
+  psConfig->ulBatch, and prints the time per path of each. The files
+  are picked before either is timed, and the lookups of a batch walk
+  down the tree together, so the difference is what overlapping their
+  cache misses saves.
+*/
+static void compareStatBatch(const struct config *psConfig, Zipf_T oPick,
+                             unsigned long *pulRand) {
+   const char **ppcPaths;
+   int *piStatus;
+   boolean *pbIsFile, bIsFile;
+   size_t *pulSize, ulSize, ulIndex, ulFirst, ulInBatch;
+   unsigned long ulStart, ulSingleNanos, ulBatchNanos;
+
+   ppcPaths = malloc(psConfig->ulOps * sizeof(*ppcPaths));
+   piStatus = malloc(psConfig->ulBatch * sizeof(*piStatus));
+   pbIsFile = malloc(psConfig->ulBatch * sizeof(*pbIsFile));
+   pulSize = malloc(psConfig->ulBatch * sizeof(*pulSize));
+   if(ppcPaths == NULL || piStatus == NULL || pbIsFile == NULL ||
+      pulSize == NULL)
+      die("out of memory");
+   for(ulIndex = 0; ulIndex < psConfig->ulOps; ulIndex++)
+      ppcPaths[ulIndex] = sFiles.ppcPaths[Bench_zipfNext(oPick, pulRand)];
+
+   ulStart = TimerFT_ticks();
+   for(ulIndex = 0; ulIndex < psConfig->ulOps; ulIndex++)
+      if(FT_stat(ppcPaths[ulIndex], &bIsFile, &ulSize) != SUCCESS)
+         die("FT_stat failed on an existing file");
+   ulSingleNanos = TimerFT_ticksToNanos(TimerFT_ticks() - ulStart);
+
+   ulBatchNanos = 0;
+   for(ulFirst = 0; ulFirst < psConfig->ulOps; ulFirst += ulInBatch) {
+      ulInBatch = psConfig->ulOps - ulFirst < psConfig->ulBatch
+                     ? psConfig->ulOps - ulFirst : psConfig->ulBatch;
+      ulStart = TimerFT_ticks();
+      if(FT_statBatch(ppcPaths + ulFirst, ulInBatch, piStatus, pbIsFile,
+                      pulSize) != SUCCESS)
+         die("FT_statBatch failed");
+      ulBatchNanos += TimerFT_ticksToNanos(TimerFT_ticks() - ulStart);
+      /* checked outside the timed region */
+      for(ulIndex = 0; ulIndex < ulInBatch; ulIndex++)
+         if(piStatus[ulIndex] != SUCCESS || !pbIsFile[ulIndex])
+            die("FT_statBatch failed on an existing file");
+   }
+
+   printf("stat:      %10.1f ns/path\n",
+          (double) ulSingleNanos / (double) psConfig->ulOps);
+   printf("statBatch: %10.1f ns/path in batches of %lu, %.2fx faster\n",
+          (double) ulBatchNanos / (double) psConfig->ulOps,
+          (unsigned long) psConfig->ulBatch,
+          (double) ulSingleNanos / (double) (ulBatchNanos ? ulBatchNanos
+                                                          : 1));
+   free(ppcPaths);
+   free(piStatus);
+   free(pbIsFile);
+   free(pulSize);
+}
+#endif
+
+/*
+  Prints the heading of the hardware counter table.
+*/
+static void printCounterHeading(void) {
+   int iCounter;
+
+   printf("%-12s", "per op");
+   for(iCounter = 0; iCounter < BENCH_NUM_COUNTERS; iCounter++)
+      printf(" %10s", Bench_perfName((enum BenchCounter) iCounter));
+   printf(" %6s\n", "IPC");
+}
+
+/*
+  Prints one row of the hardware counter table: the counter totals
+  aulTotals of ulN operations labelled pcLabel, divided by ulN.
+  Counters that could not be opened are shown as "-".
+*/
+static void printCounterRow(const char *pcLabel,
+                            const unsigned long aulTotals[], size_t ulN) {
+   int iCounter;
+
+   printf("%-12s", pcLabel);
+   for(iCounter = 0; iCounter < BENCH_NUM_COUNTERS; iCounter++) {
+      if(Bench_perfIsOpen((enum BenchCounter) iCounter))
+         printf(" %10.2f", (double) aulTotals[iCounter] / (double) ulN);
+      else
+         printf(" %10s", "-");
+   }
+   if(aulTotals[BENCH_CYCLES] != 0)
+      printf(" %6.2f\n", (double) aulTotals[BENCH_INSTRUCTIONS] /
+                         (double) aulTotals[BENCH_CYCLES]);
+   else
+      printf(" %6s\n", "-");
+}
+
+/*
+  Builds the tree, runs the workload, and prints the report.
+  Returns 0, or exits with EXIT_FAILURE on error.
+*/
+int main(int argc, char *argv[]) {
+   struct config sConfig;
+   unsigned long ulRand, ulNext = 0;
+   unsigned long ulStart, ulTicks, ulAllocs, ulBuildAllocs;
+   unsigned long ulBuildNanos, ulRunNanos = 0;
+   unsigned long *apulSamples[NUM_OPS];
+   unsigned long aaulPerf[NUM_OPS][BENCH_NUM_COUNTERS];
+   unsigned long aulBuildPerf[BENCH_NUM_COUNTERS];
+   unsigned long aulBefore[BENCH_NUM_COUNTERS];
+   unsigned long aulAfter[BENCH_NUM_COUNTERS];
+   size_t aulCounts[NUM_OPS], aulOpAllocs[NUM_OPS];
+   size_t ulOp, ulIndex;
+   unsigned uTotalWeight = 0;
+   Zipf_T oPick;
+
+   parseArgs(argc, argv, &sConfig);
+   ulRand = Bench_seed(sConfig.ulSeed);
+   for(ulOp = 0; ulOp < NUM_OPS; ulOp++)
+      uTotalWeight += sConfig.aWeights[ulOp];
+   if(uTotalWeight == 0)
+      usage(argv[0]);
+
+   pcContents = calloc(sConfig.ulContentLen + 1, 1);
+   if(pcContents == NULL)
+      die("out of memory");
+   if(sConfig.bPerf && Bench_perfOpen() == 0) {
+      fprintf(stderr, "ft_bench: no hardware counters available; "
+              "ignoring -p\n");
+      sConfig.bPerf = FALSE;
+   }
+   memset(aaulPerf, 0, sizeof(aaulPerf));
+
+   /* build phase */
+   if(FT_init() != SUCCESS)
+      die("FT_init failed");
+   ulBuildAllocs = Bench_allocCount();
+   Bench_perfRead(aulBefore);
+   ulStart = TimerFT_ticks();
+   buildDir("r");
+   switch(sConfig.eShape) {
+      case SHAPE_CHAIN: buildChains(&sConfig); break;
+      case SHAPE_WIDE: buildWide(&sConfig); break;
+      case SHAPE_BALANCED: buildBalanced(&sConfig); break;
+      case SHAPE_ZIPF: buildZipf(&sConfig, &ulRand); break;
+   }
+   ulBuildNanos = TimerFT_ticksToNanos(TimerFT_ticks() - ulStart);
+   Bench_perfRead(aulAfter);
+   memset(aulBuildPerf, 0, sizeof(aulBuildPerf));
+   Bench_perfAdd(aulBuildPerf, aulBefore, aulAfter);
+   ulBuildAllocs = Bench_allocCount() - ulBuildAllocs;
+   if(sFiles.ulLength == 0)
+      die("the tree has no files; use more nodes");
+
+   buildScratch(sConfig.ulOps * sConfig.aWeights[OP_RMDIR] /
+                uTotalWeight + 1, &ulRand);
+   oPick = Bench_zipfNew(sFiles.ulLength, sConfig.dSkew);
+   if(oPick == NULL)
+      die("out of memory");
+
+   printf("ft_bench: shape=%s nodes=%lu files=%lu dirs=%lu ops=%lu "
+          "skew=%.2f seed=%lu\n",
+          apcShapeNames[sConfig.eShape], (unsigned long) sConfig.ulNodes,
+          (unsigned long) sFiles.ulLength, (unsigned long) sDirs.ulLength,
+          (unsigned long) sConfig.ulOps, sConfig.dSkew, sConfig.ulSeed);
+   printf("build: %.3f s, %.0f paths/s (includes path formatting), "
+          "%.2f allocs/path\n",
+          (double) ulBuildNanos / 1e9,
+          (double) (sFiles.ulLength + sDirs.ulLength) * 1e9 /
+          (double) (ulBuildNanos ? ulBuildNanos : 1),
+          (double) ulBuildAllocs /
+          (double) (sFiles.ulLength + sDirs.ulLength));
+
+   /* measured phase */
+   for(ulOp = 0; ulOp < NUM_OPS; ulOp++) {
+      apulSamples[ulOp] = malloc((sConfig.ulOps + 1) *
+                                 sizeof(unsigned long));
+      if(apulSamples[ulOp] == NULL)
+         die("out of memory");
+      aulCounts[ulOp] = 0;
+      aulOpAllocs[ulOp] = 0;
+   }
+   for(ulIndex = 0; ulIndex < sConfig.ulOps; ulIndex++) {
+      enum benchOp eOp = pickOp(&sConfig, uTotalWeight, &ulRand);
+      char *pcPath;
+
+      /* paths are formatted and recorded, and counters read, outside
+         the timed region, so times and allocations are the FT's own */
+      eOp = prepareOp(eOp, oPick, &ulRand, &ulNext, &pcPath);
+      if(sConfig.bPerf)
+         Bench_perfRead(aulBefore);
+      ulAllocs = Bench_allocCount();
+      ulStart = TimerFT_ticks();
+      runOp(eOp, &sConfig, pcPath);
+      ulTicks = TimerFT_ticks() - ulStart;
+      aulOpAllocs[eOp] += Bench_allocCount() - ulAllocs;
+      if(sConfig.bPerf) {
+         Bench_perfRead(aulAfter);
+         Bench_perfAdd(aaulPerf[eOp], aulBefore, aulAfter);
+      }
+      finishOp(eOp, pcPath);
+      apulSamples[eOp][aulCounts[eOp]++] = TimerFT_ticksToNanos(ulTicks);
+      ulRunNanos += TimerFT_ticksToNanos(ulTicks);
+   }
+
+   printf("%-12s %10s %12s %9s %9s %9s %9s %10s %10s\n", "operation",
+          "count", "ops/s", "p50 ns", "p90 ns", "p99 ns", "p99.9 ns",
+          "max ns", "allocs/op");
+   for(ulOp = 0; ulOp < NUM_OPS; ulOp++) {
+      unsigned long ulSum = 0;
+      size_t ulN = aulCounts[ulOp];
+
+      if(ulN == 0)
+         continue;
+      for(ulIndex = 0; ulIndex < ulN; ulIndex++)
+         ulSum += apulSamples[ulOp][ulIndex];
+      Bench_sort(apulSamples[ulOp], ulN);
+      printf("%-12s %10lu %12.0f %9lu %9lu %9lu %9lu %10lu %10.2f\n",
+             apcOpNames[ulOp], (unsigned long) ulN,
+             (double) ulN * 1e9 / (double) (ulSum ? ulSum : 1),
+             Bench_percentile(apulSamples[ulOp], ulN, 50.0),
+             Bench_percentile(apulSamples[ulOp], ulN, 90.0),
+             Bench_percentile(apulSamples[ulOp], ulN, 99.0),
+             Bench_percentile(apulSamples[ulOp], ulN, 99.9),
+             apulSamples[ulOp][ulN - 1],
+             (double) aulOpAllocs[ulOp] / (double) ulN);
+      free(apulSamples[ulOp]);
+   }
+   if(sConfig.bPerf) {
+      printf("hardware counters (user mode, per operation):\n");
+      printCounterHeading();
+      printCounterRow("build/path", aulBuildPerf,
+                      sFiles.ulLength + sDirs.ulLength);
+      for(ulOp = 0; ulOp < NUM_OPS; ulOp++)
+         if(aulCounts[ulOp] > 0)
+            printCounterRow(apcOpNames[ulOp], aaulPerf[ulOp],
+                            aulCounts[ulOp]);
+      Bench_perfClose();
+   }
+   printf("total: %lu ops in %.3f s, %.0f ops/s; peak RSS %ld KB\n",
+          (unsigned long) sConfig.ulOps, (double) ulRunNanos / 1e9,
+          (double) sConfig.ulOps * 1e9 /
+          (double) (ulRunNanos ? ulRunNanos : 1),
+          Bench_peakRssKB());
+#ifndef BENCH_REFERENCE
+   if(sConfig.ulBatch > 0 && sConfig.ulOps > 0)
+      compareStatBatch(&sConfig, oPick, &ulRand);
+#endif
+
+   if(FT_destroy() != SUCCESS)
+      die("FT_destroy failed");
+   Bench_zipfFree(oPick);
+   pathList_free(&sDirs);
+   pathList_free(&sFiles);
+   pathList_free(&sScratch);
+   free(pcContents);
+   return 0;
+}
@@ -0,0 +1,305 @@
+/*--------------------------------------------------------------------*/
+/* ft_replay.c                                                        */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+/* getopt and nanosleep are POSIX, not C99 */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "ft.h"
+#include "opFT.h"
+#include "recordFT.h"
+#include "bench.h"
+#include "timerFT.h"
+
+/*
+  Replays a trace written by an FT built with -DFT_RECORD (see
+  recordFT.h) against whatever FT this program is linked with: ft.c
+  (target ft_replay) or the reference sampleft.o (target
+  ft_replay_sample). Calls run back to back by default, or with -t at
+  the times they were originally made. Every result is compared with
+  the recorded one. The report gives throughput and latency per
+  operation next to the recorded latency, and the mismatches.
+  Exits with EXIT_FAILURE if any result differed.
+*/
+
+/* One call to replay */
+struct call {
+   enum OpFT eOp;
+   int iResult;
+   unsigned long ulStartNanos;
+   unsigned long ulDurNanos;
+   size_t ulLength;
+   /* owned copy of the path, or NULL */
+   char *pcPath;
+};
+
+/* The whole trace, loaded before replay so that reading the file is
+   not timed */
+static struct call *psCalls;
+static size_t ulCallCount;
+
+/* Contents passed to every insert and replace; as long as the
+   longest recorded content */
+static char *pcContents;
+
+/*
+  Prints a usage message for program pcProg to stderr and exits.
+*/
+static void usage(const char *pcProg) {
+   fprintf(stderr,
+      "usage: %s [-t] [-x speed] [-v mismatches to show] tracefile\n",
+      pcProg);
+   exit(EXIT_FAILURE);
+}
+
+/*
+  Prints pcWhat to stderr and exits.
+*/
+static void die(const char *pcWhat) {
+   fprintf(stderr, "ft_replay: %s\n", pcWhat);
+   exit(EXIT_FAILURE);
+}
+
+/*
+  Reads the trace in file pcName into psCalls and sizes pcContents.
+*/
+static void loadTrace(const char *pcName) {
+   struct RecordFT_Event sEvent = { OPFT_INIT, 0, 0, 0, 0, NULL, NULL, 0 };
+   size_t ulCapacity = 0, ulMaxLength = 0;
+   FILE *psFile;
+   int iRead;
+
+   psFile = fopen(pcName, "rb");
+   if(psFile == NULL)
+      die("cannot open the trace file");
+   if(!RecordFT_readHeader(psFile))
+      die("not a trace file");
+
+   while((iRead = RecordFT_read(psFile, &sEvent)) == 1) {
+      struct call *psCall;
+
+      if(ulCallCount == ulCapacity) {
+         ulCapacity = ulCapacity ? 2 * ulCapacity : 1024;
+         psCalls = realloc(psCalls, ulCapacity * sizeof(struct call));
+         if(psCalls == NULL)
+            die("out of memory");
+      }
+      psCall = &psCalls[ulCallCount++];
+      psCall->eOp = sEvent.eOp;
+      psCall->iResult = sEvent.iResult;
+      psCall->ulStartNanos = sEvent.ulStartNanos;
+      psCall->ulDurNanos = sEvent.ulDurNanos;
+      psCall->ulLength = sEvent.ulLength;
+      psCall->pcPath = NULL;
+      if(sEvent.pcPath != NULL) {
+         psCall->pcPath = malloc(strlen(sEvent.pcPath) + 1);
+         if(psCall->pcPath == NULL)
+            die("out of memory");
+         strcpy(psCall->pcPath, sEvent.pcPath);
+      }
+      if(sEvent.ulLength > ulMaxLength)
+         ulMaxLength = sEvent.ulLength;
+   }
+   if(iRead < 0)
+      fprintf(stderr, "ft_replay: trace is truncated after %lu calls\n",
+              (unsigned long) ulCallCount);
+   free(sEvent.pcBuffer);
+   fclose(psFile);
+
+   pcContents = calloc(ulMaxLength + 1, 1);
+   if(pcContents == NULL)
+      die("out of memory");
+}
+
+/*
+  Makes call psCall and returns its result in the form recordFT
+  uses: the status for int operations, the boolean for boolean ones,
+  and whether the pointer was non-NULL for pointer ones.
+*/
+static int replayCall(const struct call *psCall) {
+   boolean bIsFile;
+   size_t ulSize;
+   void *pvResult;
+   char *pcPath = psCall->pcPath;
+
+   /* only FT_init, FT_destroy and FT_toString take no path */
+   if(pcPath == NULL && psCall->eOp != OPFT_INIT &&
+      psCall->eOp != OPFT_DESTROY && psCall->eOp != OPFT_TO_STRING)
+      die("trace has a path operation without a path");
+
+   switch(psCall->eOp) {
+      case OPFT_INIT:
+         return FT_init();
+      case OPFT_DESTROY:
+         return FT_destroy();
+      case OPFT_INSERT_DIR:
+         return FT_insertDir(pcPath);
+      case OPFT_INSERT_FILE:
+         return FT_insertFile(pcPath, pcContents, psCall->ulLength);
+      case OPFT_RM_DIR:
+         return FT_rmDir(pcPath);
+      case OPFT_RM_FILE:
+         return FT_rmFile(pcPath);
+      case OPFT_CONTAINS_DIR:
+         return (int) FT_containsDir(pcPath);
+      case OPFT_CONTAINS_FILE:
+         return (int) FT_containsFile(pcPath);
+      case OPFT_GET_CONTENTS:
+         return FT_getFileContents(pcPath) != NULL;
+      case OPFT_REPLACE_CONTENTS:
+         pvResult = FT_replaceFileContents(pcPath, pcContents,
+                                           psCall->ulLength);
+         /* an FT that copies contents hands back a copy to free; one
+            that keeps pointers hands back pcContents itself */
+         if(pvResult != NULL && pvResult != (void *) pcContents)
+            free(pvResult);
+         return pvResult != NULL;
+      case OPFT_STAT:
+         return FT_stat(pcPath, &bIsFile, &ulSize);
+      case OPFT_TO_STRING:
+         pvResult = FT_toString();
+         free(pvResult);
+         return pvResult != NULL;
+      default:
+         assert(0);
+         return 0;
+   }
+}
+
+/*
+  Sleeps until ulNanos ns after ulOriginNanos (a TimerFT_nanos
+  reading), if that is still in the future.
+*/
+static void waitUntil(unsigned long ulOriginNanos, unsigned long ulNanos) {
+   unsigned long ulNow = TimerFT_nanos() - ulOriginNanos;
+   struct timespec sDelay;
+
+   if(ulNow >= ulNanos)
+      return;
+   sDelay.tv_sec = (time_t) ((ulNanos - ulNow) / 1000000000UL);
+   sDelay.tv_nsec = (long) ((ulNanos - ulNow) % 1000000000UL);
+   (void) nanosleep(&sDelay, NULL);
+}
+
+/*
+  Replays the trace named on the command line and prints the report.
+  Returns 0 if every result matched the recording, EXIT_FAILURE
+  otherwise.
+*/
+int main(int argc, char *argv[]) {
+   int bTimed = FALSE;
+   double dSpeed = 1.0;
+   unsigned long ulShow = 10, ulMismatches = 0;
+   unsigned long ulOrigin, ulStart, ulNanos, ulRunNanos = 0;
+   unsigned long *apulSamples[OPFT_COUNT], *apulRecorded[OPFT_COUNT];
+   size_t aulCounts[OPFT_COUNT], aulMismatches[OPFT_COUNT];
+   size_t ulIndex, ulOp;
+   int iOpt;
+
+   while((iOpt = getopt(argc, argv, "tx:v:h")) != -1) {
+      switch(iOpt) {
+         case 't': bTimed = TRUE; break;
+         case 'x': dSpeed = strtod(optarg, NULL); break;
+         case 'v': ulShow = strtoul(optarg, NULL, 10); break;
+         default: usage(argv[0]);
+      }
+   }
+   if(optind != argc - 1 || dSpeed <= 0.0)
+      usage(argv[0]);
+
+   loadTrace(argv[optind]);
+
+   /* size each operation's samples by its share of the trace, so
+      they take two words per call in all */
+   for(ulOp = 0; ulOp < OPFT_COUNT; ulOp++)
+      aulCounts[ulOp] = 0;
+   for(ulIndex = 0; ulIndex < ulCallCount; ulIndex++)
+      aulCounts[psCalls[ulIndex].eOp]++;
+   for(ulOp = 0; ulOp < OPFT_COUNT; ulOp++) {
+      apulSamples[ulOp] = malloc((aulCounts[ulOp] + 1) *
+                                 sizeof(unsigned long));
+      apulRecorded[ulOp] = malloc((aulCounts[ulOp] + 1) *
+                                  sizeof(unsigned long));
+      if(apulSamples[ulOp] == NULL || apulRecorded[ulOp] == NULL)
+         die("out of memory");
+      aulCounts[ulOp] = 0;
+      aulMismatches[ulOp] = 0;
+   }
+
+   /* calibrate the tick rate now rather than inside the first call */
+   (void) TimerFT_ticksToNanos(0);
+
+   ulOrigin = TimerFT_nanos();
+   for(ulIndex = 0; ulIndex < ulCallCount; ulIndex++) {
+      const struct call *psCall = &psCalls[ulIndex];
+      int iResult;
+
+      if(bTimed)
+         waitUntil(ulOrigin,
+                   (unsigned long) ((double) psCall->ulStartNanos / dSpeed));
+
+      ulStart = TimerFT_ticks();
+      iResult = replayCall(psCall);
+      ulNanos = TimerFT_ticksToNanos(TimerFT_ticks() - ulStart);
+
+      ulOp = (size_t) psCall->eOp;
+      apulSamples[ulOp][aulCounts[ulOp]] = ulNanos;
+      apulRecorded[ulOp][aulCounts[ulOp]++] = psCall->ulDurNanos;
+      ulRunNanos += ulNanos;
+
+      if(iResult != psCall->iResult) {
+         aulMismatches[ulOp]++;
+         if(ulMismatches++ < ulShow)
+            printf("mismatch at call %lu: %s(%s) recorded %d, "
+                   "replayed %d\n", (unsigned long) ulIndex,
+                   OpFT_name(psCall->eOp),
+                   psCall->pcPath ? psCall->pcPath : "",
+                   psCall->iResult, iResult);
+      }
+   }
+
+   printf("ft_replay: %lu calls, %s\n", (unsigned long) ulCallCount,
+          bTimed ? "original timing" : "full speed");
+   printf("%-22s %9s %12s %9s %9s %9s %12s %10s\n", "operation", "count",
+          "ops/s", "p50 ns", "p99 ns", "max ns", "recorded p50",
+          "mismatches");
+   for(ulOp = 0; ulOp < OPFT_COUNT; ulOp++) {
+      unsigned long ulSum = 0;
+      size_t ulN = aulCounts[ulOp];
+
+      if(ulN > 0) {
+         for(ulIndex = 0; ulIndex < ulN; ulIndex++)
+            ulSum += apulSamples[ulOp][ulIndex];
+         Bench_sort(apulSamples[ulOp], ulN);
+         Bench_sort(apulRecorded[ulOp], ulN);
+         printf("%-22s %9lu %12.0f %9lu %9lu %9lu %12lu %10lu\n",
+                OpFT_name((enum OpFT) ulOp), (unsigned long) ulN,
+                (double) ulN * 1e9 / (double) (ulSum ? ulSum : 1),
+                Bench_percentile(apulSamples[ulOp], ulN, 50.0),
+                Bench_percentile(apulSamples[ulOp], ulN, 99.0),
+                apulSamples[ulOp][ulN - 1],
+                Bench_percentile(apulRecorded[ulOp], ulN, 50.0),
+                (unsigned long) aulMismatches[ulOp]);
+      }
+      free(apulSamples[ulOp]);
+      free(apulRecorded[ulOp]);
+   }
+   printf("total: %.3f s in FT calls, %.0f calls/s; %lu mismatches\n",
+          (double) ulRunNanos / 1e9,
+          (double) ulCallCount * 1e9 /
+          (double) (ulRunNanos ? ulRunNanos : 1), ulMismatches);
+
+   for(ulIndex = 0; ulIndex < ulCallCount; ulIndex++)
+      free(psCalls[ulIndex].pcPath);
+   free(psCalls);
+   free(pcContents);
+   return ulMismatches == 0 ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,465 @@
+/*--------------------------------------------------------------------*/
+/* ft_scale.c                                                         */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+/* getopt, sysconf and pthread barriers are POSIX, not C99 */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "ft.h"
+#include "bench.h"
+#include "timerFT.h"
+#ifndef SCALE_PERTHREAD
+#include "samplerFT.h"
+#endif
+
+/*
+  Multi-threaded scalability benchmark for the FT. For each workload
+  (read-heavy, mixed, write-heavy) it runs 1, 2, 4, ... up to -t
+  threads and reports throughput, speedup and efficiency relative to
+  one thread, and the time spent waiting for the tree lock.
+
+  The same source builds two programs. ft_scale links an FT compiled
+  with -DFT_THREADSAFE, and all threads share one tree. ft_scale_pt
+  is compiled with -DSCALE_PERTHREAD and links an FT compiled with
+  -DFT_PERTHREAD, and every thread builds and uses a tree of its own.
+  Comparing the two separates the cost of sharing from the cost of
+  the work itself.
+
+  With -s N, ft_scale also runs the background consistency checker
+  of samplerFT at N nodes per second during the sweep, so that its
+  cost shows up in the throughput; ft_scale_pt has no shared tree to
+  check and ignores -s.
+*/
+
+/* A workload: its name and the percentage of operations that read */
+struct workload {
+   const char *pcName;
+   unsigned uReadPct;
+};
+
+static const struct workload asWorkloads[] = {
+   { "read-heavy", 95 }, { "mixed", 50 }, { "write-heavy", 10 }
+};
+
+enum { NUM_WORKLOADS = sizeof(asWorkloads) / sizeof(asWorkloads[0]) };
+
+/* Top-level and second-level directories each fan out this much */
+enum { FANOUT = 32 };
+
+/* Files each thread keeps in its private directory while churning */
+enum { CHURN_FILES = 64 };
+
+/* Longest path this program builds */
+enum { MAX_PATH = 64 };
+
+/* Command-line settings */
+struct config {
+   size_t ulMaxThreads;
+   size_t ulFiles;
+   size_t ulOps;
+   size_t ulContentLen;
+   unsigned long ulSeed;
+   size_t ulSampleRate;
+   int abWorkloads[NUM_WORKLOADS];
+};
+
+/* What one thread does in one configuration, and what it measured */
+struct worker {
+   pthread_t sThread;
+   size_t ulTid;
+   const struct config *psConfig;
+   const struct workload *psWorkload;
+   unsigned long ulEndNanos;
+};
+
+/* Shared file paths, the same in every tree; read-only once built */
+static char **ppcFiles;
+
+/* Contents written by every insert and replace */
+static char *pcContents;
+
+/* Workers and the main thread meet here before timing starts */
+static pthread_barrier_t sStartLine;
+
+/*
+  Prints a usage message for program pcProg to stderr and exits.
+*/
+static void usage(const char *pcProg) {
+   fprintf(stderr,
+      "usage: %s [-t maxthreads] [-n files] [-o ops per thread]\n"
+      "          [-c contentbytes] [-r seed] "
+      "[-w read-heavy,mixed,write-heavy]\n"
+      "          [-s sampled nodes per second]\n", pcProg);
+   exit(EXIT_FAILURE);
+}
+
+/*
+  Prints pcWhat to stderr and exits.
+*/
+static void die(const char *pcWhat) {
+   fprintf(stderr, "ft_scale: %s\n", pcWhat);
+   exit(EXIT_FAILURE);
+}
+
+/*
+  Inserts directory pcPath, which must not exist yet.
+*/
+static void buildDir(const char *pcPath) {
+   if(FT_insertDir(pcPath) != SUCCESS)
+      die("FT_insertDir failed while building the tree");
+}
+
+/*
+  Creates and fills a tree: r/aI/bJ directories with psConfig->ulFiles
+  files spread over them, and a private directory r/wT for each of
+  ulThreads threads. Initializes the FT first.
+*/
+static void buildTree(const struct config *psConfig, size_t ulThreads) {
+   char acPath[MAX_PATH];
+   size_t ulA, ulB, ulIndex;
+
+   if(FT_init() != SUCCESS)
+      die("FT_init failed");
+   buildDir("r");
+   for(ulA = 0; ulA < FANOUT; ulA++) {
+      sprintf(acPath, "r/a%lu", (unsigned long) ulA);
+      buildDir(acPath);
+      for(ulB = 0; ulB < FANOUT; ulB++) {
+         sprintf(acPath, "r/a%lu/b%lu", (unsigned long) ulA,
+                 (unsigned long) ulB);
+         buildDir(acPath);
+      }
+   }
+   for(ulIndex = 0; ulIndex < psConfig->ulFiles; ulIndex++)
+      if(FT_insertFile(ppcFiles[ulIndex], pcContents,
+                       psConfig->ulContentLen) != SUCCESS)
+         die("FT_insertFile failed while building the tree");
+   for(ulIndex = 0; ulIndex < ulThreads; ulIndex++) {
+      sprintf(acPath, "r/w%lu", (unsigned long) ulIndex);
+      buildDir(acPath);
+   }
+}
+
+/*
+  Formats the path of churn file number ulSeq of thread ulTid into
+  acPath.
+*/
+static void churnPath(char acPath[MAX_PATH], size_t ulTid,
+                      unsigned long ulSeq) {
+   sprintf(acPath, "r/w%lu/f%lu", (unsigned long) ulTid, ulSeq);
+}
+
+/*
+  Runs one worker's share of the workload, then removes the files it
+  left in its private directory. In per-thread mode it first builds
+  its own tree, and destroys it at the end.
+*/
+static void *runWorker(void *pvWorker) {
+   struct worker *psWorker = pvWorker;
+   const struct config *psConfig = psWorker->psConfig;
+   char acPath[MAX_PATH];
+   unsigned long ulRand, ulFirst = 0, ulNext = 0;
+   size_t ulOp;
+   boolean bIsFile;
+   size_t ulSize;
+   void *pvOld;
+
+#ifdef SCALE_PERTHREAD
+   buildTree(psConfig, psWorker->ulTid + 1);
+#endif
+   ulRand = Bench_seed(psConfig->ulSeed + psWorker->ulTid);
+   (void) pthread_barrier_wait(&sStartLine);
+
+   for(ulOp = 0; ulOp < psConfig->ulOps; ulOp++) {
+      unsigned uRoll = (unsigned) (Bench_rand(&ulRand) % 100);
+      const char *pcShared =
+         ppcFiles[Bench_rand(&ulRand) % psConfig->ulFiles];
+
+      if(uRoll < psWorker->psWorkload->uReadPct) {
+         /* reads: lookups and stats of shared files */
+         if(uRoll % 5 < 3) {
+            if(!FT_containsFile(pcShared))
+               die("FT_containsFile missed a shared file");
+         }
+         else if(FT_stat(pcShared, &bIsFile, &ulSize) != SUCCESS)
+            die("FT_stat failed on a shared file");
+      }
+      else if(uRoll % 3 == 0) {
+         /* writes: replace shared contents... */
+         pvOld = FT_replaceFileContents(pcShared, pcContents,
+                                        psConfig->ulContentLen);
+         if(pvOld != (void *) pcContents)
+            free(pvOld);
+      }
+      else if(ulNext - ulFirst < CHURN_FILES) {
+         /* ...or churn files in this thread's private directory */
+         churnPath(acPath, psWorker->ulTid, ulNext++);
+         if(FT_insertFile(acPath, pcContents, psConfig->ulContentLen)
+            != SUCCESS)
+            die("FT_insertFile failed on a churn file");
+      }
+      else {
+         churnPath(acPath, psWorker->ulTid, ulFirst++);
+         if(FT_rmFile(acPath) != SUCCESS)
+            die("FT_rmFile failed on a churn file");
+      }
+   }
+   psWorker->ulEndNanos = TimerFT_nanos();
+
+   while(ulFirst < ulNext) {
+      churnPath(acPath, psWorker->ulTid, ulFirst++);
+      if(FT_rmFile(acPath) != SUCCESS)
+         die("FT_rmFile failed while cleaning up");
+   }
+#ifdef SCALE_PERTHREAD
+   if(FT_destroy() != SUCCESS)
+      die("FT_destroy failed");
+#endif
+   return NULL;
+}
+
+/*
+  Runs psWorkload on ulThreads threads and returns the throughput in
+  operations per second. Stores the lock counters in *psLock and the
+  wall-clock time of the run in *pulWallNanos.
+*/
+static double runConfig(const struct config *psConfig,
+                        const struct workload *psWorkload,
+                        size_t ulThreads, struct FT_LockStats *psLock,
+                        unsigned long *pulWallNanos) {
+   struct worker *psWorkers;
+   unsigned long ulStart, ulEnd = 0;
+   size_t ulIndex;
+
+   psWorkers = calloc(ulThreads, sizeof(struct worker));
+   if(psWorkers == NULL)
+      die("out of memory");
+   if(pthread_barrier_init(&sStartLine, NULL, (unsigned) ulThreads + 1)
+      != 0)
+      die("cannot create a barrier");
+
+   for(ulIndex = 0; ulIndex < ulThreads; ulIndex++) {
+      psWorkers[ulIndex].ulTid = ulIndex;
+      psWorkers[ulIndex].psConfig = psConfig;
+      psWorkers[ulIndex].psWorkload = psWorkload;
+      if(pthread_create(&psWorkers[ulIndex].sThread, NULL, runWorker,
+                        &psWorkers[ulIndex]) != 0)
+         die("cannot create a thread");
+   }
+
+   (void) pthread_barrier_wait(&sStartLine);
+   FT_resetLockStats();
+   ulStart = TimerFT_nanos();
+
+   for(ulIndex = 0; ulIndex < ulThreads; ulIndex++) {
+      (void) pthread_join(psWorkers[ulIndex].sThread, NULL);
+      if(psWorkers[ulIndex].ulEndNanos > ulEnd)
+         ulEnd = psWorkers[ulIndex].ulEndNanos;
+   }
+   /* the counters also cover cleanup, which is small next to the run */
+   FT_getLockStats(psLock);
+
+   (void) pthread_barrier_destroy(&sStartLine);
+   free(psWorkers);
+   *pulWallNanos = ulEnd > ulStart ? ulEnd - ulStart : 1;
+   return (double) (ulThreads * psConfig->ulOps) * 1e9 /
+          (double) *pulWallNanos;
+}
+
+/*
+  Returns the thread count to try after ulThreads: the next power of
+  two, then ulMax itself if it is not one, then ulMax + 1 to stop.
+*/
+static size_t nextThreadCount(size_t ulThreads, size_t ulMax) {
+   if(ulThreads * 2 <= ulMax)
+      return ulThreads * 2;
+   if(ulThreads < ulMax)
+      return ulMax;
+   return ulMax + 1;
+}
+
+/*
+  Parses the comma-separated workload names in pcArg into
+  psConfig->abWorkloads. Returns 0, or -1 on an unknown name.
+*/
+static int parseWorkloads(char *pcArg, struct config *psConfig) {
+   char *pcName;
+   size_t ulIndex;
+
+   memset(psConfig->abWorkloads, 0, sizeof(psConfig->abWorkloads));
+   for(pcName = strtok(pcArg, ","); pcName != NULL;
+       pcName = strtok(NULL, ",")) {
+      for(ulIndex = 0; ulIndex < NUM_WORKLOADS; ulIndex++)
+         if(strcmp(pcName, asWorkloads[ulIndex].pcName) == 0)
+            break;
+      if(ulIndex == NUM_WORKLOADS)
+         return -1;
+      psConfig->abWorkloads[ulIndex] = TRUE;
+   }
+   return 0;
+}
+
+#ifndef SCALE_PERTHREAD
+/*
+  The sampler's report function: prints pcProblem to stderr.
+*/
+static void reportProblem(const char *pcProblem, void *pvArg) {
+   (void) pvArg;
+   fprintf(stderr, "ft_scale: sampler found: %s\n", pcProblem);
+}
+#endif
+
+/*
+  Parses the command line into psConfig, exiting on bad usage.
+*/
+static void parseArgs(int argc, char *argv[], struct config *psConfig) {
+   long lCpus = sysconf(_SC_NPROCESSORS_ONLN);
+   size_t ulIndex;
+   int iOpt;
+
+   psConfig->ulMaxThreads = lCpus > 0 ? (size_t) lCpus : 4;
+   psConfig->ulFiles = 16384;
+   psConfig->ulOps = 200000;
+   psConfig->ulContentLen = 64;
+   psConfig->ulSeed = 1;
+   psConfig->ulSampleRate = 0;
+   for(ulIndex = 0; ulIndex < NUM_WORKLOADS; ulIndex++)
+      psConfig->abWorkloads[ulIndex] = TRUE;
+
+   while((iOpt = getopt(argc, argv, "t:n:o:c:r:w:s:h")) != -1) {
+      switch(iOpt) {
+         case 't': psConfig->ulMaxThreads = strtoul(optarg, NULL, 10);
+                   break;
+         case 'n': psConfig->ulFiles = strtoul(optarg, NULL, 10); break;
+         case 'o': psConfig->ulOps = strtoul(optarg, NULL, 10); break;
+         case 'c': psConfig->ulContentLen = strtoul(optarg, NULL, 10);
+                   break;
+         case 'r': psConfig->ulSeed = strtoul(optarg, NULL, 10); break;
+         case 's': psConfig->ulSampleRate = strtoul(optarg, NULL, 10);
+                   break;
+         case 'w':
+            if(parseWorkloads(optarg, psConfig) != 0)
+               usage(argv[0]);
+            break;
+         default:
+            usage(argv[0]);
+      }
+   }
+   if(psConfig->ulMaxThreads == 0 || psConfig->ulFiles == 0 ||
+      psConfig->ulOps == 0)
+      usage(argv[0]);
+}
+
+/*
+  Runs the thread-count sweep for every selected workload and prints
+  one line per configuration. Returns 0, or exits with EXIT_FAILURE
+  on error.
+*/
+int main(int argc, char *argv[]) {
+   struct config sConfig;
+   struct FT_LockStats sLock;
+#ifndef SCALE_PERTHREAD
+   struct SamplerFT_Stats sSampler;
+   struct FT_ArenaStats sArena;
+   struct FT_HotCacheStats sHot;
+#endif
+   unsigned long ulWallNanos;
+   double dOpsPerSec, dBase;
+   size_t ulIndex, ulThreads, ulWorkload;
+
+   parseArgs(argc, argv, &sConfig);
+
+   pcContents = calloc(sConfig.ulContentLen + 1, 1);
+   ppcFiles = malloc(sConfig.ulFiles * sizeof(char *));
+   if(pcContents == NULL || ppcFiles == NULL)
+      die("out of memory");
+   for(ulIndex = 0; ulIndex < sConfig.ulFiles; ulIndex++) {
+      ppcFiles[ulIndex] = malloc(MAX_PATH);
+      if(ppcFiles[ulIndex] == NULL)
+         die("out of memory");
+      sprintf(ppcFiles[ulIndex], "r/a%lu/b%lu/f%lu",
+              (unsigned long) (ulIndex % FANOUT),
+              (unsigned long) (ulIndex / FANOUT % FANOUT),
+              (unsigned long) ulIndex);
+   }
+
+#ifndef SCALE_PERTHREAD
+   buildTree(&sConfig, sConfig.ulMaxThreads);
+   if(sConfig.ulSampleRate > 0 &&
+      SamplerFT_start(sConfig.ulSampleRate, reportProblem, NULL)
+      != SUCCESS)
+      die("cannot start the sampler");
+#endif
+
+   printf("ft_scale: %s, %lu files, %lu ops per thread, "
+          "up to %lu threads\n",
+#ifdef SCALE_PERTHREAD
+          "per-thread trees",
+#else
+          "one shared tree",
+#endif
+          (unsigned long) sConfig.ulFiles, (unsigned long) sConfig.ulOps,
+          (unsigned long) sConfig.ulMaxThreads);
+   printf("%-12s %7s %12s %8s %10s %11s %10s %8s\n", "workload",
+          "threads", "ops/s", "speedup", "efficiency", "contended %",
+          "lock wait", "wait %");
+
+   for(ulWorkload = 0; ulWorkload < NUM_WORKLOADS; ulWorkload++) {
+      if(!sConfig.abWorkloads[ulWorkload])
+         continue;
+      dBase = 0.0;
+      for(ulThreads = 1; ulThreads <= sConfig.ulMaxThreads;
+          ulThreads = nextThreadCount(ulThreads, sConfig.ulMaxThreads)) {
+         dOpsPerSec = runConfig(&sConfig, &asWorkloads[ulWorkload],
+                                ulThreads, &sLock, &ulWallNanos);
+         if(ulThreads == 1)
+            dBase = dOpsPerSec;
+         printf("%-12s %7lu %12.0f %7.2fx %9.1f%% %10.2f%% %8.1fms "
+                "%7.2f%%\n",
+                asWorkloads[ulWorkload].pcName, (unsigned long) ulThreads,
+                dOpsPerSec, dOpsPerSec / dBase,
+                100.0 * dOpsPerSec / dBase / (double) ulThreads,
+                sLock.ulAcquired ? 100.0 * (double) sLock.ulContended /
+                                   (double) sLock.ulAcquired : 0.0,
+                (double) sLock.ulWaitNanos / 1e6,
+                100.0 * (double) sLock.ulWaitNanos /
+                ((double) ulWallNanos * (double) ulThreads));
+      }
+   }
+
+#ifndef SCALE_PERTHREAD
+   if(sConfig.ulSampleRate > 0) {
+      SamplerFT_stop();
+      SamplerFT_getStats(&sSampler);
+      printf("sampler: %lu samples, %lu nodes checked, %lu problems\n",
+             sSampler.ulSamples, sSampler.ulNodes, sSampler.ulFindings);
+   }
+   FT_getArenaStats(&sArena);
+   if(sArena.ulMapped > 0)
+      printf("arena: %lu KB mapped for huge pages, %lu KB backed "
+             "(%.1f%%)\n", (unsigned long) (sArena.ulMapped / 1024),
+             (unsigned long) (sArena.ulHuge / 1024),
+             100.0 * (double) sArena.ulHuge / (double) sArena.ulMapped);
+   FT_getHotCacheStats(&sHot);
+   if(sHot.ulHits + sHot.ulMisses > 0)
+      printf("hot cache: %lu of %lu child lookups hit (%.1f%%)\n",
+             sHot.ulHits, sHot.ulHits + sHot.ulMisses,
+             100.0 * (double) sHot.ulHits /
+             (double) (sHot.ulHits + sHot.ulMisses));
+   if(FT_destroy() != SUCCESS)
+      die("FT_destroy failed");
+#endif
+   for(ulIndex = 0; ulIndex < sConfig.ulFiles; ulIndex++)
+      free(ppcFiles[ulIndex]);
+   free(ppcFiles);
+   free(pcContents);
+   return 0;
+}
@@ -0,0 +1,389 @@
+/*--------------------------------------------------------------------*/
+/* ftclient.c                                                         */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+/* sockets, poll and fcntl are POSIX, not C99 */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "wireFT.h"
+#include "ftclient.h"
+
+/* Bytes to make room for before each read */
+enum { READ_CHUNK = 65536 };
+
+/* A connection to ftd */
+struct FTClient {
+   /* the socket, nonblocking, or -1 once the connection has failed */
+   int iFd;
+   /* frames submitted but not yet written */
+   struct WireFT_Buffer sOut;
+   /* bytes of results read but not yet completed */
+   struct WireFT_Buffer sIn;
+   /* tag of the next frame to submit, and number of frames whose
+      results have not been completed */
+   uint32_t uiNextTag;
+   size_t ulInFlight;
+};
+
+/*
+  Marks oCClient failed, closing its socket. Returns
+  FTCLIENT_IO_ERROR.
+*/
+static int FTClient_fail(FTClient_T oCClient) {
+   if(oCClient->iFd >= 0)
+      (void) close(oCClient->iFd);
+   oCClient->iFd = -1;
+   return FTCLIENT_IO_ERROR;
+}
+
+/*
+  Waits until oCClient's socket can be read, or written if bWrite,
+  and reads whatever results have arrived, so that ftd is never left
+  unable to send while this end is still sending. Returns SUCCESS,
+  MEMORY_ERROR or FTCLIENT_IO_ERROR.
+*/
+static int FTClient_pump(FTClient_T oCClient, boolean bWrite) {
+   struct pollfd sPoll;
+   ssize_t lDone;
+
+   sPoll.fd = oCClient->iFd;
+   sPoll.events = (short) (POLLIN | (bWrite ? POLLOUT : 0));
+   if(poll(&sPoll, 1, -1) < 0)
+      return errno == EINTR ? SUCCESS : FTClient_fail(oCClient);
+
+   if(sPoll.revents & (POLLIN | POLLHUP | POLLERR)) {
+      if(!WireFT_reserve(&oCClient->sIn, READ_CHUNK))
+         return MEMORY_ERROR;
+      lDone = read(oCClient->iFd,
+                   oCClient->sIn.pcData + oCClient->sIn.ulHead +
+                      oCClient->sIn.ulLength,
+                   oCClient->sIn.ulSize - oCClient->sIn.ulHead -
+                      oCClient->sIn.ulLength);
+      if(lDone == 0 ||
+         (lDone < 0 && errno != EAGAIN && errno != EINTR))
+         return FTClient_fail(oCClient);
+      if(lDone > 0)
+         oCClient->sIn.ulLength += (size_t) lDone;
+   }
+
+   if(bWrite && (sPoll.revents & POLLOUT)) {
+      lDone = write(oCClient->iFd,
+                    oCClient->sOut.pcData + oCClient->sOut.ulHead,
+                    oCClient->sOut.ulLength);
+      if(lDone < 0 && errno != EAGAIN && errno != EINTR)
+         return FTClient_fail(oCClient);
+      if(lDone > 0)
+         WireFT_consume(&oCClient->sOut, (size_t) lDone);
+   }
+   return SUCCESS;
+}
+
+/*
+  Writes every submitted frame to ftd. Returns SUCCESS, MEMORY_ERROR
+  or FTCLIENT_IO_ERROR.
+*/
+static int FTClient_flush(FTClient_T oCClient) {
+   int iStatus = SUCCESS;
+
+   while(iStatus == SUCCESS && oCClient->sOut.ulLength > 0)
+      iStatus = FTClient_pump(oCClient, TRUE);
+   return iStatus;
+}
+
+FTClient_T FTClient_connect(const char *pcSocket) {
+   struct sockaddr_un sAddr;
+   FTClient_T oCClient;
+   int iFd;
+
+   assert(pcSocket != NULL);
+
+   if(strlen(pcSocket) >= sizeof(sAddr.sun_path))
+      return NULL;
+   memset(&sAddr, 0, sizeof(sAddr));
+   sAddr.sun_family = AF_UNIX;
+   strcpy(sAddr.sun_path, pcSocket);
+
+   iFd = socket(AF_UNIX, SOCK_STREAM, 0);
+   if(iFd < 0)
+      return NULL;
+   if(connect(iFd, (struct sockaddr *) &sAddr, sizeof(sAddr)) < 0 ||
+      fcntl(iFd, F_SETFL, fcntl(iFd, F_GETFL) | O_NONBLOCK) < 0) {
+      (void) close(iFd);
+      return NULL;
+   }
+
+   oCClient = calloc(1, sizeof(*oCClient));
+   if(oCClient == NULL) {
+      (void) close(iFd);
+      return NULL;
+   }
+   oCClient->iFd = iFd;
+   return oCClient;
+}
+
+void FTClient_close(FTClient_T oCClient) {
+   if(oCClient == NULL)
+      return;
+   (void) FTClient_fail(oCClient);
+   WireFT_free(&oCClient->sOut);
+   WireFT_free(&oCClient->sIn);
+   free(oCClient);
+}
+
+int FTClient_submit(FTClient_T oCClient, const struct FTClient_Op *psOps,
+                    size_t ulCount) {
+   size_t ulStart, ulOldLength, ulIndex;
+   boolean bOk;
+
+   assert(oCClient != NULL);
+   assert(psOps != NULL || ulCount == 0);
+
+   if(oCClient->iFd < 0)
+      return FTCLIENT_IO_ERROR;
+   if(ulCount > (uint32_t) -1)
+      return MEMORY_ERROR;
+
+   ulOldLength = oCClient->sOut.ulLength;
+   bOk = (boolean) WireFT_beginFrame(&oCClient->sOut, oCClient->uiNextTag,
+                                     &ulStart);
+   for(ulIndex = 0; bOk && ulIndex < ulCount; ulIndex++)
+      bOk = (boolean) WireFT_putRequest(&oCClient->sOut, psOps[ulIndex].eOp,
+                                        psOps[ulIndex].pcPath,
+                                        psOps[ulIndex].pvContents,
+                                        psOps[ulIndex].ulLength);
+   if(!bOk || !WireFT_endFrame(&oCClient->sOut, ulStart,
+                               (uint32_t) ulCount)) {
+      oCClient->sOut.ulLength = ulOldLength;
+      return MEMORY_ERROR;
+   }
+   oCClient->uiNextTag++;
+   oCClient->ulInFlight++;
+
+   /* send what has built up once it is worth a system call, so that
+      small batches submitted back to back share writes */
+   if(oCClient->sOut.ulLength >= READ_CHUNK)
+      return FTClient_flush(oCClient);
+   return SUCCESS;
+}
+
+int FTClient_complete(FTClient_T oCClient, struct FTClient_Op *psOps,
+                      size_t ulCount) {
+   struct WireFT_Header sHeader;
+   struct WireFT_Result sResult;
+   const char *pcAt, *pcEnd;
+   const void *pvData;
+   size_t ulLength, ulIndex;
+   int iStatus;
+
+   assert(oCClient != NULL);
+   assert(psOps != NULL || ulCount == 0);
+
+   if(oCClient->ulInFlight == 0)
+      return FTCLIENT_IO_ERROR;
+   iStatus = FTClient_flush(oCClient);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   while((ulLength = WireFT_frameLength(&oCClient->sIn, &sHeader)) == 0) {
+      iStatus = FTClient_pump(oCClient, FALSE);
+      if(iStatus != SUCCESS)
+         return iStatus;
+   }
+   if(ulLength == (size_t) -1 || sHeader.uiCount != ulCount ||
+      sHeader.uiTag != (uint32_t) (oCClient->uiNextTag -
+                                   oCClient->ulInFlight))
+      return FTClient_fail(oCClient);
+
+   pcAt = oCClient->sIn.pcData + oCClient->sIn.ulHead + sizeof(sHeader);
+   pcEnd = oCClient->sIn.pcData + oCClient->sIn.ulHead + ulLength;
+   for(ulIndex = 0; ulIndex < ulCount; ulIndex++) {
+      psOps[ulIndex].pvData = NULL;
+      if(!WireFT_getResult(&pcAt, pcEnd, &sResult, &pvData)) {
+         while(ulIndex-- > 0)
+            free(psOps[ulIndex].pvData);
+         return FTClient_fail(oCClient);
+      }
+      psOps[ulIndex].iStatus = sResult.iStatus;
+      psOps[ulIndex].bIsFile = (boolean) ((sResult.uiFlags &
+                                           WIREFT_IS_FILE) != 0);
+      psOps[ulIndex].ulSize = (size_t) sResult.ulLength;
+      if(pvData != NULL) {
+         /* one spare byte, so that a string can be terminated */
+         psOps[ulIndex].pvData = malloc(psOps[ulIndex].ulSize + 1);
+         if(psOps[ulIndex].pvData == NULL)
+            iStatus = MEMORY_ERROR;
+         else {
+            memcpy(psOps[ulIndex].pvData, pvData, psOps[ulIndex].ulSize);
+            ((char *) psOps[ulIndex].pvData)[psOps[ulIndex].ulSize] = '\0';
+         }
+      }
+   }
+
+   WireFT_consume(&oCClient->sIn, ulLength);
+   oCClient->ulInFlight--;
+   return iStatus;
+}
+
+/*
+  Runs one request, psOp, and waits for its result. Returns SUCCESS,
+  MEMORY_ERROR or FTCLIENT_IO_ERROR.
+*/
+static int FTClient_call(FTClient_T oCClient, struct FTClient_Op *psOp) {
+   int iStatus;
+
+   assert(oCClient != NULL);
+   assert(oCClient->ulInFlight == 0);
+
+   iStatus = FTClient_submit(oCClient, psOp, 1);
+   if(iStatus == SUCCESS)
+      iStatus = FTClient_complete(oCClient, psOp, 1);
+   return iStatus;
+}
+
+/*
+  Runs operation eOp on pcPath with the ulLength bytes of contents at
+  pvContents, and returns its status, or the reason it could not be
+  run.
+*/
+static int FTClient_simple(FTClient_T oCClient, enum OpFT eOp,
+                           const char *pcPath, const void *pvContents,
+                           size_t ulLength) {
+   struct FTClient_Op sOp;
+   int iStatus;
+
+   sOp.eOp = eOp;
+   sOp.pcPath = pcPath;
+   sOp.pvContents = pvContents;
+   sOp.ulLength = ulLength;
+   iStatus = FTClient_call(oCClient, &sOp);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   free(sOp.pvData);
+   return sOp.iStatus;
+}
+
+int FTClient_init(FTClient_T oCClient) {
+   return FTClient_simple(oCClient, OPFT_INIT, NULL, NULL, 0);
+}
+
+int FTClient_destroy(FTClient_T oCClient) {
+   return FTClient_simple(oCClient, OPFT_DESTROY, NULL, NULL, 0);
+}
+
+int FTClient_insertDir(FTClient_T oCClient, const char *pcPath) {
+   assert(pcPath != NULL);
+   return FTClient_simple(oCClient, OPFT_INSERT_DIR, pcPath, NULL, 0);
+}
+
+int FTClient_insertFile(FTClient_T oCClient, const char *pcPath,
+                        const void *pvContents, size_t ulLength) {
+   assert(pcPath != NULL);
+   return FTClient_simple(oCClient, OPFT_INSERT_FILE, pcPath, pvContents,
+                          ulLength);
+}
+
+int FTClient_rmDir(FTClient_T oCClient, const char *pcPath) {
+   assert(pcPath != NULL);
+   return FTClient_simple(oCClient, OPFT_RM_DIR, pcPath, NULL, 0);
+}
+
+int FTClient_rmFile(FTClient_T oCClient, const char *pcPath) {
+   assert(pcPath != NULL);
+   return FTClient_simple(oCClient, OPFT_RM_FILE, pcPath, NULL, 0);
+}
+
+boolean FTClient_containsDir(FTClient_T oCClient, const char *pcPath) {
+   assert(pcPath != NULL);
+   return (boolean) (FTClient_simple(oCClient, OPFT_CONTAINS_DIR, pcPath,
+                                     NULL, 0) == TRUE);
+}
+
+boolean FTClient_containsFile(FTClient_T oCClient, const char *pcPath) {
+   assert(pcPath != NULL);
+   return (boolean) (FTClient_simple(oCClient, OPFT_CONTAINS_FILE, pcPath,
+                                     NULL, 0) == TRUE);
+}
+
+int FTClient_stat(FTClient_T oCClient, const char *pcPath,
+                  boolean *pbIsFile, size_t *pulSize) {
+   struct FTClient_Op sOp;
+   int iStatus;
+
+   assert(pcPath != NULL);
+   assert(pbIsFile != NULL);
+   assert(pulSize != NULL);
+
+   sOp.eOp = OPFT_STAT;
+   sOp.pcPath = pcPath;
+   sOp.pvContents = NULL;
+   sOp.ulLength = 0;
+   iStatus = FTClient_call(oCClient, &sOp);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   if(sOp.iStatus == SUCCESS) {
+      *pbIsFile = sOp.bIsFile;
+      if(sOp.bIsFile)
+         *pulSize = sOp.ulSize;
+   }
+   return sOp.iStatus;
+}
+
+/*
+  Runs operation eOp, which returns data, on pcPath with the ulLength
+  bytes of contents at pvContents. Returns the data, storing its
+  length in *pulLength, or NULL if there was none or the request
+  failed.
+*/
+static void *FTClient_fetch(FTClient_T oCClient, enum OpFT eOp,
+                            const char *pcPath, const void *pvContents,
+                            size_t ulLength, size_t *pulLength) {
+   struct FTClient_Op sOp;
+
+   sOp.eOp = eOp;
+   sOp.pcPath = pcPath;
+   sOp.pvContents = pvContents;
+   sOp.ulLength = ulLength;
+   *pulLength = 0;
+   if(FTClient_call(oCClient, &sOp) != SUCCESS)
+      return NULL;
+   if(sOp.iStatus != SUCCESS || sOp.pvData == NULL) {
+      free(sOp.pvData);
+      return NULL;
+   }
+   *pulLength = sOp.ulSize;
+   return sOp.pvData;
+}
+
+void *FTClient_getFileContents(FTClient_T oCClient, const char *pcPath,
+                               size_t *pulLength) {
+   assert(pcPath != NULL);
+   assert(pulLength != NULL);
+   return FTClient_fetch(oCClient, OPFT_GET_CONTENTS, pcPath, NULL, 0,
+                         pulLength);
+}
+
+void *FTClient_replaceFileContents(FTClient_T oCClient, const char *pcPath,
+                                   const void *pvNewContents,
+                                   size_t ulLength, size_t *pulOldLength) {
+   assert(pcPath != NULL);
+   assert(pulOldLength != NULL);
+   return FTClient_fetch(oCClient, OPFT_REPLACE_CONTENTS, pcPath,
+                         pvNewContents, ulLength, pulOldLength);
+}
+
+char *FTClient_toString(FTClient_T oCClient) {
+   size_t ulLength;
+
+   return FTClient_fetch(oCClient, OPFT_TO_STRING, NULL, NULL, 0,
+                         &ulLength);
+}
@@ -0,0 +1,122 @@
+/*--------------------------------------------------------------------*/
+/* ftclient.h                                                         */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+#ifndef FTCLIENT_INCLUDED
+#define FTCLIENT_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+#include "opFT.h"
+
+/*
+  The client side of ftd: a connection to the FT an ftd daemon hosts,
+  with one function per ft.h function, taking the connection first.
+  Contents travel by value, so the functions that return contents
+  return a copy the caller owns and must free, and report its length.
+
+  Requests can also be sent in batches, several in one frame, with
+  FTClient_submit, which returns without waiting; any number of
+  batches may be in flight, and FTClient_complete collects their
+  results in the order they were submitted. The one-call functions
+  must not be used while batches are in flight.
+
+  A connection must only be used by one thread at a time.
+*/
+
+/* A connection to ftd */
+typedef struct FTClient *FTClient_T;
+
+/* The status a function returns when the connection has failed;
+   every later call on the connection fails the same way */
+enum { FTCLIENT_IO_ERROR = MEMORY_ERROR + 1 };
+
+/* One request of a batch */
+struct FTClient_Op {
+   /* set by the caller: the operation and its arguments; pcPath and
+      pvContents need only stay valid until FTClient_submit returns */
+   enum OpFT eOp;
+   const char *pcPath;
+   const void *pvContents;
+   size_t ulLength;
+
+   /* set by FTClient_complete: the status (for FT_containsDir and
+      FT_containsFile, the boolean result), whether the path is a
+      file and its size (for FT_stat), and, for the operations that
+      return contents or a string, a malloc'd copy that the caller
+      owns (NULL if there was none) and its length in ulSize */
+   int iStatus;
+   boolean bIsFile;
+   size_t ulSize;
+   void *pvData;
+};
+
+/*
+  Connects to the ftd listening at socket path pcSocket. Returns the
+  connection, or NULL if it could not be made.
+*/
+FTClient_T FTClient_connect(const char *pcSocket);
+
+/*
+  Closes oCClient, discarding the results of any batches still in
+  flight.
+*/
+void FTClient_close(FTClient_T oCClient);
+
+/*
+  Sends the ulCount requests of psOps to ftd as one frame, without
+  waiting for their results. Returns SUCCESS, MEMORY_ERROR, or
+  FTCLIENT_IO_ERROR.
+*/
+int FTClient_submit(FTClient_T oCClient, const struct FTClient_Op *psOps,
+                    size_t ulCount);
+
+/*
+  Waits for the results of the oldest batch in flight, which must
+  have been submitted from psOps with ulCount requests, and stores
+  them in psOps. Returns SUCCESS, MEMORY_ERROR, or FTCLIENT_IO_ERROR
+  (also if there is no batch in flight or ulCount does not match).
+*/
+int FTClient_complete(FTClient_T oCClient, struct FTClient_Op *psOps,
+                      size_t ulCount);
+
+/* The ft.h functions, run by ftd; they return FTCLIENT_IO_ERROR
+   (FALSE or NULL for the boolean and pointer ones) if the
+   connection fails */
+int FTClient_init(FTClient_T oCClient);
+int FTClient_destroy(FTClient_T oCClient);
+int FTClient_insertDir(FTClient_T oCClient, const char *pcPath);
+int FTClient_insertFile(FTClient_T oCClient, const char *pcPath,
+                        const void *pvContents, size_t ulLength);
+int FTClient_rmDir(FTClient_T oCClient, const char *pcPath);
+int FTClient_rmFile(FTClient_T oCClient, const char *pcPath);
+boolean FTClient_containsDir(FTClient_T oCClient, const char *pcPath);
+boolean FTClient_containsFile(FTClient_T oCClient, const char *pcPath);
+int FTClient_stat(FTClient_T oCClient, const char *pcPath,
+                  boolean *pbIsFile, size_t *pulSize);
+
+/*
+  Returns a copy of the contents of the file with absolute path
+  pcPath, and stores their length in *pulLength, or returns NULL if
+  they are empty or the request failed. The caller owns the copy.
+*/
+void *FTClient_getFileContents(FTClient_T oCClient, const char *pcPath,
+                               size_t *pulLength);
+
+/*
+  Replaces the contents of the file with absolute path pcPath with
+  the ulLength bytes at pvNewContents, and returns a copy of the old
+  contents, storing their length in *pulOldLength; returns NULL if
+  they were empty or the request failed. The caller owns the copy.
+*/
+void *FTClient_replaceFileContents(FTClient_T oCClient, const char *pcPath,
+                                   const void *pvNewContents,
+                                   size_t ulLength, size_t *pulOldLength);
+
+/*
+  Returns FT_toString of ftd's tree, which the caller owns, or NULL.
+*/
+char *FTClient_toString(FTClient_T oCClient);
+
+#endif
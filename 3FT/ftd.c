@@ -0,0 +1,847 @@
+/*--------------------------------------------------------------------*/
+/* ftd.c                                                              */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+/* epoll, eventfd and accept4 are Linux extensions */
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "a4def.h"
+#include "ft.h"
+#include "opFT.h"
+#include "wireFT.h"
+
+/*
+  ftd: hosts one thread-safe FT and serves the ft.h operations to
+  the processes of one host over a Unix domain socket, in the
+  protocol of wireFT.h, so that they can share one tree instead of
+  each embedding its own copy. ftclient.h is the client side.
+
+  usage: ftd [-s socketpath] [-w workers]
+
+  The main thread runs an epoll loop that accepts connections, reads
+  whole frames off them and writes results back. Frames are queued
+  on their connection, and a connection with queued frames is put on
+  the run queue, from which the worker threads take it and run its
+  frames in order. A connection is only ever run by one worker at a
+  time, so each client sees its requests done in the order it sent
+  them, while different clients' requests run in parallel under the
+  FT's own shared/exclusive lock. A worker appends each frame's
+  results to its connection's output and puts the connection on the
+  dirty list, waking the loop through an eventfd to write them out.
+
+  The FT keeps its own copies of files' contents, but
+  FT_getFileContents returns the FT's copy itself, which a concurrent
+  FT_replaceFileContents, FT_rmFile, FT_rmDir or FT_destroy would
+  free; sContentsLock keeps them out while a worker copies contents
+  into a result.
+*/
+
+/* Defaults for the options */
+#define DEFAULT_SOCKET "ftd.sock"
+enum { DEFAULT_WORKERS = 4 };
+
+/* Most epoll events handled per wait */
+enum { MAX_EVENTS = 64 };
+
+/* Bytes to make room for before each read */
+enum { READ_CHUNK = 65536 };
+
+/* A connection stops being read while it has this many frames
+   queued or this many bytes of results unsent, so that a client that
+   sends without reading cannot make ftd buffer without bound */
+enum { MAX_QUEUED = 64 };
+enum { MAX_OUTPUT = 16 << 20 };
+
+/* One frame waiting to be run, header included */
+struct frame {
+   struct frame *psNext;
+   size_t ulLength;
+   char acData[1];
+};
+
+/* One client connection */
+struct connection {
+   /* the socket, or -1 once closed; used by the loop only */
+   int iFd;
+   /* bytes read but not yet made into frames; loop only */
+   struct WireFT_Buffer sIn;
+   /* whether the socket is polled for reading and for writing;
+      loop only */
+   boolean bReading;
+   boolean bWriting;
+   /* TRUE while the socket is out of the epoll set because the client
+      hung up when it was not being read; loop only */
+   boolean bHungUp;
+
+   /* results not yet written, protected by sOutLock */
+   struct WireFT_Buffer sOut;
+   pthread_mutex_t sOutLock;
+
+   /* the rest is protected by sLock */
+   /* frames waiting to be run, oldest first */
+   struct frame *psFirst;
+   struct frame *psLast;
+   size_t ulQueued;
+   /* TRUE while on the run queue or being run by a worker */
+   boolean bRunnable;
+   /* TRUE while on the dirty list */
+   boolean bDirty;
+   /* TRUE once the loop has closed the socket */
+   boolean bClosed;
+   /* TRUE if a worker found the connection unusable */
+   boolean bBroken;
+   /* links of the run queue, the dirty list and the list of all
+      connections */
+   struct connection *psNextRun;
+   struct connection *psNextDirty;
+   struct connection *psPrevAll;
+   struct connection *psNextAll;
+};
+
+/* Protects the run queue, the dirty list, the list of all
+   connections and the fields of each connection marked above */
+static pthread_mutex_t sLock = PTHREAD_MUTEX_INITIALIZER;
+/* Signalled when a connection is put on the run queue */
+static pthread_cond_t sRunnable = PTHREAD_COND_INITIALIZER;
+static struct connection *psRunFirst;
+static struct connection *psRunLast;
+static struct connection *psDirty;
+static struct connection *psAll;
+/* Set when the workers are to stop */
+static boolean bStopping;
+
+/* Held shared while contents are copied into a result, and
+   exclusively by anything that may free contents */
+static pthread_rwlock_t sContentsLock = PTHREAD_RWLOCK_INITIALIZER;
+
+/* The epoll instance and the eventfd that wakes the loop */
+static int iEpollFd = -1;
+static int iWakeFd = -1;
+
+/* Set by the signal handler to stop the loop */
+static volatile sig_atomic_t iSignalled;
+
+/* What the epoll data of the listening socket and of the eventfd
+   point to, to tell them apart from connections */
+static char cListenMark;
+static char cWakeMark;
+
+/*---------------------------------------------------------------*/
+
+/*
+  Asks the loop to exit on SIGINT or SIGTERM, waking it with the
+  eventfd.
+*/
+static void FTD_onSignal(int iSignal) {
+   uint64_t ulOne = 1;
+
+   (void) iSignal;
+   iSignalled = 1;
+   if(write(iWakeFd, &ulOne, sizeof(ulOne)) < 0) {
+      /* the loop is already awake */
+   }
+}
+
+/*
+  Puts psConn on the dirty list, if it is not there already, and
+  wakes the loop. Called with sLock held.
+*/
+static void FTD_markDirty(struct connection *psConn) {
+   uint64_t ulOne = 1;
+
+   if(psConn->bDirty)
+      return;
+   psConn->bDirty = TRUE;
+   psConn->psNextDirty = psDirty;
+   psDirty = psConn;
+   if(write(iWakeFd, &ulOne, sizeof(ulOne)) < 0) {
+      /* the counter is already nonzero, so the loop will wake */
+   }
+}
+
+/*
+  Runs FT_getFileContents on pcPath and appends its result to
+  psReply. Returns FALSE if memory for the result could not be
+  allocated, TRUE otherwise.
+*/
+static int FTD_getContents(const char *pcPath,
+                           struct WireFT_Buffer *psReply) {
+   boolean bIsFile = FALSE;
+   size_t ulSize = 0;
+   void *pvContents;
+   int iStatus, bOk;
+
+   pthread_rwlock_rdlock(&sContentsLock);
+   iStatus = FT_stat(pcPath, &bIsFile, &ulSize);
+   if(iStatus == SUCCESS && !bIsFile)
+      iStatus = NOT_A_FILE;
+   if(iStatus != SUCCESS) {
+      pthread_rwlock_unlock(&sContentsLock);
+      return WireFT_putResult(psReply, iStatus, 0, NULL, 0);
+   }
+   pvContents = FT_getFileContents(pcPath);
+   bOk = WireFT_putResult(psReply, SUCCESS,
+                          pvContents != NULL ? WIREFT_DATA : 0,
+                          pvContents, ulSize);
+   pthread_rwlock_unlock(&sContentsLock);
+   return bOk;
+}
+
+/*
+  Runs FT_replaceFileContents on pcPath with the ulLength bytes at
+  pvContents, and appends its result, holding the old contents, to
+  psReply. Returns FALSE if memory for the
+  result could not be allocated, TRUE otherwise.
+*/
+static int FTD_replaceContents(const char *pcPath, void *pvContents,
+                               size_t ulLength,
+                               struct WireFT_Buffer *psReply) {
+   boolean bIsFile = FALSE;
+   size_t ulOldSize = 0;
+   void *pvOld;
+   int iStatus, bOk;
+
+   pthread_rwlock_wrlock(&sContentsLock);
+   iStatus = FT_stat(pcPath, &bIsFile, &ulOldSize);
+   if(iStatus == SUCCESS && !bIsFile)
+      iStatus = NOT_A_FILE;
+   if(iStatus != SUCCESS) {
+      pthread_rwlock_unlock(&sContentsLock);
+      return WireFT_putResult(psReply, iStatus, 0, NULL, 0);
+   }
+   /* the FT returns a copy of the old contents, so a NULL result
+      for a nonempty file can only mean the replacement failed */
+   pvOld = FT_replaceFileContents(pcPath, pvContents, ulLength);
+   if(pvOld == NULL && ulOldSize > 0) {
+      pthread_rwlock_unlock(&sContentsLock);
+      return WireFT_putResult(psReply, MEMORY_ERROR, 0, NULL, 0);
+   }
+   pthread_rwlock_unlock(&sContentsLock);
+
+   bOk = WireFT_putResult(psReply, SUCCESS, pvOld != NULL ? WIREFT_DATA : 0,
+                          pvOld, ulOldSize);
+   free(pvOld);
+   return bOk;
+}
+
+/*
+  Runs the request for operation eOp on pcPath (NULL for none), with
+  the ulLength bytes of contents at pvContents, and appends its
+  result to psReply. Returns FALSE if memory for the result could not
+  be allocated, TRUE otherwise.
+*/
+static int FTD_run(enum OpFT eOp, const char *pcPath, void *pvContents,
+                   size_t ulLength, struct WireFT_Buffer *psReply) {
+   boolean bIsFile = FALSE;
+   size_t ulSize = 0;
+   char *pcString;
+   int iStatus = SUCCESS, bOk;
+
+   if(pcPath == NULL && eOp != OPFT_INIT && eOp != OPFT_DESTROY &&
+      eOp != OPFT_TO_STRING)
+      return WireFT_putResult(psReply, BAD_PATH, 0, NULL, 0);
+
+   switch(eOp) {
+   case OPFT_INIT:
+      iStatus = FT_init();
+      break;
+   case OPFT_DESTROY:
+      pthread_rwlock_wrlock(&sContentsLock);
+      iStatus = FT_destroy();
+      pthread_rwlock_unlock(&sContentsLock);
+      break;
+   case OPFT_INSERT_DIR:
+      iStatus = FT_insertDir(pcPath);
+      break;
+   case OPFT_INSERT_FILE:
+      iStatus = FT_insertFile(pcPath, pvContents, ulLength);
+      break;
+   case OPFT_RM_DIR:
+      pthread_rwlock_wrlock(&sContentsLock);
+      iStatus = FT_rmDir(pcPath);
+      pthread_rwlock_unlock(&sContentsLock);
+      break;
+   case OPFT_RM_FILE:
+      pthread_rwlock_wrlock(&sContentsLock);
+      iStatus = FT_rmFile(pcPath);
+      pthread_rwlock_unlock(&sContentsLock);
+      break;
+   case OPFT_CONTAINS_DIR:
+      iStatus = FT_containsDir(pcPath);
+      break;
+   case OPFT_CONTAINS_FILE:
+      iStatus = FT_containsFile(pcPath);
+      break;
+   case OPFT_GET_CONTENTS:
+      return FTD_getContents(pcPath, psReply);
+   case OPFT_REPLACE_CONTENTS:
+      return FTD_replaceContents(pcPath, pvContents, ulLength, psReply);
+   case OPFT_STAT:
+      iStatus = FT_stat(pcPath, &bIsFile, &ulSize);
+      return WireFT_putResult(psReply, iStatus,
+                              bIsFile ? WIREFT_IS_FILE : 0, NULL,
+                              bIsFile ? ulSize : 0);
+   case OPFT_TO_STRING:
+      pcString = FT_toString();
+      bOk = WireFT_putResult(psReply, pcString != NULL ? SUCCESS
+                                                       : MEMORY_ERROR,
+                             pcString != NULL ? WIREFT_DATA : 0,
+                             pcString,
+                             pcString != NULL ? strlen(pcString) : 0);
+      free(pcString);
+      return bOk;
+   default:
+      iStatus = BAD_PATH;
+      break;
+   }
+   return WireFT_putResult(psReply, iStatus, 0, NULL, 0);
+}
+
+/*
+  Runs every request of psFrame, whose contents the FT only copies,
+  and appends the frame of results to psConn's output. Returns FALSE if the frame was malformed or memory
+  could not be allocated, in which case the connection must be
+  dropped, and TRUE otherwise.
+*/
+static int FTD_serve(struct connection *psConn, struct frame *psFrame) {
+   struct WireFT_Buffer sReply = {NULL, 0, 0, 0};
+   struct WireFT_Header sHeader;
+   const char *pcAt, *pcEnd, *pcPath;
+   const void *pvContents;
+   size_t ulStart, ulLength;
+   uint32_t uiIndex;
+   enum OpFT eOp;
+   int bOk;
+
+   memcpy(&sHeader, psFrame->acData, sizeof(sHeader));
+   pcAt = psFrame->acData + sizeof(sHeader);
+   pcEnd = psFrame->acData + psFrame->ulLength;
+
+   bOk = WireFT_beginFrame(&sReply, sHeader.uiTag, &ulStart);
+   for(uiIndex = 0; bOk && uiIndex < sHeader.uiCount; uiIndex++)
+      bOk = WireFT_getRequest(&pcAt, pcEnd, &eOp, &pcPath, &pvContents,
+                              &ulLength) &&
+            FTD_run(eOp, pcPath, (void *) pvContents, ulLength, &sReply);
+   bOk = bOk && pcAt == pcEnd &&
+         WireFT_endFrame(&sReply, ulStart, sHeader.uiCount);
+
+   if(bOk) {
+      pthread_mutex_lock(&psConn->sOutLock);
+      bOk = WireFT_append(&psConn->sOut, sReply.pcData, sReply.ulLength);
+      pthread_mutex_unlock(&psConn->sOutLock);
+   }
+   WireFT_free(&sReply);
+   return bOk;
+}
+
+/*
+  The body of each worker thread: takes connections off the run
+  queue and runs their queued frames, oldest first, until told to
+  stop.
+*/
+static void *FTD_work(void *pvUnused) {
+   struct connection *psConn;
+   struct frame *psFrame;
+   int bOk;
+
+   (void) pvUnused;
+   pthread_mutex_lock(&sLock);
+   for(;;) {
+      while(psRunFirst == NULL && !bStopping)
+         pthread_cond_wait(&sRunnable, &sLock);
+      if(bStopping)
+         break;
+
+      psConn = psRunFirst;
+      psRunFirst = psConn->psNextRun;
+      if(psRunFirst == NULL)
+         psRunLast = NULL;
+
+      while(!bStopping && !psConn->bBroken &&
+            (psFrame = psConn->psFirst) != NULL) {
+         psConn->psFirst = psFrame->psNext;
+         if(psConn->psFirst == NULL)
+            psConn->psLast = NULL;
+         psConn->ulQueued--;
+         pthread_mutex_unlock(&sLock);
+
+         bOk = FTD_serve(psConn, psFrame);
+         free(psFrame);
+
+         pthread_mutex_lock(&sLock);
+         if(!bOk)
+            psConn->bBroken = TRUE;
+         /* let the loop send each frame's results as soon as they
+            are ready */
+         FTD_markDirty(psConn);
+      }
+      psConn->bRunnable = FALSE;
+      FTD_markDirty(psConn);
+   }
+   pthread_mutex_unlock(&sLock);
+   return NULL;
+}
+
+/*---------------------------------------------------------------*/
+
+/*
+  Changes the events the loop polls psConn's socket for to match
+  psConn->bReading and psConn->bWriting. A socket taken out of the
+  set on a hang-up goes back in once it is to be read, so that the
+  read sees the end of file.
+*/
+static void FTD_poll(struct connection *psConn) {
+   struct epoll_event sEvent;
+   int iOp = EPOLL_CTL_MOD;
+
+   if(psConn->bHungUp) {
+      if(!psConn->bReading)
+         return;
+      psConn->bHungUp = FALSE;
+      iOp = EPOLL_CTL_ADD;
+   }
+   sEvent.events = (psConn->bReading ? EPOLLIN : 0) |
+                   (psConn->bWriting ? EPOLLOUT : 0);
+   sEvent.data.ptr = psConn;
+   (void) epoll_ctl(iEpollFd, iOp, psConn->iFd, &sEvent);
+}
+
+/*
+  Frees psConn, which must be closed and neither runnable nor dirty.
+  Called with sLock held.
+*/
+static void FTD_free(struct connection *psConn) {
+   struct frame *psFrame;
+
+   assert(psConn->bClosed && !psConn->bRunnable && !psConn->bDirty);
+
+   while((psFrame = psConn->psFirst) != NULL) {
+      psConn->psFirst = psFrame->psNext;
+      free(psFrame);
+   }
+   if(psConn->psPrevAll != NULL)
+      psConn->psPrevAll->psNextAll = psConn->psNextAll;
+   else
+      psAll = psConn->psNextAll;
+   if(psConn->psNextAll != NULL)
+      psConn->psNextAll->psPrevAll = psConn->psPrevAll;
+
+   WireFT_free(&psConn->sIn);
+   WireFT_free(&psConn->sOut);
+   pthread_mutex_destroy(&psConn->sOutLock);
+   free(psConn);
+}
+
+/*
+  Closes psConn's socket and drops its queued frames. psConn itself
+  is freed when the loop next takes it off the dirty list with no
+  worker running it, so that events already returned for it in the
+  current epoll batch still find it.
+*/
+static void FTD_close(struct connection *psConn) {
+   struct frame *psFrame;
+
+   if(psConn->iFd >= 0) {
+      (void) epoll_ctl(iEpollFd, EPOLL_CTL_DEL, psConn->iFd, NULL);
+      (void) close(psConn->iFd);
+      psConn->iFd = -1;
+   }
+
+   pthread_mutex_lock(&sLock);
+   psConn->bClosed = TRUE;
+   while((psFrame = psConn->psFirst) != NULL) {
+      psConn->psFirst = psFrame->psNext;
+      free(psFrame);
+   }
+   psConn->psLast = NULL;
+   psConn->ulQueued = 0;
+   FTD_markDirty(psConn);
+   pthread_mutex_unlock(&sLock);
+}
+
+/*
+  Returns TRUE if the loop should read more from psConn: it has few
+  enough frames queued and results unsent.
+*/
+static boolean FTD_canRead(struct connection *psConn) {
+   size_t ulQueued, ulUnsent;
+
+   pthread_mutex_lock(&sLock);
+   ulQueued = psConn->ulQueued;
+   pthread_mutex_unlock(&sLock);
+   pthread_mutex_lock(&psConn->sOutLock);
+   ulUnsent = psConn->sOut.ulLength;
+   pthread_mutex_unlock(&psConn->sOutLock);
+   return (boolean) (ulQueued < MAX_QUEUED && ulUnsent < MAX_OUTPUT);
+}
+
+/*
+  Writes as much of psConn's output as the socket takes, polling for
+  writability if some is left. Returns FALSE if the connection failed
+  and has been closed, TRUE otherwise.
+*/
+static int FTD_write(struct connection *psConn) {
+   ssize_t lWritten;
+   boolean bWriting;
+
+   pthread_mutex_lock(&psConn->sOutLock);
+   while(psConn->sOut.ulLength > 0) {
+      lWritten = write(psConn->iFd,
+                       psConn->sOut.pcData + psConn->sOut.ulHead,
+                       psConn->sOut.ulLength);
+      if(lWritten < 0) {
+         if(errno == EINTR)
+            continue;
+         if(errno == EAGAIN || errno == EWOULDBLOCK)
+            break;
+         pthread_mutex_unlock(&psConn->sOutLock);
+         FTD_close(psConn);
+         return FALSE;
+      }
+      WireFT_consume(&psConn->sOut, (size_t) lWritten);
+   }
+   bWriting = (boolean) (psConn->sOut.ulLength > 0);
+   pthread_mutex_unlock(&psConn->sOutLock);
+
+   if(bWriting != psConn->bWriting) {
+      psConn->bWriting = bWriting;
+      FTD_poll(psConn);
+   }
+   return TRUE;
+}
+
+/*
+  Queues every complete frame in psConn's input for the workers, and
+  puts psConn on the run queue if it is not there already. Returns
+  FALSE if a frame was invalid or memory could not be allocated, in
+  which case the connection must be closed, and TRUE otherwise.
+*/
+static int FTD_queueFrames(struct connection *psConn) {
+   struct WireFT_Header sHeader;
+   struct frame *psFrame;
+   size_t ulLength;
+
+   while((ulLength = WireFT_frameLength(&psConn->sIn, &sHeader)) > 0) {
+      if(ulLength == (size_t) -1)
+         return FALSE;
+      psFrame = malloc(offsetof(struct frame, acData) + ulLength);
+      if(psFrame == NULL)
+         return FALSE;
+      psFrame->psNext = NULL;
+      psFrame->ulLength = ulLength;
+      memcpy(psFrame->acData, psConn->sIn.pcData + psConn->sIn.ulHead,
+             ulLength);
+      WireFT_consume(&psConn->sIn, ulLength);
+
+      pthread_mutex_lock(&sLock);
+      if(psConn->psLast != NULL)
+         psConn->psLast->psNext = psFrame;
+      else
+         psConn->psFirst = psFrame;
+      psConn->psLast = psFrame;
+      psConn->ulQueued++;
+      if(!psConn->bRunnable) {
+         psConn->bRunnable = TRUE;
+         psConn->psNextRun = NULL;
+         if(psRunLast != NULL)
+            psRunLast->psNextRun = psConn;
+         else
+            psRunFirst = psConn;
+         psRunLast = psConn;
+         pthread_cond_signal(&sRunnable);
+      }
+      pthread_mutex_unlock(&sLock);
+   }
+   return TRUE;
+}
+
+/*
+  Reads what psConn's socket has, queueing the frames it completes,
+  until it has no more or psConn has as much work outstanding as it
+  may. Closes psConn at end of file or on an error.
+*/
+static void FTD_read(struct connection *psConn) {
+   ssize_t lRead;
+
+   while(FTD_canRead(psConn)) {
+      if(!WireFT_reserve(&psConn->sIn, READ_CHUNK)) {
+         FTD_close(psConn);
+         return;
+      }
+      lRead = read(psConn->iFd, psConn->sIn.pcData + psConn->sIn.ulHead +
+                      psConn->sIn.ulLength,
+                   psConn->sIn.ulSize - psConn->sIn.ulHead -
+                      psConn->sIn.ulLength);
+      if(lRead < 0 && errno == EINTR)
+         continue;
+      if(lRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+         return;
+      if(lRead <= 0) {
+         FTD_close(psConn);
+         return;
+      }
+      psConn->sIn.ulLength += (size_t) lRead;
+      if(!FTD_queueFrames(psConn)) {
+         FTD_close(psConn);
+         return;
+      }
+   }
+
+   /* stop reading until the workers and the client catch up */
+   psConn->bReading = FALSE;
+   FTD_poll(psConn);
+}
+
+/*
+  Handles every connection on the dirty list: frees those that are
+  closed and finished with, closes those a worker found broken,
+  writes out the results of the rest and resumes reading from those
+  that have caught up.
+*/
+static void FTD_flushDirty(void) {
+   struct connection *psConn, *psNext;
+
+   pthread_mutex_lock(&sLock);
+   psConn = psDirty;
+   psDirty = NULL;
+   pthread_mutex_unlock(&sLock);
+
+   for(; psConn != NULL; psConn = psNext) {
+      /* a worker may put psConn back on the list as soon as it is
+         no longer marked, which overwrites psNextDirty */
+      pthread_mutex_lock(&sLock);
+      psNext = psConn->psNextDirty;
+      psConn->bDirty = FALSE;
+      if(psConn->bClosed) {
+         if(!psConn->bRunnable)
+            FTD_free(psConn);
+         pthread_mutex_unlock(&sLock);
+         continue;
+      }
+      if(psConn->bBroken) {
+         pthread_mutex_unlock(&sLock);
+         FTD_close(psConn);
+         continue;
+      }
+      pthread_mutex_unlock(&sLock);
+
+      if(!FTD_write(psConn))
+         continue;
+      if(!psConn->bReading && FTD_canRead(psConn)) {
+         psConn->bReading = TRUE;
+         FTD_poll(psConn);
+      }
+   }
+}
+
+/*
+  Accepts every pending connection on listening socket iListenFd.
+*/
+static void FTD_accept(int iListenFd) {
+   struct connection *psConn;
+   struct epoll_event sEvent;
+   int iFd;
+
+   while((iFd = accept4(iListenFd, NULL, NULL,
+                        SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+      psConn = calloc(1, sizeof(*psConn));
+      if(psConn == NULL) {
+         (void) close(iFd);
+         continue;
+      }
+      psConn->iFd = iFd;
+      psConn->bReading = TRUE;
+      pthread_mutex_init(&psConn->sOutLock, NULL);
+
+      sEvent.events = EPOLLIN;
+      sEvent.data.ptr = psConn;
+      if(epoll_ctl(iEpollFd, EPOLL_CTL_ADD, iFd, &sEvent) < 0) {
+         pthread_mutex_destroy(&psConn->sOutLock);
+         free(psConn);
+         (void) close(iFd);
+         continue;
+      }
+
+      pthread_mutex_lock(&sLock);
+      psConn->psNextAll = psAll;
+      if(psAll != NULL)
+         psAll->psPrevAll = psConn;
+      psAll = psConn;
+      pthread_mutex_unlock(&sLock);
+   }
+}
+
+/*
+  Creates the listening socket at pcSocket, replacing any stale one.
+  Returns it, or -1 after reporting why it could not be created.
+*/
+static int FTD_listen(const char *pcSocket) {
+   struct sockaddr_un sAddr;
+   int iFd;
+
+   if(strlen(pcSocket) >= sizeof(sAddr.sun_path)) {
+      fprintf(stderr, "ftd: socket path too long: %s\n", pcSocket);
+      return -1;
+   }
+   memset(&sAddr, 0, sizeof(sAddr));
+   sAddr.sun_family = AF_UNIX;
+   strcpy(sAddr.sun_path, pcSocket);
+
+   iFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+   if(iFd < 0) {
+      perror("ftd: socket");
+      return -1;
+   }
+   (void) unlink(pcSocket);
+   if(bind(iFd, (struct sockaddr *) &sAddr, sizeof(sAddr)) < 0 ||
+      listen(iFd, SOMAXCONN) < 0) {
+      perror("ftd: bind");
+      (void) close(iFd);
+      return -1;
+   }
+   return iFd;
+}
+
+/*
+  Runs the daemon until SIGINT or SIGTERM. Returns 0 on a clean
+  shutdown, 1 on an error.
+*/
+int main(int argc, char **argv) {
+   const char *pcSocket = DEFAULT_SOCKET;
+   size_t ulWorkers = DEFAULT_WORKERS, ulIndex, ulStarted;
+   pthread_t *psThreads;
+   struct epoll_event asEvents[MAX_EVENTS], sEvent;
+   struct sigaction sAction;
+   struct connection *psConn;
+   uint64_t ulCount;
+   int iListenFd, iEvents, iEvent, iOpt;
+   boolean bWoken;
+
+   while((iOpt = getopt(argc, argv, "s:w:")) != -1) {
+      if(iOpt == 's')
+         pcSocket = optarg;
+      else if(iOpt == 'w' && atol(optarg) > 0)
+         ulWorkers = (size_t) atol(optarg);
+      else {
+         fprintf(stderr, "usage: %s [-s socketpath] [-w workers]\n",
+                 argv[0]);
+         return 1;
+      }
+   }
+
+   if(FT_init() != SUCCESS)
+      return 1;
+
+   iListenFd = FTD_listen(pcSocket);
+   if(iListenFd < 0)
+      return 1;
+   iEpollFd = epoll_create1(EPOLL_CLOEXEC);
+   iWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+   if(iEpollFd < 0 || iWakeFd < 0) {
+      perror("ftd: epoll");
+      return 1;
+   }
+   sEvent.events = EPOLLIN;
+   sEvent.data.ptr = &cListenMark;
+   (void) epoll_ctl(iEpollFd, EPOLL_CTL_ADD, iListenFd, &sEvent);
+   sEvent.data.ptr = &cWakeMark;
+   (void) epoll_ctl(iEpollFd, EPOLL_CTL_ADD, iWakeFd, &sEvent);
+
+   memset(&sAction, 0, sizeof(sAction));
+   sAction.sa_handler = FTD_onSignal;
+   (void) sigaction(SIGINT, &sAction, NULL);
+   (void) sigaction(SIGTERM, &sAction, NULL);
+   sAction.sa_handler = SIG_IGN;
+   (void) sigaction(SIGPIPE, &sAction, NULL);
+
+   psThreads = calloc(ulWorkers, sizeof(*psThreads));
+   if(psThreads == NULL)
+      return 1;
+   for(ulStarted = 0; ulStarted < ulWorkers; ulStarted++)
+      if(pthread_create(&psThreads[ulStarted], NULL, FTD_work, NULL) != 0)
+         break;
+   if(ulStarted == 0)
+      return 1;
+   fprintf(stderr, "ftd: serving %s with %lu workers\n", pcSocket,
+           (unsigned long) ulStarted);
+
+   while(!iSignalled) {
+      iEvents = epoll_wait(iEpollFd, asEvents, MAX_EVENTS, -1);
+      if(iEvents < 0 && errno != EINTR) {
+         perror("ftd: epoll_wait");
+         break;
+      }
+      bWoken = FALSE;
+      for(iEvent = 0; iEvent < iEvents; iEvent++) {
+         if(asEvents[iEvent].data.ptr == &cListenMark)
+            FTD_accept(iListenFd);
+         else if(asEvents[iEvent].data.ptr == &cWakeMark)
+            bWoken = TRUE;
+         else {
+            psConn = asEvents[iEvent].data.ptr;
+            /* connections are only freed by the flush below, so one
+               closed earlier in this batch is still here */
+            if(psConn->iFd >= 0 &&
+               (asEvents[iEvent].events & EPOLLOUT))
+               (void) FTD_write(psConn);
+            /* EPOLLHUP and EPOLLERR come whatever the mask, so one
+               not being read would wake the loop until its workers
+               are done; leave it out of the set until then */
+            if(psConn->iFd >= 0 && !psConn->bReading &&
+               (asEvents[iEvent].events & (EPOLLHUP | EPOLLERR))) {
+               (void) epoll_ctl(iEpollFd, EPOLL_CTL_DEL, psConn->iFd, NULL);
+               psConn->bHungUp = TRUE;
+            }
+            else if(psConn->iFd >= 0 &&
+               (asEvents[iEvent].events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+               FTD_read(psConn);
+         }
+      }
+      if(bWoken) {
+         if(read(iWakeFd, &ulCount, sizeof(ulCount)) < 0) {
+            /* nothing to drain */
+         }
+         FTD_flushDirty();
+      }
+   }
+
+   /* stop the workers, then drop every connection */
+   pthread_mutex_lock(&sLock);
+   bStopping = TRUE;
+   pthread_cond_broadcast(&sRunnable);
+   pthread_mutex_unlock(&sLock);
+   for(ulIndex = 0; ulIndex < ulStarted; ulIndex++)
+      pthread_join(psThreads[ulIndex], NULL);
+   free(psThreads);
+
+   pthread_mutex_lock(&sLock);
+   while((psConn = psAll) != NULL) {
+      if(psConn->iFd >= 0)
+         (void) close(psConn->iFd);
+      psConn->bClosed = TRUE;
+      psConn->bRunnable = FALSE;
+      psConn->bDirty = FALSE;
+      FTD_free(psConn);
+   }
+   pthread_mutex_unlock(&sLock);
+
+   (void) close(iListenFd);
+   (void) unlink(pcSocket);
+   (void) close(iWakeFd);
+   (void) close(iEpollFd);
+   (void) FT_destroy();
+   return 0;
+}
@@ -0,0 +1,210 @@
+/*--------------------------------------------------------------------*/
+/* ftd_client.c                                                       */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+/* prctl is a Linux extension, as is ftd's epoll */
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "ftclient.h"
+
+/*
+  Tests ftd and ftclient.c: starts ./ftd on a private socket, runs
+  the ft.h operations through one connection, singly and in
+  pipelined batches, and checks that a second connection sees the
+  same tree. Prints the tree along the way to stderr.
+*/
+
+/* Batches kept in flight at once by the pipelining check */
+enum { PIPELINE_DEPTH = 1000 };
+
+/* Starts ./ftd serving pcSocket and returns its pid. ftd is stopped
+   if this process dies, so that a failed check does not leave it
+   running. */
+static pid_t startServer(const char *pcSocket) {
+   pid_t iPid;
+
+   iPid = fork();
+   assert(iPid >= 0);
+   if(iPid == 0) {
+      (void) prctl(PR_SET_PDEATHSIG, SIGTERM);
+      execl("./ftd", "ftd", "-s", pcSocket, "-w", "2", (char *) NULL);
+      perror("./ftd");
+      _exit(1);
+   }
+   return iPid;
+}
+
+/* Connects to pcSocket, waiting up to a few seconds for ftd to
+   start listening */
+static FTClient_T connectServer(const char *pcSocket) {
+   struct timespec sDelay = {0, 10000000};
+   FTClient_T oCClient;
+   int iTry;
+
+   for(iTry = 0; iTry < 500; iTry++) {
+      oCClient = FTClient_connect(pcSocket);
+      if(oCClient != NULL)
+         return oCClient;
+      (void) nanosleep(&sDelay, NULL);
+   }
+   return NULL;
+}
+
+/* Checks the one-call functions against ftd's fresh tree */
+static void testSingle(FTClient_T oCClient) {
+   boolean bIsFile;
+   size_t ulSize;
+   char *pcData;
+
+   /* ftd starts with its tree initialized */
+   assert(FTClient_init(oCClient) == INITIALIZATION_ERROR);
+   assert(FTClient_destroy(oCClient) == SUCCESS);
+   assert(FTClient_insertDir(oCClient, "1root") == INITIALIZATION_ERROR);
+   assert(FTClient_init(oCClient) == SUCCESS);
+   assert(FTClient_init(oCClient) == INITIALIZATION_ERROR);
+
+   assert(FTClient_insertDir(oCClient, "1root//2child") == BAD_PATH);
+   assert(FTClient_insertFile(oCClient, "A", NULL, 0) == CONFLICTING_PATH);
+   assert(FTClient_insertDir(oCClient, "1root/2child") == SUCCESS);
+   assert(FTClient_insertDir(oCClient, "1root/2child") == ALREADY_IN_TREE);
+   assert(FTClient_insertFile(oCClient, "1root/2child/C", "Ritchie",
+                              strlen("Ritchie") + 1) == SUCCESS);
+   assert(FTClient_insertFile(oCClient, "1root/empty", NULL, 0) == SUCCESS);
+   assert(FTClient_containsDir(oCClient, "1root/2child") == TRUE);
+   assert(FTClient_containsFile(oCClient, "1root/2child") == FALSE);
+   assert(FTClient_containsFile(oCClient, "1root/2child/C") == TRUE);
+   assert(FTClient_insertDir(oCClient, "1root/2child/C/x") ==
+          NOT_A_DIRECTORY);
+
+   assert(FTClient_stat(oCClient, "1root/2child/C", &bIsFile, &ulSize) ==
+          SUCCESS);
+   assert(bIsFile == TRUE && ulSize == strlen("Ritchie") + 1);
+   assert(FTClient_stat(oCClient, "1root/2child", &bIsFile, &ulSize) ==
+          SUCCESS);
+   assert(bIsFile == FALSE);
+   assert(FTClient_stat(oCClient, "1root/none", &bIsFile, &ulSize) ==
+          NO_SUCH_PATH);
+
+   /* contents come back as copies the caller owns */
+   pcData = FTClient_getFileContents(oCClient, "1root/2child/C", &ulSize);
+   assert(pcData != NULL && ulSize == strlen("Ritchie") + 1);
+   assert(!strcmp(pcData, "Ritchie"));
+   free(pcData);
+   assert(FTClient_getFileContents(oCClient, "1root/empty", &ulSize) ==
+          NULL);
+   pcData = FTClient_replaceFileContents(oCClient, "1root/2child/C",
+                                         "Thompson",
+                                         strlen("Thompson") + 1, &ulSize);
+   assert(pcData != NULL && !strcmp(pcData, "Ritchie"));
+   free(pcData);
+   pcData = FTClient_getFileContents(oCClient, "1root/2child/C", &ulSize);
+   assert(pcData != NULL && !strcmp(pcData, "Thompson"));
+   free(pcData);
+
+   pcData = FTClient_toString(oCClient);
+   assert(pcData != NULL);
+   fprintf(stderr, "Checkpoint 1:\n%s\n", pcData);
+   assert(!strcmp(pcData,
+                  "Dir:  1root\nFile: 1root/empty\n"
+                  "Dir:  1root/2child\nFile: 1root/2child/C\n"));
+   free(pcData);
+
+   assert(FTClient_rmDir(oCClient, "1root/2child/C") == NOT_A_DIRECTORY);
+   assert(FTClient_rmFile(oCClient, "1root/2child/C") == SUCCESS);
+   assert(FTClient_rmFile(oCClient, "1root/2child/C") == NO_SUCH_PATH);
+}
+
+/* Checks batches, one at a time and many in flight at once */
+static void testBatches(FTClient_T oCClient) {
+   struct FTClient_Op asOps[4];
+   struct FTClient_Op *psPipe;
+   char acPath[64];
+   size_t ulIndex;
+
+   memset(asOps, 0, sizeof(asOps));
+   asOps[0].eOp = OPFT_INSERT_FILE;
+   asOps[0].pcPath = "1root/2child/B";
+   asOps[0].pvContents = "Kernighan";
+   asOps[0].ulLength = strlen("Kernighan") + 1;
+   asOps[1].eOp = OPFT_CONTAINS_FILE;
+   asOps[1].pcPath = "1root/2child/B";
+   asOps[2].eOp = OPFT_GET_CONTENTS;
+   asOps[2].pcPath = "1root/2child/B";
+   asOps[3].eOp = OPFT_STAT;
+   asOps[3].pcPath = "1root/2child/B";
+   assert(FTClient_submit(oCClient, asOps, 4) == SUCCESS);
+   assert(FTClient_complete(oCClient, asOps, 4) == SUCCESS);
+   assert(asOps[0].iStatus == SUCCESS);
+   assert(asOps[1].iStatus == TRUE);
+   assert(asOps[2].pvData != NULL && !strcmp(asOps[2].pvData, "Kernighan"));
+   assert(asOps[3].iStatus == SUCCESS && asOps[3].bIsFile == TRUE &&
+          asOps[3].ulSize == strlen("Kernighan") + 1);
+   free(asOps[2].pvData);
+
+   /* many batches in flight, completed in the order submitted */
+   psPipe = calloc(PIPELINE_DEPTH, sizeof(*psPipe));
+   assert(psPipe != NULL);
+   for(ulIndex = 0; ulIndex < PIPELINE_DEPTH; ulIndex++) {
+      sprintf(acPath, "1root/pipe/%lu", (unsigned long) ulIndex);
+      psPipe[ulIndex].eOp = OPFT_INSERT_DIR;
+      psPipe[ulIndex].pcPath = acPath;
+      assert(FTClient_submit(oCClient, &psPipe[ulIndex], 1) == SUCCESS);
+   }
+   for(ulIndex = 0; ulIndex < PIPELINE_DEPTH; ulIndex++) {
+      assert(FTClient_complete(oCClient, &psPipe[ulIndex], 1) == SUCCESS);
+      assert(psPipe[ulIndex].iStatus == SUCCESS);
+   }
+   /* with nothing in flight there is nothing to complete */
+   assert(FTClient_complete(oCClient, psPipe, 1) == FTCLIENT_IO_ERROR);
+   free(psPipe);
+}
+
+/* Runs the checks against a private ftd. Returns 0. */
+int main(void) {
+   char acSocket[64];
+   FTClient_T oCClient, oCOther;
+   pid_t iPid;
+   int iStatus;
+   char *pcData;
+
+   sprintf(acSocket, "ftd_client.%ld.sock", (long) getpid());
+   iPid = startServer(acSocket);
+   oCClient = connectServer(acSocket);
+   assert(oCClient != NULL);
+
+   testSingle(oCClient);
+   testBatches(oCClient);
+
+   /* a second connection shares the tree */
+   oCOther = FTClient_connect(acSocket);
+   assert(oCOther != NULL);
+   assert(FTClient_containsDir(oCOther, "1root/pipe/999") == TRUE);
+   assert(FTClient_containsFile(oCOther, "1root/2child/B") == TRUE);
+   FTClient_close(oCOther);
+
+   assert(FTClient_rmDir(oCClient, "1root/pipe") == SUCCESS);
+   pcData = FTClient_toString(oCClient);
+   assert(pcData != NULL);
+   fprintf(stderr, "Checkpoint 2:\n%s\n", pcData);
+   free(pcData);
+   assert(FTClient_destroy(oCClient) == SUCCESS);
+   assert(FTClient_destroy(oCClient) == INITIALIZATION_ERROR);
+   FTClient_close(oCClient);
+
+   assert(kill(iPid, SIGTERM) == 0);
+   assert(waitpid(iPid, &iStatus, 0) == iPid);
+   assert(WIFEXITED(iStatus) && WEXITSTATUS(iStatus) == 0);
+   return 0;
+}
@@ -0,0 +1,88 @@
+/*--------------------------------------------------------------------*/
+/* heat_client.c                                                      */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "ft.h"
+
+/*
+  Tests FT_hotspots: looks up three directories different numbers of
+  times and checks that FT_hotspots lists them hottest first, with a
+  lookup of a file counted at its directory and every lookup counted
+  as passing through 1root. Built without -DFT_HEAT, checks instead
+  that FT_hotspots finds nothing. Prints the hotspots to stderr.
+*/
+
+/* Directories looked up, and how often each is looked up */
+enum { DIRS = 3 };
+static const char *apcDirs[DIRS] = {"1root/a", "1root/b", "1root/c"};
+static const size_t aulLookups[DIRS] = {20, 30, 10};
+
+/* Hotspots asked for: more than there are directories */
+enum { ASKED = 8 };
+
+/* Runs the checks. Returns 0. */
+int main(void) {
+   struct FT_Hotspot asHot[ASKED];
+   size_t ulDir, ulIndex, ulFound;
+   char acFile[32];
+
+   assert(FT_hotspots(ASKED, asHot, &ulFound) == INITIALIZATION_ERROR);
+   assert(ulFound == 0);
+
+   assert(FT_init() == SUCCESS);
+   assert(FT_hotspots(ASKED, asHot, &ulFound) == SUCCESS);
+   assert(ulFound == 0);
+   assert(FT_insertDir("1root") == SUCCESS);
+   for(ulDir = 0; ulDir < DIRS; ulDir++) {
+      sprintf(acFile, "%s/f", apcDirs[ulDir]);
+      assert(FT_insertFile(acFile, NULL, 0) == SUCCESS);
+   }
+
+   /* half the lookups are of the directory, half of its file */
+   for(ulDir = 0; ulDir < DIRS; ulDir++) {
+      sprintf(acFile, "%s/f", apcDirs[ulDir]);
+      for(ulIndex = 0; ulIndex < aulLookups[ulDir]; ulIndex++)
+         assert(ulIndex % 2 == 0 ? FT_containsDir(apcDirs[ulDir])
+                                 : FT_containsFile(acFile));
+   }
+
+   assert(FT_hotspots(0, NULL, &ulFound) == SUCCESS);
+   assert(ulFound == 0);
+   assert(FT_hotspots(ASKED, asHot, &ulFound) == SUCCESS);
+   for(ulIndex = 0; ulIndex < ulFound; ulIndex++)
+      fprintf(stderr, "%-10s ended %3lu through %3lu\n",
+              asHot[ulIndex].pcPath, asHot[ulIndex].ulEnded,
+              asHot[ulIndex].ulThrough);
+
+#ifdef FT_HEAT
+   /* 1root and its three directories */
+   assert(ulFound == DIRS + 1);
+   assert(!strcmp(asHot[0].pcPath, "1root/b"));
+   assert(!strcmp(asHot[1].pcPath, "1root/a"));
+   assert(!strcmp(asHot[2].pcPath, "1root/c"));
+   assert(!strcmp(asHot[3].pcPath, "1root"));
+   for(ulIndex = 0; ulIndex < DIRS; ulIndex++) {
+      assert(asHot[ulIndex].ulEnded == 10 * (DIRS - ulIndex));
+      assert(asHot[ulIndex].ulThrough == 0);
+   }
+   assert(asHot[3].ulThrough == 20 + 30 + 10);
+   for(ulIndex = 0; ulIndex < ulFound; ulIndex++)
+      free(asHot[ulIndex].pcPath);
+
+   /* asked for fewer, only the hottest are kept */
+   assert(FT_hotspots(1, asHot, &ulFound) == SUCCESS);
+   assert(ulFound == 1 && !strcmp(asHot[0].pcPath, "1root/b"));
+   free(asHot[0].pcPath);
+#else
+   assert(ulFound == 0);
+#endif
+
+   assert(FT_destroy() == SUCCESS);
+   return 0;
+}
@@ -0,0 +1,246 @@
+/*--------------------------------------------------------------------*/
+/* histFT.c                                                           */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include "histFT.h"
+
+/* Number of sub-buckets per power of two is 2^SUB_BITS */
+enum { SUB_BITS = 4, SUB_COUNT = 1 << SUB_BITS };
+
+/* Values of 2^(MAX_MSB+1) ns (about 73 min) or more share a bucket */
+enum { MAX_MSB = 41 };
+
+/* Total number of buckets needed to cover [0, 2^(MAX_MSB+1)) */
+enum { NUM_BUCKETS = (MAX_MSB - SUB_BITS + 2) * SUB_COUNT };
+
+/* Number of shards that recording threads are spread across */
+enum { NUM_SHARDS = 8 };
+
+/* The histograms recorded by one group of threads */
+struct shard {
+   /* per-operation bucket counts */
+   unsigned long aulBuckets[OPFT_COUNT][NUM_BUCKETS];
+   /* per-operation sum of recorded values, for the mean */
+   unsigned long aulSum[OPFT_COUNT];
+   /* per-operation largest recorded value */
+   unsigned long aulMax[OPFT_COUNT];
+};
+
+/* All shards; recording threads are assigned round-robin */
+static struct shard asShards[NUM_SHARDS];
+
+/* The next shard to hand out to a thread recording for the first time */
+static unsigned long ulNextShard;
+
+/* This thread's shard, or NULL if it has not recorded yet */
+static __thread struct shard *psMyShard;
+
+/*
+  Returns the bucket that holds value ulValue.
+*/
+static size_t HistFT_bucketOf(unsigned long ulValue) {
+   size_t ulMsb, ulShift;
+
+   if(ulValue < (unsigned long) SUB_COUNT)
+      return (size_t) ulValue;
+
+   ulMsb = (size_t) (63 - __builtin_clzl(ulValue));
+   if(ulMsb > (size_t) MAX_MSB)
+      return NUM_BUCKETS - 1;
+
+   ulShift = ulMsb - SUB_BITS;
+   return (ulShift + 1) * SUB_COUNT +
+          (size_t) ((ulValue >> ulShift) - SUB_COUNT);
+}
+
+/*
+  Returns the largest value that falls into bucket ulBucket.
+*/
+static unsigned long HistFT_bucketHigh(size_t ulBucket) {
+   size_t ulShift;
+   unsigned long ulMantissa;
+
+   assert(ulBucket < (size_t) NUM_BUCKETS);
+
+   if(ulBucket < (size_t) (2 * SUB_COUNT))
+      return (unsigned long) ulBucket;
+
+   ulShift = ulBucket / SUB_COUNT - 1;
+   ulMantissa = (unsigned long) (ulBucket % SUB_COUNT + SUB_COUNT);
+   return ((ulMantissa + 1) << ulShift) - 1;
+}
+
+/*
+  Returns this thread's shard, assigning one on first use.
+*/
+static struct shard *HistFT_myShard(void) {
+   if(psMyShard == NULL)
+      psMyShard = &asShards[__atomic_fetch_add(&ulNextShard, 1,
+                                               __ATOMIC_RELAXED)
+                            % NUM_SHARDS];
+   return psMyShard;
+}
+
+/*
+  Merges every shard's buckets for eOp into aulMerged (which must have
+  NUM_BUCKETS elements). Returns the total count.
+*/
+static unsigned long HistFT_merge(enum OpFT eOp,
+                                  unsigned long *aulMerged) {
+   size_t ulShard, ulBucket;
+   unsigned long ulTotal = 0;
+
+   assert(aulMerged != NULL);
+
+   memset(aulMerged, 0, NUM_BUCKETS * sizeof(unsigned long));
+   for(ulShard = 0; ulShard < NUM_SHARDS; ulShard++)
+      for(ulBucket = 0; ulBucket < NUM_BUCKETS; ulBucket++) {
+         unsigned long ulCount = __atomic_load_n(
+            &asShards[ulShard].aulBuckets[eOp][ulBucket],
+            __ATOMIC_RELAXED);
+         aulMerged[ulBucket] += ulCount;
+         ulTotal += ulCount;
+      }
+   return ulTotal;
+}
+
+/*
+  Returns the value at dPercentile within merged buckets aulMerged
+  holding ulTotal values, capped at ulMax.
+*/
+static unsigned long HistFT_valueAt(const unsigned long *aulMerged,
+                                    unsigned long ulTotal,
+                                    unsigned long ulMax,
+                                    double dPercentile) {
+   unsigned long ulRank, ulSeen = 0;
+   size_t ulBucket;
+
+   assert(aulMerged != NULL);
+
+   if(ulTotal == 0)
+      return 0;
+
+   /* the rank of the value we want, counting from 1 */
+   ulRank = (unsigned long) (dPercentile / 100.0 * (double) ulTotal
+                             + 0.5);
+   if(ulRank < 1)
+      ulRank = 1;
+   if(ulRank > ulTotal)
+      ulRank = ulTotal;
+
+   for(ulBucket = 0; ulBucket < NUM_BUCKETS; ulBucket++) {
+      ulSeen += aulMerged[ulBucket];
+      if(ulSeen >= ulRank) {
+         unsigned long ulHigh = HistFT_bucketHigh(ulBucket);
+         return ulHigh < ulMax ? ulHigh : ulMax;
+      }
+   }
+   return ulMax;
+}
+
+/*
+  Returns the largest value recorded for eOp across all shards.
+*/
+static unsigned long HistFT_max(enum OpFT eOp) {
+   size_t ulShard;
+   unsigned long ulMax = 0;
+
+   for(ulShard = 0; ulShard < NUM_SHARDS; ulShard++) {
+      unsigned long ulShardMax =
+         __atomic_load_n(&asShards[ulShard].aulMax[eOp],
+                         __ATOMIC_RELAXED);
+      if(ulShardMax > ulMax)
+         ulMax = ulShardMax;
+   }
+   return ulMax;
+}
+
+void HistFT_record(enum OpFT eOp, unsigned long ulNanos) {
+   struct shard *psShard;
+   unsigned long ulOldMax;
+
+   assert((size_t) eOp < (size_t) OPFT_COUNT);
+
+   psShard = HistFT_myShard();
+   (void) __atomic_fetch_add(
+      &psShard->aulBuckets[eOp][HistFT_bucketOf(ulNanos)], 1,
+      __ATOMIC_RELAXED);
+   (void) __atomic_fetch_add(&psShard->aulSum[eOp], ulNanos,
+                             __ATOMIC_RELAXED);
+
+   ulOldMax = __atomic_load_n(&psShard->aulMax[eOp], __ATOMIC_RELAXED);
+   while(ulNanos > ulOldMax &&
+         !__atomic_compare_exchange_n(&psShard->aulMax[eOp], &ulOldMax,
+                                      ulNanos, 0, __ATOMIC_RELAXED,
+                                      __ATOMIC_RELAXED))
+      ;
+}
+
+unsigned long HistFT_getCount(enum OpFT eOp) {
+   unsigned long aulMerged[NUM_BUCKETS];
+
+   assert((size_t) eOp < (size_t) OPFT_COUNT);
+
+   return HistFT_merge(eOp, aulMerged);
+}
+
+unsigned long HistFT_percentile(enum OpFT eOp, double dPercentile) {
+   unsigned long aulMerged[NUM_BUCKETS];
+   unsigned long ulTotal;
+
+   assert((size_t) eOp < (size_t) OPFT_COUNT);
+
+   ulTotal = HistFT_merge(eOp, aulMerged);
+   return HistFT_valueAt(aulMerged, ulTotal, HistFT_max(eOp),
+                         dPercentile);
+}
+
+void HistFT_dump(FILE *psFile) {
+   unsigned long aulMerged[NUM_BUCKETS];
+   unsigned long ulTotal, ulMax, ulSum;
+   size_t ulOp, ulShard;
+
+   assert(psFile != NULL);
+
+   fprintf(psFile, "%-24s %10s %10s %10s %10s %10s %10s %10s\n",
+           "operation (ns)", "count", "mean", "p50", "p90", "p99",
+           "p99.9", "max");
+   for(ulOp = 0; ulOp < OPFT_COUNT; ulOp++) {
+      ulTotal = HistFT_merge((enum OpFT) ulOp, aulMerged);
+      if(ulTotal == 0)
+         continue;
+
+      ulMax = HistFT_max((enum OpFT) ulOp);
+      ulSum = 0;
+      for(ulShard = 0; ulShard < NUM_SHARDS; ulShard++)
+         ulSum += __atomic_load_n(&asShards[ulShard].aulSum[ulOp],
+                                  __ATOMIC_RELAXED);
+
+      fprintf(psFile, "%-24s %10lu %10lu %10lu %10lu %10lu %10lu %10lu\n",
+              OpFT_name((enum OpFT) ulOp), ulTotal, ulSum / ulTotal,
+              HistFT_valueAt(aulMerged, ulTotal, ulMax, 50.0),
+              HistFT_valueAt(aulMerged, ulTotal, ulMax, 90.0),
+              HistFT_valueAt(aulMerged, ulTotal, ulMax, 99.0),
+              HistFT_valueAt(aulMerged, ulTotal, ulMax, 99.9),
+              ulMax);
+   }
+}
+
+void HistFT_reset(void) {
+   size_t ulShard, ulOp, ulBucket;
+
+   for(ulShard = 0; ulShard < NUM_SHARDS; ulShard++)
+      for(ulOp = 0; ulOp < OPFT_COUNT; ulOp++) {
+         for(ulBucket = 0; ulBucket < NUM_BUCKETS; ulBucket++)
+            __atomic_store_n(&asShards[ulShard].aulBuckets[ulOp][ulBucket],
+                             0, __ATOMIC_RELAXED);
+         __atomic_store_n(&asShards[ulShard].aulSum[ulOp], 0,
+                          __ATOMIC_RELAXED);
+         __atomic_store_n(&asShards[ulShard].aulMax[ulOp], 0,
+                          __ATOMIC_RELAXED);
+      }
+}
@@ -0,0 +1,45 @@
+/*--------------------------------------------------------------------*/
+/* histFT.h                                                           */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+#ifndef HISTFT_INCLUDED
+#define HISTFT_INCLUDED
+
+#include <stdio.h>
+#include "opFT.h"
+
+/*
+  Per-operation latency histograms for the FT. When ft.c is compiled
+  with -DFT_HIST, every public FT call records its latency here.
+
+  Buckets are log-linear (HDR-style): values below 32ns are exact and
+  every power-of-two range above that is split into 16 equal
+  sub-buckets, so any recorded value is reported within about 6%.
+  Each thread records into one of a fixed number of shards, and the
+  shards are merged only when the histograms are read.
+*/
+
+/* Records one call of operation eOp that took ulNanos nanoseconds. */
+void HistFT_record(enum OpFT eOp, unsigned long ulNanos);
+
+/* Returns the number of calls of operation eOp recorded so far. */
+unsigned long HistFT_getCount(enum OpFT eOp);
+
+/*
+  Returns the latency in nanoseconds at or below which dPercentile
+  percent (0.0 to 100.0) of the recorded calls of eOp completed,
+  or 0 if no calls of eOp have been recorded.
+*/
+unsigned long HistFT_percentile(enum OpFT eOp, double dPercentile);
+
+/*
+  Writes a table with count, mean, p50, p90, p99, p99.9 and max latency
+  for each operation that has been recorded at least once to psFile.
+*/
+void HistFT_dump(FILE *psFile);
+
+/* Discards everything recorded so far. */
+void HistFT_reset(void);
+
+#endif
@@ -10,6 +10,22 @@
 #include "path.h"
 #include "nodeFT.h"
 
+#ifdef FT_HOTCACHE
+/* Number of children each directory's hot-child cache remembers */
+enum { HOT_SLOTS = 4 };
+
+/*
+  One entry of a hot-child cache: a child that a lookup found, the
+  index it was found at and a hash of its last path component. Only
+  a hint, checked against the child array before it is believed.
+*/
+struct hotSlot {
+    Node_T child;
+    size_t index;
+    unsigned int hash;
+};
+#endif
+
 /* Definition of the Node_T structure */
 struct node {
     /* the path associated with this node */
@@ -26,8 +42,28 @@ struct node {
     void *contents;
     /* length of the contents (only valid if isFile is TRUE) */
     size_t contentLength;
+#ifdef FT_HEAT
+    /* lookups that ended at this directory, as of heatEpoch */
+    unsigned long heatEnded;
+    /* lookups that passed through this directory, as of heatEpoch */
+    unsigned long heatThrough;
+    /* the heat epoch in which the counts above were last decayed */
+    unsigned long heatEpoch;
+#endif
+#ifdef FT_HOTCACHE
+    /* the children most recently found under this directory, most
+       recent first */
+    struct hotSlot hot[HOT_SLOTS];
+#endif
 };
 
+#ifdef FT_HOTCACHE
+/* Successful child lookups that the hot-child caches answered, and
+   that they did not, updated atomically */
+static unsigned long hotHits;
+static unsigned long hotMisses;
+#endif
+
 /*---------------------------------------------------------------*/
 /* Static Helper Function Prototypes                             */
 /*---------------------------------------------------------------*/
@@ -47,18 +83,20 @@ struct node {
 static int NodeFT_compareNodes(const void *node1, const void *node2);
 
 /*
-  Compares the path of a node and a string for searching.
+  Compares the path of a node with the first `length` characters of
+  a string, as strcmp would compare it with a copy of just those.
 
   Parameters:
-    - nodePtr: pointer to the node whose path is to be compared
-    - pathStrPtr: pointer to the string path to compare against
+    - node: the node whose path is to be compared
+    - pathStr: the string whose start is compared against
+    - length: how many characters of `pathStr` make up the path
 
   Returns:
-    - A negative value if node's path < pathStrPtr
-    - Zero if node's path == pathStrPtr
-    - A positive value if node's path > pathStrPtr
+    - A negative value if node's path < the path in pathStr
+    - Zero if node's path == the path in pathStr
+    - A positive value if node's path > the path in pathStr
 */
-static int NodeFT_comparePathString(const void *nodePtr, const void *pathStrPtr);
+static int NodeFT_comparePathPrefix(Node_T node, const char *pathStr, size_t length);
 
 /*
   Initializes a new node with given path, parent, and type (file or dir).
@@ -121,6 +159,35 @@ static int NodeFT_insertChild(Node_T parentNode, Node_T childNode, boolean isFil
 */
 static void NodeFT_removeFromParent(Node_T node);
 
+#ifdef FT_HOTCACHE
+/*
+  Returns a hash of the last component of the path made of the first
+  `length` characters of `pathStr`, which is all that tells apart the
+  children of one directory.
+*/
+static unsigned int NodeFT_hashLast(const char *pathStr, size_t length);
+
+/*
+  Looks for the child of `parent` with the path made of the first
+  `length` characters of `pathStr`, whose last component hashes to
+  `hash`, in `parent`'s hot-child cache, checking any candidate
+  against `childArray`. If it is there, moves it to the front of the
+  cache, stores its index in `*childIndexPtr` and returns TRUE;
+  otherwise returns FALSE.
+*/
+static boolean NodeFT_hotLookup(Node_T parent, DynArray_T childArray,
+                                const char *pathStr, size_t length,
+                                unsigned int hash, size_t *childIndexPtr);
+
+/*
+  Puts `child`, found at `index` and with last component hash `hash`,
+  at the front of `parent`'s hot-child cache, dropping it from further
+  back if it is there already and the least recent entry otherwise.
+*/
+static void NodeFT_hotPromote(Node_T parent, Node_T child, size_t index,
+                              unsigned int hash);
+#endif
+
 /*---------------------------------------------------------------*/
 /* Static Helper Function Definitions                            */
 /*---------------------------------------------------------------*/
@@ -148,25 +215,32 @@ static int NodeFT_compareNodes(const void *node1, const void *node2) {
 }
 
 /*
-  Compares the path of a node and a string for searching.
+  Compares the path of a node with the first `length` characters of
+  a string, as strcmp would compare it with a copy of just those.
 
   Parameters:
-    - nodePtr: pointer to the node whose path is to be compared
-    - pathStrPtr: pointer to the string path to compare against
+    - node: the node whose path is to be compared
+    - pathStr: the string whose start is compared against
+    - length: how many characters of `pathStr` make up the path
 
   Returns:
-    - A negative value if node's path < pathStrPtr
-    - Zero if node's path == pathStrPtr
-    - A positive value if node's path > pathStrPtr
+    - A negative value if node's path < the path in pathStr
+    - Zero if node's path == the path in pathStr
+    - A positive value if node's path > the path in pathStr
 */
-static int NodeFT_comparePathString(const void *nodePtr, const void *pathStrPtr) {
-    const Node_T node = (const Node_T)nodePtr;
-    const char *pathStr = (const char *)pathStrPtr;
+static int NodeFT_comparePathPrefix(Node_T node, const char *pathStr, size_t length) {
+    const char *nodeStr;
+    int compare;
 
     assert(node != NULL);
     assert(pathStr != NULL);
 
-    return Path_compareString(node->path, pathStr);
+    nodeStr = Path_getPathname(node->path);
+    compare = strncmp(nodeStr, pathStr, length);
+    if (compare != 0)
+        return compare;
+    /* equal so far: the node's path is greater if it goes on */
+    return nodeStr[length] != '\0';
 }
 
 /*
@@ -215,6 +289,14 @@ static int NodeFT_initializeNode(Path_T path, Node_T parent, boolean isFile, Nod
     newNode->isFile = isFile;
     newNode->contents = NULL;
     newNode->contentLength = 0;
+#ifdef FT_HEAT
+    newNode->heatEnded = 0;
+    newNode->heatThrough = 0;
+    newNode->heatEpoch = 0;
+#endif
+#ifdef FT_HOTCACHE
+    memset(newNode->hot, 0, sizeof(newNode->hot));
+#endif
 
     if (isFile) {
         /* Files don't have children */
@@ -494,23 +576,82 @@ Path_T NodeFT_getPath(Node_T node) {
   Otherwise, stores the index where such a child would be inserted.
 */
 boolean NodeFT_hasChild(Node_T parent, Path_T childPath, size_t *childIndexPtr, boolean isFile) {
+    assert(childPath != NULL);
+
+    return NodeFT_hasChildPrefix(parent, Path_getPathname(childPath),
+                                 Path_getStrLength(childPath), childIndexPtr, isFile);
+}
+
+/*
+  Checks if parent has a child node whose path is the first length
+  characters of pathStr, with type specified by isFile.
+
+  Parameters:
+    - parent: the parent node to search within
+    - pathStr: a string beginning with the child's path
+    - length: the length of the child's path within pathStr
+    - childIndexPtr: pointer to where the index will be stored
+    - isFile: boolean indicating the type of child (TRUE for file, FALSE for directory)
+
+  Returns:
+    - TRUE if such a child exists
+    - FALSE otherwise
+
+  If the child exists, stores its index in `*childIndexPtr`.
+  Otherwise, stores the index where such a child would be inserted.
+*/
+boolean NodeFT_hasChildPrefix(Node_T parent, const char *pathStr, size_t length,
+                              size_t *childIndexPtr, boolean isFile) {
     DynArray_T childArray;
-    const char *childPathStr;
-    boolean found;
+    size_t low, high, mid;
+    int compare;
+#ifdef FT_HOTCACHE
+    unsigned int hash;
+#endif
 
     assert(parent != NULL);
-    assert(childPath != NULL);
+    assert(pathStr != NULL);
     assert(childIndexPtr != NULL);
 
     /* Choose the correct child array */
     childArray = isFile ? parent->fileChildren : parent->dirChildren;
 
-    childPathStr = Path_getPathname(childPath);
-
-    /* Search for the child */
-    found = DynArray_bsearch(childArray, (void *)childPathStr, childIndexPtr, NodeFT_comparePathString);
+#ifdef FT_HOTCACHE
+    hash = NodeFT_hashLast(pathStr, length);
+    if (NodeFT_hotLookup(parent, childArray, pathStr, length, hash, childIndexPtr))
+        return TRUE;
+#endif
+
+    /* Binary search, as DynArray_bsearch would do, but fetching both
+       nodes the next step might compare while this step's comparison
+       waits for its own node's path */
+    low = 0;
+    high = DynArray_getLength(childArray);
+    while (low < high) {
+        mid = low + (high - low) / 2;
+        if (low < mid)
+            __builtin_prefetch(DynArray_get(childArray, low + (mid - low) / 2));
+        if (mid + 1 < high)
+            __builtin_prefetch(DynArray_get(childArray, mid + 1 + (high - mid - 1) / 2));
+
+        compare = NodeFT_comparePathPrefix(DynArray_get(childArray, mid), pathStr, length);
+        if (compare < 0)
+            low = mid + 1;
+        else if (compare > 0)
+            high = mid;
+        else {
+#ifdef FT_HOTCACHE
+            /* the cache could have answered this lookup but did not */
+            (void)__atomic_fetch_add(&hotMisses, 1, __ATOMIC_RELAXED);
+            NodeFT_hotPromote(parent, DynArray_get(childArray, mid), mid, hash);
+#endif
+            *childIndexPtr = mid;
+            return TRUE;
+        }
+    }
 
-    return found;
+    *childIndexPtr = low;
+    return FALSE;
 }
 
 /*
@@ -729,4 +870,205 @@ char *NodeFT_toString(Node_T node) {
 
     /* No need to free pathStr as it's managed elsewhere */
     return resultStr;
-}
\ No newline at end of file
+}
+
+/*
+  Starts loading node's child arrays, which looking up one of its
+  children reads first. A file has none.
+
+  Parameters:
+    - node: the node a traversal has just reached
+*/
+void NodeFT_prefetch(Node_T node) {
+    assert(node != NULL);
+
+    if (node->isFile)
+        return;
+    __builtin_prefetch(node->fileChildren);
+    __builtin_prefetch(node->dirChildren);
+}
+
+#ifdef FT_HEAT
+
+/*
+  Brings node's counts forward to heat epoch epoch, halving them once
+  per epoch that has passed. Concurrent callers race benignly: only
+  the one that advances heatEpoch applies the decay.
+*/
+static void NodeFT_decay(Node_T node, unsigned long epoch) {
+    unsigned long oldEpoch, shift;
+
+    assert(node != NULL);
+
+    oldEpoch = __atomic_load_n(&node->heatEpoch, __ATOMIC_RELAXED);
+    if (oldEpoch >= epoch)
+        return;
+    if (!__atomic_compare_exchange_n(&node->heatEpoch, &oldEpoch, epoch,
+                                     0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        return;
+
+    shift = epoch - oldEpoch;
+    if (shift >= 8 * sizeof(unsigned long)) {
+        __atomic_store_n(&node->heatEnded, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&node->heatThrough, 0, __ATOMIC_RELAXED);
+    } else {
+        __atomic_store_n(&node->heatEnded,
+                         __atomic_load_n(&node->heatEnded, __ATOMIC_RELAXED) >> shift,
+                         __ATOMIC_RELAXED);
+        __atomic_store_n(&node->heatThrough,
+                         __atomic_load_n(&node->heatThrough, __ATOMIC_RELAXED) >> shift,
+                         __ATOMIC_RELAXED);
+    }
+}
+
+/*
+  Records one lookup that reached directory node.
+
+  Parameters:
+    - node: the directory that the lookup reached
+    - ended: TRUE if the lookup ended at node
+    - epoch: the current heat epoch
+*/
+void NodeFT_touch(Node_T node, boolean ended, unsigned long epoch) {
+    assert(node != NULL);
+    assert(!node->isFile);
+
+    NodeFT_decay(node, epoch);
+    if (ended)
+        (void)__atomic_fetch_add(&node->heatEnded, 1, __ATOMIC_RELAXED);
+    else
+        (void)__atomic_fetch_add(&node->heatThrough, 1, __ATOMIC_RELAXED);
+}
+
+/*
+  Stores the decayed lookup counts of directory node.
+
+  Parameters:
+    - node: the directory whose counts are to be retrieved
+    - epoch: the current heat epoch
+    - endedPtr: where the number of lookups ending at node is stored
+    - throughPtr: where the number of lookups passing node is stored
+*/
+void NodeFT_getHeat(Node_T node, unsigned long epoch,
+                    unsigned long *endedPtr, unsigned long *throughPtr) {
+    assert(node != NULL);
+    assert(endedPtr != NULL);
+    assert(throughPtr != NULL);
+
+    NodeFT_decay(node, epoch);
+    *endedPtr = __atomic_load_n(&node->heatEnded, __ATOMIC_RELAXED);
+    *throughPtr = __atomic_load_n(&node->heatThrough, __ATOMIC_RELAXED);
+}
+
+#endif /* FT_HEAT */
+
+#ifdef FT_HOTCACHE
+
+/*
+  Returns a hash of the last component of the path made of the first
+  length characters of pathStr (FNV-1a).
+*/
+static unsigned int NodeFT_hashLast(const char *pathStr, size_t length) {
+    size_t start = length;
+    unsigned int hash = 2166136261u;
+
+    while (start > 0 && pathStr[start - 1] != '/')
+        start--;
+    for (; start < length; start++)
+        hash = (hash ^ (unsigned char)pathStr[start]) * 16777619u;
+    return hash;
+}
+
+/*
+  Looks for the child with the path made of the first length
+  characters of pathStr in parent's hot-child cache. Each entry is
+  believed only if childArray still holds its child at its index and
+  that child's path matches, so an entry left behind by an insertion
+  or removal that shifted the array, or half-written by a concurrent
+  lookup, is merely a miss. The fields are read and written one at a
+  time with relaxed atomics, so lookups under the shared tree lock
+  can update the cache without a lock of their own.
+*/
+static boolean NodeFT_hotLookup(Node_T parent, DynArray_T childArray,
+                                const char *pathStr, size_t length,
+                                unsigned int hash, size_t *childIndexPtr) {
+    struct hotSlot *slot;
+    Node_T child;
+    size_t index;
+    int i;
+
+    for (i = 0; i < HOT_SLOTS; i++) {
+        slot = &parent->hot[i];
+        if (__atomic_load_n(&slot->hash, __ATOMIC_RELAXED) != hash)
+            continue;
+        child = __atomic_load_n(&slot->child, __ATOMIC_RELAXED);
+        index = __atomic_load_n(&slot->index, __ATOMIC_RELAXED);
+        if (child == NULL || index >= DynArray_getLength(childArray) ||
+            DynArray_get(childArray, index) != child ||
+            NodeFT_comparePathPrefix(child, pathStr, length) != 0)
+            continue;
+
+        (void)__atomic_fetch_add(&hotHits, 1, __ATOMIC_RELAXED);
+        if (i > 0)
+            NodeFT_hotPromote(parent, child, index, hash);
+        *childIndexPtr = index;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/*
+  Puts child at the front of parent's hot-child cache, shifting the
+  entries in front of its old place (or all but the last, if it had
+  none) back by one.
+*/
+static void NodeFT_hotPromote(Node_T parent, Node_T child, size_t index,
+                              unsigned int hash) {
+    struct hotSlot *hot = parent->hot;
+    int from;
+
+    for (from = 0; from < HOT_SLOTS - 1; from++)
+        if (__atomic_load_n(&hot[from].child, __ATOMIC_RELAXED) == child)
+            break;
+    for (; from > 0; from--) {
+        __atomic_store_n(&hot[from].hash,
+                         __atomic_load_n(&hot[from - 1].hash, __ATOMIC_RELAXED),
+                         __ATOMIC_RELAXED);
+        __atomic_store_n(&hot[from].child,
+                         __atomic_load_n(&hot[from - 1].child, __ATOMIC_RELAXED),
+                         __ATOMIC_RELAXED);
+        __atomic_store_n(&hot[from].index,
+                         __atomic_load_n(&hot[from - 1].index, __ATOMIC_RELAXED),
+                         __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&hot[0].hash, hash, __ATOMIC_RELAXED);
+    __atomic_store_n(&hot[0].child, child, __ATOMIC_RELAXED);
+    __atomic_store_n(&hot[0].index, index, __ATOMIC_RELAXED);
+}
+
+/*
+  Stores the number of successful child lookups that the hot-child
+  caches answered, and that needed a binary search, since the last
+  NodeFT_resetHotStats.
+
+  Parameters:
+    - hitsPtr: where the number answered by a cache is stored
+    - missesPtr: where the number that needed a search is stored
+*/
+void NodeFT_getHotStats(unsigned long *hitsPtr, unsigned long *missesPtr) {
+    assert(hitsPtr != NULL);
+    assert(missesPtr != NULL);
+
+    *hitsPtr = __atomic_load_n(&hotHits, __ATOMIC_RELAXED);
+    *missesPtr = __atomic_load_n(&hotMisses, __ATOMIC_RELAXED);
+}
+
+/*
+  Sets the counts reported by NodeFT_getHotStats back to 0.
+*/
+void NodeFT_resetHotStats(void) {
+    __atomic_store_n(&hotHits, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&hotMisses, 0, __ATOMIC_RELAXED);
+}
+
+#endif /* FT_HOTCACHE */
@@ -82,6 +82,26 @@ Path_T NodeFT_getPath(Node_T node);
 */
 boolean NodeFT_hasChild(Node_T parent, Path_T childPath, size_t *childIndexPtr, boolean isFile);
 
+/*
+  Like NodeFT_hasChild, but the child's path is the first `length`
+  characters of `pathStr`, which may go on past them. This lets a
+  traversal look up each prefix of a path without building a Path_T
+  for it.
+
+  Parameters:
+    - parent: the parent node to search within
+    - pathStr: a string beginning with the child's path
+    - length: the length of the child's path within `pathStr`
+    - childIndexPtr: pointer to where the index will be stored
+    - isFile: boolean indicating the type of child (TRUE for file, FALSE for directory)
+
+  Returns:
+    - TRUE if such a child exists
+    - FALSE otherwise
+*/
+boolean NodeFT_hasChildPrefix(Node_T parent, const char *pathStr, size_t length,
+                              size_t *childIndexPtr, boolean isFile);
+
 /* 
   Returns the number of children of `parent` of type specified by `isFile`.
 
@@ -195,4 +215,64 @@ Node_T NodeFT_getParent(Node_T node);
 */
 char *NodeFT_toString(Node_T node);
 
+/*
+  Starts loading the parts of `node` that looking up one of its
+  children will read, without waiting for them, so that a traversal
+  can overlap those cache misses with other work. Only a hint: it
+  has no effect on the node.
+
+  Parameters:
+    - node: the node a traversal has just reached
+*/
+void NodeFT_prefetch(Node_T node);
+
+/*
+  Records one lookup that reached directory `node`, decaying its
+  counts first if the heat epoch has advanced since it was last
+  touched. Only available when compiled with -DFT_HEAT.
+
+  Parameters:
+    - node: the directory that the lookup reached
+    - ended: TRUE if the lookup ended at `node`, FALSE if it went on
+      to a deeper directory
+    - epoch: the current heat epoch; counts are halved once for each
+      epoch that has passed since `node` was last touched
+*/
+void NodeFT_touch(Node_T node, boolean ended, unsigned long epoch);
+
+/*
+  Stores the decayed lookup counts of directory `node` as of heat
+  epoch `epoch` in `*endedPtr` and `*throughPtr`. Only available when
+  compiled with -DFT_HEAT.
+
+  Parameters:
+    - node: the directory whose counts are to be retrieved
+    - epoch: the current heat epoch
+    - endedPtr: where the number of lookups ending at `node` is stored
+    - throughPtr: where the number of lookups passing `node` is stored
+*/
+void NodeFT_getHeat(Node_T node, unsigned long epoch,
+                    unsigned long *endedPtr, unsigned long *throughPtr);
+
+/*
+  Stores how many successful child lookups (NodeFT_hasChild and
+  NodeFT_hasChildPrefix calls that found the child) were answered by
+  the looked-in directory's hot-child cache, a few of its most
+  recently found children checked before its sorted child array is
+  searched, and how many needed the search, since the last
+  NodeFT_resetHotStats. Only available when compiled with
+  -DFT_HOTCACHE.
+
+  Parameters:
+    - hitsPtr: where the number answered by a cache is stored
+    - missesPtr: where the number that needed a search is stored
+*/
+void NodeFT_getHotStats(unsigned long *hitsPtr, unsigned long *missesPtr);
+
+/*
+  Sets the counts reported by NodeFT_getHotStats back to 0. Only
+  available when compiled with -DFT_HOTCACHE.
+*/
+void NodeFT_resetHotStats(void);
+
 #endif /* NODEFT_INCLUDED */
\ No newline at end of file
@@ -0,0 +1,901 @@
+/*--------------------------------------------------------------------*/
+/* nodeFTSoA.c                                                        */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+#include <string.h>
+#include "path.h"
+#include "arenaFT.h"
+#include "nodeFT.h"
+
+/*
+  A second implementation of nodeFT.h, linked instead of nodeFT.c
+  when the FT is built with -DFT_SOA. Rather than one malloc'd struct
+  per node, all nodes live in one store of parallel arrays indexed by
+  a 32-bit node ID: parent IDs, type bits, paths, child ID arrays and
+  content handles. Nodes refer to each other only by ID, so a child
+  reference is half the size of a pointer, and a scan over one field
+  (e.g. the type bits, to visit every file) touches only that field's
+  dense array. The store is not position-independent, though: each
+  node's Path_T, its child ID arrays and its contents are still
+  separate allocations held by pointer. Growing the store copies
+  those pointers along with the IDs, which is safe, but the store
+  cannot be saved and reloaded, or mapped elsewhere, as raw bytes.
+
+  A Node_T is the node's ID cast to a pointer. Nothing outside this
+  file looks behind a Node_T, and ID 0 is never used, so the null
+  Node_T is still NULL.
+
+  The store is shared by every tree in the process, and is protected
+  by the FT's own lock in a -DFT_THREADSAFE build. A -DFT_PERTHREAD
+  build gives each thread its own tree, so this file must then be
+  compiled with -DFT_PERTHREAD too, to give each thread its own store.
+*/
+
+#ifdef FT_PERTHREAD
+#define STORE static __thread
+#else
+#define STORE static
+#endif
+
+/* A node ID; NONE is no node */
+typedef uint32_t NodeID;
+enum { NONE = 0 };
+
+/* The type bits */
+enum { NODE_LIVE = 1, NODE_FILE = 2 };
+
+/* Index into the child arrays: directories, then files */
+enum { DIR_KIDS = 0, FILE_KIDS = 1, KINDS = 2 };
+
+/* Number of nodes the store has room for when first allocated */
+enum { INITIAL_NODES = 64 };
+
+#ifdef FT_HOTCACHE
+/* Number of children each directory's hot-child cache remembers */
+enum { HOT_SLOTS = 4 };
+
+/*
+  One entry of a hot-child cache: a child that a lookup found, the
+  index it was found at and a hash of its last path component. Only
+  a hint, checked against the child array before it is believed.
+*/
+struct hotSlot {
+    NodeID child;
+    NodeID index;
+    uint32_t hash;
+};
+#endif
+
+/* Converts between a Node_T and its ID */
+#define NODE_ID(node) ((NodeID)(uintptr_t)(node))
+#define NODE_OF(id) ((Node_T)(uintptr_t)(id))
+
+/*
+  The store's arrays, all carved out of one block that NodeFT_layout
+  divides up, so that growing the store is a single allocation that
+  either succeeds or leaves the store as it was, and a large store is
+  one ArenaFT mapping that huge pages can back.
+*/
+struct nodeStore {
+    /* The parent of each node (or the next free ID while it is free) */
+    NodeID *parents;
+    /* The absolute path of each node */
+    Path_T *paths;
+    /* Each directory's child IDs of each kind, sorted by path */
+    NodeID **children[KINDS];
+    /* How many children of each kind each directory has */
+    NodeID *numChildren[KINDS];
+    /* How many children of each kind each directory has room for */
+    NodeID *childCapacity[KINDS];
+    /* The contents of each file, and their length */
+    void **contents;
+    size_t *contentLengths;
+#ifdef FT_HEAT
+    /* Lookups that ended at or passed through each directory, as of
+       heatEpochs */
+    unsigned long *heatEnded;
+    unsigned long *heatThrough;
+    /* The heat epoch in which each node's counts were last decayed */
+    unsigned long *heatEpochs;
+#endif
+#ifdef FT_HOTCACHE
+    /* The children most recently found under each directory, most
+       recent first */
+    struct hotSlot (*hot)[HOT_SLOTS];
+#endif
+    /* The type bits of each node */
+    unsigned char *types;
+};
+
+STORE struct nodeStore store;
+/* The block holding the arrays */
+STORE void *block;
+/* Entries allocated in each array, and entries used so far;
+   entry NONE is never used */
+STORE size_t capacity;
+STORE size_t used;
+/* Head of the list of freed IDs, linked through parents */
+STORE NodeID freeList;
+/* Number of IDs in use */
+STORE size_t liveNodes;
+
+#ifdef FT_HOTCACHE
+/* Successful child lookups that the hot-child caches answered, and
+   that they did not, for every store, updated atomically */
+static unsigned long hotHits;
+static unsigned long hotMisses;
+#endif
+
+/*---------------------------------------------------------------*/
+/* Static Helper Function Definitions                            */
+/*---------------------------------------------------------------*/
+
+/*
+  Points field of *storePtr at the next nodes entries of the block
+  whose next free byte is *nextPtr, and advances *nextPtr past them.
+  If base is NULL only the size is counted.
+*/
+#define CARVE(storePtr, field, base, nextPtr, nodes) \
+    ((storePtr)->field = \
+         (void *)((base) == NULL ? NULL : (base) + *(nextPtr)), \
+     *(nextPtr) += (nodes) * sizeof(*(storePtr)->field))
+
+/*
+  Divides the block at base into the arrays of a store of nodes
+  entries, stored in *storePtr. If base is NULL, only computes the
+  size.
+
+  Parameters:
+    - storePtr: where the arrays' addresses are stored
+    - base: the block, or NULL
+    - nodes: the number of entries in each array
+
+  Returns:
+    - The size of the block in bytes
+*/
+static size_t NodeFT_layout(struct nodeStore *storePtr, char *base,
+                            size_t nodes) {
+    size_t next = 0;
+    int kind;
+
+    /* the arrays go in order of decreasing alignment, so none needs
+       padding */
+    CARVE(storePtr, paths, base, &next, nodes);
+    CARVE(storePtr, contents, base, &next, nodes);
+    CARVE(storePtr, contentLengths, base, &next, nodes);
+    for (kind = 0; kind < KINDS; kind++)
+        CARVE(storePtr, children[kind], base, &next, nodes);
+#ifdef FT_HEAT
+    CARVE(storePtr, heatEnded, base, &next, nodes);
+    CARVE(storePtr, heatThrough, base, &next, nodes);
+    CARVE(storePtr, heatEpochs, base, &next, nodes);
+#endif
+#ifdef FT_HOTCACHE
+    CARVE(storePtr, hot, base, &next, nodes);
+#endif
+    CARVE(storePtr, parents, base, &next, nodes);
+    for (kind = 0; kind < KINDS; kind++) {
+        CARVE(storePtr, numChildren[kind], base, &next, nodes);
+        CARVE(storePtr, childCapacity[kind], base, &next, nodes);
+    }
+    CARVE(storePtr, types, base, &next, nodes);
+    return next;
+}
+
+/*
+  Copies the first count entries of array field from store to
+  *newStorePtr.
+*/
+#define COPY_FIELD(newStorePtr, field, count) \
+    memcpy((newStorePtr)->field, store.field, (count) * sizeof(*store.field))
+
+/*
+  Grows array from oldCapacity to newCapacity elements with
+  ArenaFT_resize, using grown as scratch. Evaluates to TRUE on
+  success, or FALSE if memory allocation fails, leaving array as it
+  was.
+*/
+#define GROW_ARRAY(array, oldCapacity, newCapacity, grown) \
+    (((grown) = ArenaFT_resize((array), (oldCapacity) * sizeof(*(array)), \
+                               (newCapacity) * sizeof(*(array)))) \
+     != NULL ? ((array) = (grown), TRUE) : FALSE)
+
+/* Frees array, of capacity elements, with ArenaFT_free */
+#define FREE_ARRAY(array, capacity) \
+    ArenaFT_free((array), (capacity) * sizeof(*(array)))
+
+/*
+  Takes an unused ID from the store, moving the store to a block
+  twice the size if there is none.
+
+  Returns:
+    - The ID, whose fields are not yet initialized
+    - NONE if memory allocation fails or the IDs have run out
+*/
+static NodeID NodeFT_allocateID(void) {
+    NodeID id;
+    size_t newCapacity;
+    struct nodeStore newStore;
+    void *newBlock;
+    int kind;
+
+    if (freeList != NONE) {
+        id = freeList;
+        freeList = store.parents[id];
+        liveNodes++;
+        return id;
+    }
+
+    if (used == 0)
+        used = 1;
+    if (used >= capacity) {
+        newCapacity = capacity == 0 ? INITIAL_NODES : capacity * 2;
+        if (newCapacity - 1 > (NodeID)-1)
+            return NONE;
+
+        newBlock = ArenaFT_resize(NULL, 0,
+                                  NodeFT_layout(&newStore, NULL, newCapacity));
+        if (newBlock == NULL)
+            return NONE;
+        (void)NodeFT_layout(&newStore, newBlock, newCapacity);
+
+        if (block != NULL) {
+            COPY_FIELD(&newStore, paths, used);
+            COPY_FIELD(&newStore, contents, used);
+            COPY_FIELD(&newStore, contentLengths, used);
+#ifdef FT_HEAT
+            COPY_FIELD(&newStore, heatEnded, used);
+            COPY_FIELD(&newStore, heatThrough, used);
+            COPY_FIELD(&newStore, heatEpochs, used);
+#endif
+#ifdef FT_HOTCACHE
+            COPY_FIELD(&newStore, hot, used);
+#endif
+            COPY_FIELD(&newStore, parents, used);
+            for (kind = 0; kind < KINDS; kind++) {
+                COPY_FIELD(&newStore, children[kind], used);
+                COPY_FIELD(&newStore, numChildren[kind], used);
+                COPY_FIELD(&newStore, childCapacity[kind], used);
+            }
+            COPY_FIELD(&newStore, types, used);
+            ArenaFT_free(block, NodeFT_layout(&store, NULL, capacity));
+        }
+        block = newBlock;
+        store = newStore;
+        capacity = newCapacity;
+    }
+
+    liveNodes++;
+    return (NodeID)used++;
+}
+
+/*
+  Returns an ID to the store. When the last node is gone, frees the
+  store's block, so that a destroyed FT holds no memory.
+
+  Parameters:
+    - id: the ID to return, whose path must already be freed
+*/
+static void NodeFT_releaseID(NodeID id) {
+    store.types[id] = 0;
+    store.parents[id] = freeList;
+    freeList = id;
+    if (--liveNodes > 0)
+        return;
+
+    ArenaFT_free(block, NodeFT_layout(&store, NULL, capacity));
+    block = NULL;
+    capacity = 0;
+    used = 0;
+    freeList = NONE;
+}
+
+/*
+  Compares the path of node id with the first length characters of
+  pathStr.
+
+  Parameters:
+    - id: the node whose path is to be compared
+    - pathStr: a string beginning with the path to compare against
+    - length: the length of that path
+
+  Returns:
+    - A negative value, zero or a positive value as the node's path
+      is less than, equal to or greater than that path
+*/
+static int NodeFT_compareID(NodeID id, const char *pathStr, size_t length) {
+    const char *nodeStr = Path_getPathname(store.paths[id]);
+    int compare = strncmp(nodeStr, pathStr, length);
+
+    if (compare != 0)
+        return compare;
+    return nodeStr[length] != '\0';
+}
+
+/*
+  Searches the sorted children of kind kind of directory parent for
+  the path made of the first length characters of pathStr.
+
+  Parameters:
+    - parent: the directory to search
+    - kind: DIR_KIDS or FILE_KIDS
+    - pathStr: a string beginning with the path to search for
+    - length: the length of that path
+    - indexPtr: where the index is stored
+
+  Returns:
+    - TRUE if found, storing its index in *indexPtr
+    - FALSE otherwise, storing in *indexPtr the index at which such a
+      child would be inserted
+*/
+static boolean NodeFT_search(NodeID parent, int kind, const char *pathStr,
+                             size_t length, size_t *indexPtr) {
+    const NodeID *kids = store.children[kind][parent];
+    size_t low = 0, high = store.numChildren[kind][parent], mid;
+    int compare;
+
+    while (low < high) {
+        mid = low + (high - low) / 2;
+        /* fetch the paths of both children the next step might
+           compare while this comparison waits for its own */
+        if (low < mid)
+            __builtin_prefetch(&store.paths[kids[low + (mid - low) / 2]]);
+        if (mid + 1 < high)
+            __builtin_prefetch(&store.paths[kids[mid + 1 + (high - mid - 1) / 2]]);
+        compare = NodeFT_compareID(kids[mid], pathStr, length);
+        if (compare < 0)
+            low = mid + 1;
+        else if (compare > 0)
+            high = mid;
+        else {
+            *indexPtr = mid;
+            return TRUE;
+        }
+    }
+    *indexPtr = low;
+    return FALSE;
+}
+
+#ifdef FT_HOTCACHE
+
+/*
+  Returns a hash of the last component of the path made of the first
+  length characters of pathStr (FNV-1a), which is all that tells
+  apart the children of one directory.
+*/
+static uint32_t NodeFT_hashLast(const char *pathStr, size_t length) {
+    size_t start = length;
+    uint32_t hash = 2166136261u;
+
+    while (start > 0 && pathStr[start - 1] != '/')
+        start--;
+    for (; start < length; start++)
+        hash = (hash ^ (unsigned char)pathStr[start]) * 16777619u;
+    return hash;
+}
+
+/*
+  Puts child, found at index, at the front of directory parent's
+  hot-child cache, shifting the entries in front of its old place (or
+  all but the last, if it had none) back by one.
+*/
+static void NodeFT_hotPromote(NodeID parent, NodeID child, NodeID index,
+                              uint32_t hash) {
+    struct hotSlot *hot = store.hot[parent];
+    int from;
+
+    for (from = 0; from < HOT_SLOTS - 1; from++)
+        if (__atomic_load_n(&hot[from].child, __ATOMIC_RELAXED) == child)
+            break;
+    for (; from > 0; from--) {
+        __atomic_store_n(&hot[from].hash,
+                         __atomic_load_n(&hot[from - 1].hash, __ATOMIC_RELAXED),
+                         __ATOMIC_RELAXED);
+        __atomic_store_n(&hot[from].child,
+                         __atomic_load_n(&hot[from - 1].child, __ATOMIC_RELAXED),
+                         __ATOMIC_RELAXED);
+        __atomic_store_n(&hot[from].index,
+                         __atomic_load_n(&hot[from - 1].index, __ATOMIC_RELAXED),
+                         __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&hot[0].hash, hash, __ATOMIC_RELAXED);
+    __atomic_store_n(&hot[0].child, child, __ATOMIC_RELAXED);
+    __atomic_store_n(&hot[0].index, index, __ATOMIC_RELAXED);
+}
+
+/*
+  Looks for the child of kind kind with the path made of the first
+  length characters of pathStr, whose last component hashes to hash,
+  in directory parent's hot-child cache. An entry is believed only if
+  the child array still holds its child at its index and that child's
+  path matches, so one made stale by a shift of the array, or half
+  written by a concurrent lookup, is merely a miss; the fields are
+  accessed with relaxed atomics, so lookups under the shared tree
+  lock can update the cache without a lock of their own. On a hit,
+  moves the entry to the front, stores its index in *indexPtr and
+  returns TRUE; otherwise returns FALSE.
+*/
+static boolean NodeFT_hotLookup(NodeID parent, int kind, const char *pathStr,
+                                size_t length, uint32_t hash, size_t *indexPtr) {
+    struct hotSlot *hot = store.hot[parent];
+    NodeID child, index;
+    int i;
+
+    for (i = 0; i < HOT_SLOTS; i++) {
+        if (__atomic_load_n(&hot[i].hash, __ATOMIC_RELAXED) != hash)
+            continue;
+        child = __atomic_load_n(&hot[i].child, __ATOMIC_RELAXED);
+        index = __atomic_load_n(&hot[i].index, __ATOMIC_RELAXED);
+        if (child == NONE || index >= store.numChildren[kind][parent] ||
+            store.children[kind][parent][index] != child ||
+            NodeFT_compareID(child, pathStr, length) != 0)
+            continue;
+
+        (void)__atomic_fetch_add(&hotHits, 1, __ATOMIC_RELAXED);
+        if (i > 0)
+            NodeFT_hotPromote(parent, child, index, hash);
+        *indexPtr = index;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+#endif /* FT_HOTCACHE */
+
+/*
+  Inserts child into the children of kind kind of directory parent
+  at index index, growing the child array if it is full.
+
+  Parameters:
+    - parent: the directory to insert into
+    - kind: DIR_KIDS or FILE_KIDS
+    - index: where child goes in the sorted order
+    - child: the child to insert
+
+  Returns:
+    - SUCCESS on successful insertion
+    - MEMORY_ERROR if memory allocation fails
+*/
+static int NodeFT_insertChild(NodeID parent, int kind, size_t index,
+                              NodeID child) {
+    NodeID count = store.numChildren[kind][parent];
+    NodeID newCapacity;
+    void *scratch;
+
+    if (count == store.childCapacity[kind][parent]) {
+        newCapacity = count == 0 ? 2 : count * 2;
+        if (!GROW_ARRAY(store.children[kind][parent], count, newCapacity, scratch))
+            return MEMORY_ERROR;
+        store.childCapacity[kind][parent] = newCapacity;
+    }
+
+    memmove(&store.children[kind][parent][index + 1],
+            &store.children[kind][parent][index],
+            (count - index) * sizeof(NodeID));
+    store.children[kind][parent][index] = child;
+    store.numChildren[kind][parent] = count + 1;
+    return SUCCESS;
+}
+
+/*
+  Removes node id from its parent's child array, if it has a parent.
+
+  Parameters:
+    - id: the node to remove from its parent
+*/
+static void NodeFT_removeFromParent(NodeID id) {
+    NodeID parent = store.parents[id];
+    int kind = (store.types[id] & NODE_FILE) ? FILE_KIDS : DIR_KIDS;
+    size_t index;
+
+    if (parent == NONE)
+        return;
+    if (NodeFT_search(parent, kind, Path_getPathname(store.paths[id]),
+                      Path_getStrLength(store.paths[id]), &index)) {
+        memmove(&store.children[kind][parent][index],
+                &store.children[kind][parent][index + 1],
+                (store.numChildren[kind][parent] - index - 1) * sizeof(NodeID));
+        store.numChildren[kind][parent]--;
+    }
+}
+
+/*
+  Frees the subtree rooted at node id, which has already been removed
+  from its parent, so that its children need not remove themselves
+  from it one by one.
+
+  Parameters:
+    - id: the root of the subtree to free
+
+  Returns:
+    - The total number of nodes freed
+*/
+static size_t NodeFT_freeSubtree(NodeID id) {
+    size_t freedNodes = 1;
+    NodeID index;
+    int kind;
+
+    if (store.types[id] & NODE_FILE)
+        free(store.contents[id]);
+    else
+        for (kind = 0; kind < KINDS; kind++) {
+            for (index = 0; index < store.numChildren[kind][id]; index++)
+                freedNodes += NodeFT_freeSubtree(store.children[kind][id][index]);
+            FREE_ARRAY(store.children[kind][id], store.childCapacity[kind][id]);
+        }
+
+    Path_free(store.paths[id]);
+    NodeFT_releaseID(id);
+    return freedNodes;
+}
+
+/*---------------------------------------------------------------*/
+/* Public Interface Function Definitions                         */
+/*---------------------------------------------------------------*/
+
+/*
+  Constructs a new node with specified path, parent, and type. See
+  nodeFT.h for the statuses returned; on failure sets *resultNode to
+  NULL and leaves the store as it was.
+*/
+int NodeFT_new(Path_T path, Node_T parent, boolean isFile, Node_T *resultNode) {
+    NodeID parentID = NODE_ID(parent);
+    NodeID id;
+    Path_T pathCopy = NULL;
+    size_t depth, index = 0;
+    int kind = isFile ? FILE_KIDS : DIR_KIDS;
+    int status;
+
+    assert(path != NULL);
+    assert(resultNode != NULL);
+
+    *resultNode = NULL;
+
+    /* Validate the parent-child relationship */
+    depth = Path_getDepth(path);
+    if (parentID == NONE) {
+        if (depth != 1)
+            return NO_SUCH_PATH;
+    } else {
+        assert(!(store.types[parentID] & NODE_FILE));
+        if (Path_getSharedPrefixDepth(path, store.paths[parentID]) <
+            Path_getDepth(store.paths[parentID]))
+            return CONFLICTING_PATH;
+        if (depth != Path_getDepth(store.paths[parentID]) + 1)
+            return NO_SUCH_PATH;
+        if (NodeFT_search(parentID, kind, Path_getPathname(path),
+                          Path_getStrLength(path), &index))
+            return ALREADY_IN_TREE;
+    }
+
+    status = Path_dup(path, &pathCopy);
+    if (status != SUCCESS)
+        return status;
+    id = NodeFT_allocateID();
+    if (id == NONE) {
+        Path_free(pathCopy);
+        return MEMORY_ERROR;
+    }
+
+    store.parents[id] = parentID;
+    store.types[id] = (unsigned char)(NODE_LIVE | (isFile ? NODE_FILE : 0));
+    store.paths[id] = pathCopy;
+    store.contents[id] = NULL;
+    store.contentLengths[id] = 0;
+    for (kind = 0; kind < KINDS; kind++) {
+        store.children[kind][id] = NULL;
+        store.numChildren[kind][id] = 0;
+        store.childCapacity[kind][id] = 0;
+    }
+#ifdef FT_HEAT
+    store.heatEnded[id] = 0;
+    store.heatThrough[id] = 0;
+    store.heatEpochs[id] = 0;
+#endif
+#ifdef FT_HOTCACHE
+    memset(store.hot[id], 0, sizeof(store.hot[id]));
+#endif
+
+    if (parentID != NONE) {
+        status = NodeFT_insertChild(parentID, isFile ? FILE_KIDS : DIR_KIDS,
+                                    index, id);
+        if (status != SUCCESS) {
+            Path_free(pathCopy);
+            NodeFT_releaseID(id);
+            return status;
+        }
+    }
+
+    *resultNode = NODE_OF(id);
+    return SUCCESS;
+}
+
+/*
+  Frees the subtree rooted at node, including node itself, and
+  removes it from its parent. Returns the number of nodes freed.
+*/
+size_t NodeFT_free(Node_T node) {
+    NodeID id = NODE_ID(node);
+
+    assert(id != NONE);
+
+    NodeFT_removeFromParent(id);
+    return NodeFT_freeSubtree(id);
+}
+
+/* Returns the path object representing node's absolute path. */
+Path_T NodeFT_getPath(Node_T node) {
+    assert(node != NULL);
+
+    return store.paths[NODE_ID(node)];
+}
+
+/*
+  Checks if parent has a child with path childPath and type isFile,
+  storing its index, or the index where it would go, in
+  *childIndexPtr.
+*/
+boolean NodeFT_hasChild(Node_T parent, Path_T childPath, size_t *childIndexPtr, boolean isFile) {
+    assert(childPath != NULL);
+
+    return NodeFT_hasChildPrefix(parent, Path_getPathname(childPath),
+                                 Path_getStrLength(childPath), childIndexPtr, isFile);
+}
+
+/*
+  Checks if parent has a child whose path is the first length
+  characters of pathStr, with type isFile, storing its index, or the
+  index where it would go, in *childIndexPtr.
+*/
+boolean NodeFT_hasChildPrefix(Node_T parent, const char *pathStr, size_t length,
+                              size_t *childIndexPtr, boolean isFile) {
+    NodeID id = NODE_ID(parent);
+    int kind = isFile ? FILE_KIDS : DIR_KIDS;
+#ifdef FT_HOTCACHE
+    uint32_t hash;
+#endif
+
+    assert(parent != NULL);
+    assert(pathStr != NULL);
+    assert(childIndexPtr != NULL);
+
+#ifdef FT_HOTCACHE
+    hash = NodeFT_hashLast(pathStr, length);
+    if (NodeFT_hotLookup(id, kind, pathStr, length, hash, childIndexPtr))
+        return TRUE;
+    if (!NodeFT_search(id, kind, pathStr, length, childIndexPtr))
+        return FALSE;
+    /* the cache could have answered this lookup but did not */
+    (void)__atomic_fetch_add(&hotMisses, 1, __ATOMIC_RELAXED);
+    NodeFT_hotPromote(id, store.children[kind][id][*childIndexPtr],
+                      (NodeID)*childIndexPtr, hash);
+    return TRUE;
+#else
+    return NodeFT_search(id, kind, pathStr, length, childIndexPtr);
+#endif
+}
+
+/* Returns the number of children of parent of type isFile. */
+size_t NodeFT_getNumChildren(Node_T parent, boolean isFile) {
+    assert(parent != NULL);
+    assert(!(store.types[NODE_ID(parent)] & NODE_FILE));
+
+    return store.numChildren[isFile ? FILE_KIDS : DIR_KIDS][NODE_ID(parent)];
+}
+
+/*
+  Retrieves the child of parent at index childID of type isFile.
+  Returns SUCCESS, or NO_SUCH_PATH if childID is out of bounds.
+*/
+int NodeFT_getChild(Node_T parent, size_t childID, Node_T *resultNode, boolean isFile) {
+    NodeID id = NODE_ID(parent);
+    int kind = isFile ? FILE_KIDS : DIR_KIDS;
+
+    assert(parent != NULL);
+    assert(resultNode != NULL);
+    assert(!(store.types[id] & NODE_FILE));
+
+    if (childID >= store.numChildren[kind][id]) {
+        *resultNode = NULL;
+        return NO_SUCH_PATH;
+    }
+
+    *resultNode = NODE_OF(store.children[kind][id][childID]);
+    return SUCCESS;
+}
+
+/*
+  Stores the contents of node in *contentsPtr. Returns SUCCESS, or
+  NO_SUCH_PATH if node is NULL.
+*/
+int NodeFT_getContents(Node_T node, void **contentsPtr) {
+    assert(contentsPtr != NULL);
+
+    if (node == NULL)
+        return NO_SUCH_PATH;
+
+    *contentsPtr = store.contents[NODE_ID(node)];
+    return SUCCESS;
+}
+
+/*
+  Stores the length of node's contents in *lengthPtr. Returns
+  SUCCESS, or NO_SUCH_PATH if node is NULL.
+*/
+int NodeFT_getContentLength(Node_T node, size_t *lengthPtr) {
+    assert(lengthPtr != NULL);
+
+    if (node == NULL)
+        return NO_SUCH_PATH;
+
+    *lengthPtr = store.contentLengths[NODE_ID(node)];
+    return SUCCESS;
+}
+
+/*
+  Sets the contents of file node to a copy of the newLength bytes at
+  newContents. Returns SUCCESS, or MEMORY_ERROR if memory allocation
+  fails, leaving the file empty.
+*/
+int NodeFT_setContents(Node_T node, void *newContents, size_t newLength) {
+    NodeID id = NODE_ID(node);
+
+    assert(node != NULL);
+
+    free(store.contents[id]);
+    store.contents[id] = NULL;
+    store.contentLengths[id] = 0;
+
+    if (newContents != NULL && newLength > 0) {
+        store.contents[id] = malloc(newLength);
+        if (store.contents[id] == NULL)
+            return MEMORY_ERROR;
+        memcpy(store.contents[id], newContents, newLength);
+        store.contentLengths[id] = newLength;
+    }
+
+    return SUCCESS;
+}
+
+/* Returns TRUE if node is a file, FALSE if it is a directory or NULL. */
+boolean NodeFT_isFile(Node_T node) {
+    if (node == NULL)
+        return FALSE;
+
+    return (boolean)((store.types[NODE_ID(node)] & NODE_FILE) != 0);
+}
+
+/* Returns the parent of node, or NULL if node is the root. */
+Node_T NodeFT_getParent(Node_T node) {
+    assert(node != NULL);
+
+    return NODE_OF(store.parents[NODE_ID(node)]);
+}
+
+/*
+  Returns "File: " or "Dir:  " followed by node's path, in memory the
+  caller must free, or NULL if memory allocation fails.
+*/
+char *NodeFT_toString(Node_T node) {
+    const char *pathStr;
+    const char *typePrefix;
+    char *resultStr;
+
+    assert(node != NULL);
+
+    pathStr = Path_getPathname(store.paths[NODE_ID(node)]);
+    typePrefix = NodeFT_isFile(node) ? "File: " : "Dir:  ";
+
+    resultStr = (char *)malloc(strlen(typePrefix) + strlen(pathStr) + 1);
+    if (resultStr == NULL)
+        return NULL;
+    strcpy(resultStr, typePrefix);
+    strcat(resultStr, pathStr);
+    return resultStr;
+}
+
+/*
+  Starts loading what looking up one of node's children reads first:
+  its type bits, its child counts and the starts of its child
+  arrays, which are all in different arrays of the store.
+*/
+void NodeFT_prefetch(Node_T node) {
+    NodeID id = NODE_ID(node);
+    int kind;
+
+    assert(node != NULL);
+
+    __builtin_prefetch(&store.types[id]);
+    for (kind = 0; kind < KINDS; kind++) {
+        __builtin_prefetch(&store.numChildren[kind][id]);
+        __builtin_prefetch(&store.children[kind][id]);
+    }
+}
+
+#ifdef FT_HEAT
+
+/*
+  Brings node id's counts forward to heat epoch epoch, halving them
+  once per epoch that has passed. Concurrent callers race benignly:
+  only the one that advances its epoch applies the decay.
+*/
+static void NodeFT_decay(NodeID id, unsigned long epoch) {
+    unsigned long oldEpoch, shift;
+
+    oldEpoch = __atomic_load_n(&store.heatEpochs[id], __ATOMIC_RELAXED);
+    if (oldEpoch >= epoch)
+        return;
+    if (!__atomic_compare_exchange_n(&store.heatEpochs[id], &oldEpoch, epoch,
+                                     0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        return;
+
+    shift = epoch - oldEpoch;
+    if (shift >= 8 * sizeof(unsigned long)) {
+        __atomic_store_n(&store.heatEnded[id], 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&store.heatThrough[id], 0, __ATOMIC_RELAXED);
+    } else {
+        __atomic_store_n(&store.heatEnded[id],
+                         __atomic_load_n(&store.heatEnded[id], __ATOMIC_RELAXED) >> shift,
+                         __ATOMIC_RELAXED);
+        __atomic_store_n(&store.heatThrough[id],
+                         __atomic_load_n(&store.heatThrough[id], __ATOMIC_RELAXED) >> shift,
+                         __ATOMIC_RELAXED);
+    }
+}
+
+/* Records one lookup that reached directory node. */
+void NodeFT_touch(Node_T node, boolean ended, unsigned long epoch) {
+    NodeID id = NODE_ID(node);
+
+    assert(node != NULL);
+    assert(!(store.types[id] & NODE_FILE));
+
+    NodeFT_decay(id, epoch);
+    if (ended)
+        (void)__atomic_fetch_add(&store.heatEnded[id], 1, __ATOMIC_RELAXED);
+    else
+        (void)__atomic_fetch_add(&store.heatThrough[id], 1, __ATOMIC_RELAXED);
+}
+
+/* Stores the decayed lookup counts of directory node. */
+void NodeFT_getHeat(Node_T node, unsigned long epoch,
+                    unsigned long *endedPtr, unsigned long *throughPtr) {
+    NodeID id = NODE_ID(node);
+
+    assert(node != NULL);
+    assert(endedPtr != NULL);
+    assert(throughPtr != NULL);
+
+    NodeFT_decay(id, epoch);
+    *endedPtr = __atomic_load_n(&store.heatEnded[id], __ATOMIC_RELAXED);
+    *throughPtr = __atomic_load_n(&store.heatThrough[id], __ATOMIC_RELAXED);
+}
+
+#endif /* FT_HEAT */
+
+#ifdef FT_HOTCACHE
+
+/*
+  Stores the number of successful child lookups that the hot-child
+  caches answered, and that needed a binary search, since the last
+  NodeFT_resetHotStats.
+*/
+void NodeFT_getHotStats(unsigned long *hitsPtr, unsigned long *missesPtr) {
+    assert(hitsPtr != NULL);
+    assert(missesPtr != NULL);
+
+    *hitsPtr = __atomic_load_n(&hotHits, __ATOMIC_RELAXED);
+    *missesPtr = __atomic_load_n(&hotMisses, __ATOMIC_RELAXED);
+}
+
+/* Sets the counts reported by NodeFT_getHotStats back to 0. */
+void NodeFT_resetHotStats(void) {
+    __atomic_store_n(&hotHits, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&hotMisses, 0, __ATOMIC_RELAXED);
+}
+
+#endif /* FT_HOTCACHE */
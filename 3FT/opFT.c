@@ -0,0 +1,24 @@
+/*--------------------------------------------------------------------*/
+/* opFT.c                                                             */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+#include <stddef.h>
+#include "opFT.h"
+
+/* Names of the operations, indexed by enum OpFT */
+static const char *const apcOpNames[OPFT_COUNT] = {
+   "FT_init", "FT_destroy",
+   "FT_insertDir", "FT_insertFile",
+   "FT_rmDir", "FT_rmFile",
+   "FT_containsDir", "FT_containsFile",
+   "FT_getFileContents", "FT_replaceFileContents",
+   "FT_stat", "FT_toString"
+};
+
+const char *OpFT_name(enum OpFT eOp) {
+   if((size_t) eOp >= (size_t) OPFT_COUNT)
+      return "?";
+
+   return apcOpNames[eOp];
+}
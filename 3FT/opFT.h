@@ -0,0 +1,29 @@
+/*--------------------------------------------------------------------*/
+/* opFT.h                                                             */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+#ifndef OPFT_INCLUDED
+#define OPFT_INCLUDED
+
+/*
+  Identifies each public entry point of the FT interface, so that the
+  optional instrumentation modules can attribute what they observe
+  to a particular operation.
+*/
+enum OpFT { OPFT_INIT, OPFT_DESTROY,
+            OPFT_INSERT_DIR, OPFT_INSERT_FILE,
+            OPFT_RM_DIR, OPFT_RM_FILE,
+            OPFT_CONTAINS_DIR, OPFT_CONTAINS_FILE,
+            OPFT_GET_CONTENTS, OPFT_REPLACE_CONTENTS,
+            OPFT_STAT, OPFT_TO_STRING,
+            OPFT_COUNT
+};
+
+/*
+  Returns the name of the ft.h function that eOp identifies,
+  or "?" if eOp is not a valid operation.
+*/
+const char *OpFT_name(enum OpFT eOp);
+
+#endif
@@ -0,0 +1,425 @@
+/*--------------------------------------------------------------------*/
+/* prim_bench.c                                                       */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+/* getopt is POSIX, not C99 */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "dynarray.h"
+#include "path.h"
+#include "bench.h"
+#include "timerFT.h"
+
+/*
+  Microbenchmarks for the Path and DynArray primitives that every tree
+  operation is built from. Each case runs batches of iterations sized
+  to take about the target time per repetition. A few warmup
+  repetitions are discarded, and the report gives the median and the
+  median absolute deviation (MAD) of ns/op over the remaining
+  repetitions. With -p it also gives hardware counters per operation,
+  averaged over the measured repetitions.
+*/
+
+/* Everything one case needs; which fields are used depends on it */
+struct caseData {
+   /* a path string and the Path_T built from it */
+   char *pcPath;
+   Path_T oPPath;
+   /* a second path, for comparisons */
+   Path_T oPOther;
+   /* depth of oPPath */
+   size_t ulDepth;
+   /* an array of sorted key strings and its template order */
+   DynArray_T oDArray;
+   char **ppcKeys;
+   char **ppcShuffled;
+   size_t ulSize;
+   /* generator state for cases that pick random elements */
+   unsigned long ulRand;
+};
+
+/* A benchmark case: a name, a description of its parameters, and a
+   function that runs it for a given number of iterations */
+struct benchCase {
+   const char *pcName;
+   char acParams[48];
+   void (*pfRun)(struct caseData *psData, size_t ulIters);
+   struct caseData sData;
+};
+
+/* Results are accumulated here so the work cannot be optimized away */
+static volatile unsigned long ulSink;
+
+/* Command-line settings */
+static size_t ulReps = 15;
+static size_t ulWarmups = 3;
+static unsigned long ulTargetNanos = 2000000UL;
+static const char *pcFilter = NULL;
+static int bPerf = FALSE;
+
+/*
+  Prints pcWhat to stderr and exits.
+*/
+static void die(const char *pcWhat) {
+   fprintf(stderr, "prim_bench: %s\n", pcWhat);
+   exit(EXIT_FAILURE);
+}
+
+/*
+  Returns a newly allocated path string of ulDepth components, each
+  ulCompLen characters long, whose last character is cLast.
+*/
+static char *makePathString(size_t ulDepth, size_t ulCompLen, char cLast) {
+   char *pcPath, *pcAt;
+   size_t ulLevel, ulChar;
+
+   pcPath = malloc(ulDepth * (ulCompLen + 1) + 1);
+   if(pcPath == NULL)
+      die("out of memory");
+   pcAt = pcPath;
+   for(ulLevel = 0; ulLevel < ulDepth; ulLevel++) {
+      for(ulChar = 0; ulChar < ulCompLen; ulChar++)
+         *pcAt++ = (char) ('a' + (ulLevel + ulChar) % 26);
+      *pcAt++ = '/';
+   }
+   pcAt[-1] = '\0';
+   pcAt[-2] = cLast;
+   return pcPath;
+}
+
+/*
+  Compares two key strings, for DynArray_bsearch and DynArray_sort.
+*/
+static int compareKeys(const void *pv1, const void *pv2) {
+   return strcmp((const char *) pv1, (const char *) pv2);
+}
+
+static void runPathNew(struct caseData *psData, size_t ulIters) {
+   Path_T oPPath;
+   size_t ulIter;
+
+   for(ulIter = 0; ulIter < ulIters; ulIter++) {
+      if(Path_new(psData->pcPath, &oPPath) != SUCCESS)
+         die("Path_new failed");
+      ulSink += Path_getDepth(oPPath);
+      Path_free(oPPath);
+   }
+}
+
+static void runPathPrefix(struct caseData *psData, size_t ulIters) {
+   Path_T oPPrefix;
+   size_t ulIter;
+
+   for(ulIter = 0; ulIter < ulIters; ulIter++) {
+      if(Path_prefix(psData->oPPath, (psData->ulDepth + 1) / 2,
+                     &oPPrefix) != SUCCESS)
+         die("Path_prefix failed");
+      ulSink += Path_getStrLength(oPPrefix);
+      Path_free(oPPrefix);
+   }
+}
+
+static void runPathDup(struct caseData *psData, size_t ulIters) {
+   Path_T oPDup;
+   size_t ulIter;
+
+   for(ulIter = 0; ulIter < ulIters; ulIter++) {
+      if(Path_dup(psData->oPPath, &oPDup) != SUCCESS)
+         die("Path_dup failed");
+      ulSink += Path_getStrLength(oPDup);
+      Path_free(oPDup);
+   }
+}
+
+static void runPathCompare(struct caseData *psData, size_t ulIters) {
+   size_t ulIter;
+
+   for(ulIter = 0; ulIter < ulIters; ulIter++)
+      ulSink += (unsigned long)
+         Path_comparePath(psData->oPPath, psData->oPOther);
+}
+
+static void runPathShared(struct caseData *psData, size_t ulIters) {
+   size_t ulIter;
+
+   for(ulIter = 0; ulIter < ulIters; ulIter++)
+      ulSink += Path_getSharedPrefixDepth(psData->oPPath,
+                                          psData->oPOther);
+}
+
+static void runAddAt(struct caseData *psData, size_t ulIters) {
+   size_t ulIter, ulMid = psData->ulSize / 2;
+
+   /* insert in the middle, then undo it, so the size stays fixed */
+   for(ulIter = 0; ulIter < ulIters; ulIter++) {
+      if(!DynArray_addAt(psData->oDArray, ulMid, psData->ppcKeys[0]))
+         die("DynArray_addAt failed");
+      ulSink += (unsigned long)
+         (size_t) DynArray_removeAt(psData->oDArray, ulMid);
+   }
+}
+
+static void runBsearch(struct caseData *psData, size_t ulIters) {
+   size_t ulIter, ulIndex;
+
+   for(ulIter = 0; ulIter < ulIters; ulIter++) {
+      const char *pcKey = psData->ppcKeys[Bench_rand(&psData->ulRand)
+                                          % psData->ulSize];
+      if(!DynArray_bsearch(psData->oDArray, (void *) pcKey, &ulIndex,
+                           compareKeys))
+         die("DynArray_bsearch missed a present key");
+      ulSink += ulIndex;
+   }
+}
+
+static void runSort(struct caseData *psData, size_t ulIters) {
+   size_t ulIter, ulIndex;
+
+   /* each iteration restores the shuffled order, then sorts */
+   for(ulIter = 0; ulIter < ulIters; ulIter++) {
+      for(ulIndex = 0; ulIndex < psData->ulSize; ulIndex++)
+         (void) DynArray_set(psData->oDArray, ulIndex,
+                             psData->ppcShuffled[ulIndex]);
+      DynArray_sort(psData->oDArray, compareKeys);
+      ulSink += (unsigned long)
+         (size_t) DynArray_get(psData->oDArray, 0);
+   }
+}
+
+/*
+  Sets up psCase's path data: a path of ulDepth components of
+  ulCompLen characters, and another that differs only in its last
+  character.
+*/
+static void setupPaths(struct benchCase *psCase, size_t ulDepth,
+                       size_t ulCompLen) {
+   char *pcOther;
+
+   psCase->sData.ulDepth = ulDepth;
+   psCase->sData.pcPath = makePathString(ulDepth, ulCompLen, 'x');
+   pcOther = makePathString(ulDepth, ulCompLen, 'y');
+   if(Path_new(psCase->sData.pcPath, &psCase->sData.oPPath) != SUCCESS ||
+      Path_new(pcOther, &psCase->sData.oPOther) != SUCCESS)
+      die("Path_new failed during setup");
+   free(pcOther);
+   sprintf(psCase->acParams, "depth=%lu complen=%lu",
+           (unsigned long) ulDepth, (unsigned long) ulCompLen);
+}
+
+/*
+  Sets up psCase's array data: ulSize distinct keys, a DynArray
+  holding them in sorted order, and a shuffled copy of them.
+*/
+static void setupArray(struct benchCase *psCase, size_t ulSize) {
+   struct caseData *psData = &psCase->sData;
+   size_t ulIndex;
+
+   psData->ulSize = ulSize;
+   psData->ulRand = Bench_seed(ulSize);
+   psData->ppcKeys = malloc(ulSize * sizeof(char *));
+   psData->ppcShuffled = malloc(ulSize * sizeof(char *));
+   psData->oDArray = DynArray_new(ulSize);
+   if(psData->ppcKeys == NULL || psData->ppcShuffled == NULL ||
+      psData->oDArray == NULL)
+      die("out of memory");
+
+   for(ulIndex = 0; ulIndex < ulSize; ulIndex++) {
+      psData->ppcKeys[ulIndex] = malloc(16);
+      if(psData->ppcKeys[ulIndex] == NULL)
+         die("out of memory");
+      sprintf(psData->ppcKeys[ulIndex], "k%09lu", (unsigned long) ulIndex);
+      (void) DynArray_set(psData->oDArray, ulIndex,
+                          psData->ppcKeys[ulIndex]);
+      psData->ppcShuffled[ulIndex] = psData->ppcKeys[ulIndex];
+   }
+   for(ulIndex = ulSize; ulIndex > 1; ulIndex--) {
+      size_t ulSwap = Bench_rand(&psData->ulRand) % ulIndex;
+      char *pcTemp = psData->ppcShuffled[ulIndex - 1];
+      psData->ppcShuffled[ulIndex - 1] = psData->ppcShuffled[ulSwap];
+      psData->ppcShuffled[ulSwap] = pcTemp;
+   }
+   sprintf(psCase->acParams, "size=%lu", (unsigned long) ulSize);
+}
+
+/*
+  Frees whatever setupPaths or setupArray allocated for psCase.
+*/
+static void teardown(struct benchCase *psCase) {
+   struct caseData *psData = &psCase->sData;
+   size_t ulIndex;
+
+   free(psData->pcPath);
+   Path_free(psData->oPPath);
+   Path_free(psData->oPOther);
+   if(psData->oDArray != NULL)
+      DynArray_free(psData->oDArray);
+   if(psData->ppcKeys != NULL)
+      for(ulIndex = 0; ulIndex < psData->ulSize; ulIndex++)
+         free(psData->ppcKeys[ulIndex]);
+   free(psData->ppcKeys);
+   free(psData->ppcShuffled);
+}
+
+/*
+  Runs psCase: calibrates the batch size, discards the warmup
+  repetitions, and prints the median and MAD of ns/op.
+*/
+static void measure(struct benchCase *psCase) {
+   unsigned long *aulNanosPerOp;
+   unsigned long ulStart, ulNanos, ulMedian;
+   unsigned long aulBefore[BENCH_NUM_COUNTERS];
+   unsigned long aulAfter[BENCH_NUM_COUNTERS];
+   unsigned long aulTotals[BENCH_NUM_COUNTERS] = { 0 };
+   size_t ulIters = 1, ulRep;
+   int iCounter;
+
+   aulNanosPerOp = malloc(ulReps * sizeof(unsigned long));
+   if(aulNanosPerOp == NULL)
+      die("out of memory");
+
+   /* one untimed call first, so a cold start does not cut the
+      calibration short */
+   psCase->pfRun(&psCase->sData, 1);
+
+   /* grow the batch until one repetition takes the target time */
+   for(;;) {
+      ulStart = TimerFT_ticks();
+      psCase->pfRun(&psCase->sData, ulIters);
+      ulNanos = TimerFT_ticksToNanos(TimerFT_ticks() - ulStart);
+      if(ulNanos >= ulTargetNanos / 4 || ulIters >= (1UL << 30))
+         break;
+      ulIters *= 2;
+   }
+   if(ulNanos < ulTargetNanos && ulNanos > 0)
+      ulIters = (size_t) ((double) ulIters * (double) ulTargetNanos /
+                          (double) ulNanos) + 1;
+
+   for(ulRep = 0; ulRep < ulWarmups + ulReps; ulRep++) {
+      if(bPerf)
+         Bench_perfRead(aulBefore);
+      ulStart = TimerFT_ticks();
+      psCase->pfRun(&psCase->sData, ulIters);
+      ulNanos = TimerFT_ticksToNanos(TimerFT_ticks() - ulStart);
+      if(bPerf && ulRep >= ulWarmups) {
+         Bench_perfRead(aulAfter);
+         Bench_perfAdd(aulTotals, aulBefore, aulAfter);
+      }
+      if(ulRep >= ulWarmups)
+         /* keep hundredths of a ns so fast cases still resolve */
+         aulNanosPerOp[ulRep - ulWarmups] =
+            (unsigned long) ((double) ulNanos * 100.0 / (double) ulIters);
+   }
+
+   Bench_sort(aulNanosPerOp, ulReps);
+   ulMedian = Bench_percentile(aulNanosPerOp, ulReps, 50.0);
+   printf("%-26s %-24s %10.2f %10.2f %10lu", psCase->pcName,
+          psCase->acParams, (double) ulMedian / 100.0,
+          (double) Bench_mad(aulNanosPerOp, ulReps, ulMedian) / 100.0,
+          (unsigned long) ulIters);
+   for(iCounter = 0; bPerf && iCounter < BENCH_NUM_COUNTERS; iCounter++) {
+      if(Bench_perfIsOpen((enum BenchCounter) iCounter))
+         printf(" %10.2f", (double) aulTotals[iCounter] /
+                           ((double) ulIters * (double) ulReps));
+      else
+         printf(" %10s", "-");
+   }
+   printf("\n");
+   free(aulNanosPerOp);
+}
+
+/*
+  Sets up, measures and tears down one case, unless the -f filter
+  excludes it.
+*/
+static void runCase(const char *pcName,
+                    void (*pfRun)(struct caseData *, size_t),
+                    size_t ulDepth, size_t ulCompLen, size_t ulSize) {
+   struct benchCase sCase;
+
+   if(pcFilter != NULL && strstr(pcName, pcFilter) == NULL)
+      return;
+
+   memset(&sCase, 0, sizeof(sCase));
+   sCase.pcName = pcName;
+   sCase.pfRun = pfRun;
+   if(ulSize > 0)
+      setupArray(&sCase, ulSize);
+   else
+      setupPaths(&sCase, ulDepth, ulCompLen);
+
+   measure(&sCase);
+   teardown(&sCase);
+}
+
+/*
+  Runs every case (or those whose name contains the -f argument) and
+  prints one line per case. Returns 0.
+*/
+int main(int argc, char *argv[]) {
+   static const size_t aulDepths[] = { 1, 4, 16, 64 };
+   static const size_t aulCompLens[] = { 4, 16, 64 };
+   static const size_t aulSizes[] = { 16, 256, 4096, 65536 };
+   size_t ulD, ulC, ulS;
+   int iOpt, iCounter;
+
+   while((iOpt = getopt(argc, argv, "r:w:t:f:ph")) != -1) {
+      switch(iOpt) {
+         case 'r': ulReps = strtoul(optarg, NULL, 10); break;
+         case 'w': ulWarmups = strtoul(optarg, NULL, 10); break;
+         case 't': ulTargetNanos = strtoul(optarg, NULL, 10) * 1000000UL;
+                   break;
+         case 'f': pcFilter = optarg; break;
+         case 'p': bPerf = TRUE; break;
+         default:
+            fprintf(stderr, "usage: %s [-r reps] [-w warmups] "
+                    "[-t ms per rep] [-f name filter] [-p]\n", argv[0]);
+            return EXIT_FAILURE;
+      }
+   }
+   if(ulReps == 0 || ulTargetNanos == 0)
+      die("-r and -t must be positive");
+
+   if(bPerf && Bench_perfOpen() == 0) {
+      fprintf(stderr, "prim_bench: no hardware counters available; "
+              "ignoring -p\n");
+      bPerf = FALSE;
+   }
+
+   printf("%-26s %-24s %10s %10s %10s", "primitive", "parameters",
+          "median ns", "MAD ns", "iters/rep");
+   for(iCounter = 0; bPerf && iCounter < BENCH_NUM_COUNTERS; iCounter++)
+      printf(" %10s", Bench_perfName((enum BenchCounter) iCounter));
+   printf("\n");
+
+   for(ulD = 0; ulD < sizeof(aulDepths) / sizeof(aulDepths[0]); ulD++)
+      for(ulC = 0; ulC < sizeof(aulCompLens) / sizeof(aulCompLens[0]);
+          ulC++) {
+         runCase("Path_new+free", runPathNew, aulDepths[ulD],
+                 aulCompLens[ulC], 0);
+         runCase("Path_prefix(half)+free", runPathPrefix, aulDepths[ulD],
+                 aulCompLens[ulC], 0);
+         runCase("Path_dup+free", runPathDup, aulDepths[ulD],
+                 aulCompLens[ulC], 0);
+         runCase("Path_comparePath", runPathCompare, aulDepths[ulD],
+                 aulCompLens[ulC], 0);
+         runCase("Path_getSharedPrefixDepth", runPathShared,
+                 aulDepths[ulD], aulCompLens[ulC], 0);
+      }
+
+   for(ulS = 0; ulS < sizeof(aulSizes) / sizeof(aulSizes[0]); ulS++) {
+      runCase("DynArray_addAt+removeAt", runAddAt, 0, 0, aulSizes[ulS]);
+      runCase("DynArray_bsearch", runBsearch, 0, 0, aulSizes[ulS]);
+      runCase("DynArray_sort", runSort, 0, 0, aulSizes[ulS]);
+   }
+
+   if(bPerf)
+      Bench_perfClose();
+   return 0;
+}
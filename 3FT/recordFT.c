@@ -0,0 +1,218 @@
+/*--------------------------------------------------------------------*/
+/* recordFT.c                                                         */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "a4def.h"
+#include "timerFT.h"
+#include "recordFT.h"
+
+/* States of the trace file */
+enum { FILE_CLOSED, FILE_OPENING, FILE_OPEN, FILE_FAILED };
+
+/* Records with paths shorter than this are encoded on the stack */
+enum { LOCAL_RECORD_SIZE = 512 };
+
+/* Most bytes one varint can take */
+enum { MAX_VARINT = 10 };
+
+/* stdio buffer size for the trace file */
+enum { FILE_BUFFER_SIZE = 1 << 20 };
+
+/* The trace file, valid once iFileState is FILE_OPEN */
+static FILE *psTrace;
+
+/* One of the states above, changed atomically */
+static int iFileState = FILE_CLOSED;
+
+/* Tick at which the first recorded call started */
+static unsigned long ulBaseTick;
+
+/* Whether RecordFT_close has been registered with atexit */
+static int bAtExit = FALSE;
+
+/*
+  Opens the trace file and writes its header, unless another thread
+  already has. ulStart becomes the time origin of the trace. Returns
+  TRUE if the file is open, FALSE if it could not be opened.
+*/
+static int RecordFT_open(unsigned long ulStart) {
+   int iState = FILE_CLOSED;
+   const char *pcName;
+
+   if(__atomic_load_n(&iFileState, __ATOMIC_ACQUIRE) == FILE_OPEN)
+      return TRUE;
+
+   if(!__atomic_compare_exchange_n(&iFileState, &iState, FILE_OPENING,
+                                   FALSE, __ATOMIC_ACQUIRE,
+                                   __ATOMIC_ACQUIRE)) {
+      /* someone else is opening it; wait for the outcome */
+      while(iState == FILE_OPENING)
+         iState = __atomic_load_n(&iFileState, __ATOMIC_ACQUIRE);
+      return iState == FILE_OPEN;
+   }
+
+   pcName = getenv("FT_RECORD_FILE");
+   if(pcName == NULL)
+      pcName = "ft.rec";
+   psTrace = fopen(pcName, "wb");
+   if(psTrace == NULL ||
+      fwrite(RECORDFT_MAGIC, 1, 8, psTrace) != 8) {
+      if(psTrace != NULL)
+         fclose(psTrace);
+      __atomic_store_n(&iFileState, FILE_FAILED, __ATOMIC_RELEASE);
+      return FALSE;
+   }
+   (void) setvbuf(psTrace, NULL, _IOFBF, FILE_BUFFER_SIZE);
+   ulBaseTick = ulStart;
+   if(!bAtExit) {
+      bAtExit = TRUE;
+      (void) atexit(RecordFT_close);
+   }
+   __atomic_store_n(&iFileState, FILE_OPEN, __ATOMIC_RELEASE);
+   return TRUE;
+}
+
+/*
+  Appends ulValue as a LEB128 varint at pucAt and returns the byte
+  after it.
+*/
+static unsigned char *RecordFT_putVarint(unsigned char *pucAt,
+                                         unsigned long ulValue) {
+   while(ulValue >= 0x80) {
+      *pucAt++ = (unsigned char) (ulValue | 0x80);
+      ulValue >>= 7;
+   }
+   *pucAt++ = (unsigned char) ulValue;
+   return pucAt;
+}
+
+void RecordFT_record(enum OpFT eOp, unsigned long ulStart,
+                     unsigned long ulEnd, const char *pcPath,
+                     size_t ulLength, int iResult) {
+   unsigned char aucLocal[LOCAL_RECORD_SIZE];
+   unsigned char *pucRecord = aucLocal, *pucAt;
+   size_t ulPathLen = 0;
+   unsigned long ulSince;
+
+   assert((int) eOp >= 0 && eOp < OPFT_COUNT);
+
+   if(!RecordFT_open(ulStart))
+      return;
+
+   if(pcPath != NULL)
+      ulPathLen = strlen(pcPath);
+   if(ulPathLen + 6 * MAX_VARINT > LOCAL_RECORD_SIZE) {
+      pucRecord = malloc(ulPathLen + 6 * MAX_VARINT);
+      if(pucRecord == NULL)
+         return;
+   }
+
+   /* a call on another thread may have started before the origin */
+   ulSince = ulStart > ulBaseTick ? ulStart - ulBaseTick : 0;
+
+   pucAt = pucRecord;
+   *pucAt++ = (unsigned char) eOp;
+   pucAt = RecordFT_putVarint(pucAt,
+                              ((unsigned long) (long) iResult << 1) ^
+                              (unsigned long) ((long) iResult >> 63));
+   pucAt = RecordFT_putVarint(pucAt, TimerFT_ticksToNanos(ulSince));
+   pucAt = RecordFT_putVarint(pucAt,
+                              TimerFT_ticksToNanos(ulEnd - ulStart));
+   pucAt = RecordFT_putVarint(pucAt, ulLength);
+   pucAt = RecordFT_putVarint(pucAt, pcPath == NULL ? 0 : ulPathLen + 1);
+   if(ulPathLen > 0) {
+      memcpy(pucAt, pcPath, ulPathLen);
+      pucAt += ulPathLen;
+   }
+
+   /* one fwrite per record: stdio locking keeps records whole */
+   (void) fwrite(pucRecord, 1, (size_t) (pucAt - pucRecord), psTrace);
+
+   if(pucRecord != aucLocal)
+      free(pucRecord);
+}
+
+void RecordFT_close(void) {
+   if(__atomic_load_n(&iFileState, __ATOMIC_ACQUIRE) == FILE_OPEN)
+      fclose(psTrace);
+   psTrace = NULL;
+   __atomic_store_n(&iFileState, FILE_CLOSED, __ATOMIC_RELEASE);
+}
+
+int RecordFT_readHeader(FILE *psFile) {
+   char acMagic[8];
+
+   assert(psFile != NULL);
+
+   if(fread(acMagic, 1, 8, psFile) != 8)
+      return FALSE;
+   return memcmp(acMagic, RECORDFT_MAGIC, 8) == 0;
+}
+
+/*
+  Reads one LEB128 varint from psFile into *pulValue. Returns TRUE on
+  success and FALSE at end of file or on an overlong encoding.
+*/
+static int RecordFT_getVarint(FILE *psFile, unsigned long *pulValue) {
+   unsigned long ulValue = 0;
+   unsigned int uiShift = 0;
+   int iByte;
+
+   do {
+      iByte = getc(psFile);
+      if(iByte == EOF || uiShift >= 7 * MAX_VARINT)
+         return FALSE;
+      ulValue |= (unsigned long) (iByte & 0x7f) << uiShift;
+      uiShift += 7;
+   } while(iByte & 0x80);
+
+   *pulValue = ulValue;
+   return TRUE;
+}
+
+int RecordFT_read(FILE *psFile, struct RecordFT_Event *psEvent) {
+   unsigned long ulResult, ulLength, ulPathLen;
+   int iOp;
+
+   assert(psFile != NULL);
+   assert(psEvent != NULL);
+
+   iOp = getc(psFile);
+   if(iOp == EOF)
+      return 0;
+   if(iOp >= OPFT_COUNT)
+      return -1;
+   psEvent->eOp = (enum OpFT) iOp;
+
+   if(!RecordFT_getVarint(psFile, &ulResult) ||
+      !RecordFT_getVarint(psFile, &psEvent->ulStartNanos) ||
+      !RecordFT_getVarint(psFile, &psEvent->ulDurNanos) ||
+      !RecordFT_getVarint(psFile, &ulLength) ||
+      !RecordFT_getVarint(psFile, &ulPathLen))
+      return -1;
+   psEvent->iResult = (int) (long) ((ulResult >> 1) ^
+                                    (0UL - (ulResult & 1)));
+   psEvent->ulLength = (size_t) ulLength;
+
+   psEvent->pcPath = NULL;
+   if(ulPathLen == 0)
+      return 1;
+   ulPathLen--;
+   if(ulPathLen + 1 > psEvent->ulBufferSize) {
+      char *pcNew = realloc(psEvent->pcBuffer, ulPathLen + 1);
+      if(pcNew == NULL)
+         return -1;
+      psEvent->pcBuffer = pcNew;
+      psEvent->ulBufferSize = ulPathLen + 1;
+   }
+   if(fread(psEvent->pcBuffer, 1, ulPathLen, psFile) != ulPathLen)
+      return -1;
+   psEvent->pcBuffer[ulPathLen] = '\0';
+   psEvent->pcPath = psEvent->pcBuffer;
+   return 1;
+}
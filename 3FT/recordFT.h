@@ -0,0 +1,90 @@
+/*--------------------------------------------------------------------*/
+/* recordFT.h                                                         */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+#ifndef RECORDFT_INCLUDED
+#define RECORDFT_INCLUDED
+
+#include <stddef.h>
+#include <stdio.h>
+#include "opFT.h"
+
+/*
+  Workload recording for the FT. When ft.c is compiled with
+  -DFT_RECORD, every public FT call is appended to a binary trace
+  file: its operation, path, content length, result, start time and
+  duration. The file is named by the FT_RECORD_FILE environment
+  variable (default "ft.rec"). It is opened on the first call and
+  flushed at exit. ft_replay re-executes such a trace.
+
+  The file starts with the 8 bytes of RECORDFT_MAGIC. Each record
+  after that is one byte holding the operation, followed by LEB128
+  varints for:
+    - the result (zigzag encoded)
+    - the start time in ns since the first recorded call started
+    - the duration in ns
+    - the content length
+    - the path length plus one (0 for no path)
+  and then the path bytes, without a terminator.
+*/
+
+#define RECORDFT_MAGIC "FTREC001"
+
+/* One recorded call, as read back by RecordFT_read */
+struct RecordFT_Event {
+   /* which operation was called */
+   enum OpFT eOp;
+   /* the call's result: a status code for int operations, TRUE/FALSE
+      for boolean ones, and whether the result was non-NULL for
+      pointer ones */
+   int iResult;
+   /* start of the call, in ns since the first recorded call */
+   unsigned long ulStartNanos;
+   /* duration of the call in ns */
+   unsigned long ulDurNanos;
+   /* content length for FT_insertFile/FT_replaceFileContents, else 0 */
+   size_t ulLength;
+   /* the call's path, or NULL for operations without one; points
+      into pcBuffer */
+   const char *pcPath;
+   /* storage for pcPath, reused by the next RecordFT_read into this
+      event, and its allocated size */
+   char *pcBuffer;
+   size_t ulBufferSize;
+};
+
+/*
+  Appends one call of operation eOp to the trace file. The call ran
+  from tick ulStart to tick ulEnd (see TimerFT_ticks) on path pcPath
+  (NULL if it has none), with content length ulLength, and produced
+  iResult as described in struct RecordFT_Event. Does nothing if
+  the file cannot be opened. Safe to call from several threads.
+*/
+void RecordFT_record(enum OpFT eOp, unsigned long ulStart,
+                     unsigned long ulEnd, const char *pcPath,
+                     size_t ulLength, int iResult);
+
+/*
+  Flushes and closes the trace file. Recording resumes (truncating
+  the file) if another call is recorded afterwards. Must not run
+  while FT calls are in progress on other threads.
+*/
+void RecordFT_close(void);
+
+/*
+  Reads and checks the magic header of the trace in psFile.
+  Returns TRUE if it is a trace, FALSE otherwise.
+*/
+int RecordFT_readHeader(FILE *psFile);
+
+/*
+  Reads the next record of the trace in psFile into *psEvent, whose
+  pcBuffer and ulBufferSize must be NULL and 0 on first use; the
+  caller frees psEvent->pcBuffer when done. Returns 1 if a record
+  was read, 0 at a clean end of file, and -1 if the record is
+  truncated or malformed or memory ran out.
+*/
+int RecordFT_read(FILE *psFile, struct RecordFT_Event *psEvent);
+
+#endif
@@ -0,0 +1,136 @@
+/*--------------------------------------------------------------------*/
+/* samplerFT.c                                                        */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+/* nanosleep is POSIX, not C99 */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <time.h>
+#include <pthread.h>
+#include "a4def.h"
+#include "ft.h"
+#include "timerFT.h"
+#include "samplerFT.h"
+
+/* The sampler spends its budget in periods of this length */
+enum { PERIOD_NANOS = 20000000 };
+
+/* Periods per second */
+enum { PERIODS = 1000000000 / PERIOD_NANOS };
+
+/* Most nodes one sample may visit, which bounds how long it holds
+   the tree lock and so how long writers can be kept waiting */
+enum { MAX_SAMPLE = 4096 };
+
+/* The sampler thread, valid while bRunning */
+static pthread_t sThread;
+
+/* Whether the thread is running; only used by start and stop */
+static int bRunning = FALSE;
+
+/* Set by SamplerFT_stop to ask the thread to finish */
+static int bStop;
+
+/* Nodes to visit per period */
+static size_t ulPerPeriod;
+
+/* Where problems go */
+static SamplerFT_Report pfUserReport;
+static void *pvUserArg;
+
+/* Counters reported by SamplerFT_getStats, updated atomically */
+static unsigned long ulSamples;
+static unsigned long ulNodes;
+static unsigned long ulFindings;
+
+/*
+  The report function given to FT_checkSample: counts the problem and
+  passes it on to the user's report function.
+*/
+static void SamplerFT_report(const char *pcProblem, void *pvArg) {
+   (void) pvArg;
+   __atomic_fetch_add(&ulFindings, 1, __ATOMIC_RELAXED);
+   pfUserReport(pcProblem, pvUserArg);
+}
+
+/*
+  Sleeps until ulNanos ns after ulOrigin (a TimerFT_nanos reading),
+  if that is still in the future.
+*/
+static void SamplerFT_sleepUntil(unsigned long ulOrigin,
+                                 unsigned long ulNanos) {
+   unsigned long ulNow = TimerFT_nanos() - ulOrigin;
+   struct timespec sDelay;
+
+   if(ulNow >= ulNanos)
+      return;
+   sDelay.tv_sec = (time_t) ((ulNanos - ulNow) / 1000000000UL);
+   sDelay.tv_nsec = (long) ((ulNanos - ulNow) % 1000000000UL);
+   (void) nanosleep(&sDelay, NULL);
+}
+
+/*
+  The body of the sampler thread: each period, samples until the
+  period's budget is spent, then sleeps out the rest of the period.
+*/
+static void *SamplerFT_run(void *pvUnused) {
+   unsigned long ulSeed = TimerFT_nanos() | 1;
+   unsigned long ulStart;
+   size_t ulLeft, ulVisited, ulBudget;
+
+   (void) pvUnused;
+   while(!__atomic_load_n(&bStop, __ATOMIC_ACQUIRE)) {
+      ulStart = TimerFT_nanos();
+      for(ulLeft = ulPerPeriod; ulLeft > 0; ulLeft -= ulVisited) {
+         ulBudget = ulLeft < MAX_SAMPLE ? ulLeft : MAX_SAMPLE;
+         (void) FT_checkSample(ulBudget, &ulSeed, SamplerFT_report, NULL,
+                               &ulVisited);
+         __atomic_fetch_add(&ulSamples, 1, __ATOMIC_RELAXED);
+         __atomic_fetch_add(&ulNodes, ulVisited, __ATOMIC_RELAXED);
+         /* an empty tree has nothing more to check this period */
+         if(ulVisited == 0 || ulVisited > ulLeft)
+            break;
+      }
+      SamplerFT_sleepUntil(ulStart, PERIOD_NANOS);
+   }
+   return NULL;
+}
+
+int SamplerFT_start(size_t ulNodesPerSecond, SamplerFT_Report pfReport,
+                    void *pvArg) {
+   assert(ulNodesPerSecond > 0);
+   assert(pfReport != NULL);
+
+   if(bRunning)
+      return INITIALIZATION_ERROR;
+
+   ulPerPeriod = (ulNodesPerSecond + PERIODS - 1) / PERIODS;
+   pfUserReport = pfReport;
+   pvUserArg = pvArg;
+   ulSamples = 0;
+   ulNodes = 0;
+   ulFindings = 0;
+   bStop = FALSE;
+   if(pthread_create(&sThread, NULL, SamplerFT_run, NULL) != 0)
+      return MEMORY_ERROR;
+   bRunning = TRUE;
+   return SUCCESS;
+}
+
+void SamplerFT_stop(void) {
+   if(!bRunning)
+      return;
+   __atomic_store_n(&bStop, TRUE, __ATOMIC_RELEASE);
+   (void) pthread_join(sThread, NULL);
+   bRunning = FALSE;
+}
+
+void SamplerFT_getStats(struct SamplerFT_Stats *psStats) {
+   assert(psStats != NULL);
+
+   psStats->ulSamples = __atomic_load_n(&ulSamples, __ATOMIC_RELAXED);
+   psStats->ulNodes = __atomic_load_n(&ulNodes, __ATOMIC_RELAXED);
+   psStats->ulFindings = __atomic_load_n(&ulFindings, __ATOMIC_RELAXED);
+}
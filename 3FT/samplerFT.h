@@ -0,0 +1,63 @@
+/*--------------------------------------------------------------------*/
+/* samplerFT.h                                                        */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+#ifndef SAMPLERFT_INCLUDED
+#define SAMPLERFT_INCLUDED
+
+#include <stddef.h>
+
+/*
+  A background thread that keeps checking the FT's invariants in
+  production, where a full check after every change costs too much.
+  Each period it checks randomly chosen subtrees with FT_checkSample
+  until it has visited its share of a fixed number of nodes per
+  second, so its cost does not grow with the tree. Each sample holds
+  the tree lock shared, and so needs an FT compiled with
+  -DFT_THREADSAFE (with -DFT_PERTHREAD it would only see its own,
+  empty tree). Problems are passed to a callback as they are found;
+  a damaged region is reported again each time it is sampled.
+*/
+
+/*
+  A function to which the sampler reports each problem, as a one-line
+  description pcProblem, together with the pvArg given to
+  SamplerFT_start. Called on the sampler thread with the tree lock
+  held shared, so it must not call FT functions that modify the tree.
+*/
+typedef void (*SamplerFT_Report)(const char *pcProblem, void *pvArg);
+
+/* Counters describing the sampler, reported by SamplerFT_getStats */
+struct SamplerFT_Stats {
+   /* number of subtrees checked */
+   unsigned long ulSamples;
+   /* number of nodes visited by those checks */
+   unsigned long ulNodes;
+   /* number of problems reported */
+   unsigned long ulFindings;
+};
+
+/*
+  Starts the sampler thread, checking about ulNodesPerSecond nodes per
+  second (which must be positive) and passing problems to pfReport
+  with pvArg. Returns SUCCESS, INITIALIZATION_ERROR if the sampler is
+  already running, or MEMORY_ERROR if the thread could not be
+  created.
+*/
+int SamplerFT_start(size_t ulNodesPerSecond, SamplerFT_Report pfReport,
+                    void *pvArg);
+
+/*
+  Stops the sampler thread and waits for it to finish its current
+  sample. Does nothing if the sampler is not running.
+*/
+void SamplerFT_stop(void);
+
+/*
+  Stores the sampler's counters since it was last started in
+  *psStats.
+*/
+void SamplerFT_getStats(struct SamplerFT_Stats *psStats);
+
+#endif
@@ -0,0 +1,977 @@
+/*--------------------------------------------------------------------*/
+/* shmFT.c                                                            */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+/* shm_open, mmap, sched_yield and process-shared mutexes are POSIX,
+   not C99 */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "shmFT.h"
+
+/* Identifies a segment holding a tree in this layout */
+#define SHMFT_MAGIC ((uint64_t) 0x3130544654686d73)
+
+/* Blocks of the segment's heap come in NUM_CLASSES sizes, from
+   MIN_BLOCK bytes doubling; each starts with a word giving its
+   class */
+enum { NUM_CLASSES = 48 };
+enum { MIN_BLOCK = 16 };
+enum { BLOCK_HEADER = sizeof(uint64_t) };
+
+/* Index into a directory's child arrays: files, then directories,
+   the order in which the FT lists them */
+enum { FILE_KIDS = 0, DIR_KIDS = 1, KINDS = 2 };
+
+/* Capacity of a child array when first allocated */
+enum { INITIAL_KIDS = 4 };
+
+/* An internal status: a query read something that a change was
+   overwriting, and must start over */
+enum { TORN = -1 };
+
+/* The start of the segment */
+struct shmHeader {
+   uint64_t ulMagic;
+   /* the size of the segment */
+   uint64_t ulSize;
+   /* odd while a change is under way */
+   uint64_t ulSeq;
+   /* the root node, or 0 if the tree is empty, and the node count */
+   uint64_t ulRoot;
+   uint64_t ulCount;
+   /* the end of the heap's used part, and the free blocks of each
+      class, linked through their first word after the header */
+   uint64_t ulTop;
+   uint64_t aulFree[NUM_CLASSES];
+   /* held by every change */
+   pthread_mutex_t sWriteLock;
+};
+
+/* A node; its path, with its '\0', follows it in the same block */
+struct shmNode {
+   uint64_t ulParent;
+   /* for a file, its contents (0 if empty) and their length */
+   uint64_t ulContents;
+   uint64_t ulLength;
+   /* for a directory, its child arrays of each kind, each holding
+      the children's offsets sorted by path, and their sizes */
+   uint64_t aulKids[KINDS];
+   uint32_t auiNumKids[KINDS];
+   uint32_t auiKidCapacity[KINDS];
+   uint32_t uiPathLength;
+   uint32_t uiIsFile;
+};
+
+struct ShmFT {
+   /* where the segment is mapped, and its size */
+   char *pcBase;
+   size_t ulSize;
+   boolean bWritable;
+};
+
+/* A string being built by ShmFT_toString */
+struct text {
+   char *pcData;
+   size_t ulLength;
+   size_t ulSize;
+};
+
+/* The header of psTree's segment */
+#define HEADER(psTree) ((struct shmHeader *) (psTree)->pcBase)
+
+/* The node at offset ulNode of psTree, for writers, which hold the
+   lock and so can trust every offset */
+#define NODE(psTree, ulNode) ((struct shmNode *) ((psTree)->pcBase + (ulNode)))
+
+/* The path of node psNode */
+#define PATH(psNode) ((const char *) ((psNode) + 1))
+
+/* The child array at offset ulKids of psTree, for writers */
+#define KIDS(psTree, ulKids) ((uint64_t *) ((psTree)->pcBase + (ulKids)))
+
+/* Reads x, which a writer may be changing, exactly once; torn or
+   stale values are caught by the sequence count, but each must be
+   checked once and then used as checked */
+#define LOAD(x) __atomic_load_n(&(x), __ATOMIC_RELAXED)
+
+/*---------------------------------------------------------------*/
+
+/*
+  Returns the ulLength bytes at offset ulOffset of psTree, or NULL if
+  ulOffset is 0 or they are not all inside the segment.
+*/
+static const void *ShmFT_at(const struct ShmFT *psTree, uint64_t ulOffset,
+                            uint64_t ulLength) {
+   if(ulOffset == 0 || ulOffset > psTree->ulSize ||
+      ulLength > psTree->ulSize - ulOffset)
+      return NULL;
+   return psTree->pcBase + ulOffset;
+}
+
+/*
+  Returns the node at offset ulNode of psTree, storing the length of
+  its path in *pulPathLength, or NULL if the node or its path is not
+  inside the segment.
+*/
+static const struct shmNode *ShmFT_node(const struct ShmFT *psTree,
+                                        uint64_t ulNode,
+                                        size_t *pulPathLength) {
+   const struct shmNode *psNode = ShmFT_at(psTree, ulNode, sizeof(*psNode));
+
+   if(psNode == NULL)
+      return NULL;
+   *pulPathLength = LOAD(psNode->uiPathLength);
+   if(ShmFT_at(psTree, ulNode + sizeof(*psNode),
+               (uint64_t) *pulPathLength + 1) == NULL)
+      return NULL;
+   return psNode;
+}
+
+/*
+  Returns SUCCESS if pcPath is a well-formed absolute path: not
+  empty, neither starting nor ending with '/', and without "//".
+  Returns BAD_PATH otherwise.
+*/
+static int ShmFT_checkPath(const char *pcPath) {
+   size_t ulIndex;
+
+   if(pcPath[0] == '\0' || pcPath[0] == '/')
+      return BAD_PATH;
+   for(ulIndex = 1; pcPath[ulIndex] != '\0'; ulIndex++)
+      if(pcPath[ulIndex] == '/' && pcPath[ulIndex - 1] == '/')
+         return BAD_PATH;
+   return pcPath[ulIndex - 1] == '/' ? BAD_PATH : SUCCESS;
+}
+
+/*
+  Searches the uiCount children at offset ulKids of psTree for the
+  path made of the first ulLength characters of pcPath. Returns TRUE
+  and stores the child in *pulChild if found, or returns FALSE; in
+  either case stores in *pulIndex the index at which such a child is
+  or would be. Returns TORN if it reads outside the segment.
+*/
+static int ShmFT_search(const struct ShmFT *psTree, uint64_t ulKids,
+                        uint32_t uiCount, const char *pcPath,
+                        size_t ulLength, size_t *pulIndex,
+                        uint64_t *pulChild) {
+   const uint64_t *pulKids;
+   const struct shmNode *psChild;
+   size_t ulLow = 0, ulHigh = uiCount, ulMid, ulChildLength;
+   uint64_t ulChild;
+   int iCmp;
+
+   *pulIndex = 0;
+   if(uiCount == 0)
+      return FALSE;
+   pulKids = ShmFT_at(psTree, ulKids, (uint64_t) uiCount * sizeof(uint64_t));
+   if(pulKids == NULL)
+      return TORN;
+
+   while(ulLow < ulHigh) {
+      ulMid = ulLow + (ulHigh - ulLow) / 2;
+      ulChild = LOAD(pulKids[ulMid]);
+      psChild = ShmFT_node(psTree, ulChild, &ulChildLength);
+      if(psChild == NULL)
+         return TORN;
+      /* the order of strcmp, without needing pcPath's prefix to end
+         in a '\0' */
+      iCmp = memcmp(PATH(psChild), pcPath,
+                    ulChildLength < ulLength ? ulChildLength : ulLength);
+      if(iCmp == 0)
+         iCmp = (ulChildLength > ulLength) - (ulChildLength < ulLength);
+      if(iCmp == 0) {
+         *pulIndex = ulMid;
+         *pulChild = ulChild;
+         return TRUE;
+      }
+      if(iCmp < 0)
+         ulLow = ulMid + 1;
+      else
+         ulHigh = ulMid;
+   }
+   *pulIndex = ulLow;
+   return FALSE;
+}
+
+/*
+  Follows absolute path pcPath down psTree as far as it goes, storing
+  the furthest node reached (0 if the tree is empty) in *pulFurthest
+  and the length of its path in *pulReached. Returns SUCCESS, or:
+  * CONFLICTING_PATH if the root's path is not a prefix of pcPath
+  * NOT_A_DIRECTORY if a proper prefix of pcPath is a file
+  * TORN if it read outside the segment
+*/
+static int ShmFT_walk(const struct ShmFT *psTree, const char *pcPath,
+                      uint64_t *pulFurthest, size_t *pulReached) {
+   const struct shmNode *psNode;
+   uint64_t ulNode, ulChild = 0;
+   size_t ulLength, ulPathLength, ulEnd, ulIndex;
+   int iKind, iFound = FALSE;
+
+   *pulFurthest = 0;
+   *pulReached = 0;
+   ulNode = LOAD(HEADER(psTree)->ulRoot);
+   if(ulNode == 0)
+      return SUCCESS;
+   psNode = ShmFT_node(psTree, ulNode, &ulPathLength);
+   if(psNode == NULL)
+      return TORN;
+   ulLength = strcspn(pcPath, "/");
+   if(ulPathLength != ulLength || memcmp(PATH(psNode), pcPath, ulLength) != 0)
+      return CONFLICTING_PATH;
+
+   while(pcPath[ulLength] != '\0') {
+      if(LOAD(psNode->uiIsFile))
+         return NOT_A_DIRECTORY;
+      ulEnd = ulLength + 1 + strcspn(pcPath + ulLength + 1, "/");
+      for(iKind = 0; iKind < KINDS; iKind++) {
+         iFound = ShmFT_search(psTree, LOAD(psNode->aulKids[iKind]),
+                               LOAD(psNode->auiNumKids[iKind]), pcPath,
+                               ulEnd, &ulIndex, &ulChild);
+         if(iFound != FALSE)
+            break;
+      }
+      if(iFound == TORN)
+         return TORN;
+      if(!iFound)
+         break;
+      ulNode = ulChild;
+      psNode = ShmFT_node(psTree, ulNode, &ulPathLength);
+      if(psNode == NULL)
+         return TORN;
+      ulLength = ulEnd;
+   }
+
+   *pulFurthest = ulNode;
+   *pulReached = ulLength;
+   return SUCCESS;
+}
+
+/*
+  Finds the node with absolute path pcPath, which must be well
+  formed, in psTree, storing it in *pulNode. Returns SUCCESS,
+  NO_SUCH_PATH, or a status of ShmFT_walk.
+*/
+static int ShmFT_find(const struct ShmFT *psTree, const char *pcPath,
+                      uint64_t *pulNode) {
+   size_t ulReached;
+   int iStatus;
+
+   iStatus = ShmFT_walk(psTree, pcPath, pulNode, &ulReached);
+   if(iStatus == SUCCESS &&
+      (*pulNode == 0 || pcPath[ulReached] != '\0'))
+      iStatus = NO_SUCH_PATH;
+   return iStatus;
+}
+
+/*---------------------------------------------------------------*/
+
+/*
+  Starts a change to psTree: takes the write lock and makes the
+  sequence count odd, so that queries under way will start over.
+*/
+static void ShmFT_beginWrite(struct ShmFT *psTree) {
+   struct shmHeader *psHeader = HEADER(psTree);
+
+   assert(psTree->bWritable);
+
+   pthread_mutex_lock(&psHeader->sWriteLock);
+   __atomic_store_n(&psHeader->ulSeq, psHeader->ulSeq + 1, __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/* Finishes a change to psTree begun by ShmFT_beginWrite. */
+static void ShmFT_endWrite(struct ShmFT *psTree) {
+   struct shmHeader *psHeader = HEADER(psTree);
+
+   __atomic_store_n(&psHeader->ulSeq, psHeader->ulSeq + 1, __ATOMIC_RELEASE);
+   pthread_mutex_unlock(&psHeader->sWriteLock);
+}
+
+/*
+  Allocates a block of at least ulBytes from psTree's heap. Returns
+  the offset of its usable part, or 0 if the segment is full.
+*/
+static uint64_t ShmFT_alloc(struct ShmFT *psTree, size_t ulBytes) {
+   struct shmHeader *psHeader = HEADER(psTree);
+   uint64_t ulBlock, ulBlockSize = MIN_BLOCK;
+   size_t ulClass = 0;
+
+   if(ulBytes > psTree->ulSize)
+      return 0;
+   while(ulBlockSize < ulBytes + BLOCK_HEADER) {
+      ulBlockSize *= 2;
+      if(++ulClass == NUM_CLASSES)
+         return 0;
+   }
+
+   ulBlock = psHeader->aulFree[ulClass];
+   if(ulBlock != 0)
+      psHeader->aulFree[ulClass] =
+         *(uint64_t *) (psTree->pcBase + ulBlock + BLOCK_HEADER);
+   else {
+      if(ulBlockSize > psTree->ulSize - psHeader->ulTop)
+         return 0;
+      ulBlock = psHeader->ulTop;
+      psHeader->ulTop += ulBlockSize;
+      *(uint64_t *) (psTree->pcBase + ulBlock) = ulClass;
+   }
+   return ulBlock + BLOCK_HEADER;
+}
+
+/*
+  Returns the block whose usable part is at ulOffset (nothing if 0)
+  to psTree's heap.
+*/
+static void ShmFT_release(struct ShmFT *psTree, uint64_t ulOffset) {
+   struct shmHeader *psHeader = HEADER(psTree);
+   uint64_t ulBlock, ulClass;
+
+   if(ulOffset == 0)
+      return;
+   ulBlock = ulOffset - BLOCK_HEADER;
+   ulClass = *(uint64_t *) (psTree->pcBase + ulBlock);
+   *(uint64_t *) (psTree->pcBase + ulOffset) = psHeader->aulFree[ulClass];
+   psHeader->aulFree[ulClass] = ulBlock;
+}
+
+/*
+  Inserts node ulNode, a child of directory psParent of kind iKind,
+  into that kind's child array at index ulIndex, growing the array if
+  it is full. Returns SUCCESS or MEMORY_ERROR.
+*/
+static int ShmFT_link(struct ShmFT *psTree, struct shmNode *psParent,
+                      int iKind, size_t ulIndex, uint64_t ulNode) {
+   uint32_t uiCount = psParent->auiNumKids[iKind];
+   uint32_t uiCapacity;
+   uint64_t ulKids;
+
+   if(uiCount == psParent->auiKidCapacity[iKind]) {
+      if(uiCount == (uint32_t) -1)
+         return MEMORY_ERROR;
+      uiCapacity = uiCount == 0 ? INITIAL_KIDS
+                   : uiCount > (uint32_t) -1 / 2 ? (uint32_t) -1
+                   : uiCount * 2;
+      ulKids = ShmFT_alloc(psTree, (size_t) uiCapacity * sizeof(uint64_t));
+      if(ulKids == 0)
+         return MEMORY_ERROR;
+      if(uiCount > 0)
+         memcpy(KIDS(psTree, ulKids), KIDS(psTree, psParent->aulKids[iKind]),
+                uiCount * sizeof(uint64_t));
+      ShmFT_release(psTree, psParent->aulKids[iKind]);
+      psParent->aulKids[iKind] = ulKids;
+      psParent->auiKidCapacity[iKind] = uiCapacity;
+   }
+
+   ulKids = psParent->aulKids[iKind];
+   memmove(KIDS(psTree, ulKids) + ulIndex + 1, KIDS(psTree, ulKids) + ulIndex,
+           (uiCount - ulIndex) * sizeof(uint64_t));
+   KIDS(psTree, ulKids)[ulIndex] = ulNode;
+   psParent->auiNumKids[iKind] = uiCount + 1;
+   return SUCCESS;
+}
+
+/*
+  Removes node ulNode from its parent's child array, or makes the
+  tree empty if it is the root.
+*/
+static void ShmFT_detach(struct ShmFT *psTree, uint64_t ulNode) {
+   struct shmNode *psNode = NODE(psTree, ulNode), *psParent;
+   int iKind = psNode->uiIsFile ? FILE_KIDS : DIR_KIDS;
+   size_t ulIndex;
+   uint64_t ulFound = 0;
+   uint64_t *pulKids;
+
+   if(psNode->ulParent == 0) {
+      HEADER(psTree)->ulRoot = 0;
+      return;
+   }
+   psParent = NODE(psTree, psNode->ulParent);
+   (void) ShmFT_search(psTree, psParent->aulKids[iKind],
+                       psParent->auiNumKids[iKind], PATH(psNode),
+                       psNode->uiPathLength, &ulIndex, &ulFound);
+   assert(ulFound == ulNode);
+   pulKids = KIDS(psTree, psParent->aulKids[iKind]);
+   memmove(pulKids + ulIndex, pulKids + ulIndex + 1,
+           (psParent->auiNumKids[iKind] - ulIndex - 1) * sizeof(uint64_t));
+   psParent->auiNumKids[iKind]--;
+}
+
+/*
+  Frees node ulNode and everything below it, which must already be
+  unlinked from the tree. Returns the number of nodes freed.
+*/
+static size_t ShmFT_freeSubtree(struct ShmFT *psTree, uint64_t ulNode) {
+   struct shmNode *psNode = NODE(psTree, ulNode);
+   size_t ulFreed = 1;
+   uint32_t uiIndex;
+   int iKind;
+
+   for(iKind = 0; iKind < KINDS; iKind++) {
+      for(uiIndex = 0; uiIndex < psNode->auiNumKids[iKind]; uiIndex++)
+         ulFreed += ShmFT_freeSubtree(psTree,
+                                      KIDS(psTree, psNode->aulKids[iKind])
+                                         [uiIndex]);
+      ShmFT_release(psTree, psNode->aulKids[iKind]);
+   }
+   ShmFT_release(psTree, psNode->ulContents);
+   ShmFT_release(psTree, ulNode);
+   return ulFreed;
+}
+
+/*
+  Stores a copy of the ulLength bytes at pvContents (none if 0) in
+  psTree's heap, storing their offset in *pulContents. Returns
+  SUCCESS or MEMORY_ERROR.
+*/
+static int ShmFT_copyIn(struct ShmFT *psTree, const void *pvContents,
+                        size_t ulLength, uint64_t *pulContents) {
+   *pulContents = 0;
+   if(ulLength == 0)
+      return SUCCESS;
+   *pulContents = ShmFT_alloc(psTree, ulLength);
+   if(*pulContents == 0)
+      return MEMORY_ERROR;
+   memcpy(psTree->pcBase + *pulContents, pvContents, ulLength);
+   return SUCCESS;
+}
+
+/*
+  Creates the node whose path is the first ulLength characters of
+  pcPath under directory ulParent (0 for the root): a file holding a
+  copy of the ulContents bytes at pvContents if bIsFile, a directory
+  otherwise. Stores it in *pulNode and returns SUCCESS, or returns
+  MEMORY_ERROR.
+*/
+static int ShmFT_newNode(struct ShmFT *psTree, uint64_t ulParent,
+                         const char *pcPath, size_t ulLength,
+                         boolean bIsFile, const void *pvContents,
+                         size_t ulContents, uint64_t *pulNode) {
+   struct shmNode *psNode;
+   uint64_t ulNode, ulFound;
+   size_t ulIndex;
+   int iKind = bIsFile ? FILE_KIDS : DIR_KIDS;
+
+   if(ulLength > (uint32_t) -1 - 1)
+      return MEMORY_ERROR;
+   ulNode = ShmFT_alloc(psTree, sizeof(*psNode) + ulLength + 1);
+   if(ulNode == 0)
+      return MEMORY_ERROR;
+   psNode = NODE(psTree, ulNode);
+   memset(psNode, 0, sizeof(*psNode));
+   psNode->ulParent = ulParent;
+   psNode->uiPathLength = (uint32_t) ulLength;
+   psNode->uiIsFile = bIsFile;
+   memcpy((char *) (psNode + 1), pcPath, ulLength);
+   ((char *) (psNode + 1))[ulLength] = '\0';
+
+   if(bIsFile) {
+      psNode->ulLength = ulContents;
+      if(ShmFT_copyIn(psTree, pvContents, ulContents,
+                      &psNode->ulContents) != SUCCESS) {
+         ShmFT_release(psTree, ulNode);
+         return MEMORY_ERROR;
+      }
+   }
+
+   if(ulParent == 0)
+      HEADER(psTree)->ulRoot = ulNode;
+   else {
+      (void) ShmFT_search(psTree, NODE(psTree, ulParent)->aulKids[iKind],
+                          NODE(psTree, ulParent)->auiNumKids[iKind], pcPath,
+                          ulLength, &ulIndex, &ulFound);
+      if(ShmFT_link(psTree, NODE(psTree, ulParent), iKind, ulIndex,
+                    ulNode) != SUCCESS) {
+         ShmFT_release(psTree, psNode->ulContents);
+         ShmFT_release(psTree, ulNode);
+         return MEMORY_ERROR;
+      }
+   }
+   *pulNode = ulNode;
+   return SUCCESS;
+}
+
+/*
+  Inserts absolute path pcPath into psTree, with any missing
+  directories above it: a file holding a copy of the ulLength bytes
+  at pvContents if bIsFile, a directory otherwise. Returns as
+  FT_insertDir or FT_insertFile.
+*/
+static int ShmFT_insert(struct ShmFT *psTree, const char *pcPath,
+                        boolean bIsFile, const void *pvContents,
+                        size_t ulLength) {
+   uint64_t ulParent, ulNew, ulFirstNew = 0;
+   size_t ulReached, ulEnd, ulNewNodes = 0;
+   int iStatus;
+
+   assert(psTree != NULL);
+   assert(pcPath != NULL);
+   assert(pvContents != NULL || ulLength == 0);
+
+   iStatus = ShmFT_checkPath(pcPath);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   ShmFT_beginWrite(psTree);
+   if(bIsFile && (strchr(pcPath, '/') == NULL ||
+                  HEADER(psTree)->ulRoot == 0)) {
+      /* a file cannot be the root, or go anywhere without one */
+      ShmFT_endWrite(psTree);
+      return CONFLICTING_PATH;
+   }
+   iStatus = ShmFT_walk(psTree, pcPath, &ulParent, &ulReached);
+   if(iStatus == SUCCESS && ulParent != 0 && pcPath[ulReached] == '\0')
+      iStatus = ALREADY_IN_TREE;
+   else if(iStatus == SUCCESS && ulParent != 0 &&
+           NODE(psTree, ulParent)->uiIsFile)
+      iStatus = NOT_A_DIRECTORY;
+
+   /* build the rest of the path one level at a time */
+   while(iStatus == SUCCESS && (ulParent == 0 || pcPath[ulReached] != '\0')) {
+      ulEnd = ulParent == 0 ? strcspn(pcPath, "/")
+              : ulReached + 1 + strcspn(pcPath + ulReached + 1, "/");
+      iStatus = ShmFT_newNode(psTree, ulParent, pcPath, ulEnd,
+                              (boolean) (bIsFile && pcPath[ulEnd] == '\0'),
+                              pvContents, ulLength, &ulNew);
+      if(iStatus != SUCCESS) {
+         /* freeing the first new node frees the ones below it */
+         if(ulFirstNew != 0) {
+            ShmFT_detach(psTree, ulFirstNew);
+            (void) ShmFT_freeSubtree(psTree, ulFirstNew);
+         }
+         break;
+      }
+      if(ulFirstNew == 0)
+         ulFirstNew = ulNew;
+      ulNewNodes++;
+      ulParent = ulNew;
+      ulReached = ulEnd;
+   }
+
+   if(iStatus == SUCCESS)
+      HEADER(psTree)->ulCount += ulNewNodes;
+   ShmFT_endWrite(psTree);
+   return iStatus;
+}
+
+/*
+  Removes the node with absolute path pcPath from psTree, with
+  everything below it, if it is a file and bIsFile or a directory and
+  not bIsFile. Returns as FT_rmFile or FT_rmDir.
+*/
+static int ShmFT_remove(struct ShmFT *psTree, const char *pcPath,
+                        boolean bIsFile) {
+   uint64_t ulNode;
+   int iStatus;
+
+   assert(psTree != NULL);
+   assert(pcPath != NULL);
+
+   iStatus = ShmFT_checkPath(pcPath);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   ShmFT_beginWrite(psTree);
+   iStatus = ShmFT_find(psTree, pcPath, &ulNode);
+   if(iStatus == SUCCESS && (boolean) NODE(psTree, ulNode)->uiIsFile != bIsFile)
+      iStatus = bIsFile ? NOT_A_FILE : NOT_A_DIRECTORY;
+   if(iStatus == SUCCESS) {
+      ShmFT_detach(psTree, ulNode);
+      HEADER(psTree)->ulCount -= ShmFT_freeSubtree(psTree, ulNode);
+   }
+   ShmFT_endWrite(psTree);
+   return iStatus;
+}
+
+/*---------------------------------------------------------------*/
+
+ShmFT_T ShmFT_create(const char *pcName, size_t ulSize) {
+   struct ShmFT *psTree;
+   struct shmHeader *psHeader;
+   pthread_mutexattr_t sAttr;
+   void *pvBase;
+   int iFd;
+
+   assert(pcName != NULL);
+
+   if(ulSize < sizeof(struct shmHeader) + MIN_BLOCK)
+      return NULL;
+   psTree = malloc(sizeof(*psTree));
+   if(psTree == NULL)
+      return NULL;
+
+   iFd = shm_open(pcName, O_RDWR | O_CREAT | O_EXCL, 0600);
+   if(iFd < 0) {
+      free(psTree);
+      return NULL;
+   }
+   /* the segment is sparse: pages are only used once written */
+   if(ftruncate(iFd, (off_t) ulSize) < 0 ||
+      (pvBase = mmap(NULL, ulSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     iFd, 0)) == MAP_FAILED) {
+      (void) close(iFd);
+      (void) shm_unlink(pcName);
+      free(psTree);
+      return NULL;
+   }
+   (void) close(iFd);
+
+   psTree->pcBase = pvBase;
+   psTree->ulSize = ulSize;
+   psTree->bWritable = TRUE;
+
+   psHeader = HEADER(psTree);
+   psHeader->ulSize = ulSize;
+   psHeader->ulSeq = 0;
+   psHeader->ulRoot = 0;
+   psHeader->ulCount = 0;
+   psHeader->ulTop = (sizeof(*psHeader) + MIN_BLOCK - 1) / MIN_BLOCK *
+                     MIN_BLOCK;
+   memset(psHeader->aulFree, 0, sizeof(psHeader->aulFree));
+   pthread_mutexattr_init(&sAttr);
+   pthread_mutexattr_setpshared(&sAttr, PTHREAD_PROCESS_SHARED);
+   pthread_mutex_init(&psHeader->sWriteLock, &sAttr);
+   pthread_mutexattr_destroy(&sAttr);
+   /* only now can ShmFT_open take the segment for a tree */
+   __atomic_store_n(&psHeader->ulMagic, SHMFT_MAGIC, __ATOMIC_RELEASE);
+   return psTree;
+}
+
+ShmFT_T ShmFT_open(const char *pcName, boolean bWritable) {
+   struct ShmFT *psTree;
+   struct stat sStat;
+   void *pvBase;
+   int iFd;
+
+   assert(pcName != NULL);
+
+   psTree = malloc(sizeof(*psTree));
+   if(psTree == NULL)
+      return NULL;
+   iFd = shm_open(pcName, bWritable ? O_RDWR : O_RDONLY, 0);
+   if(iFd < 0) {
+      free(psTree);
+      return NULL;
+   }
+   if(fstat(iFd, &sStat) < 0 ||
+      (size_t) sStat.st_size < sizeof(struct shmHeader) ||
+      (pvBase = mmap(NULL, (size_t) sStat.st_size,
+                     bWritable ? PROT_READ | PROT_WRITE : PROT_READ,
+                     MAP_SHARED, iFd, 0)) == MAP_FAILED) {
+      (void) close(iFd);
+      free(psTree);
+      return NULL;
+   }
+   (void) close(iFd);
+
+   psTree->pcBase = pvBase;
+   psTree->ulSize = (size_t) sStat.st_size;
+   psTree->bWritable = bWritable;
+   if(__atomic_load_n(&HEADER(psTree)->ulMagic, __ATOMIC_ACQUIRE) !=
+         SHMFT_MAGIC ||
+      HEADER(psTree)->ulSize != psTree->ulSize) {
+      ShmFT_close(psTree);
+      return NULL;
+   }
+   return psTree;
+}
+
+void ShmFT_close(ShmFT_T oSTree) {
+   if(oSTree == NULL)
+      return;
+   (void) munmap(oSTree->pcBase, oSTree->ulSize);
+   free(oSTree);
+}
+
+int ShmFT_unlink(const char *pcName) {
+   assert(pcName != NULL);
+   return shm_unlink(pcName) == 0 ? SUCCESS : NO_SUCH_PATH;
+}
+
+int ShmFT_insertDir(ShmFT_T oSTree, const char *pcPath) {
+   return ShmFT_insert(oSTree, pcPath, FALSE, NULL, 0);
+}
+
+int ShmFT_insertFile(ShmFT_T oSTree, const char *pcPath,
+                     const void *pvContents, size_t ulLength) {
+   return ShmFT_insert(oSTree, pcPath, TRUE, pvContents, ulLength);
+}
+
+int ShmFT_rmDir(ShmFT_T oSTree, const char *pcPath) {
+   return ShmFT_remove(oSTree, pcPath, FALSE);
+}
+
+int ShmFT_rmFile(ShmFT_T oSTree, const char *pcPath) {
+   return ShmFT_remove(oSTree, pcPath, TRUE);
+}
+
+int ShmFT_replaceFileContents(ShmFT_T oSTree, const char *pcPath,
+                              const void *pvNewContents, size_t ulLength) {
+   struct shmNode *psNode;
+   uint64_t ulNode, ulContents;
+   int iStatus;
+
+   assert(oSTree != NULL);
+   assert(pcPath != NULL);
+   assert(pvNewContents != NULL || ulLength == 0);
+
+   iStatus = ShmFT_checkPath(pcPath);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   ShmFT_beginWrite(oSTree);
+   iStatus = ShmFT_find(oSTree, pcPath, &ulNode);
+   if(iStatus == SUCCESS && !NODE(oSTree, ulNode)->uiIsFile)
+      iStatus = NOT_A_FILE;
+   if(iStatus == SUCCESS)
+      iStatus = ShmFT_copyIn(oSTree, pvNewContents, ulLength, &ulContents);
+   if(iStatus == SUCCESS) {
+      psNode = NODE(oSTree, ulNode);
+      ShmFT_release(oSTree, psNode->ulContents);
+      psNode->ulContents = ulContents;
+      psNode->ulLength = ulLength;
+   }
+   ShmFT_endWrite(oSTree);
+   return iStatus;
+}
+
+int ShmFT_clear(ShmFT_T oSTree) {
+   struct shmHeader *psHeader;
+
+   assert(oSTree != NULL);
+
+   ShmFT_beginWrite(oSTree);
+   psHeader = HEADER(oSTree);
+   /* with no nodes left the whole heap is free */
+   psHeader->ulRoot = 0;
+   psHeader->ulCount = 0;
+   psHeader->ulTop = (sizeof(*psHeader) + MIN_BLOCK - 1) / MIN_BLOCK *
+                     MIN_BLOCK;
+   memset(psHeader->aulFree, 0, sizeof(psHeader->aulFree));
+   ShmFT_endWrite(oSTree);
+   return SUCCESS;
+}
+
+unsigned long ShmFT_readBegin(ShmFT_T oSTree) {
+   uint64_t ulSeq;
+
+   assert(oSTree != NULL);
+
+   while((ulSeq = __atomic_load_n(&HEADER(oSTree)->ulSeq,
+                                  __ATOMIC_ACQUIRE)) % 2 != 0)
+      (void) sched_yield();
+   return (unsigned long) ulSeq;
+}
+
+boolean ShmFT_readValid(ShmFT_T oSTree, unsigned long ulToken) {
+   assert(oSTree != NULL);
+
+   __atomic_thread_fence(__ATOMIC_ACQUIRE);
+   return (boolean) (LOAD(HEADER(oSTree)->ulSeq) == ulToken);
+}
+
+/*
+  Looks up absolute path pcPath in psTree, storing whether it is a
+  file, and if so the offset and length of its contents, in
+  *pbIsFile, *pulContents and *pulLength. Returns as FT_stat.
+*/
+static int ShmFT_lookup(const struct ShmFT *psTree, const char *pcPath,
+                        boolean *pbIsFile, uint64_t *pulContents,
+                        size_t *pulLength) {
+   const struct shmNode *psNode;
+   uint64_t ulNode;
+   unsigned long ulToken;
+   size_t ulPathLength;
+   int iStatus;
+
+   assert(psTree != NULL);
+   assert(pcPath != NULL);
+
+   iStatus = ShmFT_checkPath(pcPath);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   do {
+      ulToken = ShmFT_readBegin((ShmFT_T) psTree);
+      iStatus = ShmFT_find(psTree, pcPath, &ulNode);
+      if(iStatus == SUCCESS) {
+         psNode = ShmFT_node(psTree, ulNode, &ulPathLength);
+         if(psNode == NULL)
+            iStatus = TORN;
+         else {
+            *pbIsFile = (boolean) (LOAD(psNode->uiIsFile) != 0);
+            *pulContents = LOAD(psNode->ulContents);
+            *pulLength = (size_t) LOAD(psNode->ulLength);
+         }
+      }
+   } while(iStatus == TORN || !ShmFT_readValid((ShmFT_T) psTree, ulToken));
+   return iStatus;
+}
+
+boolean ShmFT_containsDir(ShmFT_T oSTree, const char *pcPath) {
+   boolean bIsFile = FALSE;
+   uint64_t ulContents;
+   size_t ulLength;
+
+   return (boolean) (ShmFT_lookup(oSTree, pcPath, &bIsFile, &ulContents,
+                                  &ulLength) == SUCCESS && !bIsFile);
+}
+
+boolean ShmFT_containsFile(ShmFT_T oSTree, const char *pcPath) {
+   boolean bIsFile = FALSE;
+   uint64_t ulContents;
+   size_t ulLength;
+
+   return (boolean) (ShmFT_lookup(oSTree, pcPath, &bIsFile, &ulContents,
+                                  &ulLength) == SUCCESS && bIsFile);
+}
+
+int ShmFT_stat(ShmFT_T oSTree, const char *pcPath, boolean *pbIsFile,
+               size_t *pulSize) {
+   boolean bIsFile = FALSE;
+   uint64_t ulContents;
+   size_t ulLength = 0;
+   int iStatus;
+
+   assert(pbIsFile != NULL);
+   assert(pulSize != NULL);
+
+   iStatus = ShmFT_lookup(oSTree, pcPath, &bIsFile, &ulContents, &ulLength);
+   if(iStatus == SUCCESS) {
+      *pbIsFile = bIsFile;
+      if(bIsFile)
+         *pulSize = ulLength;
+   }
+   return iStatus;
+}
+
+const void *ShmFT_getFileContents(ShmFT_T oSTree, const char *pcPath,
+                                  size_t *pulLength) {
+   boolean bIsFile = FALSE;
+   uint64_t ulContents = 0;
+   const void *pvContents;
+
+   assert(pulLength != NULL);
+
+   *pulLength = 0;
+   if(ShmFT_lookup(oSTree, pcPath, &bIsFile, &ulContents,
+                   pulLength) != SUCCESS || !bIsFile)
+      return NULL;
+   /* checked again in case they were replaced since the lookup */
+   pvContents = ShmFT_at(oSTree, ulContents, *pulLength);
+   if(pvContents == NULL)
+      *pulLength = 0;
+   return pvContents;
+}
+
+/*
+  Appends the ulLength bytes at pcData to psText. Returns TRUE, or
+  FALSE if memory could not be allocated.
+*/
+static boolean ShmFT_append(struct text *psText, const char *pcData,
+                            size_t ulLength) {
+   size_t ulSize;
+   char *pcGrown;
+
+   if(psText->ulSize - psText->ulLength < ulLength + 1) {
+      ulSize = psText->ulSize == 0 ? 4096 : psText->ulSize;
+      while(ulSize - psText->ulLength < ulLength + 1)
+         ulSize *= 2;
+      pcGrown = realloc(psText->pcData, ulSize);
+      if(pcGrown == NULL)
+         return FALSE;
+      psText->pcData = pcGrown;
+      psText->ulSize = ulSize;
+   }
+   memcpy(psText->pcData + psText->ulLength, pcData, ulLength);
+   psText->ulLength += ulLength;
+   psText->pcData[psText->ulLength] = '\0';
+   return TRUE;
+}
+
+/*
+  Appends a line for node ulNode of psTree, and then for everything
+  below it, files before directories, to psText. Returns SUCCESS,
+  MEMORY_ERROR, or TORN if it read outside the segment, found a child
+  whose path does not extend its parent's (which only a change can
+  make it see), or the tree changed since ShmFT_readBegin returned
+  ulToken.
+*/
+static int ShmFT_appendLines(const struct ShmFT *psTree, uint64_t ulNode,
+                             size_t ulParentLength, unsigned long ulToken,
+                             struct text *psText) {
+   const struct shmNode *psNode;
+   const uint64_t *pulKids;
+   size_t ulPathLength;
+   uint64_t ulKids;
+   uint32_t uiCount, uiIndex;
+   boolean bIsFile;
+   int iKind, iStatus;
+
+   if(!ShmFT_readValid((ShmFT_T) psTree, ulToken))
+      return TORN;
+   psNode = ShmFT_node(psTree, ulNode, &ulPathLength);
+   if(psNode == NULL || ulPathLength <= ulParentLength)
+      return TORN;
+   bIsFile = (boolean) (LOAD(psNode->uiIsFile) != 0);
+   if(!ShmFT_append(psText, bIsFile ? "File: " : "Dir:  ", 6) ||
+      !ShmFT_append(psText, PATH(psNode), ulPathLength) ||
+      !ShmFT_append(psText, "\n", 1))
+      return MEMORY_ERROR;
+   if(bIsFile)
+      return SUCCESS;
+
+   for(iKind = 0; iKind < KINDS; iKind++) {
+      ulKids = LOAD(psNode->aulKids[iKind]);
+      uiCount = LOAD(psNode->auiNumKids[iKind]);
+      if(uiCount == 0)
+         continue;
+      pulKids = ShmFT_at(psTree, ulKids, (uint64_t) uiCount * sizeof(uint64_t));
+      if(pulKids == NULL)
+         return TORN;
+      for(uiIndex = 0; uiIndex < uiCount; uiIndex++) {
+         iStatus = ShmFT_appendLines(psTree, LOAD(pulKids[uiIndex]),
+                                     ulPathLength, ulToken, psText);
+         if(iStatus != SUCCESS)
+            return iStatus;
+      }
+   }
+   return SUCCESS;
+}
+
+char *ShmFT_toString(ShmFT_T oSTree) {
+   struct text sText;
+   unsigned long ulToken;
+   uint64_t ulRoot;
+   int iStatus;
+
+   assert(oSTree != NULL);
+
+   sText.pcData = NULL;
+   sText.ulSize = 0;
+   do {
+      sText.ulLength = 0;
+      ulToken = ShmFT_readBegin(oSTree);
+      ulRoot = LOAD(HEADER(oSTree)->ulRoot);
+      iStatus = ShmFT_append(&sText, "", 0) ? SUCCESS : MEMORY_ERROR;
+      if(iStatus == SUCCESS && ulRoot != 0)
+         iStatus = ShmFT_appendLines(oSTree, ulRoot, 0, ulToken, &sText);
+   } while(iStatus == TORN || !ShmFT_readValid(oSTree, ulToken));
+
+   if(iStatus != SUCCESS) {
+      free(sText.pcData);
+      return NULL;
+   }
+   return sText.pcData;
+}
@@ -0,0 +1,129 @@
+/*--------------------------------------------------------------------*/
+/* shmFT.h                                                            */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+#ifndef SHMFT_INCLUDED
+#define SHMFT_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/*
+  A file tree that lives in a POSIX shared-memory segment, so that
+  many processes can share one namespace instead of each building its
+  own FT. It has the FT's operations and statuses, on a handle to the
+  segment.
+
+  Inside the segment nothing is a pointer: nodes, paths, child arrays
+  and contents refer to each other by their offset from the start of
+  the segment, so each process may map it at any address. The segment
+  has a fixed size, chosen when it is created; memory is only used as
+  the tree grows into it.
+
+  Changes are made under a process-shared mutex in the segment, so
+  any number of processes may write, each through a writable handle.
+  Queries take no lock and write nothing, so they work through a
+  read-only mapping: the segment has a sequence count that every
+  change makes odd while it is under way and then even again, and a
+  query that sees the count move while it reads starts over. Readers
+  therefore never wait for one another, and only wait for a writer
+  while a change is under way.
+
+  ShmFT_getFileContents returns the contents in place, with no copy.
+  They may change as soon as it returns, so a reader brackets its use
+  of them with ShmFT_readBegin and ShmFT_readValid:
+
+     do {
+        ulToken = ShmFT_readBegin(oSTree);
+        pvContents = ShmFT_getFileContents(oSTree, pcPath, &ulLength);
+        ... use pvContents, discarding the result if not valid ...
+     } while(!ShmFT_readValid(oSTree, ulToken));
+
+  A writer that dies during a change leaves the segment unusable.
+*/
+
+/* A process's handle on a shared tree */
+typedef struct ShmFT *ShmFT_T;
+
+/*
+  Creates the shared-memory segment pcName (a name for shm_open, such
+  as "/ft"), of ulSize bytes, holding an empty, initialized tree, and
+  returns a writable handle on it. Returns NULL if the segment
+  already exists or could not be created.
+*/
+ShmFT_T ShmFT_create(const char *pcName, size_t ulSize);
+
+/*
+  Returns a handle on the existing shared tree pcName, writable if
+  bWritable and read-only otherwise, or NULL if it could not be
+  opened or does not hold a tree.
+*/
+ShmFT_T ShmFT_open(const char *pcName, boolean bWritable);
+
+/*
+  Unmaps oSTree and frees the handle; the tree itself remains until
+  ShmFT_unlink.
+*/
+void ShmFT_close(ShmFT_T oSTree);
+
+/*
+  Removes the shared tree pcName; processes that have it open keep
+  using it until they close it. Returns SUCCESS or NO_SUCH_PATH.
+*/
+int ShmFT_unlink(const char *pcName);
+
+/* Changes, which need a writable handle; as in ft.h */
+int ShmFT_insertDir(ShmFT_T oSTree, const char *pcPath);
+int ShmFT_insertFile(ShmFT_T oSTree, const char *pcPath,
+                     const void *pvContents, size_t ulLength);
+int ShmFT_rmDir(ShmFT_T oSTree, const char *pcPath);
+int ShmFT_rmFile(ShmFT_T oSTree, const char *pcPath);
+
+/*
+  Replaces the contents of the file with absolute path pcPath with a
+  copy of the ulLength bytes at pvNewContents. The old contents may
+  still be in use by readers, so they are not returned. Returns
+  SUCCESS or one of FT_replaceFileContents's reasons for failure, as
+  a status.
+*/
+int ShmFT_replaceFileContents(ShmFT_T oSTree, const char *pcPath,
+                              const void *pvNewContents, size_t ulLength);
+
+/*
+  Removes every node, leaving the tree empty, as FT_destroy followed
+  by FT_init would. Returns SUCCESS.
+*/
+int ShmFT_clear(ShmFT_T oSTree);
+
+/* Queries, which also work on a read-only handle; as in ft.h */
+boolean ShmFT_containsDir(ShmFT_T oSTree, const char *pcPath);
+boolean ShmFT_containsFile(ShmFT_T oSTree, const char *pcPath);
+int ShmFT_stat(ShmFT_T oSTree, const char *pcPath, boolean *pbIsFile,
+               size_t *pulSize);
+char *ShmFT_toString(ShmFT_T oSTree);
+
+/*
+  Returns the contents of the file with absolute path pcPath in
+  place, storing their length in *pulLength, or returns NULL if there
+  is no such file or it is empty. The contents are only known to be
+  intact if ShmFT_readValid, given a token ShmFT_readBegin returned
+  before this call, returns TRUE after they have been used.
+*/
+const void *ShmFT_getFileContents(ShmFT_T oSTree, const char *pcPath,
+                                  size_t *pulLength);
+
+/*
+  Waits until no change is under way and returns a token for
+  ShmFT_readValid.
+*/
+unsigned long ShmFT_readBegin(ShmFT_T oSTree);
+
+/*
+  Returns TRUE if the tree has not changed since ShmFT_readBegin
+  returned ulToken, so that whatever was read from it since then is
+  intact.
+*/
+boolean ShmFT_readValid(ShmFT_T oSTree, unsigned long ulToken);
+
+#endif
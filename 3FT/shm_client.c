@@ -0,0 +1,231 @@
+/*--------------------------------------------------------------------*/
+/* shm_client.c                                                       */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+/* fork and waitpid */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "shmFT.h"
+
+/*
+  Tests shmFT.c: runs the FT's operations on a private segment,
+  checks that another process sees and changes the same tree, that a
+  reader through a read-only handle never keeps a torn read while a
+  writer replaces contents, and that a full segment reports
+  MEMORY_ERROR. Prints the tree along the way to stderr.
+*/
+
+/* Size of the main segment, and of the one filled to the brim */
+enum { SEGMENT_SIZE = 1 << 20, SMALL_SIZE = 1 << 16 };
+
+/* Replacements the writer makes while the reader reads */
+enum { REPLACEMENTS = 20000 };
+
+/* Length of the contents the writer and reader pass between them */
+enum { BLOCK_LENGTH = 256 };
+
+/* Waits for the child iPid and checks that it exited with status 0 */
+static void waitChild(pid_t iPid) {
+   int iStatus;
+
+   assert(waitpid(iPid, &iStatus, 0) == iPid);
+   assert(WIFEXITED(iStatus) && WEXITSTATUS(iStatus) == 0);
+}
+
+/* Checks the FT's operations through the writable handle oSTree */
+static void testSingle(ShmFT_T oSTree) {
+   unsigned long ulToken;
+   const void *pvContents;
+   boolean bIsFile;
+   size_t ulSize;
+   char *pcText;
+
+   assert(ShmFT_insertDir(oSTree, "1root//2child") == BAD_PATH);
+   assert(ShmFT_insertFile(oSTree, "A", NULL, 0) == CONFLICTING_PATH);
+   assert(ShmFT_insertDir(oSTree, "1root/2child") == SUCCESS);
+   assert(ShmFT_insertDir(oSTree, "1root/2child") == ALREADY_IN_TREE);
+   assert(ShmFT_insertDir(oSTree, "2root") == CONFLICTING_PATH);
+   assert(ShmFT_insertFile(oSTree, "1root/2child/C", "Ritchie",
+                           strlen("Ritchie") + 1) == SUCCESS);
+   assert(ShmFT_insertFile(oSTree, "1root/empty", NULL, 0) == SUCCESS);
+   assert(ShmFT_insertDir(oSTree, "1root/2child/C/x") == NOT_A_DIRECTORY);
+   assert(ShmFT_containsDir(oSTree, "1root/2child") == TRUE);
+   assert(ShmFT_containsFile(oSTree, "1root/2child") == FALSE);
+   assert(ShmFT_containsFile(oSTree, "1root/2child/C") == TRUE);
+
+   assert(ShmFT_stat(oSTree, "1root/2child/C", &bIsFile, &ulSize) ==
+          SUCCESS);
+   assert(bIsFile == TRUE && ulSize == strlen("Ritchie") + 1);
+   assert(ShmFT_stat(oSTree, "1root/none", &bIsFile, &ulSize) ==
+          NO_SUCH_PATH);
+
+   /* contents are read in place, and only trusted once validated */
+   do {
+      ulToken = ShmFT_readBegin(oSTree);
+      pvContents = ShmFT_getFileContents(oSTree, "1root/2child/C", &ulSize);
+      assert(pvContents != NULL && ulSize == strlen("Ritchie") + 1);
+   } while(!ShmFT_readValid(oSTree, ulToken));
+   assert(!strcmp(pvContents, "Ritchie"));
+   assert(ShmFT_getFileContents(oSTree, "1root/empty", &ulSize) == NULL);
+   assert(ShmFT_replaceFileContents(oSTree, "1root/2child/C", "Thompson",
+                                    strlen("Thompson") + 1) == SUCCESS);
+   assert(ShmFT_replaceFileContents(oSTree, "1root/2child", "x", 1) ==
+          NOT_A_FILE);
+   pvContents = ShmFT_getFileContents(oSTree, "1root/2child/C", &ulSize);
+   assert(pvContents != NULL && !strcmp(pvContents, "Thompson"));
+
+   assert((pcText = ShmFT_toString(oSTree)) != NULL);
+   fprintf(stderr, "Checkpoint 1:\n%s\n", pcText);
+   assert(!strcmp(pcText, "Dir:  1root\nFile: 1root/empty\n"
+                  "Dir:  1root/2child\nFile: 1root/2child/C\n"));
+   free(pcText);
+
+   assert(ShmFT_rmDir(oSTree, "1root/2child/C") == NOT_A_DIRECTORY);
+   assert(ShmFT_rmFile(oSTree, "1root/2child/C") == SUCCESS);
+   assert(ShmFT_rmFile(oSTree, "1root/2child/C") == NO_SUCH_PATH);
+}
+
+/*
+  Checks that a child process sees the tree of pcName and that what
+  it inserts is seen here.
+*/
+static void testShared(ShmFT_T oSTree, const char *pcName) {
+   ShmFT_T oSChild;
+   pid_t iPid;
+
+   iPid = fork();
+   assert(iPid >= 0);
+   if(iPid == 0) {
+      oSChild = ShmFT_open(pcName, TRUE);
+      if(oSChild == NULL ||
+         ShmFT_containsDir(oSChild, "1root/2child") != TRUE ||
+         ShmFT_insertFile(oSChild, "1root/2child/B", "Kernighan",
+                          strlen("Kernighan") + 1) != SUCCESS)
+         _exit(1);
+      ShmFT_close(oSChild);
+      _exit(0);
+   }
+   waitChild(iPid);
+   assert(ShmFT_containsFile(oSTree, "1root/2child/B") == TRUE);
+}
+
+/*
+  Has a child process replace the contents of one file over and over
+  with blocks all of one byte, while this process reads it through a
+  read-only handle, and checks that every read validated is of one
+  block.
+*/
+static void testTorn(ShmFT_T oSTree, const char *pcName) {
+   char acBlock[BLOCK_LENGTH];
+   const char *pcContents;
+   unsigned long ulToken, ulReads = 0;
+   ShmFT_T oSReader;
+   size_t ulSize, ulIndex;
+   boolean bSame;
+   pid_t iPid;
+   int iStatus;
+
+   memset(acBlock, 'a', BLOCK_LENGTH);
+   assert(ShmFT_insertFile(oSTree, "1root/block", acBlock, BLOCK_LENGTH) ==
+          SUCCESS);
+
+   iPid = fork();
+   assert(iPid >= 0);
+   if(iPid == 0) {
+      for(ulIndex = 0; ulIndex < REPLACEMENTS; ulIndex++) {
+         memset(acBlock, 'a' + (int) (ulIndex % 26), BLOCK_LENGTH);
+         if(ShmFT_replaceFileContents(oSTree, "1root/block", acBlock,
+                                      BLOCK_LENGTH) != SUCCESS)
+            _exit(1);
+      }
+      _exit(0);
+   }
+
+   oSReader = ShmFT_open(pcName, FALSE);
+   assert(oSReader != NULL);
+   while(waitpid(iPid, &iStatus, WNOHANG) == 0) {
+      do {
+         ulToken = ShmFT_readBegin(oSReader);
+         pcContents = ShmFT_getFileContents(oSReader, "1root/block",
+                                            &ulSize);
+         bSame = pcContents != NULL && ulSize == BLOCK_LENGTH;
+         for(ulIndex = 1; bSame && ulIndex < ulSize; ulIndex++)
+            bSame = pcContents[ulIndex] == pcContents[0];
+      } while(!ShmFT_readValid(oSReader, ulToken));
+      assert(bSame);
+      ulReads++;
+   }
+   assert(WIFEXITED(iStatus) && WEXITSTATUS(iStatus) == 0);
+   ShmFT_close(oSReader);
+   fprintf(stderr, "%lu reads during %d replacements, none torn\n",
+           ulReads, REPLACEMENTS);
+}
+
+/* Checks that filling the segment pcName gives MEMORY_ERROR and that
+   clearing it makes room again */
+static void testFull(const char *pcName) {
+   char acBlock[1024], acPath[32];
+   ShmFT_T oSTree;
+   size_t ulIndex;
+   int iStatus = SUCCESS;
+
+   oSTree = ShmFT_create(pcName, SMALL_SIZE);
+   assert(oSTree != NULL);
+   memset(acBlock, 'x', sizeof(acBlock));
+   assert(ShmFT_insertDir(oSTree, "1root") == SUCCESS);
+   for(ulIndex = 0; iStatus == SUCCESS && ulIndex < SMALL_SIZE; ulIndex++) {
+      sprintf(acPath, "1root/%lu", (unsigned long) ulIndex);
+      iStatus = ShmFT_insertFile(oSTree, acPath, acBlock, sizeof(acBlock));
+   }
+   assert(iStatus == MEMORY_ERROR);
+   assert(ShmFT_containsFile(oSTree, acPath) == FALSE);
+   assert(ShmFT_clear(oSTree) == SUCCESS);
+   assert(ShmFT_containsDir(oSTree, "1root") == FALSE);
+   assert(ShmFT_insertDir(oSTree, "1root") == SUCCESS);
+   assert(ShmFT_insertFile(oSTree, "1root/0", acBlock, sizeof(acBlock)) ==
+          SUCCESS);
+   ShmFT_close(oSTree);
+   assert(ShmFT_unlink(pcName) == SUCCESS);
+}
+
+/* Runs the checks on segments private to this process. Returns 0. */
+int main(void) {
+   char acName[64];
+   ShmFT_T oSTree;
+   char *pcText;
+
+   sprintf(acName, "/shm_client.%ld", (long) getpid());
+   oSTree = ShmFT_create(acName, SEGMENT_SIZE);
+   assert(oSTree != NULL);
+   assert(ShmFT_create(acName, SEGMENT_SIZE) == NULL);
+
+   testSingle(oSTree);
+   testShared(oSTree, acName);
+   testTorn(oSTree, acName);
+
+   assert((pcText = ShmFT_toString(oSTree)) != NULL);
+   fprintf(stderr, "Checkpoint 2:\n%s\n", pcText);
+   free(pcText);
+   assert(ShmFT_clear(oSTree) == SUCCESS);
+   assert((pcText = ShmFT_toString(oSTree)) != NULL);
+   assert(!strcmp(pcText, ""));
+   free(pcText);
+   ShmFT_close(oSTree);
+
+   assert(ShmFT_unlink(acName) == SUCCESS);
+   assert(ShmFT_unlink(acName) == NO_SUCH_PATH);
+   assert(ShmFT_open(acName, FALSE) == NULL);
+
+   strcat(acName, ".small");
+   testFull(acName);
+   return 0;
+}
@@ -0,0 +1,202 @@
+/*--------------------------------------------------------------------*/
+/* snapFT.c                                                           */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+/* write(2) is POSIX, not C99 */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "snapFT.h"
+
+/* Most bytes one varint can take */
+enum { MAX_VARINT = 10 };
+
+/*
+  Writes the ulLength bytes at pvData to psWriter's file descriptor,
+  going on after short writes and interruptions. Sets bFailed if a
+  write fails.
+*/
+static void SnapFT_write(struct SnapFT_Writer *psWriter,
+                         const void *pvData, size_t ulLength) {
+   const char *pcAt = pvData;
+   ssize_t lWritten;
+
+   while(ulLength > 0 && !psWriter->bFailed) {
+      lWritten = write(psWriter->iFd, pcAt, ulLength);
+      if(lWritten < 0 && errno == EINTR)
+         continue;
+      if(lWritten <= 0) {
+         psWriter->bFailed = TRUE;
+         return;
+      }
+      pcAt += lWritten;
+      ulLength -= (size_t) lWritten;
+   }
+}
+
+/* Writes out what psWriter has buffered. */
+static void SnapFT_flush(struct SnapFT_Writer *psWriter) {
+   SnapFT_write(psWriter, psWriter->aucBuffer, psWriter->ulUsed);
+   psWriter->ulUsed = 0;
+}
+
+/*
+  Appends the ulLength bytes at pvData to psWriter, writing large
+  ones directly rather than through the buffer.
+*/
+static void SnapFT_append(struct SnapFT_Writer *psWriter,
+                          const void *pvData, size_t ulLength) {
+   if(ulLength == 0)
+      return;
+   if(ulLength > SNAPFT_BUFFER_SIZE - psWriter->ulUsed) {
+      SnapFT_flush(psWriter);
+      if(ulLength > SNAPFT_BUFFER_SIZE / 2) {
+         SnapFT_write(psWriter, pvData, ulLength);
+         return;
+      }
+   }
+   memcpy(psWriter->aucBuffer + psWriter->ulUsed, pvData, ulLength);
+   psWriter->ulUsed += ulLength;
+}
+
+/* Appends ulValue as a LEB128 varint to psWriter. */
+static void SnapFT_putVarint(struct SnapFT_Writer *psWriter,
+                             unsigned long ulValue) {
+   unsigned char aucVarint[MAX_VARINT];
+   size_t ulLength = 0;
+
+   while(ulValue >= 0x80) {
+      aucVarint[ulLength++] = (unsigned char) (ulValue | 0x80);
+      ulValue >>= 7;
+   }
+   aucVarint[ulLength++] = (unsigned char) ulValue;
+   SnapFT_append(psWriter, aucVarint, ulLength);
+}
+
+void SnapFT_begin(struct SnapFT_Writer *psWriter, int iFd) {
+   assert(psWriter != NULL);
+
+   psWriter->iFd = iFd;
+   psWriter->bFailed = FALSE;
+   psWriter->ulUsed = 0;
+   SnapFT_append(psWriter, SNAPFT_MAGIC, 8);
+}
+
+boolean SnapFT_put(struct SnapFT_Writer *psWriter, boolean bIsFile,
+                   const char *pcPath, const void *pvContents,
+                   size_t ulLength) {
+   unsigned char ucKind = bIsFile ? SNAPFT_FILE : SNAPFT_DIR;
+   size_t ulPathLen;
+
+   assert(psWriter != NULL);
+   assert(pcPath != NULL);
+   assert(pvContents != NULL || ulLength == 0);
+
+   ulPathLen = strlen(pcPath);
+   SnapFT_append(psWriter, &ucKind, 1);
+   SnapFT_putVarint(psWriter, ulPathLen);
+   SnapFT_append(psWriter, pcPath, ulPathLen);
+   if(bIsFile) {
+      SnapFT_putVarint(psWriter, ulLength);
+      SnapFT_append(psWriter, pvContents, ulLength);
+   }
+   return (boolean) !psWriter->bFailed;
+}
+
+boolean SnapFT_end(struct SnapFT_Writer *psWriter) {
+   unsigned char ucEnd = SNAPFT_END;
+
+   assert(psWriter != NULL);
+
+   SnapFT_append(psWriter, &ucEnd, 1);
+   SnapFT_flush(psWriter);
+   return (boolean) !psWriter->bFailed;
+}
+
+boolean SnapFT_readHeader(FILE *psFile) {
+   char acMagic[8];
+
+   assert(psFile != NULL);
+
+   if(fread(acMagic, 1, 8, psFile) != 8)
+      return FALSE;
+   return (boolean) (memcmp(acMagic, SNAPFT_MAGIC, 8) == 0);
+}
+
+/*
+  Reads one LEB128 varint from psFile into *pulValue. Returns TRUE on
+  success and FALSE at end of file or on an overlong encoding.
+*/
+static boolean SnapFT_getVarint(FILE *psFile, unsigned long *pulValue) {
+   unsigned long ulValue = 0;
+   unsigned int uiShift = 0;
+   int iByte;
+
+   do {
+      iByte = getc(psFile);
+      if(iByte == EOF || uiShift >= 7 * MAX_VARINT)
+         return FALSE;
+      ulValue |= (unsigned long) (iByte & 0x7f) << uiShift;
+      uiShift += 7;
+   } while(iByte & 0x80);
+
+   *pulValue = ulValue;
+   return TRUE;
+}
+
+int SnapFT_read(FILE *psFile, struct SnapFT_Node *psNode) {
+   unsigned long ulPathLen, ulLength = 0;
+   size_t ulNeeded;
+   char *pcNew;
+   int iKind;
+
+   assert(psFile != NULL);
+   assert(psNode != NULL);
+
+   iKind = getc(psFile);
+   if(iKind == SNAPFT_END)
+      return 0;
+   if(iKind != SNAPFT_DIR && iKind != SNAPFT_FILE)
+      return -1;
+   psNode->bIsFile = (boolean) (iKind == SNAPFT_FILE);
+
+   /* the path, its '\0', and for a file the contents after them */
+   if(!SnapFT_getVarint(psFile, &ulPathLen) || ulPathLen == 0)
+      return -1;
+   ulNeeded = ulPathLen + 1;
+   if(ulNeeded > psNode->ulBufferSize) {
+      pcNew = realloc(psNode->pcBuffer, ulNeeded);
+      if(pcNew == NULL)
+         return -1;
+      psNode->pcBuffer = pcNew;
+      psNode->ulBufferSize = ulNeeded;
+   }
+   if(fread(psNode->pcBuffer, 1, ulPathLen, psFile) != ulPathLen)
+      return -1;
+   psNode->pcBuffer[ulPathLen] = '\0';
+
+   if(psNode->bIsFile) {
+      if(!SnapFT_getVarint(psFile, &ulLength) ||
+         ulLength > (size_t) -1 - ulNeeded)
+         return -1;
+      if(ulNeeded + ulLength > psNode->ulBufferSize) {
+         pcNew = realloc(psNode->pcBuffer, ulNeeded + ulLength);
+         if(pcNew == NULL)
+            return -1;
+         psNode->pcBuffer = pcNew;
+         psNode->ulBufferSize = ulNeeded + ulLength;
+      }
+      if(fread(psNode->pcBuffer + ulNeeded, 1, ulLength, psFile) != ulLength)
+         return -1;
+   }
+
+   psNode->pcPath = psNode->pcBuffer;
+   psNode->pvContents = ulLength == 0 ? NULL : psNode->pcBuffer + ulNeeded;
+   psNode->ulLength = (size_t) ulLength;
+   return 1;
+}
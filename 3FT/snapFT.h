@@ -0,0 +1,92 @@
+/*--------------------------------------------------------------------*/
+/* snapFT.h                                                           */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+#ifndef SNAPFT_INCLUDED
+#define SNAPFT_INCLUDED
+
+#include <stddef.h>
+#include <stdio.h>
+#include "a4def.h"
+
+/*
+  Snapshot files of the FT, written by FT_saveAsync and read back by
+  FT_load. The file starts with the 8 bytes of SNAPFT_MAGIC. Each
+  node follows, parents before their children, as one byte (SNAPFT_DIR
+  or SNAPFT_FILE), a LEB128 varint holding the length of its path and
+  the path bytes, without a terminator; a file then has a varint
+  holding the length of its contents and the contents. A SNAPFT_END
+  byte ends the file, so that a truncated snapshot is detected.
+
+  The writer is meant for a child of fork in a process that may have
+  other threads, so it only uses write(2) and its own buffer: no
+  stdio and no allocation.
+*/
+
+#define SNAPFT_MAGIC "FTSNAP01"
+
+/* The kinds of record */
+enum { SNAPFT_DIR = 'D', SNAPFT_FILE = 'F', SNAPFT_END = 'E' };
+
+/* Bytes the writer buffers before each write(2) */
+enum { SNAPFT_BUFFER_SIZE = 1 << 16 };
+
+/* A snapshot being written to a file descriptor */
+struct SnapFT_Writer {
+   int iFd;
+   /* set once a write fails; everything after is dropped */
+   boolean bFailed;
+   size_t ulUsed;
+   unsigned char aucBuffer[SNAPFT_BUFFER_SIZE];
+};
+
+/* One node, as read back by SnapFT_read */
+struct SnapFT_Node {
+   boolean bIsFile;
+   /* the node's path, and for a file its contents (NULL if empty) and
+      their length; both point into pcBuffer */
+   const char *pcPath;
+   const void *pvContents;
+   size_t ulLength;
+   /* storage reused by the next SnapFT_read into this node, and its
+      allocated size */
+   char *pcBuffer;
+   size_t ulBufferSize;
+};
+
+/* Starts a snapshot on iFd in *psWriter, writing the magic header. */
+void SnapFT_begin(struct SnapFT_Writer *psWriter, int iFd);
+
+/*
+  Appends a node to the snapshot: the directory pcPath, or if bIsFile
+  the file pcPath holding the ulLength bytes at pvContents. Returns
+  FALSE if a write has failed.
+*/
+boolean SnapFT_put(struct SnapFT_Writer *psWriter, boolean bIsFile,
+                   const char *pcPath, const void *pvContents,
+                   size_t ulLength);
+
+/*
+  Ends the snapshot and writes out what is buffered. Returns TRUE if
+  every write succeeded, FALSE otherwise. Does not close the file
+  descriptor.
+*/
+boolean SnapFT_end(struct SnapFT_Writer *psWriter);
+
+/*
+  Reads and checks the magic header of the snapshot in psFile.
+  Returns TRUE if it is a snapshot, FALSE otherwise.
+*/
+boolean SnapFT_readHeader(FILE *psFile);
+
+/*
+  Reads the next node of the snapshot in psFile into *psNode, whose
+  pcBuffer and ulBufferSize must be NULL and 0 on first use; the
+  caller frees psNode->pcBuffer when done. Returns 1 if a node was
+  read, 0 at the end of the snapshot, and -1 if it is truncated or
+  malformed or memory ran out.
+*/
+int SnapFT_read(FILE *psFile, struct SnapFT_Node *psNode);
+
+#endif
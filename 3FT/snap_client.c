@@ -0,0 +1,149 @@
+/*--------------------------------------------------------------------*/
+/* snap_client.c                                                      */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+/* mkdtemp */
+#define _XOPEN_SOURCE 700
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "ft.h"
+
+/*
+  Tests FT_saveAsync, FT_saveWait and FT_load: saves a snapshot while
+  the tree goes on changing, loads it back and checks that it is the
+  tree as it was when the save started; then checks what loading
+  refuses, and that a snapshot cut short leaves the FT empty rather
+  than half loaded. Prints the tree along the way to stderr, and
+  removes its temporary directory at the end.
+*/
+
+/* Length of the largest file, whose contents span several of the
+   writer's buffers */
+enum { BIG_LENGTH = 200000 };
+
+/* Copies the first ulBytes bytes of the file pcFrom to the new file
+   pcTo */
+static void copyPrefix(const char *pcFrom, const char *pcTo,
+                       size_t ulBytes) {
+   FILE *psFrom, *psTo;
+   int iChar;
+
+   psFrom = fopen(pcFrom, "rb");
+   assert(psFrom != NULL);
+   psTo = fopen(pcTo, "wb");
+   assert(psTo != NULL);
+   for(; ulBytes > 0 && (iChar = getc(psFrom)) != EOF; ulBytes--)
+      assert(putc(iChar, psTo) != EOF);
+   assert(fclose(psFrom) == 0);
+   assert(fclose(psTo) == 0);
+}
+
+/* Checks that FT_toString gives exactly pcExpected */
+static void checkTree(const char *pcExpected) {
+   char *pcText;
+
+   assert((pcText = FT_toString()) != NULL);
+   assert(!strcmp(pcText, pcExpected));
+   free(pcText);
+}
+
+/* Runs the checks in a fresh temporary directory. Returns 0. */
+int main(void) {
+   char acDir[64], acSnap[96], acTemp[128], acBad[96], acNone[96];
+   char *pcBig, *pcBefore, *pcText;
+   struct stat sStat;
+   size_t ulIndex, ulSize;
+   boolean bIsFile;
+   FILE *psFile;
+
+   strcpy(acDir, "/tmp/snap_client.XXXXXX");
+   assert(mkdtemp(acDir) != NULL);
+   sprintf(acSnap, "%s/ft.snap", acDir);
+   sprintf(acTemp, "%s.tmp", acSnap);
+   sprintf(acBad, "%s/bad.snap", acDir);
+   sprintf(acNone, "%s/none.snap", acDir);
+
+   pcBig = malloc(BIG_LENGTH);
+   assert(pcBig != NULL);
+   for(ulIndex = 0; ulIndex < BIG_LENGTH; ulIndex++)
+      pcBig[ulIndex] = (char) (ulIndex * 7);
+
+   /* before the FT is initialized, and with nothing to wait for */
+   assert(FT_saveAsync(acSnap) == INITIALIZATION_ERROR);
+   assert(FT_load(acSnap) == INITIALIZATION_ERROR);
+   assert(FT_saveWait() == SUCCESS);
+
+   assert(FT_init() == SUCCESS);
+   assert(FT_insertDir("1root/2child") == SUCCESS);
+   assert(FT_insertFile("1root/2child/C", "Ritchie",
+                        strlen("Ritchie") + 1) == SUCCESS);
+   assert(FT_insertFile("1root/empty", NULL, 0) == SUCCESS);
+   assert(FT_insertFile("1root/big", pcBig, BIG_LENGTH) == SUCCESS);
+   assert(FT_insertDir("1root/2bare/3deep") == SUCCESS);
+   assert((pcBefore = FT_toString()) != NULL);
+   fprintf(stderr, "Checkpoint 1:\n%s\n", pcBefore);
+
+   /* the snapshot is the tree at FT_saveAsync, whatever changes
+      while it is written */
+   assert(FT_saveAsync(acSnap) == SUCCESS);
+   assert(FT_rmDir("1root/2child") == SUCCESS);
+   assert(FT_insertFile("1root/2bare/new", "Thompson",
+                        strlen("Thompson") + 1) == SUCCESS);
+   assert((pcText = FT_replaceFileContents("1root/big", "x", 1)) != NULL);
+   free(pcText);
+   assert(FT_saveWait() == SUCCESS);
+   assert(FT_saveWait() == SUCCESS);
+   assert(access(acSnap, F_OK) == 0);
+   assert(access(acTemp, F_OK) != 0);
+
+   assert((pcText = FT_toString()) != NULL);
+   fprintf(stderr, "Checkpoint 2:\n%s\n", pcText);
+   assert(strcmp(pcText, pcBefore) != 0);
+   free(pcText);
+   assert(FT_load(acSnap) == SUCCESS);
+   checkTree(pcBefore);
+   assert(FT_stat("1root/big", &bIsFile, &ulSize) == SUCCESS);
+   assert(bIsFile == TRUE && ulSize == BIG_LENGTH);
+   assert(!memcmp(FT_getFileContents("1root/big"), pcBig, BIG_LENGTH));
+   assert(FT_stat("1root/empty", &bIsFile, &ulSize) == SUCCESS);
+   assert(bIsFile == TRUE && ulSize == 0);
+
+   /* files that are not snapshots leave the FT as it was */
+   assert(FT_load(acNone) == NO_SUCH_PATH);
+   checkTree(pcBefore);
+   psFile = fopen(acBad, "wb");
+   assert(psFile != NULL);
+   assert(fputs("NOTASNAPSHOT", psFile) != EOF);
+   assert(fclose(psFile) == 0);
+   assert(FT_load(acBad) == BAD_PATH);
+   checkTree(pcBefore);
+
+   /* snapshots cut short, inside a file's contents and just before
+      the end marker, leave the FT empty */
+   assert(stat(acSnap, &sStat) == 0);
+   copyPrefix(acSnap, acBad, (size_t) sStat.st_size / 2);
+   assert(FT_load(acBad) == BAD_PATH);
+   checkTree("");
+   assert(FT_load(acSnap) == SUCCESS);
+   checkTree(pcBefore);
+   copyPrefix(acSnap, acBad, (size_t) sStat.st_size - 1);
+   assert(FT_load(acBad) == BAD_PATH);
+   checkTree("");
+   /* and still initialized */
+   assert(FT_insertDir("1root") == SUCCESS);
+
+   assert(FT_destroy() == SUCCESS);
+   assert(remove(acSnap) == 0);
+   assert(remove(acBad) == 0);
+   assert(rmdir(acDir) == 0);
+   free(pcBefore);
+   free(pcBig);
+   return 0;
+}
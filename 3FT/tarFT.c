@@ -0,0 +1,707 @@
+/*--------------------------------------------------------------------*/
+/* tarFT.c                                                            */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+/* writev(2) and read(2) are POSIX, not C99 */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include "ft.h"
+#include "tarFT.h"
+
+/* Bytes in a tar block; headers and padded data are whole blocks */
+enum { TAR_BLOCK = 512 };
+
+/* Offsets and widths of the ustar header fields used */
+enum {
+   TAR_NAME = 0, TAR_NAME_SIZE = 100,
+   TAR_MODE = 100, TAR_UID = 108, TAR_GID = 116, TAR_ID_SIZE = 8,
+   TAR_SIZE = 124, TAR_MTIME = 136, TAR_NUMBER_SIZE = 12,
+   TAR_CHKSUM = 148, TAR_CHKSUM_SIZE = 8,
+   TAR_TYPE = 156,
+   TAR_MAGIC = 257, TAR_VERSION = 263,
+   TAR_PREFIX = 345, TAR_PREFIX_SIZE = 155
+};
+
+/* The entry types handled */
+enum {
+   TAR_OLD_FILE = '\0', TAR_FILE = '0', TAR_CONTIGUOUS = '7',
+   TAR_DIR = '5', TAR_PAX = 'x', TAR_LONG_NAME = 'L'
+};
+
+/* Most bytes of pax or GNU long-name data read for one entry */
+enum { MAX_EXTENDED = 1 << 20 };
+
+/* Padding, and the end of an archive */
+static const unsigned char aucZeros[TAR_BLOCK];
+
+/* Returns the bytes of padding after ullSize bytes of data. */
+static size_t TarFT_padding(unsigned long long ullSize) {
+   return (size_t) ((TAR_BLOCK - ullSize % TAR_BLOCK) % TAR_BLOCK);
+}
+
+/*
+  Writes ullValue into the ulWidth bytes at pucField as octal digits
+  and a '\0', or, if it does not fit, in base 256 with the top bit of
+  the first byte set, as GNU tar and pax readers accept.
+*/
+static void TarFT_putNumber(unsigned char *pucField, size_t ulWidth,
+                            unsigned long long ullValue) {
+   size_t ulDigit = ulWidth - 1;
+
+   if(3 * ulDigit < sizeof(ullValue) * CHAR_BIT &&
+      (ullValue >> (3 * ulDigit)) != 0) {
+      for(ulDigit = ulWidth; ulDigit-- > 1; ) {
+         pucField[ulDigit] = (unsigned char) (ullValue & 0xff);
+         ullValue >>= 8;
+      }
+      pucField[0] = 0x80;
+      return;
+   }
+
+   pucField[ulDigit] = '\0';
+   while(ulDigit-- > 0) {
+      pucField[ulDigit] = (unsigned char) ('0' + (ullValue & 7));
+      ullValue >>= 3;
+   }
+}
+
+/*
+  Fills the block pucBlock with a ustar header for an entry of type
+  cType named pcName, with ullSize bytes of data. Returns TRUE, or
+  FALSE if pcName does not fit, even split between the prefix and
+  name fields, in which case the header holds its first bytes.
+*/
+static boolean TarFT_putHeader(unsigned char *pucBlock, const char *pcName,
+                               char cType, unsigned long long ullSize,
+                               unsigned long ulMtime) {
+   size_t ulLength = strlen(pcName), ulSplit, ulIndex;
+   unsigned long ulSum = 0;
+   boolean bFits = TRUE;
+
+   memset(pucBlock, 0, TAR_BLOCK);
+   if(ulLength <= TAR_NAME_SIZE)
+      memcpy(pucBlock + TAR_NAME, pcName, ulLength);
+   else {
+      /* the last '/' that leaves the prefix short enough */
+      ulSplit = ulLength - 2 < TAR_PREFIX_SIZE ? ulLength - 2
+                                               : TAR_PREFIX_SIZE;
+      while(ulSplit > 0 && pcName[ulSplit] != '/')
+         ulSplit--;
+      if(ulSplit > 0 && ulLength - ulSplit - 1 <= TAR_NAME_SIZE) {
+         memcpy(pucBlock + TAR_PREFIX, pcName, ulSplit);
+         memcpy(pucBlock + TAR_NAME, pcName + ulSplit + 1,
+                ulLength - ulSplit - 1);
+      }
+      else {
+         memcpy(pucBlock + TAR_NAME, pcName, TAR_NAME_SIZE);
+         bFits = FALSE;
+      }
+   }
+
+   TarFT_putNumber(pucBlock + TAR_MODE, TAR_ID_SIZE,
+                   cType == TAR_DIR ? 0755 : 0644);
+   TarFT_putNumber(pucBlock + TAR_UID, TAR_ID_SIZE, 0);
+   TarFT_putNumber(pucBlock + TAR_GID, TAR_ID_SIZE, 0);
+   TarFT_putNumber(pucBlock + TAR_SIZE, TAR_NUMBER_SIZE, ullSize);
+   TarFT_putNumber(pucBlock + TAR_MTIME, TAR_NUMBER_SIZE, ulMtime);
+   pucBlock[TAR_TYPE] = (unsigned char) cType;
+   memcpy(pucBlock + TAR_MAGIC, "ustar", 6);
+   memcpy(pucBlock + TAR_VERSION, "00", 2);
+
+   /* summed with the checksum field as spaces; 6 digits, '\0', ' ' */
+   memset(pucBlock + TAR_CHKSUM, ' ', TAR_CHKSUM_SIZE);
+   for(ulIndex = 0; ulIndex < TAR_BLOCK; ulIndex++)
+      ulSum += pucBlock[ulIndex];
+   TarFT_putNumber(pucBlock + TAR_CHKSUM, TAR_CHKSUM_SIZE - 1, ulSum);
+   pucBlock[TAR_CHKSUM + TAR_CHKSUM_SIZE - 1] = ' ';
+   return bFits;
+}
+
+/*
+  Returns a new pax extended header record setting the path to
+  pcName, storing its length in *pulLength, or NULL if memory could
+  not be allocated.
+*/
+static char *TarFT_paxPath(const char *pcName, size_t *pulLength) {
+   size_t ulBase, ulDigits = 1, ulPower = 10, ulTotal;
+   char *pcRecord;
+
+   /* "<length> path=<name>\n", where the length counts its own digits */
+   ulBase = strlen(" path=") + strlen(pcName) + 1;
+   ulTotal = ulBase + ulDigits;
+   while(ulTotal >= ulPower) {
+      ulDigits++;
+      ulPower *= 10;
+      ulTotal = ulBase + ulDigits;
+   }
+
+   pcRecord = malloc(ulTotal + 1);
+   if(pcRecord == NULL)
+      return NULL;
+   sprintf(pcRecord, "%lu path=%s\n", (unsigned long) ulTotal, pcName);
+   *pulLength = ulTotal;
+   return pcRecord;
+}
+
+/*
+  Writes the iCount buffers at psIov to iFd, going on after short
+  writes and interruptions. Updates psIov as it goes. Returns TRUE on
+  success and FALSE if a write fails.
+*/
+static boolean TarFT_writev(int iFd, struct iovec *psIov, int iCount) {
+   ssize_t lWritten;
+
+   while(iCount > 0) {
+      if(psIov->iov_len == 0) {
+         psIov++;
+         iCount--;
+         continue;
+      }
+      lWritten = writev(iFd, psIov, iCount);
+      if(lWritten < 0 && errno == EINTR)
+         continue;
+      if(lWritten <= 0)
+         return FALSE;
+      while(iCount > 0 && (size_t) lWritten >= psIov->iov_len) {
+         lWritten -= (ssize_t) psIov->iov_len;
+         psIov++;
+         iCount--;
+      }
+      if(iCount > 0) {
+         psIov->iov_base = (char *) psIov->iov_base + lWritten;
+         psIov->iov_len -= (size_t) lWritten;
+      }
+   }
+   return TRUE;
+}
+
+/* An archive being written by TarFT_export */
+struct tarExport {
+   int iFd;
+   /* the bytes of each path before its name in the archive */
+   size_t ulSkip;
+   unsigned long ulMtime;
+};
+
+/*
+  Writes the node pcPath, as FT_walk passes it, to the archive
+  pvExport. Returns SUCCESS, NO_SUCH_PATH or MEMORY_ERROR.
+*/
+static int TarFT_put(const char *pcPath, boolean bIsFile,
+                     const void *pvContents, size_t ulLength,
+                     void *pvExport) {
+   struct tarExport *psExport = pvExport;
+   unsigned char aucPaxHeader[TAR_BLOCK], aucHeader[TAR_BLOCK];
+   struct iovec asIov[6];
+   char *pcName, *pcPax = NULL;
+   size_t ulPaxLength = 0;
+   int iCount = 0;
+   boolean bWritten;
+
+   /* directories are named with a trailing '/' */
+   pcPath += psExport->ulSkip;
+   pcName = malloc(strlen(pcPath) + 2);
+   if(pcName == NULL)
+      return MEMORY_ERROR;
+   strcpy(pcName, pcPath);
+   if(!bIsFile)
+      strcat(pcName, "/");
+
+   if(!TarFT_putHeader(aucHeader, pcName, bIsFile ? TAR_FILE : TAR_DIR,
+                       ulLength, psExport->ulMtime)) {
+      pcPax = TarFT_paxPath(pcName, &ulPaxLength);
+      if(pcPax == NULL) {
+         free(pcName);
+         return MEMORY_ERROR;
+      }
+      (void) TarFT_putHeader(aucPaxHeader, "././@PaxHeader", TAR_PAX,
+                             ulPaxLength, psExport->ulMtime);
+      asIov[iCount].iov_base = aucPaxHeader;
+      asIov[iCount++].iov_len = TAR_BLOCK;
+      asIov[iCount].iov_base = pcPax;
+      asIov[iCount++].iov_len = ulPaxLength;
+      asIov[iCount].iov_base = (void *) aucZeros;
+      asIov[iCount++].iov_len = TarFT_padding(ulPaxLength);
+   }
+
+   /* the contents go from the FT's own copy, not through a buffer */
+   asIov[iCount].iov_base = aucHeader;
+   asIov[iCount++].iov_len = TAR_BLOCK;
+   asIov[iCount].iov_base = (void *) pvContents;
+   asIov[iCount++].iov_len = ulLength;
+   asIov[iCount].iov_base = (void *) aucZeros;
+   asIov[iCount++].iov_len = TarFT_padding(ulLength);
+   bWritten = TarFT_writev(psExport->iFd, asIov, iCount);
+
+   free(pcName);
+   free(pcPax);
+   return bWritten ? SUCCESS : NO_SUCH_PATH;
+}
+
+int TarFT_export(const char *pcTreePath, int iFd) {
+   struct tarExport sExport;
+   struct iovec asIov[2];
+   const char *pcSlash;
+   int iStatus;
+
+   assert(pcTreePath != NULL);
+
+   pcSlash = strrchr(pcTreePath, '/');
+   sExport.iFd = iFd;
+   sExport.ulSkip = pcSlash == NULL ? 0
+                                    : (size_t) (pcSlash - pcTreePath) + 1;
+   sExport.ulMtime = (unsigned long) time(NULL);
+
+   iStatus = FT_walk(pcTreePath, TarFT_put, &sExport);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   /* two zero blocks end the archive */
+   asIov[0].iov_base = (void *) aucZeros;
+   asIov[0].iov_len = TAR_BLOCK;
+   asIov[1] = asIov[0];
+   return TarFT_writev(iFd, asIov, 2) ? SUCCESS : NO_SUCH_PATH;
+}
+
+/*---------------------------------------------------------------*/
+
+/*
+  Reads ulLength bytes from iFd into pvData, going on after short
+  reads and interruptions. Returns SUCCESS, NO_SUCH_PATH if a read
+  fails, or BAD_PATH if iFd ends first.
+*/
+static int TarFT_read(int iFd, void *pvData, size_t ulLength) {
+   char *pcAt = pvData;
+   ssize_t lRead;
+
+   while(ulLength > 0) {
+      lRead = read(iFd, pcAt, ulLength);
+      if(lRead < 0 && errno == EINTR)
+         continue;
+      if(lRead < 0)
+         return NO_SUCH_PATH;
+      if(lRead == 0)
+         return BAD_PATH;
+      pcAt += lRead;
+      ulLength -= (size_t) lRead;
+   }
+   return SUCCESS;
+}
+
+/* Reads and drops ullLength bytes from iFd, as TarFT_read reads. */
+static int TarFT_skip(int iFd, unsigned long long ullLength) {
+   char acDiscard[4096];
+   size_t ulChunk;
+   int iStatus;
+
+   while(ullLength > 0) {
+      ulChunk = ullLength < sizeof(acDiscard) ? (size_t) ullLength
+                                              : sizeof(acDiscard);
+      iStatus = TarFT_read(iFd, acDiscard, ulChunk);
+      if(iStatus != SUCCESS)
+         return iStatus;
+      ullLength -= ulChunk;
+   }
+   return SUCCESS;
+}
+
+/*
+  Reads the number in the ulWidth bytes at pucField, octal or base
+  256, into *pullValue. Returns TRUE, or FALSE if it is malformed,
+  negative or too large.
+*/
+static boolean TarFT_getNumber(const unsigned char *pucField, size_t ulWidth,
+                               unsigned long long *pullValue) {
+   unsigned long long ullValue = 0;
+   size_t ulIndex = 0;
+
+   if(pucField[0] & 0x80) {
+      if(pucField[0] & 0x40)
+         return FALSE;
+      ullValue = pucField[0] & 0x3f;
+      for(ulIndex = 1; ulIndex < ulWidth; ulIndex++) {
+         if((ullValue >> 56) != 0)
+            return FALSE;
+         ullValue = ullValue << 8 | pucField[ulIndex];
+      }
+   }
+   else {
+      while(ulIndex < ulWidth && pucField[ulIndex] == ' ')
+         ulIndex++;
+      for(; ulIndex < ulWidth &&
+             pucField[ulIndex] >= '0' && pucField[ulIndex] <= '7'; ulIndex++) {
+         if((ullValue >> 61) != 0)
+            return FALSE;
+         ullValue = ullValue << 3 | (unsigned) (pucField[ulIndex] - '0');
+      }
+      if(ulIndex < ulWidth && pucField[ulIndex] != ' ' &&
+         pucField[ulIndex] != '\0')
+         return FALSE;
+   }
+
+   *pullValue = ullValue;
+   return TRUE;
+}
+
+/*
+  Returns TRUE if the checksum of the header pucBlock is right, summed
+  as unsigned bytes or, as some old writers did, as signed ones.
+*/
+static boolean TarFT_checksum(const unsigned char *pucBlock) {
+   unsigned long long ullStored;
+   unsigned long ulSum = 0;
+   long lSignedSum = 0;
+   unsigned char ucByte;
+   size_t ulIndex;
+
+   if(!TarFT_getNumber(pucBlock + TAR_CHKSUM, TAR_CHKSUM_SIZE, &ullStored))
+      return FALSE;
+   for(ulIndex = 0; ulIndex < TAR_BLOCK; ulIndex++) {
+      ucByte = ulIndex >= TAR_CHKSUM &&
+               ulIndex < TAR_CHKSUM + TAR_CHKSUM_SIZE ? ' ' : pucBlock[ulIndex];
+      ulSum += ucByte;
+      lSignedSum += (signed char) ucByte;
+   }
+   return (boolean) (ullStored == ulSum ||
+                     (lSignedSum >= 0 &&
+                      ullStored == (unsigned long) lSignedSum));
+}
+
+/* Returns the length of the string in the ulWidth bytes at pucField. */
+static size_t TarFT_fieldLength(const unsigned char *pucField,
+                                size_t ulWidth) {
+   size_t ulLength = 0;
+
+   while(ulLength < ulWidth && pucField[ulLength] != '\0')
+      ulLength++;
+   return ulLength;
+}
+
+/*
+  Returns a new string holding the name in the header pucBlock,
+  joined to its prefix in a POSIX ustar header, or NULL if memory
+  could not be allocated.
+*/
+static char *TarFT_headerName(const unsigned char *pucBlock) {
+   size_t ulName, ulPrefix = 0;
+   char *pcName;
+
+   ulName = TarFT_fieldLength(pucBlock + TAR_NAME, TAR_NAME_SIZE);
+   /* GNU's "ustar  " headers use the prefix bytes for other things */
+   if(memcmp(pucBlock + TAR_MAGIC, "ustar", 6) == 0)
+      ulPrefix = TarFT_fieldLength(pucBlock + TAR_PREFIX, TAR_PREFIX_SIZE);
+
+   pcName = malloc(ulPrefix + ulName + 2);
+   if(pcName == NULL)
+      return NULL;
+   memcpy(pcName, pucBlock + TAR_PREFIX, ulPrefix);
+   if(ulPrefix > 0)
+      pcName[ulPrefix++] = '/';
+   memcpy(pcName + ulPrefix, pucBlock + TAR_NAME, ulName);
+   pcName[ulPrefix + ulName] = '\0';
+   return pcName;
+}
+
+/*
+  Drops the empty and "." parts of the archive name pcName in place,
+  so "./a//b/" becomes "a/b"; a name for the top of the archive
+  becomes "". Returns FALSE if pcName has a ".." part, which would
+  name something outside the directory the archive is extracted
+  into; tar refuses such members too.
+*/
+static boolean TarFT_clean(char *pcName) {
+   const char *pcIn = pcName;
+   char *pcOut = pcName;
+   size_t ulPart;
+
+   while(*pcIn != '\0') {
+      ulPart = strcspn(pcIn, "/");
+      if(ulPart == 2 && strncmp(pcIn, "..", 2) == 0)
+         return FALSE;
+      if(ulPart > 1 || (ulPart == 1 && *pcIn != '.')) {
+         if(pcOut != pcName)
+            *pcOut++ = '/';
+         memmove(pcOut, pcIn, ulPart);
+         pcOut += ulPart;
+      }
+      pcIn += ulPart;
+      if(*pcIn == '/')
+         pcIn++;
+   }
+   *pcOut = '\0';
+   return TRUE;
+}
+
+/* What extended headers say about the entry after them */
+struct pending {
+   /* the entry's name, or NULL to take the one in its header */
+   char *pcName;
+   boolean bHasSize;
+   unsigned long long ullSize;
+};
+
+/*
+  Reads the pax extended header records in the ulLength bytes at
+  pcData into psPending, keeping "path" and "size" and ignoring the
+  rest. Returns SUCCESS, BAD_PATH if a record is malformed, or
+  MEMORY_ERROR.
+*/
+static int TarFT_parsePax(char *pcData, size_t ulLength,
+                          struct pending *psPending) {
+   size_t ulRecord, ulIndex;
+   char *pcKey, *pcValue;
+   unsigned long long ullSize;
+
+   while(ulLength > 0) {
+      /* "<length> <key>=<value>\n", the length counting it all */
+      ulRecord = 0;
+      for(ulIndex = 0; ulIndex < ulLength &&
+             pcData[ulIndex] >= '0' && pcData[ulIndex] <= '9'; ulIndex++) {
+         ulRecord = ulRecord * 10 + (size_t) (pcData[ulIndex] - '0');
+         if(ulRecord > ulLength)
+            return BAD_PATH;
+      }
+      if(ulIndex == 0 || ulIndex >= ulLength || pcData[ulIndex] != ' ' ||
+         ulRecord <= ulIndex + 1 || pcData[ulRecord - 1] != '\n')
+         return BAD_PATH;
+      pcData[ulRecord - 1] = '\0';
+      pcKey = pcData + ulIndex + 1;
+      pcValue = strchr(pcKey, '=');
+      if(pcValue == NULL)
+         return BAD_PATH;
+      *pcValue++ = '\0';
+
+      if(strcmp(pcKey, "path") == 0) {
+         free(psPending->pcName);
+         psPending->pcName = malloc(strlen(pcValue) + 1);
+         if(psPending->pcName == NULL)
+            return MEMORY_ERROR;
+         strcpy(psPending->pcName, pcValue);
+      }
+      else if(strcmp(pcKey, "size") == 0) {
+         for(ullSize = 0; *pcValue >= '0' && *pcValue <= '9'; pcValue++) {
+            if(ullSize > (ULLONG_MAX - 9) / 10)
+               return BAD_PATH;
+            ullSize = ullSize * 10 + (unsigned) (*pcValue - '0');
+         }
+         if(*pcValue != '\0')
+            return BAD_PATH;
+         psPending->bHasSize = TRUE;
+         psPending->ullSize = ullSize;
+      }
+
+      pcData += ulRecord;
+      ulLength -= ulRecord;
+   }
+   return SUCCESS;
+}
+
+/*
+  Reads the data of a pax or GNU long-name header, ullSize bytes and
+  the padding after them, from iFd into a new string in *ppcData.
+  Returns SUCCESS, or BAD_PATH if there is too much of it, or the
+  reasons TarFT_read gives, or MEMORY_ERROR.
+*/
+static int TarFT_readExtended(int iFd, unsigned long long ullSize,
+                              char **ppcData) {
+   char *pcData;
+   int iStatus;
+
+   if(ullSize > MAX_EXTENDED)
+      return BAD_PATH;
+   pcData = malloc((size_t) ullSize + 1);
+   if(pcData == NULL)
+      return MEMORY_ERROR;
+   iStatus = TarFT_read(iFd, pcData, (size_t) ullSize);
+   if(iStatus == SUCCESS)
+      iStatus = TarFT_skip(iFd, TarFT_padding(ullSize));
+   if(iStatus != SUCCESS) {
+      free(pcData);
+      return iStatus;
+   }
+   pcData[ullSize] = '\0';
+   *ppcData = pcData;
+   return SUCCESS;
+}
+
+/*
+  Returns a new string joining pcTreePath and the cleaned archive
+  name pcName with '/', or NULL if memory could not be allocated.
+*/
+static char *TarFT_join(const char *pcTreePath, const char *pcName) {
+   char *pcPath;
+
+   pcPath = malloc(strlen(pcTreePath) + strlen(pcName) + 2);
+   if(pcPath == NULL)
+      return NULL;
+   strcpy(pcPath, pcTreePath);
+   strcat(pcPath, "/");
+   strcat(pcPath, pcName);
+   return pcPath;
+}
+
+/*
+  Reads the ullSize bytes of a file entry, and its padding, from iFd,
+  and inserts them as the file pcPath, replacing any file already
+  there. Returns SUCCESS, the reasons TarFT_read gives, MEMORY_ERROR,
+  or the status of a failed insertion.
+*/
+static int TarFT_insertFile(int iFd, const char *pcPath,
+                            unsigned long long ullSize) {
+   void *pvContents = NULL;
+   int iStatus = SUCCESS;
+
+   if(ullSize > (size_t) -1)
+      return MEMORY_ERROR;
+   if(ullSize > 0) {
+      pvContents = malloc((size_t) ullSize);
+      if(pvContents == NULL)
+         return MEMORY_ERROR;
+      iStatus = TarFT_read(iFd, pvContents, (size_t) ullSize);
+   }
+   if(iStatus == SUCCESS)
+      iStatus = TarFT_skip(iFd, TarFT_padding(ullSize));
+
+   if(iStatus == SUCCESS) {
+      iStatus = FT_insertFile(pcPath, pvContents, (size_t) ullSize);
+      /* as with tar, a later copy of a file wins */
+      if(iStatus == ALREADY_IN_TREE && FT_containsFile(pcPath)) {
+         iStatus = FT_rmFile(pcPath);
+         if(iStatus == SUCCESS)
+            iStatus = FT_insertFile(pcPath, pvContents, (size_t) ullSize);
+      }
+   }
+   free(pvContents);
+   return iStatus;
+}
+
+/*
+  Inserts the entry of type cType named pcName (as TarFT_clean left
+  it), whose ullSize bytes of data come next on iFd, below
+  pcTreePath, and reads past its data. Returns SUCCESS or the first
+  problem, as TarFT_import does.
+*/
+static int TarFT_insert(int iFd, const char *pcTreePath, const char *pcName,
+                        char cType, unsigned long long ullSize) {
+   char *pcPath;
+   int iStatus = SUCCESS;
+
+   /* the top of the archive is pcTreePath itself */
+   if(*pcName == '\0')
+      return TarFT_skip(iFd, ullSize + TarFT_padding(ullSize));
+
+   pcPath = TarFT_join(pcTreePath, pcName);
+   if(pcPath == NULL)
+      return MEMORY_ERROR;
+
+   if(cType == TAR_FILE || cType == TAR_OLD_FILE || cType == TAR_CONTIGUOUS)
+      iStatus = TarFT_insertFile(iFd, pcPath, ullSize);
+   else {
+      if(cType == TAR_DIR) {
+         iStatus = FT_insertDir(pcPath);
+         if(iStatus == ALREADY_IN_TREE)
+            iStatus = SUCCESS;
+      }
+      if(iStatus == SUCCESS)
+         iStatus = TarFT_skip(iFd, ullSize + TarFT_padding(ullSize));
+   }
+
+   free(pcPath);
+   return iStatus;
+}
+
+int TarFT_import(int iFd, const char *pcTreePath) {
+   unsigned char aucBlock[TAR_BLOCK];
+   struct pending sPending;
+   unsigned long long ullSize;
+   char *pcName, *pcData;
+   size_t ulLength;
+   int iStatus;
+   char cType;
+
+   assert(pcTreePath != NULL);
+
+   iStatus = FT_insertDir(pcTreePath);
+   if(iStatus == ALREADY_IN_TREE)
+      iStatus = FT_containsDir(pcTreePath) ? SUCCESS : NOT_A_DIRECTORY;
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   sPending.pcName = NULL;
+   sPending.bHasSize = FALSE;
+   for(;;) {
+      iStatus = TarFT_read(iFd, aucBlock, TAR_BLOCK);
+      if(iStatus != SUCCESS)
+         break;
+      /* a zero block ends the archive; the second may be missing */
+      if(memcmp(aucBlock, aucZeros, TAR_BLOCK) == 0) {
+         if(TarFT_read(iFd, aucBlock, TAR_BLOCK) == NO_SUCH_PATH)
+            iStatus = NO_SUCH_PATH;
+         break;
+      }
+      if(!TarFT_checksum(aucBlock) ||
+         !TarFT_getNumber(aucBlock + TAR_SIZE, TAR_NUMBER_SIZE, &ullSize)) {
+         iStatus = BAD_PATH;
+         break;
+      }
+      cType = (char) aucBlock[TAR_TYPE];
+      if(sPending.bHasSize && cType != TAR_PAX && cType != TAR_LONG_NAME)
+         ullSize = sPending.ullSize;
+      /* so that the size and its padding can be added */
+      if(ullSize > ULLONG_MAX - TAR_BLOCK) {
+         iStatus = BAD_PATH;
+         break;
+      }
+
+      if(cType == TAR_PAX || cType == TAR_LONG_NAME) {
+         iStatus = TarFT_readExtended(iFd, ullSize, &pcData);
+         if(iStatus != SUCCESS)
+            break;
+         if(cType == TAR_PAX)
+            iStatus = TarFT_parsePax(pcData, (size_t) ullSize, &sPending);
+         else {
+            free(sPending.pcName);
+            sPending.pcName = pcData;
+            pcData = NULL;
+         }
+         free(pcData);
+         if(iStatus != SUCCESS)
+            break;
+         continue;
+      }
+
+      if(sPending.pcName != NULL)
+         pcName = sPending.pcName;
+      else if((pcName = TarFT_headerName(aucBlock)) == NULL) {
+         iStatus = MEMORY_ERROR;
+         break;
+      }
+      sPending.pcName = NULL;
+      sPending.bHasSize = FALSE;
+
+      /* before ustar, a directory was a file whose name ends in '/' */
+      ulLength = strlen(pcName);
+      if(cType == TAR_OLD_FILE && ulLength > 0 && pcName[ulLength - 1] == '/')
+         cType = TAR_DIR;
+      if(TarFT_clean(pcName))
+         iStatus = TarFT_insert(iFd, pcTreePath, pcName, cType, ullSize);
+      else
+         iStatus = BAD_PATH;
+      free(pcName);
+      if(iStatus != SUCCESS)
+         break;
+   }
+
+   free(sPending.pcName);
+   return iStatus;
+}
@@ -0,0 +1,55 @@
+/*--------------------------------------------------------------------*/
+/* tarFT.h                                                            */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+#ifndef TARFT_INCLUDED
+#define TARFT_INCLUDED
+
+#include "a4def.h"
+
+/*
+  Streaming subtrees of the FT to and from tar archives, the ustar
+  format with pax extended headers, over a file descriptor that may be
+  a pipe or socket. Neither direction goes through the real
+  filesystem, and neither holds more than one node's worth of data.
+*/
+
+/*
+  Writes the FT's node pcTreePath, and everything below it, to iFd as
+  a tar archive, named relative to pcTreePath's parent, as
+  "tar -C parent" would: exporting "a/b" gives "b/", "b/c" and so on.
+  Each node goes out with one writev(2) of its header and its
+  contents, straight from where the FT keeps them; names that do not
+  fit a ustar header get a pax header, and sizes that do not fit get
+  the base-256 size field. This runs inside FT_walk, so the tree stays
+  locked shared until the archive is written, and whatever reads iFd
+  must not be waiting on a change to the FT. Returns SUCCESS, or stops
+  at the first problem and returns:
+  * NO_SUCH_PATH if pcTreePath is not in the FT, or iFd could not be
+    written
+  * MEMORY_ERROR if memory could not be allocated
+  * the other reasons FT_walk gives for failing to walk pcTreePath
+*/
+int TarFT_export(const char *pcTreePath, int iFd);
+
+/*
+  Reads a tar archive from iFd, up to its end-of-archive block, and
+  inserts what it holds below pcTreePath (which may already exist), as
+  "tar -x -C" would. Regular files and directories are inserted;
+  links, special files and other entry types are skipped. pax "path"
+  and "size" records and GNU long names are honoured, and a later
+  file with the same name replaces an earlier one. Memory is bounded
+  by the largest file. Returns SUCCESS, or stops at the first problem,
+  keeping what was inserted before it, and returns:
+  * NO_SUCH_PATH if iFd could not be read
+  * BAD_PATH if the archive is malformed or ends early, or names a
+    member with a ".." part
+  * MEMORY_ERROR if memory could not be allocated
+  * the first status other than SUCCESS (or ALREADY_IN_TREE, for a
+    directory) that an insertion returned, or that FT_insertDir
+    returned for pcTreePath (NOT_A_DIRECTORY if it is a file)
+*/
+int TarFT_import(int iFd, const char *pcTreePath);
+
+#endif
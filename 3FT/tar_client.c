@@ -0,0 +1,178 @@
+/*--------------------------------------------------------------------*/
+/* tar_client.c                                                       */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+/* mkstemp and ftruncate */
+#define _XOPEN_SOURCE 700
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "tarFT.h"
+#include "ft.h"
+
+/*
+  Tests tarFT.c: exports a subtree of the FT, with a name too long
+  for a plain ustar header, to a temporary file, imports the archive
+  elsewhere in the FT and checks that it matches, then checks what
+  each direction refuses, including archives that end early and
+  members named outside the directory they are extracted into. Prints
+  the tree along the way to stderr.
+*/
+
+/* Length of the directory name that needs a pax header */
+enum { LONG_NAME = 150 };
+
+/* Length of the largest file, which spans many tar blocks */
+enum { BIG_LENGTH = 100000 };
+
+/* Checks that the FT's file pcPath holds the ulLength bytes at
+   pvContents */
+static void checkFile(const char *pcPath, const void *pvContents,
+                      size_t ulLength) {
+   boolean bIsFile;
+   size_t ulSize;
+
+   assert(FT_stat(pcPath, &bIsFile, &ulSize) == SUCCESS);
+   assert(bIsFile == TRUE && ulSize == ulLength);
+   assert(ulLength == 0 ||
+          !memcmp(FT_getFileContents(pcPath), pvContents, ulLength));
+}
+
+/*
+  Replaces what iFd holds with an archive of one regular file named
+  pcName, holding pcContents, written by hand as a ustar header, its
+  contents and the end-of-archive blocks, and seeks back to the start.
+*/
+static void writeArchive(int iFd, const char *pcName,
+                         const char *pcContents) {
+   unsigned char aucBlocks[4][512];
+   unsigned long ulSum = 0;
+   size_t ulIndex;
+
+   memset(aucBlocks, 0, sizeof(aucBlocks));
+   strcpy((char *) aucBlocks[0], pcName);
+   strcpy((char *) aucBlocks[0] + 100, "0000644");
+   strcpy((char *) aucBlocks[0] + 108, "0000000");
+   strcpy((char *) aucBlocks[0] + 116, "0000000");
+   sprintf((char *) aucBlocks[0] + 124, "%011lo",
+           (unsigned long) strlen(pcContents));
+   strcpy((char *) aucBlocks[0] + 136, "00000000000");
+   aucBlocks[0][156] = '0';
+   memcpy(aucBlocks[0] + 257, "ustar\0" "00", 8);
+   /* the checksum counts its own field as spaces */
+   memset(aucBlocks[0] + 148, ' ', 8);
+   for(ulIndex = 0; ulIndex < 512; ulIndex++)
+      ulSum += aucBlocks[0][ulIndex];
+   sprintf((char *) aucBlocks[0] + 148, "%06lo", ulSum);
+   aucBlocks[0][155] = ' ';
+   memcpy(aucBlocks[1], pcContents, strlen(pcContents));
+
+   assert(ftruncate(iFd, 0) == 0);
+   assert(lseek(iFd, 0, SEEK_SET) == 0);
+   assert(write(iFd, aucBlocks, sizeof(aucBlocks)) ==
+          (ssize_t) sizeof(aucBlocks));
+   assert(lseek(iFd, 0, SEEK_SET) == 0);
+}
+
+/* Runs the checks with an archive in a temporary file. Returns 0. */
+int main(void) {
+   char acFile[] = "/tmp/tar_client.XXXXXX";
+   char acLong[LONG_NAME + 1], acPath[2 * LONG_NAME];
+   char *pcBig, *pcText;
+   size_t ulIndex;
+   off_t lArchive;
+   int iFd;
+
+   iFd = mkstemp(acFile);
+   assert(iFd >= 0);
+   assert(unlink(acFile) == 0);
+
+   pcBig = malloc(BIG_LENGTH);
+   assert(pcBig != NULL);
+   for(ulIndex = 0; ulIndex < BIG_LENGTH; ulIndex++)
+      pcBig[ulIndex] = (char) (ulIndex * 7);
+   memset(acLong, 'l', LONG_NAME);
+   acLong[LONG_NAME] = '\0';
+
+   assert(FT_init() == SUCCESS);
+   assert(FT_insertDir("1root/src") == SUCCESS);
+   assert(FT_insertFile("1root/src/C", "Ritchie",
+                        strlen("Ritchie") + 1) == SUCCESS);
+   assert(FT_insertFile("1root/src/empty", NULL, 0) == SUCCESS);
+   assert(FT_insertDir("1root/src/bare") == SUCCESS);
+   assert(FT_insertFile("1root/src/sub/big", pcBig, BIG_LENGTH) ==
+          SUCCESS);
+   sprintf(acPath, "1root/src/%s/B", acLong);
+   assert(FT_insertFile(acPath, "Kernighan",
+                        strlen("Kernighan") + 1) == SUCCESS);
+
+   /* exported, the archive names the subtree after its last part */
+   assert(TarFT_export("1root/src", iFd) == SUCCESS);
+   lArchive = lseek(iFd, 0, SEEK_CUR);
+   assert(lArchive > BIG_LENGTH && lArchive % 512 == 0);
+   assert(lseek(iFd, 0, SEEK_SET) == 0);
+   assert(TarFT_import(iFd, "1root/copy") == SUCCESS);
+
+   checkFile("1root/copy/src/C", "Ritchie", strlen("Ritchie") + 1);
+   checkFile("1root/copy/src/empty", NULL, 0);
+   assert(FT_containsDir("1root/copy/src/bare") == TRUE);
+   checkFile("1root/copy/src/sub/big", pcBig, BIG_LENGTH);
+   sprintf(acPath, "1root/copy/src/%s/B", acLong);
+   checkFile(acPath, "Kernighan", strlen("Kernighan") + 1);
+
+   /* importing again replaces the files with the archive's */
+   assert((pcText = FT_replaceFileContents("1root/copy/src/C", "x", 1)) !=
+          NULL);
+   free(pcText);
+   assert(lseek(iFd, 0, SEEK_SET) == 0);
+   assert(TarFT_import(iFd, "1root/copy") == SUCCESS);
+   checkFile("1root/copy/src/C", "Ritchie", strlen("Ritchie") + 1);
+
+   /* archives that end early, in a header or in a file's contents,
+      and one that is empty */
+   assert(ftruncate(iFd, lArchive - 1024) == 0);
+   assert(lseek(iFd, 0, SEEK_SET) == 0);
+   assert(TarFT_import(iFd, "1root/cut") == BAD_PATH);
+   assert(ftruncate(iFd, BIG_LENGTH / 2) == 0);
+   assert(lseek(iFd, 0, SEEK_SET) == 0);
+   assert(TarFT_import(iFd, "1root/cut") == BAD_PATH);
+   assert(ftruncate(iFd, 0) == 0);
+   assert(lseek(iFd, 0, SEEK_SET) == 0);
+   assert(TarFT_import(iFd, "1root/cut") == BAD_PATH);
+
+   /* a member written by hand is read, but one that would climb out
+      of the directory it is extracted into is refused */
+   writeArchive(iFd, "./hand.txt", "hand");
+   assert(TarFT_import(iFd, "1root/x") == SUCCESS);
+   checkFile("1root/x/hand.txt", "hand", 4);
+   writeArchive(iFd, "../../escaped.txt", "out");
+   assert(TarFT_import(iFd, "1root/x") == BAD_PATH);
+   writeArchive(iFd, "a/../../escaped.txt", "out");
+   assert(TarFT_import(iFd, "1root/x") == BAD_PATH);
+   assert(FT_containsDir("1root/x/..") == FALSE);
+   assert(FT_containsDir("1root/x/a") == FALSE);
+   assert(FT_rmDir("1root/x") == SUCCESS);
+
+   /* what each direction refuses */
+   assert(TarFT_import(iFd, "1root/src/C") == NOT_A_DIRECTORY);
+   assert(TarFT_import(-1, "1root/cut") == NO_SUCH_PATH);
+   assert(TarFT_export("1root/none", iFd) == NO_SUCH_PATH);
+   assert(TarFT_export("1root/src", -1) == NO_SUCH_PATH);
+
+   assert(FT_rmDir("1root/copy/src/sub") == SUCCESS);
+   assert(FT_rmDir("1root/src") == SUCCESS);
+   assert(FT_rmDir("1root/cut") == SUCCESS);
+   assert((pcText = FT_toString()) != NULL);
+   fprintf(stderr, "Checkpoint 1:\n%s\n", pcText);
+   free(pcText);
+
+   assert(FT_destroy() == SUCCESS);
+   assert(close(iFd) == 0);
+   free(pcBig);
+   return 0;
+}
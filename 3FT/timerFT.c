@@ -0,0 +1,71 @@
+/*--------------------------------------------------------------------*/
+/* timerFT.c                                                          */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+/* clock_gettime is POSIX, not C99 */
+#define _POSIX_C_SOURCE 199309L
+
+#include <time.h>
+#include "timerFT.h"
+
+/* Fixed-point shift used for the nanoseconds-per-tick multiplier */
+enum { MULT_SHIFT = 20 };
+
+/* How long calibration spins for, in nanoseconds */
+static const unsigned long CALIBRATION_NANOS = 1000000UL;
+
+/* Nanoseconds per tick, scaled by 2^MULT_SHIFT; 0 until calibrated */
+static unsigned long ulNanosPerTick;
+
+unsigned long TimerFT_nanos(void) {
+   struct timespec sNow;
+
+   (void) clock_gettime(CLOCK_MONOTONIC, &sNow);
+   return (unsigned long) sNow.tv_sec * 1000000000UL +
+          (unsigned long) sNow.tv_nsec;
+}
+
+unsigned long TimerFT_ticks(void) {
+#if defined(__x86_64__)
+   return (unsigned long) __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+   unsigned long ulTicks;
+   __asm__ __volatile__("mrs %0, cntvct_el0" : "=r" (ulTicks));
+   return ulTicks;
+#else
+   return TimerFT_nanos();
+#endif
+}
+
+/*
+  Measures how many nanoseconds one tick lasts and returns it scaled
+  by 2^MULT_SHIFT.
+*/
+static unsigned long TimerFT_calibrate(void) {
+   unsigned long ulNanos0, ulTicks0, ulNanos, ulTicks;
+
+   ulNanos0 = TimerFT_nanos();
+   ulTicks0 = TimerFT_ticks();
+   do {
+      ulNanos = TimerFT_nanos();
+      ulTicks = TimerFT_ticks();
+   } while(ulNanos - ulNanos0 < CALIBRATION_NANOS);
+
+   if(ulTicks == ulTicks0)
+      return 1UL << MULT_SHIFT;
+   return ((ulNanos - ulNanos0) << MULT_SHIFT) / (ulTicks - ulTicks0);
+}
+
+unsigned long TimerFT_ticksToNanos(unsigned long ulTicks) {
+   unsigned long ulMult = __atomic_load_n(&ulNanosPerTick,
+                                          __ATOMIC_RELAXED);
+
+   /* concurrent first calls may both calibrate; either result is
+      fine to keep */
+   if(ulMult == 0) {
+      ulMult = TimerFT_calibrate();
+      __atomic_store_n(&ulNanosPerTick, ulMult, __ATOMIC_RELAXED);
+   }
+   return (ulTicks * ulMult) >> MULT_SHIFT;
+}
@@ -0,0 +1,30 @@
+/*--------------------------------------------------------------------*/
+/* timerFT.h                                                          */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+#ifndef TIMERFT_INCLUDED
+#define TIMERFT_INCLUDED
+
+/*
+  Returns the current value of a monotonic clock in nanoseconds.
+  Only differences between two readings are meaningful.
+*/
+unsigned long TimerFT_nanos(void);
+
+/*
+  Returns the current value of the CPU's cycle/tick counter (the TSC
+  on x86-64, CNTVCT_EL0 on AArch64), or TimerFT_nanos() on other
+  machines. This is much cheaper than TimerFT_nanos, but the tick
+  rate is only known after calibration; see TimerFT_ticksToNanos.
+*/
+unsigned long TimerFT_ticks(void);
+
+/*
+  Converts ulTicks, a difference between two TimerFT_ticks readings,
+  into nanoseconds. The first call calibrates the tick rate against
+  TimerFT_nanos, which takes about a millisecond.
+*/
+unsigned long TimerFT_ticksToNanos(unsigned long ulTicks);
+
+#endif
@@ -0,0 +1,209 @@
+/*--------------------------------------------------------------------*/
+/* traceFT.c                                                          */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "a4def.h"
+#include "timerFT.h"
+#include "traceFT.h"
+
+/* One recorded call */
+struct event {
+   /* tick at which the call started */
+   unsigned long ulStart;
+   /* length of the call in ticks */
+   unsigned long ulTicks;
+   /* FNV-1a hash of the call's path, 0 if it had none */
+   unsigned long ulPathHash;
+   /* number of components in the call's path, 0 if it had none */
+   unsigned int uiDepth;
+   /* the call's result, as described in traceFT.h */
+   int iResult;
+   /* which operation was called */
+   enum OpFT eOp;
+};
+
+/* The ring buffer of one thread */
+struct ring {
+   /* the thread's most recent events, oldest overwritten first */
+   struct event asEvents[TRACEFT_RING_SIZE];
+   /* total number of events ever recorded into this ring */
+   unsigned long ulRecorded;
+   /* small sequential identifier, reported as the thread's tid */
+   unsigned long ulTid;
+   /* next ring in the global list of all rings */
+   struct ring *psNext;
+};
+
+/* Head of the list of every thread's ring; rings are never freed */
+static struct ring *psRings;
+
+/* Number of rings created so far, used to hand out tids */
+static unsigned long ulRingCount;
+
+/* This thread's ring, or NULL if it has not recorded yet */
+static __thread struct ring *psMyRing;
+
+/*
+  Computes the FNV-1a hash of pcPath and stores its depth (one more
+  than the number of '/' delimiters) in *puiDepth.
+*/
+static unsigned long TraceFT_hashPath(const char *pcPath,
+                                      unsigned int *puiDepth) {
+   unsigned long ulHash = 14695981039346656037UL;
+   unsigned int uiDepth = 1;
+
+   assert(pcPath != NULL);
+   assert(puiDepth != NULL);
+
+   for(; *pcPath != '\0'; pcPath++) {
+      if(*pcPath == '/')
+         uiDepth++;
+      ulHash ^= (unsigned char) *pcPath;
+      ulHash *= 1099511628211UL;
+   }
+   *puiDepth = uiDepth;
+   return ulHash;
+}
+
+/*
+  Returns this thread's ring, creating and publishing one on first
+  use, or NULL if memory could not be allocated.
+*/
+static struct ring *TraceFT_myRing(void) {
+   struct ring *psRing;
+
+   if(psMyRing != NULL)
+      return psMyRing;
+
+   psRing = calloc(1, sizeof(struct ring));
+   if(psRing == NULL)
+      return NULL;
+
+   psRing->ulTid = __atomic_add_fetch(&ulRingCount, 1,
+                                      __ATOMIC_RELAXED);
+   psRing->psNext = __atomic_load_n(&psRings, __ATOMIC_RELAXED);
+   while(!__atomic_compare_exchange_n(&psRings, &psRing->psNext,
+                                      psRing, 0, __ATOMIC_RELEASE,
+                                      __ATOMIC_RELAXED))
+      ;
+   psMyRing = psRing;
+   return psRing;
+}
+
+void TraceFT_record(enum OpFT eOp, unsigned long ulStart,
+                    unsigned long ulEnd, const char *pcPath,
+                    int iResult) {
+   struct ring *psRing;
+   struct event *psEvent;
+
+   psRing = TraceFT_myRing();
+   if(psRing == NULL)
+      return;
+
+   psEvent = &psRing->asEvents[psRing->ulRecorded % TRACEFT_RING_SIZE];
+   psEvent->ulStart = ulStart;
+   psEvent->ulTicks = ulEnd - ulStart;
+   psEvent->eOp = eOp;
+   psEvent->iResult = iResult;
+   if(pcPath != NULL)
+      psEvent->ulPathHash = TraceFT_hashPath(pcPath, &psEvent->uiDepth);
+   else {
+      psEvent->ulPathHash = 0;
+      psEvent->uiDepth = 0;
+   }
+
+   /* publish the event only after it is completely written */
+   __atomic_store_n(&psRing->ulRecorded, psRing->ulRecorded + 1,
+                    __ATOMIC_RELEASE);
+}
+
+/*
+  Stores in *pulFirst and *pulLast the range of event sequence
+  numbers that psRing still holds. Returns FALSE if it holds none.
+*/
+static boolean TraceFT_ringRange(struct ring *psRing,
+                                 unsigned long *pulFirst,
+                                 unsigned long *pulLast) {
+   unsigned long ulRecorded;
+
+   assert(psRing != NULL);
+   assert(pulFirst != NULL);
+   assert(pulLast != NULL);
+
+   ulRecorded = __atomic_load_n(&psRing->ulRecorded, __ATOMIC_ACQUIRE);
+   if(ulRecorded == 0)
+      return FALSE;
+
+   *pulLast = ulRecorded;
+   if(ulRecorded > TRACEFT_RING_SIZE)
+      *pulFirst = ulRecorded - TRACEFT_RING_SIZE;
+   else
+      *pulFirst = 0;
+   return TRUE;
+}
+
+unsigned long TraceFT_dump(FILE *psFile) {
+   struct ring *psRing;
+   unsigned long ulFirst, ulLast, ulSeq;
+   unsigned long ulBase = 0;
+   boolean bHaveBase = FALSE;
+   unsigned long ulWritten = 0;
+
+   assert(psFile != NULL);
+
+   /* timestamps are reported relative to the earliest event */
+   for(psRing = __atomic_load_n(&psRings, __ATOMIC_ACQUIRE);
+       psRing != NULL; psRing = psRing->psNext) {
+      if(!TraceFT_ringRange(psRing, &ulFirst, &ulLast))
+         continue;
+      for(ulSeq = ulFirst; ulSeq < ulLast; ulSeq++) {
+         struct event *psEvent =
+            &psRing->asEvents[ulSeq % TRACEFT_RING_SIZE];
+         if(!bHaveBase || psEvent->ulStart < ulBase) {
+            ulBase = psEvent->ulStart;
+            bHaveBase = TRUE;
+         }
+      }
+   }
+
+   fprintf(psFile, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+   for(psRing = __atomic_load_n(&psRings, __ATOMIC_ACQUIRE);
+       psRing != NULL; psRing = psRing->psNext) {
+      if(!TraceFT_ringRange(psRing, &ulFirst, &ulLast))
+         continue;
+      for(ulSeq = ulFirst; ulSeq < ulLast; ulSeq++) {
+         struct event *psEvent =
+            &psRing->asEvents[ulSeq % TRACEFT_RING_SIZE];
+         unsigned long ulTs, ulDur;
+
+         ulTs = TimerFT_ticksToNanos(psEvent->ulStart - ulBase);
+         ulDur = TimerFT_ticksToNanos(psEvent->ulTicks);
+         fprintf(psFile,
+                 "%s\n{\"name\":\"%s\",\"cat\":\"ft\",\"ph\":\"X\","
+                 "\"ts\":%lu.%03lu,\"dur\":%lu.%03lu,\"pid\":1,"
+                 "\"tid\":%lu,\"args\":{\"path_hash\":\"%016lx\","
+                 "\"depth\":%u,\"result\":%d}}",
+                 ulWritten == 0 ? "" : ",",
+                 OpFT_name(psEvent->eOp),
+                 ulTs / 1000, ulTs % 1000, ulDur / 1000, ulDur % 1000,
+                 psRing->ulTid, psEvent->ulPathHash, psEvent->uiDepth,
+                 psEvent->iResult);
+         ulWritten++;
+      }
+   }
+   fprintf(psFile, "\n]}\n");
+
+   return ulWritten;
+}
+
+void TraceFT_reset(void) {
+   struct ring *psRing;
+
+   for(psRing = __atomic_load_n(&psRings, __ATOMIC_ACQUIRE);
+       psRing != NULL; psRing = psRing->psNext)
+      __atomic_store_n(&psRing->ulRecorded, 0, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,45 @@
+/*--------------------------------------------------------------------*/
+/* traceFT.h                                                          */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+#ifndef TRACEFT_INCLUDED
+#define TRACEFT_INCLUDED
+
+#include <stdio.h>
+#include "opFT.h"
+
+/*
+  Operation tracing for the FT. When ft.c is compiled with -DFT_TRACE,
+  every public FT call is recorded into a ring buffer owned by the
+  calling thread: its start tick, duration, a hash and the depth of
+  its path, and its result. Each ring keeps the most recent
+  TRACEFT_RING_SIZE calls of its thread; older ones are overwritten.
+*/
+
+enum { TRACEFT_RING_SIZE = 8192 };
+
+/*
+  Records one call of operation eOp on path pcPath (which may be NULL
+  for operations without a path) that ran from tick ulStart to tick
+  ulEnd (see TimerFT_ticks) and produced iResult: a status code for
+  int operations, TRUE/FALSE for boolean ones, and whether the result
+  was non-NULL for pointer ones.
+*/
+void TraceFT_record(enum OpFT eOp, unsigned long ulStart,
+                    unsigned long ulEnd, const char *pcPath,
+                    int iResult);
+
+/*
+  Writes every recorded call of every thread to psFile in Chrome's
+  trace_event JSON format (loadable in chrome://tracing or Perfetto),
+  with timestamps in microseconds relative to the earliest call.
+  Calls recorded while the dump runs may or may not be included.
+  Returns the number of events written.
+*/
+unsigned long TraceFT_dump(FILE *psFile);
+
+/* Discards the contents of every thread's ring. */
+void TraceFT_reset(void);
+
+#endif
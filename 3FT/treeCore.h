@@ -0,0 +1 @@
+../0shared/treeCore.h
\ No newline at end of file
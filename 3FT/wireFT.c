@@ -0,0 +1,231 @@
+/*--------------------------------------------------------------------*/
+/* wireFT.c                                                           */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wireFT.h"
+
+/* Size of a buffer's first allocation */
+enum { INITIAL_BUFFER = 4096 };
+
+int WireFT_reserve(struct WireFT_Buffer *psBuffer, size_t ulMore) {
+   size_t ulSize;
+   char *pcData;
+
+   assert(psBuffer != NULL);
+
+   if(psBuffer->ulSize - psBuffer->ulHead - psBuffer->ulLength >= ulMore)
+      return TRUE;
+   if(ulMore > (size_t) -1 / 2 - psBuffer->ulLength)
+      return FALSE;
+
+   /* slide back if that moves no more than was consumed, or to grow */
+   if(psBuffer->ulHead > 0 &&
+      (psBuffer->ulHead >= psBuffer->ulLength ||
+       psBuffer->ulSize - psBuffer->ulLength < ulMore)) {
+      memmove(psBuffer->pcData, psBuffer->pcData + psBuffer->ulHead,
+              psBuffer->ulLength);
+      psBuffer->ulHead = 0;
+      if(psBuffer->ulSize - psBuffer->ulLength >= ulMore)
+         return TRUE;
+   }
+
+   ulSize = psBuffer->ulSize == 0 ? INITIAL_BUFFER : psBuffer->ulSize;
+   while(ulSize - psBuffer->ulHead - psBuffer->ulLength < ulMore)
+      ulSize *= 2;
+   pcData = realloc(psBuffer->pcData, ulSize);
+   if(pcData == NULL)
+      return FALSE;
+   psBuffer->pcData = pcData;
+   psBuffer->ulSize = ulSize;
+   return TRUE;
+}
+
+int WireFT_append(struct WireFT_Buffer *psBuffer, const void *pvData,
+                  size_t ulLength) {
+   assert(psBuffer != NULL);
+   assert(pvData != NULL || ulLength == 0);
+
+   if(!WireFT_reserve(psBuffer, ulLength))
+      return FALSE;
+   if(ulLength > 0)
+      memcpy(psBuffer->pcData + psBuffer->ulHead + psBuffer->ulLength,
+             pvData, ulLength);
+   psBuffer->ulLength += ulLength;
+   return TRUE;
+}
+
+void WireFT_consume(struct WireFT_Buffer *psBuffer, size_t ulLength) {
+   assert(psBuffer != NULL);
+   assert(ulLength <= psBuffer->ulLength);
+
+   psBuffer->ulLength -= ulLength;
+   psBuffer->ulHead = psBuffer->ulLength == 0 ? 0
+                                              : psBuffer->ulHead + ulLength;
+}
+
+void WireFT_free(struct WireFT_Buffer *psBuffer) {
+   assert(psBuffer != NULL);
+
+   free(psBuffer->pcData);
+   psBuffer->pcData = NULL;
+   psBuffer->ulLength = 0;
+   psBuffer->ulSize = 0;
+   psBuffer->ulHead = 0;
+}
+
+int WireFT_beginFrame(struct WireFT_Buffer *psBuffer, uint32_t uiTag,
+                      size_t *pulStart) {
+   struct WireFT_Header sHeader;
+
+   assert(psBuffer != NULL);
+   assert(pulStart != NULL);
+
+   sHeader.uiLength = 0;
+   sHeader.uiTag = uiTag;
+   sHeader.uiCount = 0;
+   *pulStart = psBuffer->ulLength;
+   return WireFT_append(psBuffer, &sHeader, sizeof(sHeader));
+}
+
+int WireFT_endFrame(struct WireFT_Buffer *psBuffer, size_t ulStart,
+                    uint32_t uiCount) {
+   struct WireFT_Header sHeader;
+   size_t ulBody;
+
+   assert(psBuffer != NULL);
+   assert(ulStart + sizeof(sHeader) <= psBuffer->ulLength);
+
+   ulBody = psBuffer->ulLength - ulStart - sizeof(sHeader);
+   if(ulBody > WIREFT_MAX_FRAME)
+      return FALSE;
+   memcpy(&sHeader, psBuffer->pcData + psBuffer->ulHead + ulStart,
+          sizeof(sHeader));
+   sHeader.uiLength = (uint32_t) ulBody;
+   sHeader.uiCount = uiCount;
+   memcpy(psBuffer->pcData + psBuffer->ulHead + ulStart, &sHeader,
+          sizeof(sHeader));
+   return TRUE;
+}
+
+size_t WireFT_frameLength(const struct WireFT_Buffer *psBuffer,
+                          struct WireFT_Header *psHeader) {
+   struct WireFT_Header sHeader;
+
+   assert(psBuffer != NULL);
+   assert(psHeader != NULL);
+
+   if(psBuffer->ulLength < sizeof(sHeader))
+      return 0;
+   memcpy(&sHeader, psBuffer->pcData + psBuffer->ulHead, sizeof(sHeader));
+   if(sHeader.uiLength > WIREFT_MAX_FRAME)
+      return (size_t) -1;
+   if(psBuffer->ulLength - sizeof(sHeader) < sHeader.uiLength)
+      return 0;
+   *psHeader = sHeader;
+   return sizeof(sHeader) + sHeader.uiLength;
+}
+
+int WireFT_putRequest(struct WireFT_Buffer *psBuffer, enum OpFT eOp,
+                      const char *pcPath, const void *pvContents,
+                      size_t ulLength) {
+   struct WireFT_Request sRequest;
+   size_t ulPathLength = pcPath == NULL ? 0 : strlen(pcPath) + 1;
+
+   assert(psBuffer != NULL);
+
+   if(ulPathLength > WIREFT_MAX_FRAME)
+      return FALSE;
+   sRequest.uiOp = (uint32_t) eOp;
+   sRequest.uiPathLength = (uint32_t) ulPathLength;
+   sRequest.ulLength = ulLength;
+   return WireFT_reserve(psBuffer, sizeof(sRequest) + ulPathLength +
+                                   ulLength) &&
+          WireFT_append(psBuffer, &sRequest, sizeof(sRequest)) &&
+          WireFT_append(psBuffer, pcPath, ulPathLength) &&
+          WireFT_append(psBuffer, pvContents, ulLength);
+}
+
+int WireFT_getRequest(const char **ppcAt, const char *pcEnd,
+                      enum OpFT *peOp, const char **ppcPath,
+                      const void **ppvContents, size_t *pulLength) {
+   struct WireFT_Request sRequest;
+   const char *pcAt;
+
+   assert(ppcAt != NULL && *ppcAt != NULL);
+   assert(pcEnd != NULL);
+   assert(peOp != NULL);
+   assert(ppcPath != NULL);
+   assert(ppvContents != NULL);
+   assert(pulLength != NULL);
+
+   pcAt = *ppcAt;
+   if((size_t) (pcEnd - pcAt) < sizeof(sRequest))
+      return FALSE;
+   memcpy(&sRequest, pcAt, sizeof(sRequest));
+   pcAt += sizeof(sRequest);
+
+   if(sRequest.uiOp >= OPFT_COUNT ||
+      sRequest.uiPathLength > (size_t) (pcEnd - pcAt) ||
+      sRequest.ulLength > (size_t) (pcEnd - pcAt) - sRequest.uiPathLength)
+      return FALSE;
+   /* the path must end with, and hold no other, '\0' */
+   if(sRequest.uiPathLength > 0 &&
+      memchr(pcAt, '\0', sRequest.uiPathLength) !=
+         pcAt + sRequest.uiPathLength - 1)
+      return FALSE;
+
+   *peOp = (enum OpFT) sRequest.uiOp;
+   *ppcPath = sRequest.uiPathLength > 0 ? pcAt : NULL;
+   pcAt += sRequest.uiPathLength;
+   *ppvContents = sRequest.ulLength > 0 ? pcAt : NULL;
+   *pulLength = (size_t) sRequest.ulLength;
+   *ppcAt = pcAt + sRequest.ulLength;
+   return TRUE;
+}
+
+int WireFT_putResult(struct WireFT_Buffer *psBuffer, int iStatus,
+                     uint32_t uiFlags, const void *pvData,
+                     size_t ulLength) {
+   struct WireFT_Result sResult;
+   size_t ulData = (uiFlags & WIREFT_DATA) ? ulLength : 0;
+
+   assert(psBuffer != NULL);
+
+   sResult.iStatus = (int32_t) iStatus;
+   sResult.uiFlags = uiFlags;
+   sResult.ulLength = ulLength;
+   return WireFT_reserve(psBuffer, sizeof(sResult) + ulData) &&
+          WireFT_append(psBuffer, &sResult, sizeof(sResult)) &&
+          WireFT_append(psBuffer, pvData, ulData);
+}
+
+int WireFT_getResult(const char **ppcAt, const char *pcEnd,
+                     struct WireFT_Result *psResult,
+                     const void **ppvData) {
+   const char *pcAt;
+
+   assert(ppcAt != NULL && *ppcAt != NULL);
+   assert(pcEnd != NULL);
+   assert(psResult != NULL);
+   assert(ppvData != NULL);
+
+   pcAt = *ppcAt;
+   if((size_t) (pcEnd - pcAt) < sizeof(*psResult))
+      return FALSE;
+   memcpy(psResult, pcAt, sizeof(*psResult));
+   pcAt += sizeof(*psResult);
+
+   *ppvData = NULL;
+   if(psResult->uiFlags & WIREFT_DATA) {
+      if(psResult->ulLength > (size_t) (pcEnd - pcAt))
+         return FALSE;
+      *ppvData = pcAt;
+      pcAt += psResult->ulLength;
+   }
+   *ppcAt = pcAt;
+   return TRUE;
+}
@@ -0,0 +1,181 @@
+/*--------------------------------------------------------------------*/
+/* wireFT.h                                                           */
+/* Author: anish                                                      */
+/*--------------------------------------------------------------------*/
+
+#ifndef WIREFT_INCLUDED
+#define WIREFT_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include "a4def.h"
+#include "opFT.h"
+
+/*
+  The protocol that ftd speaks with ftclient over a Unix domain
+  socket. Both ends are on one host, so every number is in host byte
+  order.
+
+  The client sends frames, each a WireFT_Header followed by ulCount
+  requests. A request is a WireFT_Request followed by its path,
+  including the terminating '\0' (uiPathLength counts it; 0 for
+  operations without a path), and then by ulLength bytes of contents
+  (for FT_insertFile and FT_replaceFileContents; 0 otherwise).
+
+  For every frame the server sends back one frame with the same tag
+  and count, holding a WireFT_Result per request, in order, each
+  followed by its ulLength bytes of data if WIREFT_DATA is set. A
+  client may send any number of frames before reading any results
+  (pipelining); the server runs one connection's frames in the order
+  they arrive and answers them in that order.
+
+  Results, by operation:
+    FT_containsDir, FT_containsFile
+                   iStatus is the boolean result
+    FT_getFileContents, FT_replaceFileContents
+                   iStatus is SUCCESS or the reason for failure; the
+                   data is the (old) contents, and WIREFT_DATA is
+                   clear if they are NULL
+    FT_stat        iStatus as FT_stat returns; WIREFT_IS_FILE, with
+                   the size in ulLength, if the path is a file
+    FT_toString    the string, without its '\0', as data; WIREFT_DATA
+                   is clear if FT_toString returned NULL
+    otherwise      iStatus is the status the function returned
+*/
+
+/* The start of every frame */
+struct WireFT_Header {
+   /* bytes in the frame after this header */
+   uint32_t uiLength;
+   /* chosen by the client and echoed in the response */
+   uint32_t uiTag;
+   /* number of requests, or results, in the frame */
+   uint32_t uiCount;
+};
+
+/* The start of each request */
+struct WireFT_Request {
+   /* an enum OpFT */
+   uint32_t uiOp;
+   /* length of the path, counting its '\0', or 0 */
+   uint32_t uiPathLength;
+   /* length of the contents that follow the path */
+   uint64_t ulLength;
+};
+
+/* The start of each result */
+struct WireFT_Result {
+   int32_t iStatus;
+   /* WIREFT_IS_FILE and WIREFT_DATA */
+   uint32_t uiFlags;
+   /* length of the data that follows, or a file's size for FT_stat */
+   uint64_t ulLength;
+};
+
+/* Bits of WireFT_Result.uiFlags */
+enum { WIREFT_IS_FILE = 1, WIREFT_DATA = 2 };
+
+/* Longest frame either end accepts, after the header */
+#define WIREFT_MAX_FRAME ((uint32_t) 1 << 30)
+
+/*
+  A growable byte buffer holding frames being built or received.
+  Consuming only advances ulHead; the bytes in use are slid back to
+  the start of the allocation when more room is wanted and the
+  consumed bytes before them are at least as many, so that each byte
+  moves a bounded number of times however many frames go through.
+*/
+struct WireFT_Buffer {
+   char *pcData;
+   /* bytes in use, starting at pcData + ulHead */
+   size_t ulLength;
+   /* bytes allocated */
+   size_t ulSize;
+   /* bytes consumed at the start of the allocation */
+   size_t ulHead;
+};
+
+/*
+  Makes room in psBuffer for ulMore bytes past its end, that is past
+  pcData + ulHead + ulLength. Returns TRUE, or FALSE if memory could
+  not be allocated.
+*/
+int WireFT_reserve(struct WireFT_Buffer *psBuffer, size_t ulMore);
+
+/*
+  Appends the ulLength bytes at pvData to psBuffer. Returns TRUE, or
+  FALSE if memory could not be allocated.
+*/
+int WireFT_append(struct WireFT_Buffer *psBuffer, const void *pvData,
+                  size_t ulLength);
+
+/* Drops the first ulLength bytes of psBuffer. */
+void WireFT_consume(struct WireFT_Buffer *psBuffer, size_t ulLength);
+
+/* Frees psBuffer's storage and empties it. */
+void WireFT_free(struct WireFT_Buffer *psBuffer);
+
+/*
+  Starts a frame with tag uiTag at the end of psBuffer and stores its
+  offset from the first byte in use in *pulStart, for WireFT_endFrame. Returns TRUE, or FALSE if
+  memory could not be allocated.
+*/
+int WireFT_beginFrame(struct WireFT_Buffer *psBuffer, uint32_t uiTag,
+                      size_t *pulStart);
+
+/*
+  Finishes the frame begun at offset ulStart of psBuffer, which holds
+  uiCount requests or results. Returns TRUE, or FALSE if the frame is
+  longer than WIREFT_MAX_FRAME.
+*/
+int WireFT_endFrame(struct WireFT_Buffer *psBuffer, size_t ulStart,
+                    uint32_t uiCount);
+
+/*
+  Returns the total length of the frame at the start of psBuffer if
+  all of it has arrived, 0 if not yet, or (size_t) -1 if its header
+  is invalid. Stores its header in *psHeader when it returns a length.
+*/
+size_t WireFT_frameLength(const struct WireFT_Buffer *psBuffer,
+                          struct WireFT_Header *psHeader);
+
+/*
+  Appends a request for operation eOp on pcPath (NULL for none) with
+  the ulLength bytes of contents at pvContents. Returns TRUE, or FALSE
+  if memory could not be allocated.
+*/
+int WireFT_putRequest(struct WireFT_Buffer *psBuffer, enum OpFT eOp,
+                      const char *pcPath, const void *pvContents,
+                      size_t ulLength);
+
+/*
+  Reads the request at *ppcAt, which must end by pcEnd, into *peOp,
+  *ppcPath (NULL for none), *ppvContents and *pulLength, all pointing
+  into the frame, and advances *ppcAt past it. Returns TRUE, or FALSE
+  if the request is malformed.
+*/
+int WireFT_getRequest(const char **ppcAt, const char *pcEnd,
+                      enum OpFT *peOp, const char **ppcPath,
+                      const void **ppvContents, size_t *pulLength);
+
+/*
+  Appends a result with status iStatus and flags uiFlags. If uiFlags
+  has WIREFT_DATA, the ulLength bytes at pvData follow it; otherwise
+  ulLength is only recorded (as FT_stat's size). Returns TRUE, or
+  FALSE if memory could not be allocated.
+*/
+int WireFT_putResult(struct WireFT_Buffer *psBuffer, int iStatus,
+                     uint32_t uiFlags, const void *pvData,
+                     size_t ulLength);
+
+/*
+  Reads the result at *ppcAt, which must end by pcEnd, into *psResult
+  and *ppvData (pointing into the frame, or NULL if it has no data),
+  and advances *ppcAt past it. Returns TRUE, or FALSE if the result
+  is malformed.
+*/
+int WireFT_getResult(const char **ppcAt, const char *pcEnd,
+                     struct WireFT_Result *psResult,
+                     const void **ppvData);
+
+#endif